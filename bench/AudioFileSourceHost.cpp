@@ -0,0 +1,48 @@
+/*
+  AudioFileSourceHost
+  Fuente de audio sobre un fichero del PC
+*/
+
+#include <chrono>
+#include <thread>
+#include "AudioFileSourceHost.h"
+#include "Telemetry.h"
+
+bool AudioFileSourceHost::open(const char *filename)
+{
+  close();
+  f = fopen(filename, "rb");
+  if (!f) return false;
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  reads = 0;
+  seeks = 0;
+  return true;
+}
+
+uint32_t AudioFileSourceHost::read(void *data, uint32_t len)
+{
+  if (!f) return 0;
+  TELEMETRY_SCOPE(sourceRead);
+  reads++;
+  if (slowUs && reads % slowEvery == 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(slowUs));
+  }
+  return fread(data, 1, len, f);
+}
+
+bool AudioFileSourceHost::seek(int32_t pos, int dir)
+{
+  if (!f) return false;
+  seeks++;
+  return fseek(f, pos, dir) == 0;
+}
+
+bool AudioFileSourceHost::close()
+{
+  if (f) fclose(f);
+  f = nullptr;
+  size = 0;
+  return true;
+}
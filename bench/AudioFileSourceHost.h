@@ -0,0 +1,38 @@
+/*
+  AudioFileSourceHost
+  Sustituto de la fuente SD para el entorno native: lee un fichero del PC con stdio.
+  Puede simular una tarjeta lenta retrasando una de cada N lecturas.
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include "AudioFileSource.h"
+
+class AudioFileSourceHost : public AudioFileSource
+{
+  public:
+    AudioFileSourceHost() {}
+    virtual ~AudioFileSourceHost() override { close(); }
+
+    virtual bool open(const char *filename) override;
+    virtual uint32_t read(void *data, uint32_t len) override;
+    virtual bool seek(int32_t pos, int dir) override;
+    virtual bool close() override;
+    virtual bool isOpen() override { return f != nullptr; }
+    virtual uint32_t getSize() override { return size; }
+    virtual uint32_t getPos() override { return f ? ftell(f) : 0; }
+
+    // Retrasa 'us' microsegundos una de cada 'every' lecturas
+    void setSlowReads(uint32_t us, uint32_t every) { slowUs = us; slowEvery = every ? every : 1; }
+
+    // Estadísticas de acceso, como las de la fuente SD con lectura anticipada
+    uint32_t reads = 0;
+    uint32_t seeks = 0;
+
+  private:
+    FILE *f = nullptr;
+    uint32_t size = 0;
+    uint32_t slowUs = 0;
+    uint32_t slowEvery = 1;
+};
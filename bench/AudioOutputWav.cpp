@@ -0,0 +1,92 @@
+/*
+  AudioOutputWav
+  Salida de audio a fichero WAV para el entorno native
+*/
+
+#include <chrono>
+#include <thread>
+#include "AudioOutputWav.h"
+#include "Telemetry.h"
+
+static uint64_t nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool AudioOutputWav::begin()
+{
+  frames = 0;
+  calls = 0;
+  outputNs = 0;
+  underruns = 0;
+  playStartNs = nowNs();
+  if (path && !f) {
+    f = fopen(path, "wb");
+    if (!f) return false;
+    writeHeader(0); // Se reescribe en stop() con el tamaño real
+  }
+  return true;
+}
+
+bool AudioOutputWav::ConsumeSample(int16_t sample[2])
+{
+  return ConsumeSamples(sample, 1) == 1;
+}
+
+uint16_t AudioOutputWav::ConsumeSamples(int16_t *samples, uint16_t count)
+{
+  uint64_t t0 = nowNs();
+  calls++;
+  if (realtimeBuffer) {
+    uint32_t rate = hertz ? hertz : 44100;
+    if (!frames) playStartNs = t0; // Empieza a sonar con la primera trama
+    uint64_t played = (t0 - playStartNs) * rate / 1000000000ull;
+    if (played > frames) {
+      // La cola se ha quedado vacía: se cuenta y el reloj sigue desde aquí
+      underruns++;
+      TELEMETRY_COUNT(underruns);
+      playStartNs = t0 - frames * 1000000000ull / rate;
+    } else if (frames + count - played > realtimeBuffer) {
+      // Cola llena: esperar a que suene lo que sobra
+      uint64_t excess = frames + count - played - realtimeBuffer;
+      std::this_thread::sleep_for(std::chrono::nanoseconds(excess * 1000000000ull / rate));
+    }
+  }
+  if (f) fwrite(samples, 2 * sizeof(int16_t), count, f);
+  frames += count;
+  outputNs += nowNs() - t0;
+  return count;
+}
+
+bool AudioOutputWav::stop()
+{
+  if (f) {
+    fseek(f, 0, SEEK_SET);
+    writeHeader(frames * 2 * sizeof(int16_t));
+    fclose(f);
+    f = nullptr;
+  }
+  return true;
+}
+
+// Cabecera RIFF de PCM de 16 bits estéreo (el decodificador duplica los canales mono)
+void AudioOutputWav::writeHeader(uint32_t dataBytes)
+{
+  uint32_t rate = hertz ? hertz : 44100;
+  uint8_t h[44];
+  auto le32 = [&h](int at, uint32_t v) { h[at] = v; h[at + 1] = v >> 8; h[at + 2] = v >> 16; h[at + 3] = v >> 24; };
+  auto le16 = [&h](int at, uint16_t v) { h[at] = v; h[at + 1] = v >> 8; };
+  memcpy(h, "RIFF", 4);
+  le32(4, 36 + dataBytes);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  le32(16, 16);
+  le16(20, 1);
+  le16(22, 2);
+  le32(24, rate);
+  le32(28, rate * 4);
+  le16(32, 4);
+  le16(34, 16);
+  memcpy(h + 36, "data", 4);
+  le32(40, dataBytes);
+  fwrite(h, 1, sizeof(h), f);
+}
@@ -0,0 +1,40 @@
+/*
+  AudioOutputWav
+  Sustituto del I2S para el entorno native: escribe el PCM en un WAV (o lo descarta
+  si no se da fichero) y mide el tiempo pasado dentro de la salida.
+  En modo tiempo real consume al ritmo de la frecuencia de muestreo con una cola de
+  'bufferFrames' tramas, como la cola PCM del ESP32, y cuenta las veces que se vacía.
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include "AudioOutput.h"
+
+class AudioOutputWav : public AudioOutput
+{
+  public:
+    AudioOutputWav(const char *path = nullptr) : path(path) {}
+    virtual ~AudioOutputWav() override { stop(); }
+
+    virtual bool begin() override;
+    virtual bool ConsumeSample(int16_t sample[2]) override;
+    virtual uint16_t ConsumeSamples(int16_t *samples, uint16_t count) override;
+    virtual bool stop() override;
+
+    // 0 = sin ritmo (lo más rápido posible)
+    void setRealtime(uint32_t bufferFrames) { realtimeBuffer = bufferFrames; }
+
+    uint64_t frames = 0;     // Tramas estéreo recibidas
+    uint32_t calls = 0;      // Llamadas a ConsumeSample/ConsumeSamples
+    uint64_t outputNs = 0;   // Tiempo dentro de la salida (escritura del WAV)
+    uint32_t underruns = 0;  // En tiempo real: la cola se vació antes de recibir más
+
+  private:
+    void writeHeader(uint32_t dataBytes);
+
+    const char *path;
+    FILE *f = nullptr;
+    uint32_t realtimeBuffer = 0;
+    uint64_t playStartNs = 0; // Momento en que habría empezado a sonar la trama 0
+};
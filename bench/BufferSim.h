@@ -0,0 +1,178 @@
+/*
+  BufferSim
+  Simulación de la reproducción con BufferController a pasos de 1 ms (tarjeta con
+  lectura anticipada, decodificador, cola PCM y DMA). La usan bench --buffers, que
+  imprime la comparación, y test/test_buffer_controller, que la comprueba.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include "BufferController.h"
+
+// Tarjeta que suele tardar 2-6 ms por bloque y se atasca de vez en cuando (borrados
+// internos): cada ~80 bloques 100-450 ms y alguna vez cerca de un segundo
+inline void syntheticTrace(std::vector<uint32_t> &trace)
+{
+  uint32_t x = 12345;
+  auto rnd = [&x]() { x = x * 1664525 + 1013904223; return x >> 8; };
+  for (int i = 0; i < 8000; i++) {
+    uint32_t us = 2000 + rnd() % 4000;
+    if (rnd() % 80 == 0) us = 100000 + rnd() % 350000;
+    if (rnd() % 1500 == 0) us = 900000;
+    trace.push_back(us);
+  }
+}
+
+struct BufferSimResult {
+  uint32_t glitches;    // Veces que el DMA se quedó sin audio sonando
+  uint32_t glitchMs;
+  double ramKb;         // Media de cola + DMA
+  double ramMaxKb;
+  double cutLatencyMs;  // Media desde un cambio de pista hasta oír la nueva
+  uint32_t decisions;
+};
+
+// Reproducción a pasos de 1 ms: la tarjeta carga bloques de READAHEAD_BLOCK (lectura
+// anticipada de dos bloques), el decodificador llena la cola a 'decodeX' veces tiempo
+// real si tiene datos y sitio, y la salida pasa de la cola al DMA, que suena a ritmo
+// fijo. Cada segundo la ventana va al controlador (si 'adaptive'); la cola cambia en
+// el acto (al reducir, cuando cabe) y el DMA en el siguiente cambio de pista.
+inline BufferSimResult bufferSim(const std::vector<uint32_t> &trace, uint32_t kbps, uint32_t ring, uint8_t dma,
+                                 bool adaptive, bool verbose)
+{
+  const uint64_t rate = 44100, blockBytes = 8192, decodeX = 6;
+  const uint64_t totalMs = 30 * 60 * 1000, skipMs = 120 * 1000;
+  const uint64_t bytesPerSec = kbps * 125;
+  auto blockOf = [&](uint64_t frame) { return frame * bytesPerSec / rate / blockBytes; };
+  auto blockStart = [&](uint64_t b) { return (b * blockBytes * rate + bytesPerSec - 1) / bytesPerSec; };
+  BufferController ctl;
+  ctl.begin(BufferController::defaults(rate, ring, dma));
+  BufferSimResult r = {};
+
+  uint64_t cap = ring, limit = ring;
+  uint64_t dmaCap = (uint64_t)dma * BUFFER_DMA_FRAMES;
+  uint64_t level = 0, dmaLevel = 0, dmaSilence = dmaCap; // Tramas en cola, de audio en el DMA y de silencio
+  uint64_t decoded = 0;
+  uint64_t loaded = 0, block0 = 0; // Bloques cargados del fichero y primero de la pista
+  uint64_t loadEnd = 0;
+  bool loading = false;
+  size_t traceAt = 0;
+  uint32_t sdPeak = 0, ringEmpty = 0, dry = 0;
+  uint64_t low = UINT64_MAX;
+  bool inEmpty = false, dryCounted = false, primed = false, glitching = false, waitSound = true;
+  uint64_t emptyStart = 0, cutAt = 0;
+  uint32_t cuts = 0;
+  double cutLatency = 0, ramSum = 0;
+
+  for (uint64_t t = 0; t < totalMs; t++) {
+    // Cambio de pista: se descarta la cola, el DMA suena en silencio y se aplica su tamaño
+    if (t && t % skipMs == 0) {
+      dmaCap = (uint64_t)ctl.dma() * BUFFER_DMA_FRAMES;
+      level = 0;
+      dmaLevel = 0;
+      dmaSilence = dmaCap;
+      block0 = loaded + (loading ? 1 : 0);
+      decoded = blockStart(block0);
+      primed = false;
+      waitSound = true;
+      cutAt = t;
+    }
+
+    // Tarjeta: dos bloques por delante de lo que se decodifica
+    if (loading && t >= loadEnd) {
+      loading = false;
+      loaded++;
+    }
+    if (!loading && loaded < blockOf(decoded) + 2) {
+      if (loaded < block0) loaded = block0;
+      uint32_t us = trace[traceAt++ % trace.size()];
+      if (us > sdPeak) sdPeak = us;
+      loading = true;
+      loadEnd = t + (us + 999) / 1000;
+    }
+
+    // Decodificador: hasta 'decodeX' ms de audio por ms si hay datos y sitio
+    uint64_t budget = decodeX * rate / 1000;
+    while (budget && level < limit) {
+      uint64_t b = blockOf(decoded);
+      if (b >= loaded) break;
+      uint64_t n = std::min({ budget, limit - level, blockStart(b + 1) - decoded });
+      if (!n) n = 1;
+      decoded += n;
+      level += n;
+      budget -= n;
+    }
+
+    // Salida: de la cola al DMA y, como en outputTask(), vaciados de la cola por rachas
+    if (level < low && primed) low = level;
+    uint64_t room = dmaCap - dmaLevel - dmaSilence;
+    uint64_t sent = std::min(level, room);
+    level -= sent;
+    dmaLevel += sent;
+    if (sent) primed = true;
+    if (primed && !level && !sent) {
+      if (!inEmpty) {
+        inEmpty = true;
+        dryCounted = false;
+        emptyStart = t;
+        ringEmpty++;
+      } else if (!dryCounted && (t - emptyStart) * rate / 1000 > dmaCap) {
+        dryCounted = true;
+        dry++;
+      }
+    } else if (level) {
+      inEmpty = false;
+    }
+
+    // El DMA suena a ritmo fijo: primero el silencio del corte, luego el audio
+    uint64_t want = (t + 1) * rate / 1000 - t * rate / 1000;
+    uint64_t silence = std::min(dmaSilence, want);
+    dmaSilence -= silence;
+    want -= silence;
+    if (waitSound && want && dmaLevel) {
+      waitSound = false;
+      cutLatency += t - cutAt;
+      cuts++;
+    }
+    uint64_t played = std::min(dmaLevel, want);
+    dmaLevel -= played;
+    bool starved = want > played && !waitSound;
+    if (starved) {
+      r.glitchMs++;
+      if (!glitching) r.glitches++;
+    }
+    glitching = starved;
+
+    double kb = (cap + dmaCap) * 4 / 1024.0;
+    ramSum += kb;
+    r.ramMaxKb = std::max(r.ramMaxKb, kb);
+
+    // Reducción pendiente de la cola: cuando lo que hay cabe
+    if (cap > limit && level <= limit) cap = limit;
+
+    if (adaptive && t % 1000 == 999) {
+      BufferController::Window w = { ringEmpty, dry, 0, low == UINT64_MAX ? 0 : (uint32_t)low, sdPeak };
+      BufferController::Decision d = ctl.update(w);
+      if (d.action != BufferController::KEEP) {
+        r.decisions++;
+        if (ctl.ring() > cap) cap = ctl.ring();
+        limit = ctl.ring();
+        if (verbose) {
+          printf("  %4llu s: %-11s cola %5u tramas, DMA %2u (%s; lectura más lenta %u ms)\n",
+                 (unsigned long long)(t / 1000), BufferController::actionName(d.action), (unsigned)ctl.ring(),
+                 (unsigned)ctl.dma(), d.reason, (unsigned)(ctl.sdPeak() / 1000));
+        }
+      }
+      ringEmpty = dry = 0;
+      sdPeak = 0;
+      low = UINT64_MAX;
+    }
+  }
+  r.ramKb = ramSum / totalMs;
+  r.cutLatencyMs = cuts ? cutLatency / cuts : 0;
+  return r;
+}
@@ -0,0 +1,159 @@
+/*
+  GovernorSim
+  Simulación de la reproducción con CpuGovernor a pasos de 1 ms para perfiles de
+  carga de la decodificación. La usan bench --governor, que imprime el tiempo en
+  cada frecuencia y el consumo, y test/test_cpu_governor, que comprueba que el
+  regulador no añade vaciados.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "CpuGovernor.h"
+
+// Carga de la decodificación por segundo de audio, en milésimas a 240 MHz, y segundos
+// en los que ya se sabe que va a subir (el fundido, preparado 3 s antes)
+struct LoadProfile {
+  const char *name;
+  std::vector<uint16_t> load;
+  std::vector<uint16_t> expect;
+};
+
+inline LoadProfile loadProfile(int n, uint32_t seconds)
+{
+  uint32_t x = 777 + n;
+  auto rnd = [&x]() { x = x * 1664525 + 1013904223; return x >> 8; };
+  auto jitter = [&](uint32_t base) { return (uint16_t)(base * (90 + rnd() % 21) / 100); }; // +/- 10 %
+  LoadProfile p;
+  p.load.resize(seconds);
+  p.expect.assign(seconds, 0);
+  for (uint32_t s = 0; s < seconds; s++) {
+    switch (n) {
+      case 0:
+        p.name = "128 kbps";
+        p.load[s] = jitter(150);
+        break;
+      case 1:
+        p.name = "320 kbps";
+        p.load[s] = jitter(220);
+        break;
+      case 2:
+        p.name = "VBR con picos";
+        p.load[s] = jitter(s % 20 < 3 ? 380 : 140); // 3 s de cada 20 mucho más densos
+        break;
+      case 3:
+        // Fundido de 5 s cada 3 min: dos decodificadores y la mezcla (20 ‰)
+        p.name = "fundidos";
+        p.load[s] = jitter(s % 180 >= 175 ? 2 * 150 + 20 : 150);
+        if (s % 180 >= 172) p.expect[s] = 2 * 150 + 20;
+        break;
+      case 4:
+        p.name = "48 kHz convertido";
+        p.load[s] = jitter(290); // Decodificación y conversor de calidad 2
+        break;
+      default:
+        // Salto brusco sin aviso a más de lo que da 160 MHz: solo lo salva guard()
+        p.name = "saltos bruscos";
+        p.load[s] = jitter(s % 60 >= 56 ? 700 : 100);
+        break;
+    }
+  }
+  return p;
+}
+
+struct GovernorSimResult {
+  uint32_t underruns;
+  uint32_t changes;
+  uint32_t relocksPlaying; // Cambios de PLL sonando (fuera de los cortes)
+  CpuGovernor governor;
+};
+
+// Reproducción a pasos de 1 ms con la cola y el DMA de siempre (2048 + 8 x 128 tramas).
+// El decodificador gasta por trama MP3 (1152 muestras) los ciclos de su carga y la
+// deja en la cola cuando cabe; la salida vacía a ritmo fijo. Cada paso se llama a
+// guard() (con la cola a 3/4 una vez desde el último corte) y cada segundo a update()
+// con la carga medida como en decodeStep(). Cada 5 min un cambio de pista vacía la cola.
+// Se cuentan los cambios de frecuencia que pasan por relockMhz sin ser en un corte.
+inline GovernorSimResult governorSim(const LoadProfile &p, const CpuGovernor::Config &cfg)
+{
+  const uint64_t rate = 44100, frame = 1152, ringCap = 2048, dmaCap = 8 * 128;
+  const uint64_t top = cfg.freqs[cfg.count - 1];
+  const uint64_t totalMs = (uint64_t)p.load.size() * 1000, skipMs = 5 * 60 * 1000;
+  GovernorSimResult r = {};
+  r.governor.begin(cfg, 0);
+
+  uint64_t level = 0, pending = 0, credit = 0, played = 0, decoded = 0;
+  uint64_t busyUs = 0, busyFrames = 0, load = 0; // Medida como decodeStep(), en µs a 240 MHz
+  uint64_t windowBusy = 0;                        // Ciclos de esta ventana, para el consumo
+  bool primed = false, empty = false;
+  auto changed = [&](uint16_t before) {
+    r.changes++;
+    uint16_t after = r.governor.mhz();
+    if (cfg.relockMhz && (before == cfg.relockMhz) != (after == cfg.relockMhz)) r.relocksPlaying++;
+  };
+  for (uint64_t t = 1; t <= totalMs; t++) {
+    if (t % skipMs == 0) {
+      level = pending = credit = 0;
+      primed = false;
+      if (r.governor.cut()) r.changes++;
+    }
+    uint64_t mhz = r.governor.mhz();
+    uint64_t sec = decoded / rate;
+    if (sec >= p.load.size()) sec = p.load.size() - 1;
+    uint64_t cost = (uint64_t)p.load[sec] * top * 1000 * frame / rate; // Ciclos por trama MP3
+
+    // Decodificar con el tiempo de este milisegundo
+    uint64_t cycles = mhz * 1000, used = 0;
+    while (used < cycles) {
+      if (pending) {
+        uint64_t room = ringCap + dmaCap - level;
+        uint64_t n = pending < room ? pending : room;
+        level += n;
+        pending -= n;
+        if (pending) break; // Cola llena: el decodificador espera
+      }
+      uint64_t step = cost - credit < cycles - used ? cost - credit : cycles - used;
+      credit += step;
+      used += step;
+      if (credit == cost) {
+        credit = 0;
+        pending = frame;
+        decoded += frame;
+        busyFrames += frame;
+      }
+    }
+    busyUs += used / top;
+    windowBusy += used;
+    if (busyFrames >= rate) {
+      uint64_t l = busyUs * rate / busyFrames / 1000;
+      load = load ? (3 * load + l) / 4 : l;
+      busyUs = busyFrames = 0;
+    }
+
+    // La salida suena a ritmo fijo; lo que pasa del DMA es la cola
+    uint64_t due = t * rate / 1000 - played;
+    played += due;
+    if (level >= due) {
+      level -= due;
+      empty = false;
+    } else {
+      level = 0;
+      if (primed && !empty) r.underruns++;
+      empty = true;
+    }
+    uint64_t ring = level > dmaCap ? level - dmaCap : 0;
+    if (ring >= ringCap * 3 / 4) primed = true;
+    uint16_t before = r.governor.mhz();
+    if (primed && r.governor.guard(ring * 1000 / ringCap)) changed(before);
+
+    if (t % 1000 == 0) {
+      r.governor.account(1000, windowBusy / top / 1000); // Ciclos de 1 s en milésimas de 240 MHz
+      windowBusy = 0;
+      CpuGovernor::Window w = { true, false, (uint32_t)load, p.expect[t / 1000 - 1] };
+      before = r.governor.mhz();
+      if (r.governor.update(w).change) changed(before);
+    }
+  }
+  return r;
+}
@@ -0,0 +1,800 @@
+/*
+  Banco de pruebas de decodificación MP3 en el PC (pio run -e native)
+
+  Decodifica con AudioGeneratorMP3Block todos los .mp3 de una carpeta (por defecto
+  bench/corpus) y por cada uno imprime tramas por segundo, ciclos por trama,
+  tiempo en la salida y memoria máxima del proceso. El corpus de referencia no va
+  en el repositorio; se genera con lame a varias tasas a partir de cualquier WAV:
+    lame -b 64 ref.wav bench/corpus/ref_064.mp3   (y 128, 192, 320, -V2...)
+
+  Uso: .pio/build/native/program [carpeta] [--wav carpeta_salida] [--csv]
+                                  [--realtime tramas] [--slow-read us[:cada]] [--output] [--dsp]
+                                  [--resample] [--crossfade] [--shuffle] [--paths]
+                                  [--loudness] [--buffers [traza]] [--governor]
+                                  [--spectrum] [--readahead [us]] [--id3 [us]]
+  Con --csv se imprime una línea por fichero para comparar entre commits.
+  --realtime consume al ritmo real con una cola como la del ESP32 y cuenta los
+  vaciados; con --slow-read se simula una tarjeta lenta para comprobar que la
+  telemetría (compilada con TELEMETRY=1 en este entorno) los detecta.
+  --output mide la salida I2S por segundo de audio a 44.1 kHz: una llamada virtual y un
+  i2s_write() por trama (AudioOutputI2S::ConsumeSample(), como antes) frente a la
+  conversión por bloques de AudioOutputI2SBlock (packI2S() y un i2s_write() por bloque).
+  i2s_write() se sustituye por una copia al buffer del DMA.
+  --dsp solo mide BlockDsp (ciclos por trama estéreo con 0, 3 y 10 bandas); en el
+  ESP32 la misma medida se obtiene compilando con -DDSP_BENCHMARK=1.
+  --resample mide los ciclos por trama de salida de las tres calidades del conversor
+  de frecuencia (48, 32 y 22.05 kHz a 44.1 kHz).
+  --crossfade decodifica cada pareja de ficheros consecutivos a la vez, mezclados con
+  CrossfadeMixer durante toda la más corta, y compara los ciclos por trama con los
+  de cada una por separado (el coste de la ventana de fundido en el ESP32).
+  --shuffle mide el coste de un paso de PlayOrder con 20000 pistas.
+  --paths compara la memoria de los nombres de 1000 y 10000 pistas guardados como
+  dos String por ruta (como hacía listFiles() antes del índice) y en un PathPool.
+  --loudness mide los ficheros de la carpeta con AudioOutputLoudness (sonoridad, pico,
+  ganancia ReplayGain a -18 LUFS y x tiempo real decodificando y midiendo).
+  --buffers simula la reproducción con BufferController (bench/BufferSim.h) a 128 y
+  320 kbps durante 30 min de audio, con las latencias de lectura de bloque de la traza
+  (un número en us por línea; valen las líneas "sd <us>" que imprime el firmware
+  compilado con -DSD_LATENCY_TRACE=1) o, sin traza, con una sintética con atascos de
+  la tarjeta. Compara la cola y el DMA fijos de antes, fijos al máximo y adaptativos:
+  cortes, RAM media y retardo tras un cambio de pista (uno cada 2 min); imprime las
+  decisiones del controlador.
+  --governor simula 20 min de reproducción con CpuGovernor (bench/GovernorSim.h) para
+  varios perfiles de carga y con la CPU fija a 240 MHz: vaciados de la cola, cambios de
+  PLL sonando (siempre 0 regulada), tiempo en cada frecuencia, consumo medio con el
+  modelo de CpuGovernor y horas con una batería de 2000 mAh (más 15 mA del resto de la
+  placa), también cambiando de PLL sin esperar a un corte (-DCPU_FREQ_RELOCK=0).
+  --readahead lee 1 MB de la tarjeta simulada (bench/host/SD.h: 'us' de latencia por
+  lectura, 2000 por defecto, y 1 MB/s) al ritmo del decodificador a 320 kbps, leyendo
+  0x600 bytes y gastando su parte de CPU: una lectura por petición, como
+  AudioFileSourceSD, frente a AudioFileSourceSDReadAhead. Da transacciones, MB/s de la
+  tarjeta, esperas y el tiempo que el decodificador pasa parado en read().
+  --id3 lee con readId3() las etiquetas de los .mp3 de la carpeta (cualquier colección
+  con etiquetas, carátulas incluidas) como al rehacer el índice: por fichero, tamaño de
+  la etiqueta ID3v2, lecturas y bytes pedidos a la tarjeta, us de CPU por lectura y el
+  tiempo en la tarjeta simulada ('us' por lectura, 2000 por defecto, y 1 MB/s); al
+  final la media por pista y lo que costarían 1000.
+  --spectrum mide ciclos y us por fotograma de SpectrumAnalyzer con FFT de 256, 512 y
+  1024 y 16, 24 y 32 bandas (en el PC), y lo que cuesta feed() por segundo de audio.
+  En el ESP32, 'v' por el puerto serie da el coste medido en la placa.
+
+  Este programa solo mide. Las comprobaciones (PlayOrder, PathPool, conversor, DSP,
+  fundido, sonoridad, buffers, regulador y espectro) son pruebas de Unity en test/
+  y se ejecutan con pio test -e native; al compilarlas se deja fuera este main().
+*/
+
+#ifndef PIO_UNIT_TESTING
+
+#include <dirent.h>
+#include <strings.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "AudioFileSourceHost.h"
+#include "AudioFileSourceSDReadAhead.h"
+#include "AudioOutputWav.h"
+#include "AudioGeneratorMP3Block.h"
+#include "XingHeader.h"
+#include "Telemetry.h"
+#include "BlockDsp.h"
+#include "I2SPack.h"
+#include "Resampler.h"
+#include "CrossfadeMixer.h"
+#include "PlayOrder.h"
+#include "PathPool.h"
+#include "AudioOutputLoudness.h"
+#include "Id3Reader.h"
+#include "CpuGovernor.h"
+#include "BufferController.h"
+#include "SpectrumAnalyzer.h"
+#include "BufferSim.h"
+#include "GovernorSim.h"
+
+static uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0; // Sin contador de ciclos: solo se informa del tiempo
+#endif
+}
+
+static long peakRssKb()
+{
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+// Sustituto de i2s_write(): copia al buffer circular del DMA, como el driver
+static volatile uint32_t dmaRing[8 * 128];
+static uint32_t dmaPos = 0;
+__attribute__((noinline)) static size_t hostI2sWrite(const void *src, size_t bytes)
+{
+  const uint32_t *w = (const uint32_t *)src;
+  for (size_t i = 0; i < bytes / 4; i++) dmaRing[dmaPos++ & (8 * 128 - 1)] = w[i];
+  return bytes;
+}
+
+// AudioOutputI2S::ConsumeSample() de ESP8266Audio: una llamada virtual y un i2s_write() por trama
+class SampleI2S : public AudioOutput
+{
+  public:
+    virtual bool ConsumeSample(int16_t sample[2]) override
+    {
+      int16_t ms[2] = { sample[0], sample[1] };
+      MakeSampleStereo16(ms);
+      if (mono) {
+        int32_t ttl = ms[LEFTCHANNEL] + ms[RIGHTCHANNEL];
+        ms[LEFTCHANNEL] = ms[RIGHTCHANNEL] = (ttl >> 1) & 0xffff;
+      }
+      uint32_t s32 = ((uint32_t)Amplify(ms[RIGHTCHANNEL]) << 16) | (Amplify(ms[LEFTCHANNEL]) & 0xffff);
+      return hostI2sWrite(&s32, sizeof(s32)) == sizeof(s32);
+    }
+    bool mono = false;
+};
+
+// AudioOutputI2SBlock::ConsumeSamples(): packI2S() sobre el bloque y un solo i2s_write()
+class BlockI2S : public AudioOutput
+{
+  public:
+    virtual uint16_t ConsumeSamples(int16_t *samples, uint16_t count) override
+    {
+      uint16_t done = 0;
+      while (done < count) {
+        uint16_t n = count - done < 1152 ? count - done : 1152;
+        packI2S(samples + 2 * done, words, n, gainF2P6, channels == 1, mono, 0);
+        done += hostI2sWrite(words, n * sizeof(uint32_t)) / sizeof(uint32_t);
+      }
+      return done;
+    }
+    bool mono = false;
+    uint32_t words[1152];
+};
+
+// Coste de la salida por segundo de audio a 44.1 kHz: trama a trama (GetOneSample() y
+// ConsumeSample() como AudioGeneratorMP3) frente a bloques de 1152 tramas
+static void outputBench()
+{
+  static int16_t pcm[2 * 1152];
+  for (int16_t &x : pcm) x = (int16_t)rand();
+  SampleI2S perSample;
+  BlockI2S perBlock;
+  AudioOutput *outs[2] = { &perSample, &perBlock };
+  for (AudioOutput *o : outs) {
+    o->SetGain(0.8f);
+    o->SetBitsPerSample(16);
+    o->SetChannels(2);
+  }
+  const int seconds = 60;
+  const uint32_t blocks = seconds * 44100 / 1152;
+  double perSecond[2];
+  for (int k = 0; k < 2; k++) {
+    AudioOutput *out = outs[k];
+    uint64_t c0 = cycles();
+    for (uint32_t b = 0; b < blocks; b++) {
+      if (k == 0) {
+        for (int i = 0; i < 1152; i++) {
+          if (!out->ConsumeSample(pcm + 2 * i)) break;
+        }
+      } else {
+        out->ConsumeSamples(pcm, 1152);
+      }
+    }
+    perSecond[k] = (double)(cycles() - c0) / seconds;
+  }
+  printf("Salida I2S por segundo de audio: %.0f ciclos trama a trama, %.0f por bloques (%.1fx menos)\n",
+         perSecond[0], perSecond[1], perSecond[0] / perSecond[1]);
+}
+
+// Ciclos por trama de BlockDsp::process() sobre ruido, con las mismas bandas que
+// dspBenchmark() en main.cpp
+static void dspBench()
+{
+  static BlockDsp dsp;
+  static int16_t pcm[2 * 1152];
+  const int rounds = 2000;
+  const int bandSets[] = { 0, 3, 10 };
+  for (int n : bandSets) {
+    dsp.clearBands();
+    for (int b = 0; b < n && b < DSP_MAX_BANDS; b++) {
+      float freq = (n == 3) ? 100.0f * powf(10.0f, b) : 31.25f * (1 << b);
+      dsp.setBand(b, BlockDsp::PEAK, freq, (b & 1) ? -3.0f : 3.0f, 1.0f);
+    }
+    dsp.setVolume(0.5f);
+    uint64_t total = 0;
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < 2 * 1152; i++) pcm[i] = (int16_t)rand();
+      uint64_t c0 = cycles();
+      dsp.process(pcm, 1152);
+      total += cycles() - c0;
+    }
+    printf("DSP %2d bandas: %.1f ciclos/trama estéreo\n", dsp.activeBands(), (double)total / (rounds * 1152.0));
+  }
+}
+
+template <class R>
+static void resampleBench(const char *name)
+{
+  static R r;
+  const uint32_t outRate = 44100;
+  const uint32_t inRates[] = { 48000, 32000, 22050 };
+  for (uint32_t inRate : inRates) {
+    r.setRates(inRate, outRate);
+
+    // Ruido blanco por bloques de una trama MP3
+    std::vector<int16_t> noise(2 * 1152);
+    for (int16_t &x : noise) x = (int16_t)rand();
+    int16_t block[2 * 1152];
+    uint64_t total = 0, frames = 0;
+    for (int k = 0; k < 500; k++) {
+      size_t pos = 0;
+      uint64_t c0 = cycles();
+      while (pos < 1152) {
+        uint32_t used;
+        frames += r.process(&noise[2 * pos], 1152 - pos, used, block, 1152);
+        pos += used;
+      }
+      total += cycles() - c0;
+    }
+
+    printf("%s %5u->%u: %6.1f ciclos/trama\n", name, inRate, outRate, (double)total / frames);
+  }
+}
+
+// Memoria de trabajo del decodificador, la misma que un hueco del pool en el ESP32
+alignas(8) static uint8_t arena[AudioGeneratorMP3Block::preAllocSize()];
+
+// Abre 'path' y lo deja en la primera trama, como startSlot() en el ESP32
+static bool openTrack(AudioFileSourceHost &src, const std::string &path)
+{
+  if (!src.open(path.c_str())) return false;
+  XingInfo info;
+  if (readXingInfo(&src, info)) src.seek(info.firstFramePos, SEEK_SET);
+  else src.seek(0, SEEK_SET);
+  return true;
+}
+
+static void crossfadeBench(const std::string &dir, const std::vector<std::string> &files)
+{
+  alignas(8) static uint8_t arenaB[AudioGeneratorMP3Block::preAllocSize()];
+  uint8_t *arenas[2] = { arena, arenaB };
+  for (size_t i = 0; i + 1 < files.size(); i++) {
+    const std::string paths[2] = { dir + "/" + files[i], dir + "/" + files[i + 1] };
+
+    // Cada pista sola
+    double single[2];
+    uint32_t length[2];
+    for (int k = 0; k < 2; k++) {
+      AudioFileSourceHost src;
+      AudioOutputWav out(nullptr);
+      AudioGeneratorMP3Block dec(arenas[k], sizeof(arenaB));
+      if (!openTrack(src, paths[k]) || !dec.begin(&src, &out)) return;
+      uint64_t c0 = cycles();
+      while (dec.loop()) {}
+      single[k] = out.frames ? (double)(cycles() - c0) * 1152 / out.frames : 0;
+      length[k] = out.frames;
+      dec.stop();
+    }
+
+    // Las dos a la vez durante toda la más corta
+    AudioFileSourceHost src[2];
+    AudioOutputWav out(nullptr);
+    CrossfadeMixer mixer(&out);
+    AudioGeneratorMP3Block dec0(arenas[0], sizeof(arenaB)), dec1(arenas[1], sizeof(arenaB));
+    AudioGeneratorMP3Block *dec[2] = { &dec0, &dec1 };
+    mixer.setActive(0);
+    for (int k = 0; k < 2; k++) {
+      if (!openTrack(src[k], paths[k]) || !dec[k]->begin(&src[k], mixer.input(k))) return;
+    }
+    mixer.start(1, std::min(length[0], length[1]));
+    uint64_t c0 = cycles();
+    while (!mixer.fadeDone()) {
+      for (int k = 0; k < 2; k++) {
+        if (!mixer.ended(k) && !dec[k]->loop()) mixer.endInput(k);
+      }
+    }
+    double dual = out.frames ? (double)(cycles() - c0) * 1152 / out.frames : 0;
+    printf("%s + %s: %.0f ciclos/trama mezclando (%.0f + %.0f por separado)\n",
+           files[i].c_str(), files[i + 1].c_str(), dual, single[0], single[1]);
+  }
+  printf("Memoria fija del fundido: 2 x %d (trabajo de libmad) + 2 x %zu (decodificador) + %zu (mezclador) bytes\n",
+         AudioGeneratorMP3Block::preAllocSize(), sizeof(AudioGeneratorMP3Block), sizeof(CrossfadeMixer));
+}
+
+// Una transacción por read(), como AudioFileSourceSD de ESP8266Audio
+class PlainSdSource : public AudioFileSource
+{
+  public:
+    virtual bool open(const char *filename) override
+    {
+      f = SD.open(filename, FILE_READ);
+      return f;
+    }
+    virtual uint32_t read(void *data, uint32_t len) override { return f.read((uint8_t *)data, len); }
+    virtual bool seek(int32_t pos, int dir) override { return f.seek(pos, (SeekMode)dir); }
+    virtual bool close() override
+    {
+      f.close();
+      return true;
+    }
+    virtual bool isOpen() override { return f; }
+    virtual uint32_t getSize() override { return f.size(); }
+    virtual uint32_t getPos() override { return f.position(); }
+
+  private:
+    File f;
+};
+
+// Lee 'src' entero en peticiones de 0x600 bytes, gastando entre una y otra la CPU que el
+// decodificador necesita para esos bytes. Devuelve los us que read() tuvo parado al lector.
+static double readPaced(AudioFileSource &src, uint32_t workUs)
+{
+  typedef std::chrono::steady_clock clock;
+  uint8_t buf[0x600];
+  double blockedUs = 0;
+  for (;;) {
+    auto t0 = clock::now();
+    uint32_t n = src.read(buf, sizeof(buf));
+    auto t1 = clock::now();
+    blockedUs += std::chrono::duration<double, std::micro>(t1 - t0).count();
+    if (!n) break;
+    while (clock::now() - t1 < std::chrono::microseconds(workUs)) {}
+  }
+  return blockedUs;
+}
+
+static int readaheadBench(uint32_t latencyUs)
+{
+  char dir[] = "/tmp/readaheadXXXXXX";
+  if (!mkdtemp(dir)) return 1;
+  SD.setRoot(dir);
+  const uint32_t size = 1 << 20;
+  File f = SD.open("/track.mp3", FILE_WRITE);
+  std::vector<uint8_t> data(size);
+  for (uint8_t &b : data) b = (uint8_t)rand();
+  f.write(data.data(), size);
+  f.close();
+
+  // 320 kbps: 0x600 bytes son 38 ms de audio; en el ESP32 decodificarlos cuesta unos 10 ms
+  const uint32_t workUs = 10000;
+  const double audioSecs = size * 8.0 / 320000;
+  SD.setLatency(latencyUs, 1000);
+  printf("Tarjeta simulada: %u us por lectura + 1 MB/s; %.0f s de audio a 320 kbps, %u us de CPU por 0x600 bytes\n",
+         (unsigned)latencyUs, audioSecs, (unsigned)workUs);
+  printf("%-12s %13s %8s %8s %12s %10s\n", "fuente", "transacciones", "MB/s", "esperas", "parado (ms)", "x tiempo");
+  AudioFileSourceSDReadAhead::begin();
+  for (int k = 0; k < 2; k++) {
+    PlainSdSource plain;
+    AudioFileSourceSDReadAhead ahead;
+    AudioFileSource &src = k ? (AudioFileSource &)ahead : (AudioFileSource &)plain;
+    AudioFileSourceSDReadAhead::stats.waits = 0;
+    SD.stats.reads = 0;
+    SD.stats.bytes = 0;
+    SD.stats.busyUs = 0;
+    if (!src.open("/track.mp3")) return 1;
+    auto t0 = std::chrono::steady_clock::now();
+    double blockedUs = readPaced(src, workUs);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    src.close();
+    double mbps = SD.stats.bytes / (SD.stats.busyUs / 1e6) / (1 << 20);
+    printf("%-12s %13u %8.2f %8u %12.0f %9.1fx\n", k ? "lectura ant." : "directa", (unsigned)SD.stats.reads, mbps,
+           k ? (unsigned)AudioFileSourceSDReadAhead::stats.waits : 0u, blockedUs / 1000, audioSecs / secs);
+  }
+  SD.remove("/track.mp3");
+  rmdir(dir);
+  return 0;
+}
+
+// Tamaño de la etiqueta ID3v2 al principio de 'path' (0 si no tiene)
+static uint32_t id3v2Bytes(const std::string &path)
+{
+  uint8_t h[10];
+  FILE *f = fopen(path.c_str(), "rb");
+  size_t n = f ? fread(h, 1, sizeof(h), f) : 0;
+  if (f) fclose(f);
+  if (n != sizeof(h) || memcmp(h, "ID3", 3)) return 0;
+  return 10 + (((h[6] & 0x7F) << 21) | ((h[7] & 0x7F) << 14) | ((h[8] & 0x7F) << 7) | (h[9] & 0x7F));
+}
+
+static int id3Bench(const std::string &dir, const std::vector<std::string> &files, uint32_t latencyUs)
+{
+  const int repeats = 200; // Para medir la CPU con la tarjeta al instante
+  const uint32_t kbPerSecond = 1000;
+  SD.setRoot(dir.c_str());
+  printf("Tarjeta simulada: %u us por lectura + 1 MB/s\n", (unsigned)latencyUs);
+  printf("%-28s %10s %8s %10s %10s %10s  %s\n", "fichero", "etiqueta", "lecturas", "bytes", "us CPU", "ms tarjeta",
+         "título / artista");
+  int failures = 0;
+  uint32_t parsed = 0;
+  double totalCpuUs = 0, totalCardMs = 0;
+  for (const std::string &name : files) {
+    std::string path = "/" + name;
+    Id3Tags tags;
+    SD.stats.reads = 0;
+    SD.stats.bytes = 0;
+    File f = SD.open(path.c_str());
+    bool found = f && readId3(f, tags);
+    uint32_t reads = SD.stats.reads, bytes = SD.stats.bytes;
+    if (!f) {
+      fprintf(stderr, "%s: no se puede abrir\n", name.c_str());
+      failures++;
+      continue;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) readId3(f, tags);
+    double cpuUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / repeats;
+    f.close();
+    // El fichero ya abierto: lo que cuesta en la tarjeta son las lecturas de readId3()
+    double cardMs = (reads * (double)latencyUs + bytes * 1000.0 / kbPerSecond) / 1000 + cpuUs / 1000;
+
+    printf("%-28s %10u %8u %10u %10.1f %10.1f  %s / %s\n", name.c_str(), (unsigned)id3v2Bytes(dir + path),
+           (unsigned)reads, (unsigned)bytes, cpuUs, cardMs, found ? tags.title : "-", found ? tags.artist : "-");
+    parsed++;
+    totalCpuUs += cpuUs;
+    totalCardMs += cardMs;
+  }
+  if (parsed) {
+    printf("Media por pista: %.1f us de CPU, %.1f ms en la tarjeta; 1000 pistas: %.1f s\n", totalCpuUs / parsed,
+           totalCardMs / parsed, totalCardMs / parsed);
+  }
+  return failures ? 1 : 0;
+}
+
+// Coste de un paso del aleatorio con una lista grande
+static void shuffleBench()
+{
+  PlayOrder big;
+  big.setCount(20000);
+  big.setShuffle(true, 12345);
+  const uint32_t steps = 1000000;
+  uint32_t sink = 0;
+  uint64_t c0 = cycles();
+  for (uint32_t i = 0; i < steps; i++) sink += big.step(1);
+  double perStep = (double)(cycles() - c0) / steps;
+  printf("Paso con 20000 pistas: %.0f ciclos (%u), memoria %zu bytes\n", perStep, sink & 1, sizeof(PlayOrder));
+}
+
+// Memoria estimada en el ESP32 de 'count' rutas como String dos veces (vector<String> y
+// String[]): 16 bytes por objeto, más el texto en un bloque del heap redondeado a 4 con
+// 8 bytes de cabecera. El vector crece duplicando su capacidad.
+static size_t stringBytes(const std::vector<std::string> &paths)
+{
+  size_t total = 0;
+  for (const std::string &p : paths) total += 2 * (16 + 8 + ((p.size() + 1 + 3) & ~3u));
+  size_t capacity = 1;
+  while (capacity < paths.size()) capacity *= 2;
+  return total + 16 * capacity + 8;
+}
+
+static int pathsBench()
+{
+  const char *artists[] = { "Los Planetas", "Vetusta Morla", "Rosalía", "Extremoduro", "Love of Lesbian",
+                            "Héroes del Silencio", "Sidonie", "Izal" };
+  printf("%7s %12s %12s %12s %8s\n", "pistas", "String x2", "PathPool", "por pista", "ahorro");
+  for (uint32_t count : { 1000u, 10000u }) {
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < count; i++) {
+      char name[128];
+      snprintf(name, sizeof(name), "/playlist/Canción %05u_%s.mp3", (unsigned)((i * 7919u) % count),
+               artists[i % 8]);
+      paths.push_back(name);
+    }
+    size_t textBytes = 0;
+    for (const std::string &p : paths) textBytes += p.size() + 1;
+
+    // Una pasada en el orden del directorio (desordenado) y orden por permutación
+    PathPool pool;
+    if (!pool.begin(textBytes, count, "/playlist")) return 1;
+    for (const std::string &p : paths) pool.add(p.c_str());
+    pool.shrink();
+    pool.sort();
+
+    size_t before = stringBytes(paths);
+    printf("%7u %12zu %12zu %12.1f %7.0f%%\n", count, before, pool.bytes(), (double)pool.bytes() / count,
+           100.0 * (before - pool.bytes()) / before);
+  }
+  return 0;
+}
+
+static int loudnessBench(const std::string &dir, const std::vector<std::string> &files)
+{
+  static AudioOutputLoudness meter;
+  int failures = 0;
+  for (const std::string &name : files) {
+    AudioFileSourceHost src;
+    AudioGeneratorMP3Block dec(arena, sizeof(arena));
+    if (!openTrack(src, dir + "/" + name) || !dec.begin(&src, &meter)) {
+      failures++;
+      continue;
+    }
+    meter.reset();
+    auto t0 = std::chrono::steady_clock::now();
+    while (dec.loop()) {}
+    dec.stop();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    double audioSecs = meter.sampleRate() ? (double)meter.frames() / meter.sampleRate() : 0;
+    float lufs = meter.loudness();
+    printf("%-28s %7.2f LUFS  pico %5.2f  ganancia %+5.1f dB  %7.1fx\n", name.c_str(), lufs, meter.peak(),
+           -18.0f - lufs, secs > 0 ? audioSecs / secs : 0.0);
+    if (!meter.frames()) failures++;
+  }
+  printf("Memoria del medidor: %zu bytes\n", sizeof(AudioOutputLoudness));
+  return failures ? 1 : 0;
+}
+
+// Latencias de lectura de bloque, en us: un número por línea (también "sd <us>")
+static bool loadTrace(const char *path, std::vector<uint32_t> &trace)
+{
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#') continue;
+    const char *p = line;
+    while (*p && (*p < '0' || *p > '9')) p++;
+    if (*p) trace.push_back(strtoul(p, nullptr, 10));
+  }
+  fclose(f);
+  return !trace.empty();
+}
+
+static int buffersBench(const char *tracePath)
+{
+  std::vector<uint32_t> trace;
+  if (tracePath) {
+    if (!loadTrace(tracePath, trace)) {
+      fprintf(stderr, "No se puede leer la traza %s\n", tracePath);
+      return 1;
+    }
+  } else {
+    syntheticTrace(trace);
+  }
+  uint32_t slowest = *std::max_element(trace.begin(), trace.end());
+  uint64_t sum = 0;
+  for (uint32_t us : trace) sum += us;
+  printf("Traza %s: %zu lecturas, media %.1f ms, la más lenta %.0f ms\n", tracePath ? tracePath : "sintética",
+         trace.size(), sum / 1000.0 / trace.size(), slowest / 1000.0);
+
+  for (uint32_t kbps : { 128u, 320u }) {
+    printf("%u kbps:\n", (unsigned)kbps);
+    BufferSimResult a = bufferSim(trace, kbps, 2048, 8, false, false);
+    BufferSimResult b = bufferSim(trace, kbps, BUFFER_RING_MAX, BUFFER_DMA_MAX, false, false);
+    BufferSimResult c = bufferSim(trace, kbps, 2048, 8, true, true);
+    printf("  %-24s %7s %9s %9s %9s %12s\n", "", "cortes", "ms cortes", "RAM KB", "máx KB", "retardo ms");
+    const std::pair<const char *, BufferSimResult *> rows[] = {
+      { "fija (2048 + 8 DMA)", &a }, { "fija al máximo", &b }, { "adaptativa", &c } };
+    for (const auto &row : rows) {
+      const BufferSimResult &x = *row.second;
+      printf("  %-24s %7u %9u %9.1f %9.1f %12.1f\n", row.first, (unsigned)x.glitches, (unsigned)x.glitchMs,
+             x.ramKb, x.ramMaxKb, x.cutLatencyMs);
+    }
+    printf("  %u decisiones\n", (unsigned)c.decisions);
+  }
+  return 0;
+}
+
+static void governorBench()
+{
+  const uint32_t seconds = 20 * 60, batteryMah = 2000, boardMa = 15;
+  CpuGovernor::Config fixed = CpuGovernor::defaults();
+  fixed.freqs[0] = fixed.freqs[fixed.count - 1];
+  fixed.count = 1;
+  CpuGovernor::Config free = CpuGovernor::defaults();
+  free.relockMhz = 0;
+  printf("%-18s %-15s %8s %8s %6s %8s %8s %9s %7s %9s\n", "perfil", "CPU", "vaciados", "cambios", "PLL", "80 MHz",
+         "160 MHz", "240 MHz", "mA", "horas");
+  for (int n = 0; n < 6; n++) {
+    LoadProfile p = loadProfile(n, seconds);
+    GovernorSimResult a = governorSim(p, fixed);
+    GovernorSimResult b = governorSim(p, CpuGovernor::defaults());
+    GovernorSimResult c = governorSim(p, free);
+    for (GovernorSimResult *r : { &a, &b, &c }) {
+      const CpuGovernor &g = r->governor;
+      uint32_t at[3] = { 0, 0, 0 };
+      for (uint8_t i = 0; i < g.levels(); i++) at[g.freq(i) <= 80 ? 0 : g.freq(i) <= 160 ? 1 : 2] += g.msAt(i);
+      float ma = g.averageMicroAmps() / 1000.0f;
+      printf("%-18s %-15s %8u %8u %6u %7.0f%% %7.0f%% %8.0f%% %7.1f %9.1f\n", r == &a ? p.name : "",
+             r == &a ? "240 fija" : r == &b ? "regulada" : "PLL sin esperar", (unsigned)r->underruns, (unsigned)r->changes,
+             (unsigned)r->relocksPlaying, at[0] / (seconds * 10.0), at[1] / (seconds * 10.0), at[2] / (seconds * 10.0), ma,
+             batteryMah / (ma + boardMa));
+    }
+  }
+}
+
+static bool spectrumReset(SpectrumAnalyzer &sa, uint16_t fft, uint8_t bands, uint32_t rate)
+{
+  if (!sa.begin(fft, bands)) return false;
+  sa.setRate(rate);
+  sa.analyze(0); // Calcula los bordes de las bandas
+  return true;
+}
+
+static void spectrumBench()
+{
+  static SpectrumAnalyzer sa;
+  // Coste por fotograma sobre ruido
+  std::vector<int16_t> noise(2 * 1024);
+  for (int16_t &v : noise) v = (int16_t)(rand() % 20000 - 10000);
+  const int rounds = 2000;
+  printf("%6s %7s %14s %10s %14s %10s\n", "FFT", "bandas", "ciclos/fotog.", "us/fotog.", "‰ a 25 fps", "memoria");
+  for (uint16_t n : { 256, 512, 1024 }) {
+    for (uint8_t nb : { 16, 24, 32 }) {
+      if (!spectrumReset(sa, n, nb, 44100)) continue;
+      uint64_t total = 0;
+      auto t0 = std::chrono::steady_clock::now();
+      for (int r = 0; r < rounds; r++) {
+        sa.feed(noise.data() + 2 * (r & 7) * 64, n);
+        uint64_t c0 = cycles();
+        sa.analyze(40);
+        total += cycles() - c0;
+      }
+      double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / rounds;
+      printf("%6u %7u %14.0f %10.1f %14.2f %10zu\n", n, nb, (double)total / rounds, us, us * 25 / 1000,
+             sizeof(SpectrumAnalyzer) + 16 * (size_t)n);
+    }
+  }
+  // feed() desde la tarea de salida, en bloques de un buffer DMA (128 tramas)
+  spectrumReset(sa, 512, 24, 44100);
+  uint64_t c0 = cycles();
+  auto t0 = std::chrono::steady_clock::now();
+  for (int s = 0; s < 100; s++) {
+    for (uint32_t f = 0; f < 44100; f += 128) sa.feed(noise.data(), 128);
+  }
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / 100;
+  printf("feed(): %.0f ciclos y %.1f us por segundo de audio\n", (double)(cycles() - c0) / 100, us);
+}
+
+int main(int argc, char **argv)
+{
+  std::string dir = "bench/corpus";
+  const char *wavDir = nullptr;
+  bool csv = false, crossfade = false, loudness = false, id3 = false;
+  uint32_t realtime = 0, slowUs = 0, slowEvery = 1, id3LatencyUs = 2000;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--csv")) csv = true;
+    else if (!strcmp(argv[i], "--wav") && i + 1 < argc) wavDir = argv[++i];
+    else if (!strcmp(argv[i], "--dsp")) {
+      dspBench();
+      return 0;
+    }
+    else if (!strcmp(argv[i], "--output")) {
+      outputBench();
+      return 0;
+    }
+    else if (!strcmp(argv[i], "--resample")) {
+      resampleBench<ResamplerQ0>("calidad 0");
+      resampleBench<ResamplerQ1>("calidad 1");
+      resampleBench<ResamplerQ2>("calidad 2");
+      return 0;
+    }
+    else if (!strcmp(argv[i], "--crossfade")) crossfade = true;
+    else if (!strcmp(argv[i], "--loudness")) loudness = true;
+    else if (!strcmp(argv[i], "--buffers")) return buffersBench(i + 1 < argc && strncmp(argv[i + 1], "--", 2) ? argv[i + 1] : nullptr);
+    else if (!strcmp(argv[i], "--governor")) {
+      governorBench();
+      return 0;
+    }
+    else if (!strcmp(argv[i], "--spectrum")) {
+      spectrumBench();
+      return 0;
+    }
+    else if (!strcmp(argv[i], "--shuffle")) {
+      shuffleBench();
+      return 0;
+    }
+    else if (!strcmp(argv[i], "--paths")) return pathsBench();
+    else if (!strcmp(argv[i], "--readahead")) {
+      return readaheadBench(i + 1 < argc && strncmp(argv[i + 1], "--", 2) ? strtoul(argv[i + 1], nullptr, 10) : 2000);
+    }
+    else if (!strcmp(argv[i], "--id3")) {
+      id3 = true;
+      if (i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9') id3LatencyUs = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (!strcmp(argv[i], "--realtime") && i + 1 < argc) realtime = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--slow-read") && i + 1 < argc) {
+      char *end;
+      slowUs = strtoul(argv[++i], &end, 10);
+      if (*end == ':') slowEvery = strtoul(end + 1, nullptr, 10);
+    }
+    else dir = argv[i];
+  }
+
+  std::vector<std::string> files;
+  DIR *d = opendir(dir.c_str());
+  if (!d && !loudness) {
+    fprintf(stderr, "No se puede abrir %s\n", dir.c_str());
+    return 1;
+  }
+  while (struct dirent *e = d ? readdir(d) : nullptr) {
+    std::string name = e->d_name;
+    if (name.size() > 4 && !strcasecmp(name.c_str() + name.size() - 4, ".mp3")) files.push_back(name);
+  }
+  if (d) closedir(d);
+  std::sort(files.begin(), files.end());
+  if (loudness) return loudnessBench(dir, files); // Las señales de prueba no necesitan corpus
+  if (files.empty()) {
+    fprintf(stderr, "No hay ficheros .mp3 en %s\n", dir.c_str());
+    return 1;
+  }
+  if (id3) return id3Bench(dir, files, id3LatencyUs);
+  if (crossfade) {
+    crossfadeBench(dir, files);
+    return 0;
+  }
+
+  if (csv) printf("file,kbps,frames,fps,cycles_per_frame,realtime_x,output_pct,peak_rss_kb\n");
+  else printf("%-28s %5s %8s %10s %12s %9s %7s %9s\n", "fichero", "kbps", "tramas", "tramas/s", "ciclos/trama", "x tiempo", "salida", "RSS KB");
+
+  int failures = 0;
+  for (const std::string &name : files) {
+    std::string path = dir + "/" + name;
+    std::string wav = wavDir ? std::string(wavDir) + "/" + name + ".wav" : std::string();
+
+    AudioFileSourceHost src;
+    AudioOutputWav out(wavDir ? wav.c_str() : nullptr);
+    AudioGeneratorMP3Block dec(arena, sizeof(arena));
+    if (!src.open(path.c_str())) {
+      fprintf(stderr, "%s: no se puede abrir\n", name.c_str());
+      failures++;
+      continue;
+    }
+    src.setSlowReads(slowUs, slowEvery);
+    out.setRealtime(realtime);
+
+    XingInfo info;
+    bool hasInfo = readXingInfo(&src, info);
+    if (hasInfo) src.seek(info.firstFramePos, SEEK_SET);
+    uint16_t spf = hasInfo ? info.samplesPerFrame : 1152;
+    uint32_t rate = hasInfo ? info.sampleRate : 44100;
+    uint32_t kbps = (hasInfo && info.frames) ? (uint64_t)(src.getSize() - info.firstFramePos) * 8 * rate / ((uint64_t)info.frames * spf * 1000)
+                                             : (hasInfo ? info.bitrateKbps : 0);
+
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = cycles();
+    if (!dec.begin(&src, &out)) {
+      fprintf(stderr, "%s: error al iniciar el decodificador\n", name.c_str());
+      failures++;
+      continue;
+    }
+    while (dec.loop()) {}
+    dec.stop();
+    uint64_t c1 = cycles();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    out.stop();
+
+    uint64_t frames = out.frames / spf;
+    double fps = secs > 0 ? frames / secs : 0;
+    double cpf = frames ? (double)(c1 - c0) / frames : 0;
+    double audioSecs = (double)out.frames / rate;
+    double realtime = secs > 0 ? audioSecs / secs : 0;
+    double outPct = secs > 0 ? 100.0 * out.outputNs / 1e9 / secs : 0;
+
+    if (csv) {
+      printf("%s,%u,%llu,%.0f,%.0f,%.1f,%.1f,%ld\n", name.c_str(), (unsigned)kbps, (unsigned long long)frames,
+             fps, cpf, realtime, outPct, peakRssKb());
+    } else {
+      printf("%-28s %5u %8llu %10.0f %12.0f %8.1fx %6.1f%% %9ld\n", name.c_str(), (unsigned)kbps,
+             (unsigned long long)frames, fps, cpf, realtime, outPct, peakRssKb());
+    }
+    if (realtime) printf("  vaciados de la cola: %u\n", (unsigned)out.underruns);
+    if (!frames) failures++;
+  }
+
+#if TELEMETRY
+  if (!csv) telemetryPrint(Serial);
+#endif
+
+  if (!csv) printf("Memoria de trabajo por decodificador: %d bytes\n", AudioGeneratorMP3Block::preAllocSize());
+  return failures ? 1 : 0;
+}
+
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,82 @@
+/*
+  Adafruit_GFX.h para el entorno native
+  Solo lo que usa el proyecto, dibujando en el framebuffer del SSD1306. El texto usa
+  celdas de 6x8 como la fuente por defecto, con un dibujo propio por carácter (no
+  es la fuente de Adafruit, pero cambia igual al desplazarse).
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+class Adafruit_GFX : public Print
+{
+  public:
+    Adafruit_GFX(int16_t w, int16_t h) : _width(w), _height(h) {}
+    virtual ~Adafruit_GFX() {}
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+      for (int16_t j = y; j < y + h; j++) {
+        for (int16_t i = x; i < x + w; i++) drawPixel(i, j, color);
+      }
+    }
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { fillRect(x, y, w, 1, color); }
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { fillRect(x, y, 1, h, color); }
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+      drawFastHLine(x, y, w, color);
+      drawFastHLine(x, y + h - 1, w, color);
+      drawFastVLine(x, y, h, color);
+      drawFastVLine(x + w - 1, y, h, color);
+    }
+
+    void setTextSize(uint8_t s) { textSize = s ? s : 1; }
+    void setTextColor(uint16_t c) { textColor = c; }
+    void setTextColor(uint16_t c, uint16_t bg)
+    {
+      textColor = c;
+      (void)bg;
+    }
+    void setCursor(int16_t x, int16_t y)
+    {
+      cursorX = x;
+      cursorY = y;
+    }
+    void setTextWrap(bool w) { wrap = w; }
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+    virtual size_t write(uint8_t c) override
+    {
+      if (c == '\n') {
+        cursorX = 0;
+        cursorY += 8 * textSize;
+        return 1;
+      }
+      if (c == '\r') return 1;
+      if (wrap && cursorX + 6 * textSize > _width) {
+        cursorX = 0;
+        cursorY += 8 * textSize;
+      }
+      if (c != ' ') {
+        for (int16_t i = 0; i < 5; i++) {
+          uint8_t column = (uint8_t)((c * 37 + i * 11) | 0x81);
+          for (int16_t j = 0; j < 8; j++) {
+            if (column & (1 << j)) fillRect(cursorX + i * textSize, cursorY + j * textSize, textSize, textSize, textColor);
+          }
+        }
+      }
+      cursorX += 6 * textSize;
+      return 1;
+    }
+    using Print::write;
+
+  protected:
+    int16_t _width, _height;
+    int16_t cursorX = 0, cursorY = 0;
+    uint8_t textSize = 1;
+    uint16_t textColor = 1;
+    bool wrap = true;
+};
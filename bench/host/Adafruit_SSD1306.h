@@ -0,0 +1,64 @@
+/*
+  Adafruit_SSD1306.h para el entorno native
+  Framebuffer en memoria con la misma organización que la librería (un byte por
+  columna y página de 8 filas); begin() y display() no envían nada.
+*/
+
+#pragma once
+
+#include "Adafruit_GFX.h"
+#include "Wire.h"
+
+#define SSD1306_BLACK        0
+#define SSD1306_WHITE        1
+#define SSD1306_INVERSE      2
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_COLUMNADDR   0x21
+#define SSD1306_PAGEADDR     0x22
+
+class Adafruit_SSD1306 : public Adafruit_GFX
+{
+  public:
+    Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *wire, int8_t rst = -1, uint32_t clkDuring = 400000UL,
+                     uint32_t clkAfter = 100000UL)
+      : Adafruit_GFX(w, h)
+    {
+      (void)wire;
+      (void)rst;
+      (void)clkDuring;
+      (void)clkAfter;
+    }
+    virtual ~Adafruit_SSD1306() override { free(buffer); }
+
+    bool begin(uint8_t vcs = SSD1306_SWITCHCAPVCC, uint8_t addr = 0, bool reset = true, bool periphBegin = true)
+    {
+      (void)vcs;
+      (void)addr;
+      (void)reset;
+      (void)periphBegin;
+      free(buffer);
+      buffer = (uint8_t *)calloc(_width * (_height / 8), 1);
+      return buffer != nullptr;
+    }
+    void display() {}
+    void clearDisplay()
+    {
+      if (buffer) memset(buffer, 0, _width * (_height / 8));
+    }
+    uint8_t *getBuffer() { return buffer; }
+    void ssd1306_command(uint8_t c) { (void)c; }
+    void dim(bool dim) { (void)dim; }
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) override
+    {
+      if (!buffer || x < 0 || y < 0 || x >= _width || y >= _height) return;
+      uint8_t &b = buffer[x + (y / 8) * _width];
+      uint8_t bit = 1 << (y & 7);
+      if (color == SSD1306_WHITE) b |= bit;
+      else if (color == SSD1306_BLACK) b &= ~bit;
+      else b ^= bit;
+    }
+
+  private:
+    uint8_t *buffer = nullptr;
+};
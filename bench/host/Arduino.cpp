@@ -0,0 +1,166 @@
+/*
+  Arduino.h para el entorno native
+*/
+
+#include "Arduino.h"
+#include "driver/gpio.h"
+#include "freertos/timers.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+HostSerial Serial;
+
+static const auto startTime = std::chrono::steady_clock::now();
+static std::atomic<bool> manualClock(false);
+static std::atomic<uint64_t> manualUs(0);
+
+uint32_t millis()
+{
+  if (manualClock) return manualUs / 1000;
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+uint32_t micros()
+{
+  if (manualClock) return manualUs;
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void hostManualClock(bool on)
+{
+  manualClock = on;
+}
+
+void hostAdvanceMs(uint32_t ms)
+{
+  while (ms--) {
+    manualUs += 1000;
+    hostRunTimers();
+  }
+}
+
+// --- GPIO ---
+
+struct HostPin {
+  int level = LOW;
+  void (*isr)(void *) = nullptr;
+  void (*isrNoArg)() = nullptr;
+  void *arg = nullptr;
+  int mode = 0;
+  bool enabled = true; // gpio_intr_enable()/gpio_intr_disable()
+};
+static HostPin pins[64];
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (mode == INPUT_PULLUP) pins[pin].level = HIGH;
+}
+
+int digitalRead(uint8_t pin)
+{
+  return pins[pin].level;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level)
+{
+  pins[pin].level = level ? HIGH : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*fn)(), int mode)
+{
+  pins[pin].isrNoArg = fn;
+  pins[pin].isr = nullptr;
+  pins[pin].mode = mode;
+  pins[pin].enabled = true;
+}
+
+void attachInterruptArg(uint8_t pin, void (*fn)(void *), void *arg, int mode)
+{
+  pins[pin].isr = fn;
+  pins[pin].isrNoArg = nullptr;
+  pins[pin].arg = arg;
+  pins[pin].mode = mode;
+  pins[pin].enabled = true;
+}
+
+void detachInterrupt(uint8_t pin)
+{
+  pins[pin].isr = nullptr;
+  pins[pin].isrNoArg = nullptr;
+}
+
+void hostSetPin(uint8_t pin, int level)
+{
+  HostPin &p = pins[pin];
+  level = level ? HIGH : LOW;
+  if (level == p.level) return;
+  p.level = level;
+  if (!p.enabled) return;
+  if (!(p.mode & (level == HIGH ? RISING : FALLING))) return;
+  if (p.isr) p.isr(p.arg);
+  else if (p.isrNoArg) p.isrNoArg();
+}
+
+int gpio_intr_enable(gpio_num_t pin)
+{
+  pins[pin].enabled = true;
+  return 0;
+}
+
+int gpio_intr_disable(gpio_num_t pin)
+{
+  pins[pin].enabled = false;
+  return 0;
+}
+
+int gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type)
+{
+  pins[pin].mode = type == GPIO_INTR_POSEDGE ? RISING : type == GPIO_INTR_NEGEDGE ? FALLING
+                 : type == GPIO_INTR_ANYEDGE ? CHANGE : 0;
+  return 0;
+}
+
+int gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type)
+{
+  (void)pin;
+  (void)type;
+  return 0;
+}
+
+int gpio_wakeup_disable(gpio_num_t pin)
+{
+  pins[pin].mode = 0; // Como en el ESP32: también quita el tipo de interrupción
+  return 0;
+}
+
+void delay(uint32_t ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+size_t Print::vprintf(const char *fmt, va_list ap)
+{
+  char buf[256];
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  if (n < 0) return 0;
+  return write((const uint8_t *)buf, (size_t)n < sizeof(buf) ? n : sizeof(buf) - 1);
+}
+
+size_t Print::printf(const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  size_t n = vprintf(fmt, ap);
+  va_end(ap);
+  return n;
+}
+
+size_t Print::printf_P(const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  size_t n = vprintf(fmt, ap);
+  va_end(ap);
+  return n;
+}
@@ -0,0 +1,87 @@
+/*
+  Arduino.h para el entorno native
+  Lo mínimo que usan ESP8266Audio (ruta MP3 y libmad) y los fuentes del proyecto
+  compilados en el PC: tipos, PROGMEM, tiempos y Print.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#define PROGMEM
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+#define PSTR(s) (s)
+#define F(s) (s)
+#define pgm_read_byte(p)  (*(const uint8_t *)(p))
+#define pgm_read_word(p)  (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+#define strlen_P strlen
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+// Reloj manual para las pruebas: millis() y micros() solo avanzan con hostAdvanceMs(),
+// que además dispara los temporizadores de FreeRTOS en cada milisegundo
+void hostManualClock(bool on);
+void hostAdvanceMs(uint32_t ms);
+
+// GPIO simulados: el nivel de una entrada lo pone hostSetPin(), que llama a la
+// interrupción del pin (en el mismo hilo) si el flanco le corresponde
+#define LOW          0
+#define HIGH         1
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+#define RISING       0x01
+#define FALLING      0x02
+#define CHANGE       0x03
+#define digitalPinToInterrupt(p) (p)
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+void attachInterrupt(uint8_t pin, void (*fn)(), int mode);
+void attachInterruptArg(uint8_t pin, void (*fn)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+void hostSetPin(uint8_t pin, int level);
+static inline void yield() {}
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len)
+    {
+      size_t n = 0;
+      while (len--) n += write(*buf++);
+      return n;
+    }
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t println(const char *s) { return print(s) + print("\n"); }
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    size_t printf_P(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+  private:
+    size_t vprintf(const char *fmt, va_list ap);
+};
+
+// Serial escribe en stdout
+class HostSerial : public Print
+{
+  public:
+    void begin(unsigned long) {}
+    virtual size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+    using Print::write;
+};
+extern HostSerial Serial;
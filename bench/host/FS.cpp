@@ -0,0 +1,99 @@
+/*
+  FS.h para el entorno native
+*/
+
+#include "FS.h"
+#include "SD.h"
+#include "SPI.h"
+#include <chrono>
+#include <thread>
+
+SDFS SD;
+SPIClass SPI;
+
+namespace fs {
+
+struct HostFile {
+  FS *owner;
+  FILE *f;
+  size_t size;
+  ~HostFile() { fclose(f); }
+};
+
+File FS::open(const char *path, const char *mode, bool create)
+{
+  (void)create;
+  std::string full = root + (path[0] == '/' ? "" : "/") + path;
+  FILE *f = fopen(full.c_str(), !strcmp(mode, FILE_READ) ? "rb" : !strcmp(mode, FILE_APPEND) ? "ab" : "wb");
+  if (!f) return File();
+  fseek(f, 0, SEEK_END);
+  size_t size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  return File(std::shared_ptr<HostFile>(new HostFile{ this, f, size }));
+}
+
+bool FS::exists(const char *path)
+{
+  return (bool)open(path);
+}
+
+bool FS::remove(const char *path)
+{
+  std::string full = root + (path[0] == '/' ? "" : "/") + path;
+  return ::remove(full.c_str()) == 0;
+}
+
+// Tiempo de una transacción de 'bytes' en la tarjeta simulada
+void FS::pay(size_t bytes)
+{
+  uint64_t us = latencyUs + (kbPerSecond ? (uint64_t)bytes * 1000 / kbPerSecond : 0);
+  stats.reads++;
+  stats.bytes += bytes;
+  stats.busyUs += us;
+  if (us) std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+size_t File::read(uint8_t *buf, size_t len)
+{
+  if (!impl) return 0;
+  size_t n = fread(buf, 1, len, impl->f);
+  impl->owner->pay(n);
+  return n;
+}
+
+int File::read()
+{
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+size_t File::write(const uint8_t *buf, size_t len)
+{
+  if (!impl) return 0;
+  size_t n = fwrite(buf, 1, len, impl->f);
+  long pos = ftell(impl->f);
+  if (pos > (long)impl->size) impl->size = pos;
+  return n;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode)
+{
+  return impl && fseek(impl->f, pos, mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END) == 0;
+}
+
+size_t File::position() const
+{
+  return impl ? ftell(impl->f) : 0;
+}
+
+size_t File::size() const
+{
+  return impl ? impl->size : 0;
+}
+
+void File::flush()
+{
+  if (impl) fflush(impl->f);
+}
+
+} // namespace fs
@@ -0,0 +1,86 @@
+/*
+  FS.h para el entorno native
+  fs::FS y fs::File sobre ficheros del PC: las rutas se resuelven bajo una
+  carpeta raíz. Para simular una tarjeta lenta, cada lectura puede pagar una
+  latencia fija por transacción más el tiempo de transferencia, y se cuentan
+  lecturas y bytes.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+namespace fs {
+
+class FS;
+struct HostFile;
+
+class File
+{
+  public:
+    File() {}
+    File(std::shared_ptr<HostFile> impl) : impl(impl) {}
+
+    size_t read(uint8_t *buf, size_t len);
+    int read();
+    size_t write(const uint8_t *buf, size_t len);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    int available() { return size() - position(); }
+    void flush();
+    void close() { impl.reset(); }
+    operator bool() const { return impl != nullptr; }
+
+  private:
+    std::shared_ptr<HostFile> impl;
+};
+
+class FS
+{
+  public:
+    FS(const char *root = ".") : root(root) {}
+
+    File open(const char *path, const char *mode = FILE_READ, bool create = false);
+    bool exists(const char *path);
+    bool remove(const char *path);
+
+    // Carpeta del PC que hace de raíz de la tarjeta
+    void setRoot(const char *dir) { root = dir; }
+    // Cada read() tarda 'us' más lo que cuesta transferir los bytes a 'kbPerSecond' (0 = al instante)
+    void setLatency(uint32_t us, uint32_t kbPerSecond = 0)
+    {
+      latencyUs = us;
+      this->kbPerSecond = kbPerSecond;
+    }
+
+    struct Stats {
+      std::atomic<uint32_t> reads{0};  // Transacciones de lectura
+      std::atomic<uint64_t> bytes{0};  // Bytes leídos
+      std::atomic<uint64_t> busyUs{0}; // Tiempo simulado de la tarjeta
+    };
+    Stats stats;
+
+  private:
+    friend class File;
+    void pay(size_t bytes);
+
+    std::string root;
+    uint32_t latencyUs = 0;
+    uint32_t kbPerSecond = 0;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
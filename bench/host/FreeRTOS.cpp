@@ -0,0 +1,292 @@
+/*
+  FreeRTOS para el entorno native
+*/
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include <Arduino.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Espera en 'cv' hasta que 'ready' se cumpla o pasen 'wait' ticks (1 tick = 1 ms)
+template <class Pred>
+static bool waitFor(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t wait, Pred ready)
+{
+  if (wait == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds(wait), ready);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *param,
+                                   UBaseType_t prio, TaskHandle_t *handle, BaseType_t core)
+{
+  (void)name;
+  (void)stack;
+  (void)prio;
+  (void)core;
+  std::thread(fn, param).detach();
+  if (handle) *handle = nullptr;
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *param, UBaseType_t prio,
+                       TaskHandle_t *handle)
+{
+  return xTaskCreatePinnedToCore(fn, name, stack, param, prio, handle, 0);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount()
+{
+  return millis();
+}
+
+TickType_t xTaskGetTickCountFromISR()
+{
+  return millis();
+}
+
+// --- Colas ---
+
+struct HostQueue {
+  std::mutex m;
+  std::condition_variable changed;
+  std::vector<uint8_t> items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  UBaseType_t head = 0;
+  UBaseType_t count = 0;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+  HostQueue *q = new (std::nothrow) HostQueue;
+  if (!q) return nullptr;
+  q->items.resize(length * itemSize);
+  q->length = length;
+  q->itemSize = itemSize;
+  return q;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+  delete q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait)
+{
+  std::unique_lock<std::mutex> lock(q->m);
+  if (!waitFor(q->changed, lock, wait, [q] { return q->count < q->length; })) return pdFALSE;
+  UBaseType_t tail = (q->head + q->count) % q->length;
+  memcpy(&q->items[tail * q->itemSize], item, q->itemSize);
+  q->count++;
+  q->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken)
+{
+  if (woken) *woken = pdFALSE;
+  return xQueueSend(q, item, 0);
+}
+
+static BaseType_t queueTake(QueueHandle_t q, void *item, TickType_t wait, bool remove)
+{
+  std::unique_lock<std::mutex> lock(q->m);
+  if (!waitFor(q->changed, lock, wait, [q] { return q->count > 0; })) return pdFALSE;
+  memcpy(item, &q->items[q->head * q->itemSize], q->itemSize);
+  if (remove) {
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    q->changed.notify_all();
+  }
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+  return queueTake(q, item, wait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t q, void *item, TickType_t wait)
+{
+  return queueTake(q, item, wait, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+  std::lock_guard<std::mutex> lock(q->m);
+  return q->count;
+}
+
+// --- Semáforos ---
+
+struct HostSemaphore {
+  std::mutex m;
+  std::condition_variable given;
+  UBaseType_t count;
+  UBaseType_t max;
+  bool isStatic = false;
+};
+static_assert(sizeof(HostSemaphore) <= sizeof(StaticSemaphore_t), "StaticSemaphore_t demasiado pequeño");
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+  HostSemaphore *s = new (std::nothrow) HostSemaphore;
+  if (!s) return nullptr;
+  s->count = initial;
+  s->max = max;
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+  return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+  HostSemaphore *s = new (buffer->storage) HostSemaphore;
+  s->count = 1;
+  s->max = 1;
+  s->isStatic = true;
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+  return xSemaphoreCreateCounting(1, 0);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t s)
+{
+  if (s->isStatic) s->~HostSemaphore();
+  else delete s;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait)
+{
+  std::unique_lock<std::mutex> lock(s->m);
+  if (!waitFor(s->given, lock, wait, [s] { return s->count > 0; })) return pdFALSE;
+  s->count--;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+  std::lock_guard<std::mutex> lock(s->m);
+  if (s->count >= s->max) return pdFALSE;
+  s->count++;
+  s->given.notify_one();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t s, BaseType_t *woken)
+{
+  if (woken) *woken = pdFALSE;
+  return xSemaphoreGive(s);
+}
+
+// --- Temporizadores ---
+
+struct HostTimer {
+  TickType_t period;
+  bool autoReload;
+  void *id;
+  TimerCallbackFunction_t fn;
+  bool active = false;
+  TickType_t expiry = 0;
+};
+
+static std::mutex timersLock;
+static std::vector<HostTimer *> timers;
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t autoReload, void *id,
+                           TimerCallbackFunction_t fn)
+{
+  (void)name;
+  HostTimer *t = new (std::nothrow) HostTimer{ period, autoReload != pdFALSE, id, fn };
+  if (!t) return nullptr;
+  std::lock_guard<std::mutex> lock(timersLock);
+  timers.push_back(t);
+  return t;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t t)
+{
+  return t->id;
+}
+
+BaseType_t xTimerStart(TimerHandle_t t, TickType_t wait)
+{
+  (void)wait;
+  std::lock_guard<std::mutex> lock(timersLock);
+  t->active = true;
+  t->expiry = millis() + t->period;
+  return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t t, TickType_t wait)
+{
+  (void)wait;
+  std::lock_guard<std::mutex> lock(timersLock);
+  t->active = false;
+  return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t t, TickType_t wait)
+{
+  return xTimerStart(t, wait);
+}
+
+BaseType_t xTimerResetFromISR(TimerHandle_t t, BaseType_t *woken)
+{
+  if (woken) *woken = pdFALSE;
+  return xTimerStart(t, 0);
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t t, TickType_t period, TickType_t wait)
+{
+  {
+    std::lock_guard<std::mutex> lock(timersLock);
+    t->period = period;
+  }
+  return xTimerStart(t, wait);
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t t)
+{
+  std::lock_guard<std::mutex> lock(timersLock);
+  return t->active ? pdTRUE : pdFALSE;
+}
+
+// De uno en uno y sin el cerrojo: la llamada puede volver a armar este u otro temporizador
+void hostRunTimers()
+{
+  for (;;) {
+    HostTimer *due = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(timersLock);
+      TickType_t now = millis();
+      for (HostTimer *t : timers) {
+        if (t->active && (int32_t)(now - t->expiry) >= 0 && (!due || (int32_t)(t->expiry - due->expiry) < 0)) due = t;
+      }
+      if (!due) return;
+      if (due->autoReload) due->expiry += due->period;
+      else due->active = false;
+    }
+    due->fn(due);
+  }
+}
@@ -0,0 +1,20 @@
+/*
+  SD.h para el entorno native: la tarjeta es una carpeta del PC (ver FS.h)
+*/
+
+#pragma once
+
+#include "FS.h"
+
+class SDFS : public fs::FS
+{
+  public:
+    bool begin(uint8_t cs = 0)
+    {
+      (void)cs;
+      return true;
+    }
+    void end() {}
+};
+
+extern SDFS SD;
@@ -0,0 +1,7 @@
+/*
+  Wire.h para el entorno native
+*/
+
+#include "Wire.h"
+
+TwoWire Wire;
@@ -0,0 +1,52 @@
+/*
+  Wire.h para el entorno native
+  No hay bus: cada transmisión se guarda entera (dirección y bytes) para que las
+  pruebas puedan contar y leer lo que se habría enviado.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+class TwoWire
+{
+  public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0)
+    {
+      (void)sda;
+      (void)scl;
+      if (frequency) clock = frequency;
+      return true;
+    }
+    void setClock(uint32_t frequency) { clock = frequency; }
+    void beginTransmission(uint8_t address)
+    {
+      log.push_back(Transmission{ address, {} });
+    }
+    uint8_t endTransmission(bool stop = true)
+    {
+      (void)stop;
+      return 0;
+    }
+    size_t write(uint8_t c)
+    {
+      if (log.empty()) return 0;
+      log.back().bytes.push_back(c);
+      return 1;
+    }
+    size_t write(const uint8_t *buf, size_t n)
+    {
+      for (size_t i = 0; i < n; i++) write(buf[i]);
+      return n;
+    }
+
+    struct Transmission {
+      uint8_t address;
+      std::vector<uint8_t> bytes;
+    };
+    std::vector<Transmission> log;
+    uint32_t clock = 100000;
+};
+
+extern TwoWire Wire;
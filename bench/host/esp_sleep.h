@@ -0,0 +1,23 @@
+/*
+  esp_sleep.h para el entorno native: no se duerme, solo se aceptan las fuentes de despertar
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+static inline int esp_sleep_enable_gpio_wakeup()
+{
+  return 0;
+}
+
+static inline int esp_sleep_enable_timer_wakeup(uint64_t us)
+{
+  (void)us;
+  return 0;
+}
+
+static inline int esp_light_sleep_start()
+{
+  return 0;
+}
@@ -0,0 +1,44 @@
+/*
+  FreeRTOS para el entorno native
+  Lo que usan los fuentes del proyecto compilados en el PC. Las tareas son hilos
+  (std::thread), las colas y los semáforos esperan con el reloj real, y el
+  tiempo de FreeRTOS es millis() de Arduino.h. Los temporizadores de software
+  no tienen tarea propia: se disparan desde hostAdvanceMs(), así las pruebas
+  que los usan (ButtonInput) van a pasos de tiempo simulado y son deterministas.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+#define portMAX_DELAY      0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
+#define portYIELD_FROM_ISR()
+#define tskIDLE_PRIORITY   0
+
+typedef void (*TaskFunction_t)(void *);
+typedef struct HostTask *TaskHandle_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *param,
+                                   UBaseType_t prio, TaskHandle_t *handle, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *param, UBaseType_t prio,
+                       TaskHandle_t *handle);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+TickType_t xTaskGetTickCountFromISR();
+
+// Memoria de un semáforo creado con xSemaphoreCreateMutexStatic()
+typedef struct {
+  alignas(16) unsigned char storage[192];
+} StaticSemaphore_t;
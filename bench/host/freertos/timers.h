@@ -0,0 +1,24 @@
+/*
+  Temporizadores de FreeRTOS para el entorno native (ver FreeRTOS.h)
+  Se disparan desde hostAdvanceMs(), en el hilo que avanza el reloj.
+*/
+
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef struct HostTimer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t autoReload, void *id,
+                           TimerCallbackFunction_t fn);
+void *pvTimerGetTimerID(TimerHandle_t t);
+BaseType_t xTimerStart(TimerHandle_t t, TickType_t wait);
+BaseType_t xTimerStop(TimerHandle_t t, TickType_t wait);
+BaseType_t xTimerReset(TimerHandle_t t, TickType_t wait);
+BaseType_t xTimerResetFromISR(TimerHandle_t t, BaseType_t *woken);
+BaseType_t xTimerChangePeriod(TimerHandle_t t, TickType_t period, TickType_t wait);
+BaseType_t xTimerIsTimerActive(TimerHandle_t t);
+
+// Dispara los temporizadores vencidos; lo llama hostAdvanceMs() en cada milisegundo
+void hostRunTimers();
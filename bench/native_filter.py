@@ -0,0 +1,15 @@
+# Entorno native: de ESP8266Audio solo se compilan libmad y la ruta MP3.
+# El resto de la librería (I2S, SPIFFS, HTTP...) necesita el SDK del ESP32.
+Import("env")
+
+KEEP = ("/libmad/", "AudioGeneratorMP3.cpp", "AudioLogger.cpp")
+
+def only_mp3_path(node):
+    path = node.get_path().replace("\\", "/")
+    if "ESP8266Audio" not in path:
+        return node
+    if any(k in path for k in KEEP):
+        return node
+    return None
+
+env.AddBuildMiddleware(only_mp3_path)
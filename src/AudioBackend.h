@@ -0,0 +1,107 @@
+/*
+  AudioBackend
+  Selección en compilación del almacenamiento y del decodificador. Cada opción
+  es una clase de rasgos (tipos y funciones estáticas, sin métodos virtuales) y
+  solo se incluye la cabecera de la elegida, así en el firmware no entra ni el
+  sistema de ficheros ni la pila de decodificación que no se usa.
+
+  Almacenamiento (-DAUDIO_STORAGE=...):
+    AUDIO_STORAGE_SD     tarjeta SD por SPI (SD.h), pines SD_CS/SPI_* (por defecto)
+    AUDIO_STORAGE_SDMMC  tarjeta SD por el periférico SDMMC en modo 1 bit (SD_MMC.h);
+                         usa los GPIO 2, 14 y 15
+  Decodificador (-DAUDIO_DECODER=...):
+    AUDIO_DECODER_MP3    libmad de ESP8266Audio por tramas completas (por defecto)
+
+  El resto del programa usa AudioStorage (fs(), Source), AudioCodec y AudioDecoder.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#define AUDIO_STORAGE_SD    0
+#define AUDIO_STORAGE_SDMMC 1
+#ifndef AUDIO_STORAGE
+#define AUDIO_STORAGE AUDIO_STORAGE_SD
+#endif
+
+#define AUDIO_DECODER_MP3   0
+#ifndef AUDIO_DECODER
+#define AUDIO_DECODER AUDIO_DECODER_MP3
+#endif
+
+#if AUDIO_STORAGE == AUDIO_STORAGE_SD
+
+#include <SD.h>
+#include <SPI.h>
+#include "AudioFileSourceSD.h"
+
+#ifndef SD_CS
+#define SD_CS         15
+#endif
+#ifndef SPI_MOSI
+#define SPI_MOSI      12
+#endif
+#ifndef SPI_MISO
+#define SPI_MISO      13
+#endif
+#ifndef SPI_SCK
+#define SPI_SCK       14
+#endif
+
+struct SdSpiStorage
+{
+  typedef AudioFileSourceSD Source; // Fuente sin lectura anticipada
+  static constexpr const char *name = "SD (SPI)";
+  static bool begin()
+  {
+    SPI.begin(SPI_SCK, SPI_MISO, SPI_MOSI, SD_CS);
+    return SD.begin(SD_CS);
+  }
+  static fs::FS &fs() { return SD; }
+};
+typedef SdSpiStorage AudioStorage;
+
+#elif AUDIO_STORAGE == AUDIO_STORAGE_SDMMC
+
+#include <SD_MMC.h>
+#include "AudioFileSourceFS.h"
+
+// AudioFileSourceFS necesita el sistema de ficheros al construirse
+class AudioFileSourceSDMMC : public AudioFileSourceFS
+{
+  public:
+    AudioFileSourceSDMMC() : AudioFileSourceFS(SD_MMC) {}
+};
+
+struct SdMmcStorage
+{
+  typedef AudioFileSourceSDMMC Source;
+  static constexpr const char *name = "SD (SDMMC 1 bit)";
+  static bool begin() { return SD_MMC.begin("/sdcard", true); }
+  static fs::FS &fs() { return SD_MMC; }
+};
+typedef SdMmcStorage AudioStorage;
+
+#else
+#error "AUDIO_STORAGE no válido"
+#endif
+
+#if AUDIO_DECODER == AUDIO_DECODER_MP3
+
+#include "AudioGeneratorMP3Block.h"
+
+struct Mp3Decoder
+{
+  typedef AudioGeneratorMP3Block Generator;
+  static constexpr const char *name = "MP3 (libmad)";
+  static constexpr int preAllocSize() { return Generator::preAllocSize(); }
+};
+typedef Mp3Decoder AudioCodec;
+
+#else
+#error "AUDIO_DECODER no válido"
+#endif
+
+typedef AudioCodec::Generator AudioDecoder;
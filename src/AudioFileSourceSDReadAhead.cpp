@@ -0,0 +1,208 @@
+/*
+  AudioFileSourceSDReadAhead
+  Fuente SD con lectura anticipada por bloques grandes y doble buffer
+*/
+
+#include "AudioFileSourceSDReadAhead.h"
+#include "Telemetry.h"
+
+AudioFileSourceSDReadAhead::Stats AudioFileSourceSDReadAhead::stats;
+QueueHandle_t AudioFileSourceSDReadAhead::fillQueue = nullptr;
+
+bool AudioFileSourceSDReadAhead::begin()
+{
+  if (fillQueue) return true;
+  QueueHandle_t q = xQueueCreate(4, sizeof(Block *) * 2);
+  if (!q) return false;
+  fillQueue = q;
+  if (xTaskCreatePinnedToCore(fillTask, "sdFill", 3072, nullptr, READAHEAD_TASK_PRIO, nullptr, READAHEAD_CORE) ==
+      pdPASS) return true;
+  fillQueue = nullptr; // Sin tarea, carga síncrona
+  vQueueDelete(q);
+  return false;
+}
+
+AudioFileSourceSDReadAhead::AudioFileSourceSDReadAhead()
+{
+  pos = 0;
+  size = 0;
+  for (int i = 0; i < 2; i++) {
+    blocks[i].state.store(BLOCK_EMPTY, std::memory_order_relaxed);
+    blocks[i].start = 0;
+    blocks[i].len = 0;
+  }
+  fileMutex = xSemaphoreCreateMutexStatic(&fileMutexBuffer);
+}
+
+AudioFileSourceSDReadAhead::AudioFileSourceSDReadAhead(const char *filename) : AudioFileSourceSDReadAhead()
+{
+  open(filename);
+}
+
+AudioFileSourceSDReadAhead::~AudioFileSourceSDReadAhead()
+{
+  close();
+}
+
+bool AudioFileSourceSDReadAhead::open(const char *filename)
+{
+  close();
+
+  f = AudioStorage::fs().open(filename, FILE_READ);
+  if (!f) return false;
+  size = f.size();
+  pos = 0;
+  return true;
+}
+
+bool AudioFileSourceSDReadAhead::close()
+{
+  waitIdle();
+  for (int i = 0; i < 2; i++) blocks[i].state.store(BLOCK_EMPTY, std::memory_order_relaxed); // Ya sin cargas
+  if (f) f.close();
+  pos = 0;
+  size = 0;
+  return true;
+}
+
+bool AudioFileSourceSDReadAhead::isOpen()
+{
+  return f ? true : false;
+}
+
+uint32_t AudioFileSourceSDReadAhead::getSize()
+{
+  return size;
+}
+
+uint32_t AudioFileSourceSDReadAhead::getPos()
+{
+  return pos;
+}
+
+bool AudioFileSourceSDReadAhead::seek(int32_t pos, int dir)
+{
+  if (!f) return false;
+  int32_t target;
+  if (dir == SEEK_SET) target = pos;
+  else if (dir == SEEK_CUR) target = this->pos + pos;
+  else if (dir == SEEK_END) target = size + pos;
+  else return false;
+  if (target < 0 || (uint32_t)target > size) return false;
+
+  // Los bloques cargados siguen siendo válidos; si la nueva posición no está en
+  // ninguno, el siguiente read() cargará el bloque que toque
+  this->pos = target;
+  return true;
+}
+
+uint32_t AudioFileSourceSDReadAhead::read(void *data, uint32_t len)
+{
+  TELEMETRY_SCOPE(sourceRead);
+  if (!f) return 0;
+  uint8_t *out = reinterpret_cast<uint8_t *>(data);
+  uint32_t done = 0;
+
+  while (done < len && pos < size) {
+    Block *b = findBlock(pos);
+    if (!b) {
+      // Fallo de caché (inicio o salto): cargar ya el bloque en un buffer que no esté en uso
+      b = (blocks[0].state.load(std::memory_order_acquire) != BLOCK_FILLING) ? &blocks[0] : &blocks[1];
+      if (b->state.load(std::memory_order_acquire) == BLOCK_FILLING) waitIdle();
+      b->start = pos - (pos % READAHEAD_BLOCK);
+      fillBlock(b);
+      if (!b->len) break;
+    }
+
+    uint32_t offset = pos - b->start;
+    if (offset >= b->len) break; // El fichero es más corto de lo que decía size()
+    uint32_t n = b->len - offset;
+    if (n > len - done) n = len - done;
+    memcpy(out + done, b->data + offset, n);
+    done += n;
+    pos += n;
+
+    // Cargar en segundo plano el bloque siguiente en el otro buffer
+    Block *other = (b == &blocks[0]) ? &blocks[1] : &blocks[0];
+    uint32_t next = b->start + READAHEAD_BLOCK;
+    uint8_t st = other->state.load(std::memory_order_acquire);
+    if (next < size && st != BLOCK_FILLING && !(st == BLOCK_READY && other->start == next)) {
+      requestFill(other, next);
+    }
+  }
+  return done;
+}
+
+// Bloque que contiene 'at', esperando si se está cargando. nullptr si no está en memoria.
+AudioFileSourceSDReadAhead::Block *AudioFileSourceSDReadAhead::findBlock(uint32_t at)
+{
+  for (int i = 0; i < 2; i++) {
+    Block *b = &blocks[i];
+    uint8_t st = b->state.load(std::memory_order_acquire);
+    if (st == BLOCK_EMPTY) continue;
+    if (at < b->start || at >= b->start + READAHEAD_BLOCK) continue;
+    if (st == BLOCK_FILLING) {
+      stats.waits++;
+      while ((st = b->state.load(std::memory_order_acquire)) == BLOCK_FILLING) vTaskDelay(1);
+    }
+    if (st == BLOCK_READY && at < b->start + b->len) return b;
+  }
+  return nullptr;
+}
+
+// Lee de la tarjeta el bloque que empieza en b->start
+void AudioFileSourceSDReadAhead::fillBlock(Block *b)
+{
+  uint32_t len = 0;
+  uint32_t start = micros();
+  {
+    TELEMETRY_SCOPE(sdRead);
+    xSemaphoreTake(fileMutex, portMAX_DELAY);
+    if (f && f.seek(b->start)) {
+      len = f.read(b->data, READAHEAD_BLOCK);
+    }
+    xSemaphoreGive(fileMutex);
+  }
+  uint32_t us = micros() - start;
+#if SD_LATENCY_TRACE
+  Serial.printf("sd %u\n", (unsigned)us);
+#endif
+
+  uint32_t slowest = stats.slowestUs.load();
+  while (us > slowest && !stats.slowestUs.compare_exchange_weak(slowest, us)) {}
+  stats.bytes += len;
+  stats.transactions++;
+  b->len = len;
+  b->state.store(BLOCK_READY, std::memory_order_release); // 'data' y 'len' antes que el estado
+}
+
+void AudioFileSourceSDReadAhead::requestFill(Block *b, uint32_t start)
+{
+  b->start = start;
+  b->state.store(BLOCK_FILLING, std::memory_order_release);
+  void *msg[2] = { this, b };
+  if (!fillQueue || xQueueSend(fillQueue, msg, 0) != pdTRUE) {
+    fillBlock(b); // Sin tarea o cola llena: carga síncrona
+  }
+}
+
+// Espera a que no quede ninguna carga en curso de esta fuente
+void AudioFileSourceSDReadAhead::waitIdle()
+{
+  while (blocks[0].state.load(std::memory_order_acquire) == BLOCK_FILLING ||
+         blocks[1].state.load(std::memory_order_acquire) == BLOCK_FILLING) {
+    vTaskDelay(1);
+  }
+}
+
+void AudioFileSourceSDReadAhead::fillTask(void *param)
+{
+  (void)param;
+  void *msg[2];
+  for (;;) {
+    if (xQueueReceive(fillQueue, msg, portMAX_DELAY) == pdTRUE) {
+      AudioFileSourceSDReadAhead *src = reinterpret_cast<AudioFileSourceSDReadAhead *>(msg[0]);
+      src->fillBlock(reinterpret_cast<Block *>(msg[1]));
+    }
+  }
+}
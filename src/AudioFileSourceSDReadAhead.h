@@ -0,0 +1,86 @@
+/*
+  AudioFileSourceSDReadAhead
+  Fuente SD con lectura anticipada por bloques grandes y doble buffer.
+  Las lecturas pequeñas del decodificador (hasta 0x600 bytes) se sirven desde
+  memoria; la tarjeta solo se lee en bloques alineados de READAHEAD_BLOCK bytes,
+  y el bloque siguiente se carga en segundo plano mientras se consume el actual.
+
+  La tarea de carga es una para todas las fuentes y la crea begin(), una vez y
+  antes de abrir ninguna; sin ella los bloques se cargan en el acto.
+*/
+
+#pragma once
+
+#include "AudioFileSource.h"
+#include "AudioBackend.h"
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
+
+#ifndef READAHEAD_BLOCK
+#define READAHEAD_BLOCK 8192     // Bytes por bloque (múltiplo de 512; 8-32 KB)
+#endif
+#ifndef READAHEAD_CORE
+#define READAHEAD_CORE 1         // Núcleo de la tarea de carga (el contrario al decodificador)
+#endif
+#ifndef SD_LATENCY_TRACE
+#define SD_LATENCY_TRACE 0       // 1: imprime "sd <us>" por cada bloque (trazas para bench --buffers)
+#endif
+#ifndef READAHEAD_TASK_PRIO
+#define READAHEAD_TASK_PRIO 2    // Por encima de loop() para que la UI no retrase las cargas
+#endif
+
+class AudioFileSourceSDReadAhead : public AudioFileSource
+{
+  public:
+    AudioFileSourceSDReadAhead();
+    AudioFileSourceSDReadAhead(const char *filename);
+    virtual ~AudioFileSourceSDReadAhead() override;
+
+    // Crea la cola y la tarea de carga compartidas (desde setup(), antes de ningún open())
+    static bool begin();
+
+    virtual bool open(const char *filename) override;
+    virtual uint32_t read(void *data, uint32_t len) override;
+    virtual bool seek(int32_t pos, int dir) override;
+    virtual bool close() override;
+    virtual bool isOpen() override;
+    virtual uint32_t getSize() override;
+    virtual uint32_t getPos() override;
+
+    // Contadores acumulados de todas las fuentes, para medir bytes y transacciones por
+    // segundo. Atómicos: los escriben la tarea de carga y la de decodificación, cada una
+    // en su núcleo, y se leen desde loop().
+    struct Stats {
+      std::atomic<uint32_t> bytes{0};         // Bytes leídos de la tarjeta
+      std::atomic<uint32_t> transactions{0};  // Lecturas de bloque a la tarjeta
+      std::atomic<uint32_t> waits{0};         // Veces que read() tuvo que esperar a una carga en curso
+      std::atomic<uint32_t> slowestUs{0};     // Lectura de bloque más lenta (quien la consulta, exchange(0))
+    };
+    static Stats stats;
+
+  private:
+    enum : uint8_t { BLOCK_EMPTY, BLOCK_FILLING, BLOCK_READY };
+    struct Block {
+      uint8_t data[READAHEAD_BLOCK];
+      uint32_t start;
+      uint32_t len;
+      std::atomic<uint8_t> state;   // BLOCK_READY se publica tras 'data' y 'len' (release)
+    };
+
+    Block *findBlock(uint32_t at);
+    void fillBlock(Block *b);
+    void requestFill(Block *b, uint32_t start);
+    void waitIdle();
+    static void fillTask(void *param);
+
+    File f;
+    uint32_t pos;
+    uint32_t size;
+    Block blocks[2];
+    StaticSemaphore_t fileMutexBuffer;
+    SemaphoreHandle_t fileMutex; // Serializa el acceso a 'f' entre read() y la tarea de carga
+
+    static QueueHandle_t fillQueue;
+};
@@ -0,0 +1,220 @@
+/*
+  AudioGeneratorMP3Block
+  Decodificación MP3 por tramas completas
+*/
+
+#include "AudioGeneratorMP3Block.h"
+#include "Telemetry.h"
+
+// Asignan un buffer propio a un puntero de libmad. Si en esta versión de libmad
+// el campo es un array dentro de la estructura no hay nada que hacer.
+template <typename T> static void attachBuffer(T *&field, void *space) { field = reinterpret_cast<T *>(space); }
+template <typename T> static void attachBuffer(T &, void *) {}
+template <typename T> static void detachBuffer(T *&field) { field = nullptr; }
+template <typename T> static void detachBuffer(T &) {}
+
+AudioGeneratorMP3Block::AudioGeneratorMP3Block(void *preallocateSpace, int preallocateSize)
+  : AudioGeneratorMP3(preallocateSpace, preallocateSize)
+{
+  if (preallocateSize >= preAllocSize()) {
+    layer3Space = reinterpret_cast<uint8_t *>(preallocateSpace) + AudioGeneratorMP3::preAllocSize();
+  }
+}
+
+bool AudioGeneratorMP3Block::begin(AudioFileSource *source, AudioOutput *output)
+{
+  blockLen = 0;
+  blockPos = 0;
+  bufErrors = 0;
+  decodedPos = 0;
+  blockEnd = 0;
+  seekSkip = 0;
+  if (!AudioGeneratorMP3::begin(source, output)) return false;
+  AttachLayer3Space();
+  return true;
+}
+
+bool AudioGeneratorMP3Block::stop()
+{
+  // Que mad_stream_finish()/mad_frame_finish() no intenten liberar la memoria preasignada
+  DetachLayer3Space();
+  return AudioGeneratorMP3::stop();
+}
+
+void AudioGeneratorMP3Block::AttachLayer3Space()
+{
+  if (!layer3Space || !madInitted) return;
+  uint8_t *overlap = layer3Space + preAllocMainDataSize();
+  memset(overlap, 0, preAllocOverlapSize()); // libmad espera el solape a cero, como con calloc()
+  attachBuffer(stream->main_data, layer3Space);
+  attachBuffer(frame->overlap, overlap);
+}
+
+void AudioGeneratorMP3Block::DetachLayer3Space()
+{
+  if (!layer3Space || !madInitted) return;
+  detachBuffer(stream->main_data);
+  detachBuffer(frame->overlap);
+}
+
+void AudioGeneratorMP3Block::SetTrim(uint32_t skip, uint32_t length)
+{
+  trimSkip = skip;
+  trimLength = length;
+}
+
+bool AudioGeneratorMP3Block::Prime()
+{
+  if (!running) return false;
+  if (blockPos < blockLen) return true; // Ya hay un bloque esperando
+  return DecodeBlock();
+}
+
+bool AudioGeneratorMP3Block::Seek(uint32_t offset, uint32_t fromSample, uint32_t sample)
+{
+  if (!running || !file->seek(offset, SEEK_SET)) return false;
+  desync();
+  stream->md_len = 0;    // La reserva de bits de la posición anterior no sirve aquí
+  mad_frame_mute(frame); // Ni el solape de la IMDCT
+  mad_synth_mute(synth); // Ni el estado del filtro de síntesis
+  blockLen = 0;
+  blockPos = 0;
+  bufErrors = 0;
+  decodedPos = fromSample;
+  blockEnd = sample;
+  seekSkip = sample;
+  return true;
+}
+
+bool AudioGeneratorMP3Block::loop()
+{
+  if (!running) goto done; // Nothing to do here!
+
+  // Primero entregar lo que la salida no aceptó en la llamada anterior (o lo pre-decodificado)
+  if (blockPos < blockLen) {
+    ApplyFormat();
+    blockPos += output->ConsumeSamples(block + 2 * blockPos, blockLen - blockPos);
+    if (blockPos < blockLen) goto done; // Can't send, but no error detected
+  }
+
+  // Decodificar y entregar tramas completas hasta que la salida se llene
+  while (running) {
+    if (!DecodeBlock()) {
+      return false; // Fin de fichero o flujo irrecuperable
+    }
+    ApplyFormat();
+    blockPos = output->ConsumeSamples(block, blockLen);
+    if (blockPos < blockLen) break;
+  }
+
+done:
+  file->loop();
+  output->loop();
+
+  return running;
+}
+
+// Decodifica hasta tener un bloque con muestras dentro de la ventana de recorte.
+// Devuelve false al final del fichero, al pasar el final de la ventana o si el flujo
+// no se puede recuperar (en ese caso también se para el generador).
+bool AudioGeneratorMP3Block::DecodeBlock()
+{
+  const uint32_t end = trimLength ? trimSkip + trimLength : UINT32_MAX;
+  const uint32_t start = seekSkip > trimSkip ? seekSkip : trimSkip;
+  for (;;) {
+    if (decodedPos >= end) return false;
+    if (!DecodeFrame()) return false;
+
+    uint32_t p0 = decodedPos;
+    decodedPos += blockLen;
+    uint32_t from, to;
+    if (!TrimFrame(p0, blockLen, start, end, from, to)) continue; // Trama entera dentro del retardo del codificador
+
+    if (from) memmove(block, block + 2 * from, (to - from) * 2 * sizeof(int16_t));
+    blockLen = to - from;
+    blockEnd = p0 + to;
+    return true;
+  }
+}
+
+// Decodifica la siguiente trama MP3 completa en 'block'
+bool AudioGeneratorMP3Block::DecodeFrame()
+{
+  TELEMETRY_SCOPE(decodeFrame);
+  for (;;) {
+    if (Input() == MAD_FLOW_STOP) {
+      return false;
+    }
+    if (DecodeNextFrame()) {
+      bufErrors = 0;
+      break;
+    }
+    if (stream->error >= MAD_ERROR_BADCRC && MAD_RECOVERABLE(stream->error)) {
+      // Cabecera válida pero datos dañados (o sin reserva de bits tras Seek()): la trama
+      // se cuenta como silencio para no desplazar la posición ni el recorte
+      bufErrors = 0;
+      blockLen = 32 * MAD_NSBSAMPLES(&frame->header);
+      if (blockLen > blockFrames) blockLen = blockFrames;
+      blockPos = 0;
+      memset(block, 0, blockLen * 2 * sizeof(int16_t));
+      blockRate = frame->header.samplerate;
+      blockChannels = MAD_NCHANNELS(&frame->header);
+      return true;
+    }
+    if (stream->error == MAD_ERROR_BUFLEN) {
+      // randomly seeking can lead to endless
+      // and unrecoverable "MAD_ERROR_BUFLEN" loop
+      if (++bufErrors >= 3) {
+        bufErrors = 0;
+        stop();
+        return false;
+      }
+    } else {
+      bufErrors = 0;
+    }
+  }
+
+  blockLen = 0;
+  blockPos = 0;
+  for (nsCount = 0; nsCount < nsCountMax; nsCount++) {
+    switch (mad_synth_frame_onens(synth, frame, nsCount)) {
+      case MAD_FLOW_STOP:
+      case MAD_FLOW_BREAK:
+        running = false;
+        return false;
+      default:
+        break; // for IGNORE and CONTINUE, just play what we have now
+    }
+
+    const int16_t (*pcm)[2] = synth->pcm.samplesX;
+    int len = synth->pcm.length;
+    if (blockLen + len > blockFrames) len = blockFrames - blockLen;
+    int16_t *dst = block + 2 * blockLen;
+    if (synth->pcm.channels == 1) {
+      for (int i = 0; i < len; i++) {
+        dst[2 * i] = dst[2 * i + 1] = pcm[i][0];
+      }
+    } else {
+      memcpy(dst, pcm, len * 2 * sizeof(int16_t));
+    }
+    blockLen += len;
+  }
+  samplePtr = synth->pcm.length; // Nada pendiente para GetOneSample()
+  blockRate = synth->pcm.samplerate;
+  blockChannels = synth->pcm.channels;
+  return true;
+}
+
+// El formato se comprueba una vez por bloque, no por muestra, y solo al entregarlo:
+// un bloque pre-decodificado no debe cambiar la salida mientras suena otra pista
+void AudioGeneratorMP3Block::ApplyFormat()
+{
+  if (blockRate != lastRate) {
+    output->SetRate(blockRate);
+    lastRate = blockRate;
+  }
+  if (blockChannels != lastChannels) {
+    output->SetChannels(blockChannels);
+    lastChannels = blockChannels;
+  }
+}
@@ -0,0 +1,80 @@
+/*
+  AudioGeneratorMP3Block
+  AudioGeneratorMP3 que sintetiza una trama MP3 completa de golpe y la entrega
+  a la salida con una sola llamada a ConsumeSamples(), en lugar de pasar una
+  trama estéreo por llamada virtual con GetOneSample()/ConsumeSample().
+*/
+
+#pragma once
+
+#include "AudioGeneratorMP3.h"
+
+class AudioGeneratorMP3Block final : public AudioGeneratorMP3
+{
+  public:
+    AudioGeneratorMP3Block() : AudioGeneratorMP3() {}
+    // 'preallocateSpace' debe medir preAllocSize() de esta clase: además de los buffers
+    // del generador base incluye los de Layer III que libmad pediría con malloc en cada pista
+    AudioGeneratorMP3Block(void *preallocateSpace, int preallocateSize);
+    virtual ~AudioGeneratorMP3Block() override {}
+    virtual bool begin(AudioFileSource *source, AudioOutput *output) override;
+    virtual bool loop() override;
+    virtual bool stop() override;
+
+    // Recorte para reproducción sin huecos: se descartan las 'skip' primeras muestras
+    // decodificadas y la pista termina tras 'length' muestras (0 = hasta el final).
+    // Se conserva entre pistas, hay que fijarlo antes de cada begin().
+    void SetTrim(uint32_t skip, uint32_t length);
+
+    // Pre-decodifica el primer bloque sin tocar la salida; lo entrega el siguiente loop()
+    bool Prime();
+
+    // Salta a la muestra 'sample' (contada desde la primera trama decodificada, antes del
+    // recorte) sin decodificar desde el principio. 'offset' es el byte donde empieza la
+    // trama que contiene la muestra 'fromSample' (<= sample); lo que hay entre las dos se
+    // decodifica y se descarta para rellenar la reserva de bits de libmad.
+    bool Seek(uint32_t offset, uint32_t fromSample, uint32_t sample);
+
+    // Muestra (en la misma cuenta que Seek()) que la salida recibirá a continuación
+    uint32_t Position() const { return blockEnd - (blockLen - blockPos); }
+    uint32_t TrimSkip() const { return trimSkip; }
+    uint32_t TrimLength() const { return trimLength; }
+    uint32_t SampleRate() const { return blockRate; } // Del último bloque decodificado (0 si aún ninguno)
+
+    // Parte [from, to) de una trama de 'len' muestras que empieza en la muestra 'pos' y
+    // cae dentro de la ventana [start, end). false si la trama queda entera fuera.
+    static bool TrimFrame(uint32_t pos, uint32_t len, uint32_t start, uint32_t end, uint32_t &from, uint32_t &to)
+    {
+      from = (start > pos) ? start - pos : 0;
+      to = (end - pos < len) ? end - pos : len;
+      return from < to;
+    }
+
+    static constexpr int blockFrames = 1152; // 36 subbandas x 32 muestras (MPEG-1 Layer III)
+
+    static constexpr int preAllocMainDataSize () { return (MAD_BUFFER_MDLEN + 7) & ~7; }
+    static constexpr int preAllocOverlapSize () { return (sizeof(mad_fixed_t) * 2 * 32 * 18 + 7) & ~7; }
+    static constexpr int preAllocSize () { return AudioGeneratorMP3::preAllocSize() + preAllocMainDataSize() + preAllocOverlapSize(); }
+
+  protected:
+    bool DecodeBlock();
+    bool DecodeFrame();
+    void ApplyFormat();
+    void AttachLayer3Space();
+    void DetachLayer3Space();
+
+    uint8_t *layer3Space = nullptr; // main_data + overlap dentro de la memoria preasignada
+
+    int16_t block[blockFrames * 2]; // PCM intercalado L/R de la última trama decodificada
+    int blockLen = 0;               // Tramas estéreo válidas en 'block'
+    int blockPos = 0;               // Tramas ya aceptadas por la salida
+    int bufErrors = 0;              // MAD_ERROR_BUFLEN seguidos
+    unsigned int blockRate = 0;     // Formato del bloque en 'block'
+    int blockChannels = 0;
+
+    uint32_t trimSkip = 0;          // Muestras a descartar al principio
+    uint32_t trimLength = 0;        // Muestras válidas, 0 = sin límite
+    uint32_t decodedPos = 0;        // Muestras decodificadas desde begin(), antes de recortar
+    uint32_t blockEnd = 0;          // Posición de la muestra siguiente a la última de 'block'
+    uint32_t seekSkip = 0;          // Muestras a descartar tras Seek()
+};
@@ -0,0 +1,77 @@
+/*
+  AudioOutputDsp
+  Salida intermedia que procesa los bloques con BlockDsp
+*/
+
+#include "AudioOutputDsp.h"
+
+AudioOutputDsp::AudioOutputDsp(BlockDsp *dsp, AudioOutput *sink)
+{
+  this->dsp = dsp;
+  this->sink = sink;
+}
+
+bool AudioOutputDsp::SetRate(int hz)
+{
+  hertz = hz;
+  dsp->setSampleRate(hz);
+  return sink->SetRate(hz);
+}
+
+bool AudioOutputDsp::SetBitsPerSample(int bits)
+{
+  bps = bits;
+  return sink->SetBitsPerSample(bits);
+}
+
+bool AudioOutputDsp::SetChannels(int channels)
+{
+  this->channels = channels;
+  return sink->SetChannels(channels);
+}
+
+bool AudioOutputDsp::begin()
+{
+  return sink->begin();
+}
+
+bool AudioOutputDsp::ConsumeSample(int16_t sample[2])
+{
+  return ConsumeSamples(sample, 1) == 1;
+}
+
+// Entrega lo que quedó del bloque anterior; true si ya no queda nada
+bool AudioOutputDsp::deliverPending()
+{
+  if (discardPending.exchange(false)) {
+    blockLen = blockPos = 0;
+    dsp->restart();
+  }
+  if (blockPos < blockLen) blockPos += sink->ConsumeSamples(block + 2 * blockPos, blockLen - blockPos);
+  return blockPos >= blockLen;
+}
+
+uint16_t AudioOutputDsp::ConsumeSamples(int16_t *samples, uint16_t count)
+{
+  if (!deliverPending()) return 0;
+
+  uint16_t n = count < blockFrames ? count : blockFrames;
+  memcpy(block, samples, n * 2 * sizeof(int16_t));
+  dsp->process(block, n);
+  blockLen = n;
+  blockPos = sink->ConsumeSamples(block, n);
+  return n; // Lo que no se haya entregado ya es responsabilidad de este objeto
+}
+
+bool AudioOutputDsp::loop()
+{
+  deliverPending();
+  return sink->loop();
+}
+
+bool AudioOutputDsp::stop()
+{
+  // Al terminar la pista lo pendiente se sigue entregando en la siguiente; para
+  // cortar en el acto está discard()
+  return sink->stop();
+}
@@ -0,0 +1,50 @@
+/*
+  AudioOutputDsp
+  Salida de audio intermedia que pasa cada bloque por un BlockDsp (ecualizador,
+  volumen y balance) y lo entrega a la salida siguiente (cola PCM o I2S).
+
+  Como el estado de los filtros avanza al procesar, lo procesado que la salida
+  siguiente no acepta se guarda aquí y se entrega antes de aceptar nada nuevo;
+  así ninguna muestra pasa dos veces por el DSP.
+*/
+
+#pragma once
+
+#include <atomic>
+#include "AudioOutput.h"
+#include "BlockDsp.h"
+
+class AudioOutputDsp : public AudioOutput
+{
+  public:
+    AudioOutputDsp(BlockDsp *dsp, AudioOutput *sink);
+    virtual ~AudioOutputDsp() override {}
+
+    virtual bool SetRate(int hz) override;
+    virtual bool SetBitsPerSample(int bits) override;
+    virtual bool SetChannels(int channels) override;
+    virtual bool begin() override;
+    virtual bool ConsumeSample(int16_t sample[2]) override;
+    virtual uint16_t ConsumeSamples(int16_t *samples, uint16_t count) override;
+    virtual bool loop() override;
+    virtual bool stop() override;
+
+    // Descarta lo pendiente y reinicia el DSP (con subida de volumen) antes del
+    // siguiente bloque. Se puede llamar desde otra tarea.
+    void discard() { discardPending = true; }
+
+    // Tramas procesadas que 'sink' aún no ha aceptado
+    uint32_t heldFrames() const { return blockLen - blockPos; }
+
+    static constexpr int blockFrames = 1152; // Una trama MPEG-1 Layer III completa
+
+  protected:
+    bool deliverPending();
+
+    BlockDsp *dsp;
+    AudioOutput *sink;
+    std::atomic<bool> discardPending{false};
+    int16_t block[2 * blockFrames]; // Último bloque procesado
+    uint16_t blockLen = 0;
+    uint16_t blockPos = 0;          // Tramas de 'block' ya entregadas a 'sink'
+};
@@ -0,0 +1,45 @@
+/*
+  AudioOutputI2SBlock
+  AudioOutputI2S con conversión y escritura por bloques
+*/
+
+#include <driver/i2s.h>
+#include "AudioOutputI2SBlock.h"
+#include "I2SPack.h"
+
+uint16_t AudioOutputI2SBlock::ConsumeSamples(int16_t *samples, uint16_t count)
+{
+  //return if we haven't called ::begin yet
+  if (!i2sOn) return 0;
+
+  // Las muestras de 8 bits siguen por el camino genérico, muestra a muestra
+  if (bps == 8) return AudioOutput::ConsumeSamples(samples, count);
+
+  const int32_t gain = gainF2P6;
+  const bool monoIn = (channels == 1);
+  const bool monoOut = this->mono;
+  const uint32_t dacOffset = (output_mode == INTERNAL_DAC) ? 0x8000 : 0;
+
+  uint16_t done = 0;
+  while (done < count) {
+    uint16_t n = count - done;
+    if (n > blockFrames) n = blockFrames;
+    packI2S(samples + 2 * done, words, n, gain, monoIn, monoOut, dacOffset);
+
+    size_t i2s_bytes_written = 0;
+    i2s_write((i2s_port_t)portNo, (const char*)words, n * sizeof(uint32_t), &i2s_bytes_written, 0);
+    done += i2s_bytes_written / sizeof(uint32_t);
+    if (i2s_bytes_written < n * sizeof(uint32_t)) break; // DMA lleno
+  }
+  return done;
+}
+
+bool AudioOutputI2SBlock::SetDmaBuffers(int count)
+{
+  if (count == dma_buf_count) return true;
+  dma_buf_count = count;
+  if (!i2sOn) return true; // Se usa en el próximo begin()
+  i2s_driver_uninstall((i2s_port_t)portNo);
+  i2sOn = false;
+  return begin() && SetRate(hertz); // El driver nuevo arranca a 44.1 kHz
+}
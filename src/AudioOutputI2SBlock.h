@@ -0,0 +1,32 @@
+/*
+  AudioOutputI2SBlock
+  AudioOutputI2S que acepta bloques completos de PCM con ConsumeSamples().
+  Ganancia, mezcla a mono y empaquetado a palabras I2S se hacen en un bucle
+  sobre todo el bloque y se envían con un único i2s_write(), en lugar de una
+  llamada virtual y un i2s_write() por cada trama estéreo.
+*/
+
+#pragma once
+
+#include "AudioOutputI2S.h"
+
+class AudioOutputI2SBlock : public AudioOutputI2S
+{
+  public:
+    AudioOutputI2SBlock(int port=0, int output_mode=EXTERNAL_I2S, int dma_buf_count = 8, int use_apll=APLL_DISABLE)
+      : AudioOutputI2S(port, output_mode, dma_buf_count, use_apll) {}
+    virtual ~AudioOutputI2SBlock() override {}
+
+    virtual uint16_t ConsumeSamples(int16_t *samples, uint16_t count) override;
+
+    // Cambia el número de buffers DMA reinstalando el driver. Lo que haya en el DMA se
+    // pierde, así que solo se usa con el audio ya cortado o parado.
+    bool SetDmaBuffers(int count);
+    int DmaBuffers() const { return dma_buf_count; }
+    int Rate() const { return hertz; }
+
+    static constexpr int blockFrames = 1152; // Una trama MPEG-1 Layer III completa
+
+  protected:
+    uint32_t words[blockFrames]; // Bloque ya convertido a formato I2S (R en los 16 bits altos)
+};
@@ -0,0 +1,184 @@
+/*
+  AudioOutputLoudness
+  Medida de sonoridad integrada (EBU R128) de lo que se decodifica
+*/
+
+#include "AudioOutputLoudness.h"
+#include <math.h>
+
+AudioOutputLoudness::AudioOutputLoudness()
+{
+  hertz = 44100;
+  bps = 16;
+  channels = 2;
+  updateFilters();
+  reset();
+}
+
+bool AudioOutputLoudness::SetRate(int hz)
+{
+  if (hz <= 0) return false;
+  if ((int)hertz != hz) {
+    hertz = hz;
+    updateFilters();
+    reset(); // Una pista no cambia de frecuencia a mitad
+  }
+  return true;
+}
+
+bool AudioOutputLoudness::SetBitsPerSample(int bits)
+{
+  bps = bits;
+  return bits == 16;
+}
+
+bool AudioOutputLoudness::SetChannels(int channels)
+{
+  this->channels = channels;
+  return channels == 1 || channels == 2;
+}
+
+bool AudioOutputLoudness::begin()
+{
+  return true;
+}
+
+bool AudioOutputLoudness::stop()
+{
+  return true;
+}
+
+void AudioOutputLoudness::reset()
+{
+  memset(z, 0, sizeof(z));
+  stepFrames = hertz / 10;
+  stepPos = 0;
+  stepEnergy = 0.0;
+  memset(steps, 0, sizeof(steps));
+  stepCount = 0;
+  memset(binCount, 0, sizeof(binCount));
+  memset(binEnergy, 0, sizeof(binEnergy));
+  peakSample = 0;
+  totalFrames = 0;
+}
+
+// Ponderación K de BS.1770 para cualquier frecuencia: los dos filtros se definen por
+// su frecuencia, ganancia y Q (como en libebur128) y se pasan a digital con la
+// transformada bilineal. A 48 kHz dan los coeficientes de la norma.
+void AudioOutputLoudness::updateFilters()
+{
+  double rate = hertz ? hertz : 44100;
+
+  double f0 = 1681.974450955533;
+  double G = 3.999843853973347;
+  double Q = 0.7071752369554196;
+  double K = tan(M_PI * f0 / rate);
+  double Vh = pow(10.0, G / 20.0);
+  double Vb = pow(Vh, 0.4996667741545416);
+  double a0 = 1.0 + K / Q + K * K;
+  shelf.b0 = (Vh + Vb * K / Q + K * K) / a0;
+  shelf.b1 = 2.0 * (K * K - Vh) / a0;
+  shelf.b2 = (Vh - Vb * K / Q + K * K) / a0;
+  shelf.a1 = 2.0 * (K * K - 1.0) / a0;
+  shelf.a2 = (1.0 - K / Q + K * K) / a0;
+
+  f0 = 38.13547087602444;
+  Q = 0.5003270373238773;
+  K = tan(M_PI * f0 / rate);
+  a0 = 1.0 + K / Q + K * K;
+  highpass.b0 = 1.0;
+  highpass.b1 = -2.0;
+  highpass.b2 = 1.0;
+  highpass.a1 = 2.0 * (K * K - 1.0) / a0;
+  highpass.a2 = (1.0 - K / Q + K * K) / a0;
+}
+
+bool AudioOutputLoudness::ConsumeSample(int16_t sample[2])
+{
+  return ConsumeSamples(sample, 1) == 1;
+}
+
+uint16_t AudioOutputLoudness::ConsumeSamples(int16_t *samples, uint16_t count)
+{
+  const Biquad s = shelf, h = highpass;
+  const int nch = channels == 1 ? 1 : 2; // En mono las dos mitades de la trama son iguales
+  uint16_t done = 0;
+  while (done < count) {
+    uint32_t n = count - done;
+    if (n > stepFrames - stepPos) n = stepFrames - stepPos;
+    const int16_t *p = samples + 2 * done;
+    for (int ch = 0; ch < nch; ch++) {
+      float s1 = z[ch][0], s2 = z[ch][1], h1 = z[ch][2], h2 = z[ch][3];
+      float sum = 0.0f;
+      int32_t pk = peakSample;
+      for (uint32_t i = 0; i < n; i++) {
+        int32_t x = p[2 * i + ch];
+        int32_t ax = x < 0 ? -x : x;
+        if (ax > pk) pk = ax;
+        // Forma directa II transpuesta: dos estados por filtro
+        float in = x * (1.0f / 32768.0f);
+        float y = s.b0 * in + s1;
+        s1 = s.b1 * in - s.a1 * y + s2;
+        s2 = s.b2 * in - s.a2 * y;
+        float w = h.b0 * y + h1;
+        h1 = h.b1 * y - h.a1 * w + h2;
+        h2 = h.b2 * y - h.a2 * w;
+        sum += w * w;
+      }
+      z[ch][0] = s1; z[ch][1] = s2; z[ch][2] = h1; z[ch][3] = h2;
+      peakSample = pk;
+      stepEnergy += sum;
+    }
+    stepPos += n;
+    done += n;
+    if (stepPos == stepFrames) endStep();
+  }
+  totalFrames += count;
+  return count;
+}
+
+// Cierra un tramo de 100 ms y, desde el cuarto, el bloque de 400 ms que termina en él
+void AudioOutputLoudness::endStep()
+{
+  steps[stepCount % 4] = stepEnergy / stepFrames;
+  stepCount++;
+  stepPos = 0;
+  stepEnergy = 0.0;
+  if (stepCount < 4) return;
+
+  double energy = (steps[0] + steps[1] + steps[2] + steps[3]) / 4.0;
+  if (energy <= 0.0) return;
+  float lufs = -0.691f + 10.0f * log10f((float)energy);
+  if (lufs < LOUDNESS_MIN_LUFS) return;
+  int bin = (int)((lufs - LOUDNESS_MIN_LUFS) / LOUDNESS_BIN_LU);
+  if (bin >= LOUDNESS_BINS) bin = LOUDNESS_BINS - 1;
+  binCount[bin]++;
+  binEnergy[bin] += energy;
+}
+
+float AudioOutputLoudness::loudness() const
+{
+  // Media de los bloques que pasan la puerta absoluta, y de ahí la relativa (-10 LU)
+  uint32_t n = 0;
+  double sum = 0.0;
+  for (int i = 0; i < LOUDNESS_BINS; i++) {
+    n += binCount[i];
+    sum += binEnergy[i];
+  }
+  if (!n) return LOUDNESS_MIN_LUFS;
+  float gate = -0.691f + 10.0f * log10f((float)(sum / n)) - 10.0f;
+
+  // Los bloques de la casilla de la puerta cuentan si su media la supera: el error
+  // queda por debajo de la anchura de una casilla y solo en esa casilla
+  n = 0;
+  sum = 0.0;
+  for (int i = 0; i < LOUDNESS_BINS; i++) {
+    if (!binCount[i]) continue;
+    float mean = -0.691f + 10.0f * log10f((float)(binEnergy[i] / binCount[i]));
+    if (mean < gate) continue;
+    n += binCount[i];
+    sum += binEnergy[i];
+  }
+  if (!n) return LOUDNESS_MIN_LUFS;
+  return -0.691f + 10.0f * log10f((float)(sum / n));
+}
@@ -0,0 +1,68 @@
+/*
+  AudioOutputLoudness
+  Salida de audio final que no suena: mide la sonoridad integrada de lo que
+  recibe según EBU R128 / ITU-R BS.1770 (la que usa ReplayGain 2.0) y el pico
+  de muestra.
+
+  Cada canal pasa por el filtro de ponderación K (shelf de agudos y paso alto,
+  dos biquads en float calculados para la frecuencia de muestreo) y se acumula
+  la energía en tramos de 100 ms. Cada bloque de 400 ms (cuatro tramos, con 75 %
+  de solape) por encima de -70 LUFS va a un histograma de LOUDNESS_BIN_LU de
+  ancho que guarda cuántos bloques y su energía sumada; al final se aplica la
+  puerta relativa (-10 LU bajo la media) sobre el histograma. Así la memoria es
+  fija sea cual sea la duración de la pista.
+*/
+
+#pragma once
+
+#include "AudioOutput.h"
+
+#define LOUDNESS_BIN_LU    0.5f
+#define LOUDNESS_MIN_LUFS  -70.0f // Puerta absoluta
+#define LOUDNESS_MAX_LUFS  5.0f
+#define LOUDNESS_BINS      150    // (MAX - MIN) / BIN
+
+class AudioOutputLoudness : public AudioOutput
+{
+  public:
+    AudioOutputLoudness();
+    virtual ~AudioOutputLoudness() override {}
+
+    virtual bool SetRate(int hz) override;
+    virtual bool SetBitsPerSample(int bits) override;
+    virtual bool SetChannels(int channels) override;
+    virtual bool begin() override;
+    virtual bool ConsumeSample(int16_t sample[2]) override;
+    virtual uint16_t ConsumeSamples(int16_t *samples, uint16_t count) override;
+    virtual bool stop() override;
+
+    // Vuelve a empezar la medida (otra pista)
+    void reset();
+
+    // Sonoridad integrada en LUFS; LOUDNESS_MIN_LUFS si no hay nada por encima de la puerta
+    float loudness() const;
+    // Mayor valor absoluto de muestra, 0..1
+    float peak() const { return peakSample / 32768.0f; }
+    uint32_t frames() const { return totalFrames; }
+    uint32_t sampleRate() const { return hertz; }
+
+  private:
+    struct Biquad {
+      float b0, b1, b2, a1, a2;
+    };
+
+    void updateFilters();
+    void endStep();
+
+    Biquad shelf, highpass;
+    float z[2][4];          // Estado de los dos biquads por canal (forma directa II transpuesta)
+    uint32_t stepFrames;    // Tramas en 100 ms
+    uint32_t stepPos;
+    double stepEnergy;      // Suma de cuadrados ponderados del tramo en curso
+    double steps[4];        // Energía media de los últimos cuatro tramos
+    uint32_t stepCount;
+    uint32_t binCount[LOUDNESS_BINS];
+    double binEnergy[LOUDNESS_BINS];
+    int32_t peakSample;
+    uint32_t totalFrames;
+};
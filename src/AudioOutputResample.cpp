@@ -0,0 +1,78 @@
+/*
+  AudioOutputResample
+  Salida intermedia que convierte a una frecuencia de muestreo fija
+*/
+
+#include "AudioOutputResample.h"
+
+AudioOutputResample::AudioOutputResample(uint32_t outputRate, AudioOutput *sink)
+{
+  this->outputRate = outputRate;
+  this->sink = sink;
+  hertz = outputRate;
+  resampler.setRates(outputRate, outputRate);
+  sink->SetRate(outputRate);
+}
+
+bool AudioOutputResample::SetRate(int hz)
+{
+  // La tabla del filtro se recalcula aquí, una vez por cambio de frecuencia
+  if (hz == (int)resampler.inputRate()) return true;
+  hertz = hz;
+  return resampler.setRates(hz, outputRate);
+}
+
+bool AudioOutputResample::SetBitsPerSample(int bits)
+{
+  bps = bits;
+  return sink->SetBitsPerSample(bits);
+}
+
+bool AudioOutputResample::SetChannels(int channels)
+{
+  this->channels = channels;
+  return sink->SetChannels(channels);
+}
+
+bool AudioOutputResample::begin()
+{
+  return sink->begin();
+}
+
+bool AudioOutputResample::ConsumeSample(int16_t sample[2])
+{
+  return ConsumeSamples(sample, 1) == 1;
+}
+
+// Entrega lo que quedó de la última conversión; true si ya no queda nada
+bool AudioOutputResample::deliverPending()
+{
+  if (discardPending.exchange(false)) {
+    blockLen = blockPos = 0;
+    resampler.reset();
+  }
+  if (blockPos < blockLen) blockPos += sink->ConsumeSamples(block + 2 * blockPos, blockLen - blockPos);
+  return blockPos >= blockLen;
+}
+
+uint16_t AudioOutputResample::ConsumeSamples(int16_t *samples, uint16_t count)
+{
+  if (!deliverPending()) return 0;
+  if (resampler.passthrough()) return sink->ConsumeSamples(samples, count);
+
+  uint32_t used;
+  blockLen = resampler.process(samples, count, used, block, blockFrames);
+  blockPos = blockLen ? sink->ConsumeSamples(block, blockLen) : 0;
+  return used;
+}
+
+bool AudioOutputResample::loop()
+{
+  deliverPending();
+  return sink->loop();
+}
+
+bool AudioOutputResample::stop()
+{
+  return sink->stop();
+}
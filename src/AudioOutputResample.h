@@ -0,0 +1,53 @@
+/*
+  AudioOutputResample
+  Salida de audio intermedia que convierte todo a una frecuencia fija antes de la
+  salida siguiente. El I2S se configura una sola vez y los cambios de frecuencia
+  entre pistas no lo reinician (ni vacían el DMA ni producen chasquidos).
+
+  Lo convertido que la salida siguiente no acepta se guarda y se entrega antes de
+  aceptar más entrada, como en AudioOutputDsp.
+*/
+
+#pragma once
+
+#include <atomic>
+#include "AudioOutput.h"
+#include "Resampler.h"
+
+class AudioOutputResample : public AudioOutput
+{
+  public:
+    AudioOutputResample(uint32_t outputRate, AudioOutput *sink);
+    virtual ~AudioOutputResample() override {}
+
+    // 'hz' es la frecuencia de la entrada; la salida siguiente siempre recibe la fija
+    virtual bool SetRate(int hz) override;
+    virtual bool SetBitsPerSample(int bits) override;
+    virtual bool SetChannels(int channels) override;
+    virtual bool begin() override;
+    virtual bool ConsumeSample(int16_t sample[2]) override;
+    virtual uint16_t ConsumeSamples(int16_t *samples, uint16_t count) override;
+    virtual bool loop() override;
+    virtual bool stop() override;
+
+    // Descarta lo pendiente y la historia del filtro; se puede llamar desde otra tarea
+    void discard() { discardPending = true; }
+
+    // Lo aceptado que aún no ha llegado a 'sink': en el filtro (tramas de entrada) y ya
+    // convertido (tramas de salida). Desde la tarea de decodificación o con el audio bloqueado.
+    uint32_t heldInputFrames() const { return resampler.passthrough() ? 0 : resampler.pending(); }
+    uint32_t heldOutputFrames() const { return blockLen - blockPos; }
+
+    static constexpr int blockFrames = 1152;
+
+  protected:
+    bool deliverPending();
+
+    Resampler resampler;
+    uint32_t outputRate;
+    AudioOutput *sink;
+    std::atomic<bool> discardPending{false};
+    int16_t block[2 * blockFrames]; // Última salida del conversor
+    uint16_t blockLen = 0;
+    uint16_t blockPos = 0;          // Tramas de 'block' ya entregadas a 'sink'
+};
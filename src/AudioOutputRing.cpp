@@ -0,0 +1,123 @@
+/*
+  AudioOutputRing
+  Salida de audio que deja las tramas decodificadas en un PcmRing
+*/
+
+#include "AudioOutputRing.h"
+
+AudioOutputRing::AudioOutputRing(PcmRing *ring, AudioOutput *sink)
+{
+  this->ring = ring;
+  this->sink = sink;
+}
+
+// Los cambios se juntan y se encolan con la primera trama del formato nuevo
+bool AudioOutputRing::SetRate(int hz)
+{
+  hertz = hz;
+  formatChanged = true;
+  return true;
+}
+
+bool AudioOutputRing::SetBitsPerSample(int bits)
+{
+  bps = bits;
+  formatChanged = true;
+  return true;
+}
+
+bool AudioOutputRing::SetChannels(int channels)
+{
+  this->channels = channels;
+  formatChanged = true;
+  return true;
+}
+
+bool AudioOutputRing::begin()
+{
+  // Cada pista llama a begin(); la salida real solo se arranca una vez para no
+  // vaciar el DMA (ni cortar la pista que aún suena si la siguiente se prepara antes)
+  if (!sinkStarted) sinkStarted = sink->begin();
+  return sinkStarted;
+}
+
+bool AudioOutputRing::ConsumeSample(int16_t sample[2])
+{
+  // Si la cola está llena el generador lo reintentará en la siguiente llamada a loop()
+  if (formatChanged && !queueFormat()) return false;
+  return ring->write(sample, 1) == 1;
+}
+
+uint16_t AudioOutputRing::ConsumeSamples(int16_t *samples, uint16_t count)
+{
+  if (formatChanged && !queueFormat()) return 0;
+  return ring->write(samples, count);
+}
+
+// Desde el productor: el formato actual vale desde la próxima trama. Con la cola de
+// cambios llena espera, como con la de tramas llena.
+bool AudioOutputRing::queueFormat()
+{
+  uint8_t h = formatHead.load(std::memory_order_relaxed);
+  if ((uint8_t)(h - formatTail.load(std::memory_order_acquire)) == FORMAT_QUEUE) return false;
+  formats[h & (FORMAT_QUEUE - 1)] = { ring->mark(), hertz, bps, channels };
+  formatHead.store(h + 1, std::memory_order_release);
+  formatChanged = false;
+  return true;
+}
+
+// Desde el consumidor: aplica los cambios a los que ha llegado la cola. Devuelve las
+// tramas que se pueden sacar antes del siguiente.
+uint32_t AudioOutputRing::applyFormats()
+{
+  uint8_t t = formatTail.load(std::memory_order_relaxed);
+  while (t != formatHead.load(std::memory_order_acquire)) {
+    const Format &f = formats[t & (FORMAT_QUEUE - 1)];
+    int32_t ahead = (int32_t)(f.pos - ring->readMark());
+    if (ahead > 0) return ahead;
+    if (f.bps != sinkFormat.bps) sink->SetBitsPerSample(f.bps);
+    if (f.channels != sinkFormat.channels) sink->SetChannels(f.channels);
+    if (f.hertz != sinkFormat.hertz) sink->SetRate(f.hertz);
+    sinkFormat = f;
+    formatTail.store(++t, std::memory_order_release);
+  }
+  return UINT32_MAX;
+}
+
+bool AudioOutputRing::stop()
+{
+  // Al terminar una pista no se descarta nada: lo encolado debe sonar hasta el final.
+  // Para cortar el sonido en el acto se usa discard().
+  return true;
+}
+
+void AudioOutputRing::discard()
+{
+  discardMark = ring->mark();
+  discardPending = true;
+}
+
+uint32_t AudioOutputRing::drain()
+{
+  if (discardPending.exchange(false)) {
+    ring->dropUntil(discardMark.load());
+    sink->stop();
+    cut = true;
+  }
+
+  // Cada zona contigua de la cola se entrega como un bloque, sin pasar de un cambio de formato
+  uint32_t sent = 0;
+  for (;;) {
+    uint32_t limit = applyFormats();
+    uint32_t n;
+    const int16_t *frames = ring->readPtr(n);
+    if (n > limit) n = limit;
+    if (!n) break;
+    if (n > 0xffff) n = 0xffff;
+    uint32_t i = sink->ConsumeSamples(const_cast<int16_t *>(frames), n);
+    ring->consume(i);
+    sent += i;
+    if (i < n) break; // DMA lleno, se sigue en la siguiente vuelta
+  }
+  return sent;
+}
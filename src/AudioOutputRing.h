@@ -0,0 +1,68 @@
+/*
+  AudioOutputRing
+  Salida de audio que deja las tramas decodificadas en un PcmRing en lugar de
+  escribirlas en el periférico. Permite decodificar en una tarea y vaciar la
+  cola hacia AudioOutputI2S desde otra.
+
+  Los cambios de formato (frecuencia, canales, bits) se encolan como una marca en
+  la trama a partir de la que valen: drain(), desde el consumidor, los aplica a la
+  salida real al llegar a ella, así que lo anterior (el final de la pista que
+  aún suena) sale con su formato y el I2S solo lo toca la tarea de salida.
+*/
+
+#pragma once
+
+#include "AudioOutput.h"
+#include "PcmRing.h"
+
+class AudioOutputRing : public AudioOutput
+{
+  public:
+    AudioOutputRing(PcmRing *ring, AudioOutput *sink);
+    virtual ~AudioOutputRing() override {}
+
+    // Lado productor (tarea de decodificación)
+    virtual bool SetRate(int hz) override;
+    virtual bool SetBitsPerSample(int bits) override;
+    virtual bool SetChannels(int channels) override;
+    virtual bool begin() override;
+    virtual bool ConsumeSample(int16_t sample[2]) override;
+    virtual uint16_t ConsumeSamples(int16_t *samples, uint16_t count) override;
+    virtual bool stop() override;
+
+    // Pide al consumidor que descarte lo encolado hasta ahora (cambio de pista, stop)
+    void discard();
+
+    // Lado consumidor (tarea de salida): vuelca lo que quepa en la salida real.
+    // Devuelve el número de tramas entregadas.
+    uint32_t drain();
+    // true una vez tras un drain() que ha descartado y parado la salida: el audio ya está
+    // cortado y se puede reconfigurar el I2S sin que se note
+    bool takeCut() { bool c = cut; cut = false; return c; }
+
+  protected:
+    // Formato de la salida real desde la trama 'pos' de la cola
+    struct Format {
+      uint32_t pos;
+      uint16_t hertz;
+      uint8_t bps;
+      uint8_t channels;
+    };
+    static const uint8_t FORMAT_QUEUE = 4; // Cambios pendientes a la vez (potencia de 2)
+
+    bool queueFormat();
+    uint32_t applyFormats();
+
+    PcmRing *ring;
+    AudioOutput *sink;
+    bool sinkStarted = false;
+    bool cut = false;
+    std::atomic<bool> discardPending{false};
+    std::atomic<uint32_t> discardMark{0};
+
+    Format formats[FORMAT_QUEUE];
+    std::atomic<uint8_t> formatHead{0}; // Escrito solo por el productor
+    std::atomic<uint8_t> formatTail{0}; // Escrito solo por el consumidor
+    bool formatChanged = false;         // Productor: encolar antes de la siguiente trama
+    Format sinkFormat = {};             // Consumidor: el puesto en la salida real (0 = sin poner)
+};
@@ -0,0 +1,63 @@
+/*
+  AudioOutputSpectrum
+  Salida intermedia que copia lo que suena al analizador de espectro
+*/
+
+#include "AudioOutputSpectrum.h"
+
+AudioOutputSpectrum::AudioOutputSpectrum(SpectrumAnalyzer *analyzer, AudioOutput *sink)
+{
+  this->analyzer = analyzer;
+  this->sink = sink;
+  hertz = 44100;
+  bps = 16;
+  channels = 2;
+}
+
+bool AudioOutputSpectrum::SetRate(int hz)
+{
+  hertz = hz;
+  analyzer->setRate(hz);
+  return sink->SetRate(hz);
+}
+
+bool AudioOutputSpectrum::SetBitsPerSample(int bits)
+{
+  bps = bits;
+  return sink->SetBitsPerSample(bits);
+}
+
+bool AudioOutputSpectrum::SetChannels(int channels)
+{
+  this->channels = channels;
+  return sink->SetChannels(channels);
+}
+
+bool AudioOutputSpectrum::begin()
+{
+  return sink->begin();
+}
+
+bool AudioOutputSpectrum::ConsumeSample(int16_t sample[2])
+{
+  if (!sink->ConsumeSample(sample)) return false;
+  if (bps == 16) analyzer->feed(sample, 1, channels == 1);
+  return true;
+}
+
+uint16_t AudioOutputSpectrum::ConsumeSamples(int16_t *samples, uint16_t count)
+{
+  uint16_t n = sink->ConsumeSamples(samples, count);
+  if (bps == 16) analyzer->feed(samples, n, channels == 1);
+  return n;
+}
+
+bool AudioOutputSpectrum::loop()
+{
+  return sink->loop();
+}
+
+bool AudioOutputSpectrum::stop()
+{
+  return sink->stop();
+}
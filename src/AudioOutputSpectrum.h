@@ -0,0 +1,32 @@
+/*
+  AudioOutputSpectrum
+  Salida de audio intermedia que entrega todo a la salida siguiente (el I2S) y
+  pasa a un SpectrumAnalyzer las tramas que esta acepta, las que van a sonar.
+  Va justo delante del I2S para que el espectro vaya con lo que se oye: detrás
+  solo queda el DMA, no la cola PCM.
+*/
+
+#pragma once
+
+#include "AudioOutput.h"
+#include "SpectrumAnalyzer.h"
+
+class AudioOutputSpectrum : public AudioOutput
+{
+  public:
+    AudioOutputSpectrum(SpectrumAnalyzer *analyzer, AudioOutput *sink);
+    virtual ~AudioOutputSpectrum() override {}
+
+    virtual bool SetRate(int hz) override;
+    virtual bool SetBitsPerSample(int bits) override;
+    virtual bool SetChannels(int channels) override;
+    virtual bool begin() override;
+    virtual bool ConsumeSample(int16_t sample[2]) override;
+    virtual uint16_t ConsumeSamples(int16_t *samples, uint16_t count) override;
+    virtual bool loop() override;
+    virtual bool stop() override;
+
+  protected:
+    SpectrumAnalyzer *analyzer;
+    AudioOutput *sink;
+};
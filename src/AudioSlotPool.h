@@ -0,0 +1,68 @@
+/*
+  AudioSlotPool
+  Conjunto fijo de parejas fuente SD + decodificador MP3 con su memoria de trabajo
+  preasignada. Cambiar de pista reutiliza un hueco libre en lugar de hacer new/delete,
+  así el heap no crece ni se fragmenta al saltar entre canciones.
+*/
+
+#pragma once
+
+#include "AudioBackend.h"
+#include "AudioFileSourceSDReadAhead.h"
+#include "XingHeader.h"
+
+// Lectura anticipada por bloques grandes (se puede desactivar con -DSD_READAHEAD=0)
+#ifndef SD_READAHEAD
+#define SD_READAHEAD 1
+#endif
+#if SD_READAHEAD
+typedef AudioFileSourceSDReadAhead AudioSlotSource;
+#else
+typedef AudioStorage::Source AudioSlotSource;
+#endif
+
+struct AudioSlot
+{
+  alignas(8) uint8_t arena[AudioCodec::preAllocSize()];
+  AudioSlotSource source;
+  AudioDecoder decoder;
+  XingInfo info;   // Cabecera de la pista abierta (sampleRate == 0 si no se encontró)
+  float gain;      // Ganancia de la pista (ReplayGain); 1 si no se ha medido
+  float peak;      // Pico de muestra de la pista, 0..1 (0 si no se sabe)
+  bool inUse;
+
+  AudioSlot() : decoder(arena, sizeof(arena)), gain(1.0f), peak(0.0f), inUse(false) {}
+};
+
+template <int N>
+class AudioSlotPool
+{
+  public:
+    // Devuelve un hueco libre o nullptr si están todos ocupados
+    AudioSlot *acquire()
+    {
+      for (int i = 0; i < N; i++) {
+        if (!slots[i].inUse) {
+          slots[i].inUse = true;
+          return &slots[i];
+        }
+      }
+      return nullptr;
+    }
+
+    // Para el decodificador, cierra el fichero y deja el hueco libre
+    void release(AudioSlot *slot)
+    {
+      if (!slot) return;
+      if (slot->decoder.isRunning()) slot->decoder.stop();
+      if (slot->source.isOpen()) slot->source.close();
+      slot->inUse = false;
+    }
+
+    int indexOf(const AudioSlot *slot) const { return slot - slots; }
+
+    static constexpr int size() { return N; }
+
+  private:
+    AudioSlot slots[N];
+};
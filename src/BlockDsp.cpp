@@ -0,0 +1,212 @@
+/*
+  BlockDsp
+  Ecualizador, volumen y balance en coma fija sobre bloques PCM
+*/
+
+#include "BlockDsp.h"
+#include <math.h>
+
+#define Q28 (1 << 28)
+#define Q30 (1 << 30)
+#define DSP_MAX_GAIN_DB 15.0f // Con más, los coeficientes de un shelf no caben en Q28
+#define DSP_MAX_GAIN    1.99f // Volumen por ganancia de pista: tiene que caber en Q30
+
+BlockDsp::BlockDsp()
+{
+  clearBands();
+  gain[0] = gain[1] = Q30;
+  updateGains();
+  rampLeft = 0;
+}
+
+void BlockDsp::setSampleRate(uint32_t hz)
+{
+  if (!hz || hz == sampleRate) return;
+  sampleRate = hz;
+  updateCoefs();
+}
+
+void BlockDsp::setVolume(float v)
+{
+  if (v < 0.0f) v = 0.0f;
+  if (v > 1.0f) v = 1.0f;
+  volume = v;
+  updateGains();
+}
+
+void BlockDsp::setBalance(int b)
+{
+  if (b < -100) b = -100;
+  if (b > 100) b = 100;
+  balance = b;
+  updateGains();
+}
+
+void BlockDsp::setTrackGain(float g, float peak)
+{
+  if (g <= 0.0f) g = 1.0f;
+  trackGain = g;
+  trackPeak = peak;
+  updateGains();
+}
+
+bool BlockDsp::setBand(int i, BandType type, float freqHz, float gainDb, float q)
+{
+  if (i < 0 || i >= DSP_MAX_BANDS || freqHz <= 0.0f || q <= 0.0f) return false;
+  if (gainDb > DSP_MAX_GAIN_DB) gainDb = DSP_MAX_GAIN_DB;
+  if (gainDb < -DSP_MAX_GAIN_DB) gainDb = -DSP_MAX_GAIN_DB;
+  bands[i] = { type, freqHz, gainDb, q };
+  updateCoefs();
+  return true;
+}
+
+void BlockDsp::clearBands()
+{
+  for (int i = 0; i < DSP_MAX_BANDS; i++) bands[i] = { PEAK, 1000.0f, 0.0f, 1.0f };
+  nActive = 0;
+  memset(state, 0, sizeof(state));
+}
+
+void BlockDsp::restart()
+{
+  memset(state, 0, sizeof(state));
+  gain[0] = gain[1] = 0;
+  rampLeft = 0;
+  updateGains();
+}
+
+// Coeficientes del "Audio EQ Cookbook" (R. Bristow-Johnson), normalizados por a0
+void BlockDsp::updateCoefs()
+{
+  int n = 0;
+  for (int i = 0; i < DSP_MAX_BANDS; i++) {
+    const Band &b = bands[i];
+    if (b.gainDb == 0.0f || b.freq >= 0.49f * sampleRate) continue;
+
+    float A = powf(10.0f, b.gainDb / 40.0f);
+    float w0 = 2.0f * (float)M_PI * b.freq / sampleRate;
+    float cs = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * b.q);
+    float sA = 2.0f * sqrtf(A) * alpha;
+    float b0, b1, b2, a0, a1, a2;
+    switch (b.type) {
+      case LOW_SHELF:
+        b0 = A * ((A + 1) - (A - 1) * cs + sA);
+        b1 = 2 * A * ((A - 1) - (A + 1) * cs);
+        b2 = A * ((A + 1) - (A - 1) * cs - sA);
+        a0 = (A + 1) + (A - 1) * cs + sA;
+        a1 = -2 * ((A - 1) + (A + 1) * cs);
+        a2 = (A + 1) + (A - 1) * cs - sA;
+        break;
+      case HIGH_SHELF:
+        b0 = A * ((A + 1) + (A - 1) * cs + sA);
+        b1 = -2 * A * ((A - 1) + (A + 1) * cs);
+        b2 = A * ((A + 1) + (A - 1) * cs - sA);
+        a0 = (A + 1) - (A - 1) * cs + sA;
+        a1 = 2 * ((A - 1) - (A + 1) * cs);
+        a2 = (A + 1) - (A - 1) * cs - sA;
+        break;
+      default:
+        b0 = 1 + alpha * A;
+        b1 = -2 * cs;
+        b2 = 1 - alpha * A;
+        a0 = 1 + alpha / A;
+        a1 = -2 * cs;
+        a2 = 1 - alpha / A;
+        break;
+    }
+    Coefs &c = coefs[n++];
+    c.b0 = lroundf(b0 / a0 * Q28);
+    c.b1 = lroundf(b1 / a0 * Q28);
+    c.b2 = lroundf(b2 / a0 * Q28);
+    c.a1 = lroundf(a1 / a0 * Q28);
+    c.a2 = lroundf(a2 / a0 * Q28);
+  }
+  // El estado de cada filtro solo vale si la cascada conserva su forma
+  if (n != nActive) memset(state, 0, sizeof(state));
+  nActive = n;
+}
+
+// Balance lineal: se atenúa solo el canal contrario
+void BlockDsp::updateGains()
+{
+  float v = volume * trackGain;
+  if (trackPeak > 0.0f && v * trackPeak > 1.0f) v = 1.0f / trackPeak; // Sin saturar el pico
+  if (v > DSP_MAX_GAIN) v = DSP_MAX_GAIN;
+  float g[2] = { v, v };
+  if (balance > 0) g[0] *= (100 - balance) / 100.0f;
+  if (balance < 0) g[1] *= (100 + balance) / 100.0f;
+  for (int ch = 0; ch < 2; ch++) {
+    gainTarget[ch] = (int32_t)(g[ch] * Q30);
+    gainStep[ch] = (gainTarget[ch] - gain[ch]) / DSP_RAMP_FRAMES;
+  }
+  rampLeft = DSP_RAMP_FRAMES;
+}
+
+void BlockDsp::process(int16_t *pcm, uint32_t frames)
+{
+  // Sin ecualizador, a volumen máximo y sin balance no hay nada que hacer
+  if (!nActive && !rampLeft && gain[0] == Q30 && gain[1] == Q30) return;
+  while (frames) {
+    uint32_t n = frames < DSP_CHUNK_FRAMES ? frames : DSP_CHUNK_FRAMES;
+    for (uint32_t i = 0; i < 2 * n; i++) work[i] = pcm[i];
+    for (int b = 0; b < nActive; b++) runBand(coefs[b], state[b], work, n);
+    applyGain(work, pcm, n);
+    pcm += 2 * n;
+    frames -= n;
+  }
+}
+
+// Biquad en forma directa I sobre el trozo, los dos canales en la misma pasada. Lo
+// que se pierde al redondear la salida se suma a la muestra siguiente: con filtros
+// graves (polos muy cerca de 1) sin esa corrección el error se amplifica miles de veces.
+void BlockDsp::runBand(const Coefs &c, State *s, int32_t *w, uint32_t frames)
+{
+  const int64_t b0 = c.b0, b1 = c.b1, b2 = c.b2, a1 = c.a1, a2 = c.a2;
+  int32_t lx1 = s[0].x1, lx2 = s[0].x2, ly1 = s[0].y1, ly2 = s[0].y2, le = s[0].err;
+  int32_t rx1 = s[1].x1, rx2 = s[1].x2, ry1 = s[1].y1, ry2 = s[1].y2, re = s[1].err;
+  for (uint32_t i = 0; i < frames; i++) {
+    int32_t lx = w[2 * i];
+    int32_t rx = w[2 * i + 1];
+    int64_t la = b0 * lx + b1 * lx1 + b2 * lx2 - a1 * ly1 - a2 * ly2 + le;
+    int64_t ra = b0 * rx + b1 * rx1 + b2 * rx2 - a1 * ry1 - a2 * ry2 + re;
+    int32_t ly = (int32_t)(la >> 28);
+    int32_t ry = (int32_t)(ra >> 28);
+    le = (int32_t)(la & (Q28 - 1));
+    re = (int32_t)(ra & (Q28 - 1));
+    lx2 = lx1; lx1 = lx; ly2 = ly1; ly1 = ly;
+    rx2 = rx1; rx1 = rx; ry2 = ry1; ry1 = ry;
+    w[2 * i] = ly;
+    w[2 * i + 1] = ry;
+  }
+  s[0] = { lx1, lx2, ly1, ly2, le };
+  s[1] = { rx1, rx2, ry1, ry2, re };
+}
+
+static inline int16_t saturate16(int32_t x)
+{
+  return x > 32767 ? 32767 : (x < -32768 ? -32768 : (int16_t)x);
+}
+
+// Ganancia por canal (Q30 -> Q15 para el producto) y saturación a 16 bits
+void BlockDsp::applyGain(const int32_t *w, int16_t *pcm, uint32_t frames)
+{
+  uint32_t i = 0;
+  // Rampa: la ganancia avanza una vez por trama, sin escalones audibles
+  for (; i < frames && rampLeft; i++, rampLeft--) {
+    gain[0] += gainStep[0];
+    gain[1] += gainStep[1];
+    if (rampLeft == 1) {
+      gain[0] = gainTarget[0];
+      gain[1] = gainTarget[1];
+    }
+    pcm[2 * i] = saturate16((int32_t)(((int64_t)w[2 * i] * (gain[0] >> 15)) >> 15));
+    pcm[2 * i + 1] = saturate16((int32_t)(((int64_t)w[2 * i + 1] * (gain[1] >> 15)) >> 15));
+  }
+  // Ganancia fija para el resto del trozo
+  const int64_t gl = gain[0] >> 15, gr = gain[1] >> 15;
+  for (; i < frames; i++) {
+    pcm[2 * i] = saturate16((int32_t)((w[2 * i] * gl) >> 15));
+    pcm[2 * i + 1] = saturate16((int32_t)((w[2 * i + 1] * gr) >> 15));
+  }
+}
@@ -0,0 +1,93 @@
+/*
+  BlockDsp
+  Procesado en coma fija de bloques PCM estéreo: ecualizador paramétrico de N
+  bandas (biquads en cascada), volumen con rampa, ganancia de pista y balance.
+
+  Cada etapa recorre el bloque entero antes de pasar a la siguiente, con los
+  coeficientes en registros y sin llamadas ni coma flotante en el bucle interno.
+  Las muestras van en Q15 (int16), los coeficientes de los filtros en Q28 (caben
+  ganancias de hasta +/-8 en b0..b2) y los acumuladores en 64 bits. Los cálculos
+  en float (coeficientes, ganancias) solo se hacen al cambiar un parámetro.
+
+  No es reentrante: los parámetros se cambian desde la misma tarea que llama a
+  process() o con el audio bloqueado.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef DSP_MAX_BANDS
+#define DSP_MAX_BANDS   10
+#endif
+#ifndef DSP_RAMP_FRAMES
+#define DSP_RAMP_FRAMES 256  // Duración de una rampa de ganancia (~6 ms a 44.1 kHz)
+#endif
+#define DSP_CHUNK_FRAMES 256 // Tramas por pasada (buffer intermedio de 32 bits)
+
+class BlockDsp
+{
+  public:
+    enum BandType : uint8_t { PEAK, LOW_SHELF, HIGH_SHELF };
+
+    BlockDsp();
+
+    // Recalcula los filtros para otra frecuencia de muestreo
+    void setSampleRate(uint32_t hz);
+
+    // Volumen 0..1 y balance -100 (izquierda) .. 100 (derecha); se llega con rampa
+    void setVolume(float volume);
+    void setBalance(int balance);
+    // Ganancia de la pista (ReplayGain) que multiplica al volumen. Con 'peak' (pico de
+    // muestra de la pista, 0..1) el producto se limita para que el pico no sature.
+    void setTrackGain(float gain, float peak = 0.0f);
+
+    // Banda 'i' del ecualizador (RBJ). Una banda a 0 dB no se procesa.
+    bool setBand(int i, BandType type, float freqHz, float gainDb, float q);
+    void clearBands();
+    int activeBands() const { return nActive; }
+
+    // Olvida el estado de los filtros y sube la ganancia desde 0 (tras un salto o
+    // un cambio de pista, para no arrastrar ni cortar la onda anterior)
+    void restart();
+
+    // Procesa 'frames' tramas estéreo intercaladas en su sitio
+    void process(int16_t *pcm, uint32_t frames);
+
+  private:
+    struct Band {
+      BandType type;
+      float freq;
+      float gainDb;
+      float q;
+    };
+    struct Coefs {
+      int32_t b0, b1, b2, a1, a2; // Q28, a0 normalizado a 1
+    };
+    struct State {
+      int32_t x1, x2, y1, y2;
+      int32_t err; // Resto del redondeo anterior (Q28)
+    };
+
+    void updateCoefs();
+    void updateGains();
+    void runBand(const Coefs &c, State *s, int32_t *work, uint32_t frames);
+    void applyGain(const int32_t *work, int16_t *pcm, uint32_t frames);
+
+    Band bands[DSP_MAX_BANDS];
+    Coefs coefs[DSP_MAX_BANDS];           // Solo las bandas activas, en orden
+    State state[DSP_MAX_BANDS][2];
+    int nActive = 0;
+    uint32_t sampleRate = 44100;
+
+    float volume = 1.0f;
+    int balance = 0;
+    float trackGain = 1.0f;
+    float trackPeak = 0.0f;
+    int32_t gain[2];       // Ganancia actual por canal, Q30
+    int32_t gainTarget[2]; // Ganancia a la que lleva la rampa, Q30
+    int32_t gainStep[2];   // Incremento por trama durante la rampa
+    uint32_t rampLeft = 0; // Tramas que faltan para llegar a gainTarget
+
+    int32_t work[2 * DSP_CHUNK_FRAMES];
+};
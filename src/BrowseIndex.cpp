@@ -0,0 +1,299 @@
+/*
+  BrowseIndex
+  Índices por artista y álbum guardados en la tarjeta SD
+*/
+
+#include <vector>
+#include "BrowseIndex.h"
+
+// Nombres de un nivel, ordenados y con codificación incremental, en un fichero temporal
+struct NameWriter
+{
+  File f;
+  uint32_t count = 0;
+  uint32_t bytes = 0;
+  std::vector<uint32_t> blocks; // Posición de cada bloque en los datos
+  char prev[PLAYLIST_TAG_MAX];
+  size_t prevLen = 0;
+
+  void add(const char *name, size_t len)
+  {
+    if (len >= PLAYLIST_TAG_MAX) len = PLAYLIST_TAG_MAX - 1;
+    size_t shared = 0;
+    if (count % BROWSE_BLOCK == 0) {
+      blocks.push_back(bytes);
+    } else {
+      while (shared < len && shared < prevLen && prev[shared] == name[shared]) shared++;
+    }
+    uint8_t head[2] = { (uint8_t)shared, (uint8_t)(len - shared) };
+    f.write(head, 2);
+    f.write((const uint8_t *)name + shared, len - shared);
+    bytes += 2 + len - shared;
+    memcpy(prev, name, len);
+    prevLen = len;
+    count++;
+  }
+};
+
+static void appendFile(File &out, fs::FS &fs, const char *path)
+{
+  File in = fs.open(path, FILE_READ);
+  uint8_t buf[512];
+  size_t n;
+  while (in && (n = in.read(buf, sizeof(buf))) > 0) {
+    out.write(buf, n);
+  }
+  if (in) in.close();
+  fs.remove(path);
+}
+
+static void writeU32(File &f, uint32_t v)
+{
+  f.write((const uint8_t *)&v, 4);
+}
+
+bool BrowseIndex::build(PlaylistIndex &playlist, fs::FS &fs, const char *path, PlaylistIndex::ThrottleFn throttle)
+{
+  // Clave de ordenación: "artista\1álbum\1" y el número de pista en big endian, que
+  // desempata por el orden de la playlist. '\1' va antes que cualquier letra, así
+  // un artista queda antes que otro que empiece igual y sea más largo.
+  RunSorter sorter;
+  char sorted[PLAYLIST_PATH_MAX];
+  if (!sorter.begin(fs, path, throttle)) return false;
+  PlaylistEntry *e = (PlaylistEntry *)malloc(sizeof(PlaylistEntry));
+  if (!e) return false;
+  char key[2 * PLAYLIST_TAG_MAX + 4];
+  bool ok = true;
+  for (uint32_t i = 0; ok && i < playlist.count(); i++) {
+    if (throttle) throttle();
+    if (!playlist.load(i, *e)) {
+      ok = false;
+      break;
+    }
+    size_t la = strlen(e->artist), lb = strlen(e->album);
+    memcpy(key, e->artist, la);
+    key[la] = '\1';
+    memcpy(key + la + 1, e->album, lb);
+    key[la + lb + 1] = '\1';
+    uint8_t *n = (uint8_t *)key + la + lb + 2;
+    n[0] = i >> 24;
+    n[1] = i >> 16;
+    n[2] = i >> 8;
+    n[3] = i;
+    ok = sorter.add(i, 0, key, la + lb + 6);
+  }
+  free(e);
+  if (!ok || !sorter.finish(sorted, sizeof(sorted))) return false;
+
+  char artistsPath[PLAYLIST_PATH_MAX], albumsPath[PLAYLIST_PATH_MAX];
+  char namesPath[2][PLAYLIST_PATH_MAX];
+  snprintf(artistsPath, sizeof(artistsPath), "%s.art", path);
+  snprintf(albumsPath, sizeof(albumsPath), "%s.alb", path);
+  snprintf(namesPath[ARTISTS], sizeof(namesPath[0]), "%s.nar", path);
+  snprintf(namesPath[ALBUMS], sizeof(namesPath[0]), "%s.nal", path);
+
+  fs.remove(path);
+  File in = fs.open(sorted, FILE_READ);
+  File out = fs.open(path, FILE_WRITE);
+  File artists = fs.open(artistsPath, FILE_WRITE);
+  File albums = fs.open(albumsPath, FILE_WRITE);
+  NameWriter names[2];
+  names[ARTISTS].f = fs.open(namesPath[ARTISTS], FILE_WRITE);
+  names[ALBUMS].f = fs.open(namesPath[ALBUMS], FILE_WRITE);
+  RunRecord *r = (RunRecord *)malloc(sizeof(RunRecord));
+  if (!in || !out || !artists || !albums || !names[0].f || !names[1].f || !r) {
+    free(r);
+    return false;
+  }
+
+  Header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, "MP3B", 4);
+  h.version = version;
+  h.block = BROWSE_BLOCK;
+  h.fingerprint = playlist.fingerprint();
+  h.orderOffset = sizeof(Header);
+  out.write((const uint8_t *)&h, sizeof(h)); // Se reescribe al final con los totales
+
+  // Un recorrido del orden: la tabla de orden va directa al índice y los cambios de
+  // artista y de álbum, a los temporales
+  char prevArtist[PLAYLIST_TAG_MAX] = "", prevAlbum[PLAYLIST_TAG_MAX] = "";
+  while (RunSorter::read(in, *r)) {
+    if (throttle) throttle();
+    const char *artist = r->key;
+    char *sep = (char *)memchr(r->key, '\1', r->keyLen);
+    if (!sep) continue;
+    *sep = '\0';
+    const char *album = sep + 1;
+    sep = (char *)memchr(album, '\1', r->keyLen - (album - r->key));
+    if (!sep) continue;
+    *sep = '\0';
+
+    bool newArtist = !h.tracks || strcmp(artist, prevArtist);
+    if (newArtist) {
+      writeU32(artists, h.albums);
+      names[ARTISTS].add(artist, strlen(artist));
+      strncpy(prevArtist, artist, sizeof(prevArtist) - 1);
+      h.artists++;
+    }
+    if (newArtist || strcmp(album, prevAlbum)) {
+      writeU32(albums, h.tracks);
+      names[ALBUMS].add(album, strlen(album));
+      strncpy(prevAlbum, album, sizeof(prevAlbum) - 1);
+      h.albums++;
+    }
+    writeU32(out, r->a);
+    h.tracks++;
+  }
+  free(r);
+  in.close();
+  fs.remove(sorted);
+  writeU32(artists, h.albums); // Fin del último artista
+  writeU32(albums, h.tracks);  // Fin del último álbum
+  artists.close();
+  albums.close();
+
+  // Tablas y nombres detrás del orden
+  h.artistOffset = h.orderOffset + 4 * h.tracks;
+  h.albumOffset = h.artistOffset + 4 * (h.artists + 1);
+  appendFile(out, fs, artistsPath);
+  appendFile(out, fs, albumsPath);
+  uint32_t pos = h.albumOffset + 4 * (h.albums + 1);
+  for (int level = ARTISTS; level <= ALBUMS; level++) {
+    NameWriter &w = names[level];
+    w.f.close();
+    h.namesOffset[level] = pos;
+    for (uint32_t b : w.blocks) writeU32(out, b);
+    appendFile(out, fs, namesPath[level]);
+    pos += 4 * w.blocks.size() + w.bytes;
+    h.namesEnd[level] = pos;
+  }
+  out.seek(0);
+  out.write((const uint8_t *)&h, sizeof(h));
+  out.close();
+  Serial.printf("Índice por artista y álbum: %u artistas, %u álbumes, %u bytes.\n",
+                (unsigned)h.artists, (unsigned)h.albums, (unsigned)pos);
+  return h.tracks == playlist.count();
+}
+
+bool BrowseIndex::readHeader(File &f, Header &h)
+{
+  if (!f.seek(0)) return false;
+  if (f.read((uint8_t *)&h, sizeof(h)) != sizeof(h)) return false;
+  return !memcmp(h.magic, "MP3B", 4) && h.version == version && h.block == BROWSE_BLOCK;
+}
+
+uint32_t BrowseIndex::storedFingerprint(fs::FS &fs, const char *path)
+{
+  File f = fs.open(path, FILE_READ);
+  Header h;
+  bool valid = f && readHeader(f, h);
+  if (f) f.close();
+  return valid ? h.fingerprint : 0;
+}
+
+bool BrowseIndex::open(fs::FS &fs, const char *path, uint32_t fingerprint, uint32_t tracks)
+{
+  close();
+  this->fs = &fs;
+  strncpy(this->path, path, sizeof(this->path) - 1);
+  this->path[sizeof(this->path) - 1] = '\0';
+  file = fs.open(path, FILE_READ);
+  if (!file || !readHeader(file, header) || header.fingerprint != fingerprint || header.tracks != tracks) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void BrowseIndex::close()
+{
+  if (file) file.close();
+  memset(&header, 0, sizeof(header));
+  blocks[ARTISTS].number = -1;
+  blocks[ALBUMS].number = -1;
+}
+
+bool BrowseIndex::adopt(const char *newPath, uint32_t fingerprint, uint32_t tracks)
+{
+  close();
+  if (!fs) return false;
+  fs->remove(path);
+  if (!fs->rename(newPath, path)) return false;
+  return open(*fs, path, fingerprint, tracks);
+}
+
+uint32_t BrowseIndex::readTable(uint32_t offset, uint32_t i)
+{
+  uint32_t v = 0;
+  if (!file || !file.seek(offset + 4 * i) || file.read((uint8_t *)&v, 4) != 4) return 0;
+  return v;
+}
+
+bool BrowseIndex::loadBlock(Level level, uint32_t number)
+{
+  Block &b = blocks[level];
+  if (b.number == (int32_t)number) return true;
+  b.number = -1;
+  uint32_t count = (this->count(level) + BROWSE_BLOCK - 1) / BROWSE_BLOCK;
+  if (number >= count) return false;
+  uint32_t data = header.namesOffset[level] + 4 * count;
+  uint32_t start = readTable(header.namesOffset[level], number);
+  uint32_t end = number + 1 < count ? readTable(header.namesOffset[level], number + 1) : header.namesEnd[level] - data;
+  if (end < start || end - start > sizeof(b.data)) return false;
+  b.len = end - start;
+  if (!file.seek(data + start) || file.read(b.data, b.len) != b.len) return false;
+  b.number = number;
+  return true;
+}
+
+bool BrowseIndex::name(Level level, uint32_t i, char *out, size_t len)
+{
+  if (i >= count(level) || !loadBlock(level, i / BROWSE_BLOCK)) return false;
+  // Desde el primero del bloque (completo) hasta el pedido, aplicando cada diferencia
+  const Block &b = blocks[level];
+  char cur[PLAYLIST_TAG_MAX];
+  size_t curLen = 0;
+  uint32_t p = 0;
+  for (uint32_t k = 0; k <= i % BROWSE_BLOCK; k++) {
+    if (p + 2 > b.len) return false;
+    uint8_t shared = b.data[p], rest = b.data[p + 1];
+    if (shared > curLen || shared + rest >= sizeof(cur) || p + 2 + rest > b.len) return false;
+    memcpy(cur + shared, b.data + p + 2, rest);
+    curLen = shared + rest;
+    p += 2 + rest;
+  }
+  cur[curLen] = '\0';
+  snprintf(out, len, "%s", cur);
+  return true;
+}
+
+uint32_t BrowseIndex::lowerBound(Level level, uint32_t lo, uint32_t hi, const char *key)
+{
+  char name[PLAYLIST_TAG_MAX];
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (!this->name(level, mid, name, sizeof(name))) break;
+    if (strcmp(name, key) < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+int32_t BrowseIndex::findArtist(const char *name)
+{
+  char found[PLAYLIST_TAG_MAX];
+  uint32_t i = lowerBound(ARTISTS, 0, header.artists, name);
+  if (i < header.artists && this->name(ARTISTS, i, found, sizeof(found)) && !strcmp(found, name)) return i;
+  return -1;
+}
+
+int32_t BrowseIndex::findAlbum(uint32_t a, const char *name)
+{
+  if (a >= header.artists) return -1;
+  char found[PLAYLIST_TAG_MAX];
+  uint32_t hi = firstAlbum(a + 1);
+  uint32_t i = lowerBound(ALBUMS, firstAlbum(a), hi, name);
+  if (i < hi && this->name(ALBUMS, i, found, sizeof(found)) && !strcmp(found, name)) return i;
+  return -1;
+}
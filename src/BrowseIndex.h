@@ -0,0 +1,105 @@
+/*
+  BrowseIndex
+  Índices secundarios de la playlist por artista y álbum, guardados en la tarjeta
+  SD junto al índice principal. Las pistas se ordenan por artista, álbum y
+  posición en la playlist; los artistas y los álbumes de cada artista quedan
+  como tramos seguidos de ese orden, así cada nivel es una tabla de "primero"
+  y bajar de nivel es leer un entero.
+
+  Los nombres se guardan ordenados con codificación incremental (cada uno, los
+  bytes que comparte con el anterior y el resto), en bloques de BROWSE_BLOCK
+  que empiezan con un nombre completo. Leer el nombre 'i' es leer su bloque
+  (uno en caché por nivel) y buscar un nombre es una búsqueda binaria: en RAM
+  solo está lo que se ve en la pantalla, sea cual sea el tamaño de la lista.
+
+  El índice lleva la huella del índice principal del que sale; si no coincide
+  se reconstruye (con RunSorter, en la tarjeta).
+
+  Formato del fichero (little endian):
+    Cabecera  52 bytes   magic "MP3B", versión, huella, pistas, artistas,
+                         álbumes y posición de cada sección
+    Orden     4 bytes    por pista: su número en la playlist
+    Artistas  4 bytes    por artista (más uno): su primer álbum
+    Álbumes   4 bytes    por álbum (más uno): su primera posición en el orden
+    Nombres              de artistas y de álbumes: tabla de bloques (4 bytes
+                         por bloque) y bloques de "compartidos, longitud, texto"
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include "PlaylistIndex.h"
+
+#define BROWSE_BLOCK 16 // Nombres por bloque (el primero, completo)
+
+class BrowseIndex
+{
+  public:
+    // Nivel de nombres: artistas o álbumes
+    enum Level { ARTISTS, ALBUMS };
+
+    // Escribe en 'path' el índice de 'playlist' (abierto). 'throttle' se llama en cada pista.
+    static bool build(PlaylistIndex &playlist, fs::FS &fs, const char *path,
+                      PlaylistIndex::ThrottleFn throttle = nullptr);
+    // Huella del índice guardado en 'path', para saber si hay que reconstruirlo; 0 si no vale
+    static uint32_t storedFingerprint(fs::FS &fs, const char *path);
+
+    // Abre el índice si corresponde al índice principal con esa huella y número de pistas
+    bool open(fs::FS &fs, const char *path, uint32_t fingerprint, uint32_t tracks);
+    void close();
+    bool ready() const { return (bool)file; }
+    // Sustituye el abierto por el que build() escribió en 'newPath'
+    bool adopt(const char *newPath, uint32_t fingerprint, uint32_t tracks);
+
+    uint32_t count(Level level) const { return level == ARTISTS ? header.artists : header.albums; }
+    // Nombre número 'i' del nivel; false si no se puede leer
+    bool name(Level level, uint32_t i, char *out, size_t len);
+
+    // Álbumes del artista 'a': [firstAlbum(a), firstAlbum(a + 1))
+    uint32_t firstAlbum(uint32_t a) { return readTable(header.artistOffset, a); }
+    // Posiciones del álbum 'b' en el orden: [firstPosition(b), firstPosition(b + 1))
+    uint32_t firstPosition(uint32_t b) { return readTable(header.albumOffset, b); }
+    // Número en la playlist de la pista en la posición 'pos' del orden
+    uint32_t track(uint32_t pos) { return readTable(header.orderOffset, pos); }
+
+    // Primera posición en [lo, hi) del nivel cuyo nombre no es menor que 'key'
+    uint32_t lowerBound(Level level, uint32_t lo, uint32_t hi, const char *key);
+    // Artista 'name', o álbum 'name' del artista 'a'; -1 si no está
+    int32_t findArtist(const char *name);
+    int32_t findAlbum(uint32_t a, const char *name);
+
+  private:
+    struct Header {
+      char magic[4];
+      uint16_t version;
+      uint16_t block;
+      uint32_t fingerprint;
+      uint32_t tracks;
+      uint32_t artists;
+      uint32_t albums;
+      uint32_t orderOffset;
+      uint32_t artistOffset;
+      uint32_t albumOffset;
+      uint32_t namesOffset[2]; // Tabla de bloques de cada nivel (los bloques van detrás)
+      uint32_t namesEnd[2];
+    };
+    static constexpr uint16_t version = 1;
+
+    // Último bloque de nombres leído de cada nivel
+    struct Block {
+      int32_t number = -1;
+      uint16_t len = 0;
+      uint8_t data[BROWSE_BLOCK * (2 + PLAYLIST_TAG_MAX)];
+    };
+
+    static bool readHeader(File &f, Header &h);
+    uint32_t readTable(uint32_t offset, uint32_t i);
+    bool loadBlock(Level level, uint32_t number);
+
+    fs::FS *fs = nullptr;
+    char path[PLAYLIST_DIR_MAX];
+    File file;
+    Header header;
+    Block blocks[2];
+};
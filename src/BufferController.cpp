@@ -0,0 +1,162 @@
+/*
+  BufferController
+  Tamaño de la cola PCM y del DMA según vaciados y latencia de la tarjeta
+*/
+
+#include "BufferController.h"
+
+#define SD_PEAK_DECAY 32 // El pico de latencia pierde 1/32 por ventana (~22 ventanas a la mitad)
+#define DECODE_FRAMES 1152 // Un bloque decodificado: lo que tarda en llegar tras una lectura
+
+BufferController::Config BufferController::defaults(uint32_t rate, uint32_t ringStart, uint8_t dmaStart)
+{
+  Config c;
+  c.rate = rate;
+  c.ringMin = BUFFER_RING_MIN;
+  c.ringMax = BUFFER_RING_MAX;
+  c.ringStart = ringStart;
+  c.dmaMin = BUFFER_DMA_MIN;
+  c.dmaMax = BUFFER_DMA_MAX;
+  c.dmaStart = dmaStart;
+  c.dmaStep = BUFFER_DMA_STEP;
+  c.dmaFrames = BUFFER_DMA_FRAMES;
+  c.marginPct = BUFFER_MARGIN_PCT;
+  c.shrinkWindows = BUFFER_SHRINK_WINDOWS;
+  return c;
+}
+
+void BufferController::begin(const Config &config)
+{
+  cfg = config;
+  ringFrames = cfg.ringStart;
+  dmaBuffers = cfg.dmaStart;
+  sdPeakUs = 0;
+  lowWater = UINT32_MAX;
+  quiet = 0;
+  punctual = 0;
+}
+
+uint32_t BufferController::needed() const
+{
+  if (!sdPeakUs) return 0;
+  return (uint64_t)sdPeakUs * cfg.rate / 1000000 * cfg.marginPct / 100 + DECODE_FRAMES;
+}
+
+BufferController::Decision BufferController::update(const Window &w)
+{
+  uint32_t peak = sdPeakUs - sdPeakUs / SD_PEAK_DECAY;
+  sdPeakUs = w.sdPeakUs > peak ? w.sdPeakUs : peak;
+  if (w.ringLow < lowWater) lowWater = w.ringLow;
+
+  bool emptied = w.ringEmpty || w.dry;
+  quiet = emptied || w.late ? 0 : quiet + 1;
+  punctual = w.late ? 0 : punctual + 1;
+
+  if (w.late && dmaBuffers < cfg.dmaMax) {
+    uint32_t n = dmaBuffers + cfg.dmaStep;
+    dmaBuffers = n > cfg.dmaMax ? cfg.dmaMax : n;
+    return { GROW_DMA, "la salida llegó tarde" };
+  }
+  if (emptied && ringFrames < cfg.ringMax) {
+    ringFrames *= 2;
+    lowWater = UINT32_MAX;
+    return { GROW_RING, w.dry ? "corte" : "cola vacía" };
+  }
+  uint32_t dmaTotal = (uint32_t)dmaBuffers * cfg.dmaFrames;
+  uint32_t need = needed();
+  if (need > ringFrames + dmaTotal && ringFrames < cfg.ringMax) {
+    while (ringFrames < cfg.ringMax && ringFrames + dmaTotal < need) ringFrames *= 2;
+    lowWater = UINT32_MAX;
+    quiet = 0;
+    return { GROW_RING, "latencia de la tarjeta" };
+  }
+  if (emptied || w.late) return { KEEP, "al máximo" };
+
+  // Reducir solo tras un tiempo sin incidentes y sin bajar de lo que pide la latencia
+  if (quiet >= cfg.shrinkWindows) {
+    uint32_t half = ringFrames / 2;
+    bool unused = lowWater != UINT32_MAX && lowWater >= half;
+    lowWater = UINT32_MAX;
+    quiet = 0;
+    if (ringFrames > cfg.ringMin && unused && half + dmaTotal >= 2 * need) { // Holgura: sin ir y volver
+      ringFrames = half;
+      return { SHRINK_RING, "la mitad de la cola sin usar" };
+    }
+  }
+  if (punctual >= 2u * cfg.shrinkWindows && dmaBuffers > cfg.dmaMin) {
+    uint32_t n = dmaBuffers > cfg.dmaMin + cfg.dmaStep ? dmaBuffers - cfg.dmaStep : cfg.dmaMin;
+    if (ringFrames + n * cfg.dmaFrames >= need) {
+      punctual = 0;
+      dmaBuffers = n;
+      return { SHRINK_DMA, "la salida siempre a tiempo" };
+    }
+  }
+  return { KEEP, "" };
+}
+
+const char *BufferController::actionName(Action a)
+{
+  switch (a) {
+    case GROW_RING: return "cola +";
+    case SHRINK_RING: return "cola -";
+    case GROW_DMA: return "DMA +";
+    case SHRINK_DMA: return "DMA -";
+    default: return "sin cambios";
+  }
+}
+
+void BufferWatch::begin(uint32_t windowUs)
+{
+  this->windowUs = windowUs;
+  clear();
+}
+
+void BufferWatch::clear()
+{
+  win = { 0, 0, 0, UINT32_MAX, 0 };
+}
+
+void BufferWatch::pass(const Pass &p)
+{
+  // Tras un corte o una pausa la cola vacía es el arranque, no un fallo
+  if (p.cut || !p.playing) primed = false;
+  if (p.sent) primed = true;
+  if (primed) {
+    if (!p.level && !p.sent) {
+      if (!inEmpty) {
+        inEmpty = true;
+        dryCounted = false;
+        emptyStart = p.nowUs;
+        win.ringEmpty++;
+      } else if (!dryCounted && p.nowUs - emptyStart > p.dmaUs) {
+        dryCounted = true;
+        win.dry++; // El DMA se ha quedado sin nada que sonar
+      }
+    } else {
+      inEmpty = false;
+      if (p.level < win.ringLow) win.ringLow = p.level;
+      if (p.nowUs - lastPass > p.dmaUs) win.late++; // Con datos en cola y el DMA ya agotado
+    }
+  }
+  lastPass = p.nowUs;
+
+  if (!p.playing) {
+    windowStart = p.nowUs; // Solo cuentan las ventanas sonando
+  } else if (p.nowUs - windowStart >= windowUs) {
+    if (!doneReady.load(std::memory_order_acquire)) {
+      done = win;
+      doneReady.store(true, std::memory_order_release);
+    }
+    clear();
+    windowStart = p.nowUs;
+  }
+}
+
+bool BufferWatch::take(BufferController::Window &w)
+{
+  if (!doneReady.load(std::memory_order_acquire)) return false;
+  w = done;
+  doneReady.store(false, std::memory_order_release);
+  if (w.ringLow == UINT32_MAX) w.ringLow = 0;
+  return true;
+}
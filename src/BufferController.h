@@ -0,0 +1,146 @@
+/*
+  BufferController
+  Decide en marcha el tamaño de la cola PCM y el número de buffers DMA del I2S
+  a partir de lo que pasa en la reproducción: vaciados de la cola, cortes del
+  DMA, retrasos de la tarea de salida y la lectura más lenta de la tarjeta.
+  Más buffer evita cortes cuando la tarjeta se atasca; menos ahorra RAM y, en el
+  DMA, el retardo entre pulsar un botón y oír la pista nueva (tras un corte el
+  DMA entero suena en silencio antes que ella).
+
+  Cada ventana (p.ej. un segundo de reproducción) se llama a update() con lo
+  observado y devuelve como mucho un cambio:
+    - la salida llegó tarde con datos en cola: más DMA (solo el DMA cubre eso);
+    - la cola se vació: el doble de cola;
+    - la lectura más lenta reciente (pico que decae poco a poco), con margen,
+      no cabe en la cola más el DMA: la cola que la cubra;
+    - tras 'shrinkWindows' ventanas sin incidentes, si la cola nunca bajó de la
+      mitad y la mitad sigue cubriendo la latencia: la mitad de cola; y tras el
+      doble de ventanas sin retrasos de la salida, menos DMA.
+  Todo dentro de los límites de la configuración.
+
+  Solo decide; quien lo usa aplica los cambios (la cola en marcha, el DMA cuando
+  el audio ya está cortado) y avisa con setRing()/setDma() si no puede. No usa
+  nada del ESP32, así que se prueba igual en el PC (test/test_buffer_controller).
+
+  BufferWatch hace las ventanas: la tarea de salida le pasa cada vuelta lo que ha
+  enviado y lo que queda en cola, y quien decide (otra tarea) toma cada ventana
+  acabada con take().
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Límites por defecto (se pueden cambiar con build_flags)
+#ifndef BUFFER_RING_MIN
+#define BUFFER_RING_MIN       1024  // Tramas de la cola (~23 ms a 44.1 kHz)
+#endif
+#ifndef BUFFER_RING_MAX
+#define BUFFER_RING_MAX       16384 // 64 KB (~370 ms)
+#endif
+#ifndef BUFFER_DMA_MIN
+#define BUFFER_DMA_MIN        4     // Buffers DMA
+#endif
+#ifndef BUFFER_DMA_MAX
+#define BUFFER_DMA_MAX        32
+#endif
+#define BUFFER_DMA_STEP       2
+#define BUFFER_DMA_FRAMES     128   // Tramas por buffer (dma_buf_len de AudioOutputI2S)
+#define BUFFER_MARGIN_PCT     150
+#define BUFFER_SHRINK_WINDOWS 30
+
+class BufferController
+{
+  public:
+    struct Config {
+      uint32_t rate;          // Frecuencia de salida
+      uint32_t ringMin;       // Tramas de la cola (potencias de 2)
+      uint32_t ringMax;
+      uint32_t ringStart;
+      uint8_t dmaMin;         // Buffers DMA
+      uint8_t dmaMax;
+      uint8_t dmaStart;
+      uint8_t dmaStep;        // Buffers que se añaden o quitan de una vez
+      uint16_t dmaFrames;     // Tramas por buffer DMA
+      uint16_t marginPct;     // Buffer pedido sobre la lectura más lenta, en %
+      uint16_t shrinkWindows; // Ventanas sin incidentes antes de reducir
+    };
+
+    // Lo observado durante una ventana
+    struct Window {
+      uint32_t ringEmpty;     // Veces que la cola se vació sonando
+      uint32_t dry;           // ...y siguió vacía más de lo que dura el DMA (corte audible)
+      uint32_t late;          // La salida volvió más tarde de lo que dura el DMA, con datos en cola
+      uint32_t ringLow;       // Mínimo de tramas en cola
+      uint32_t sdPeakUs;      // Lectura de bloque de la tarjeta más lenta (0 si no se sabe)
+    };
+
+    enum Action : uint8_t { KEEP, GROW_RING, SHRINK_RING, GROW_DMA, SHRINK_DMA };
+    struct Decision {
+      Action action;
+      const char *reason;     // Para el registro
+    };
+
+    // Configuración con los límites BUFFER_* y los tamaños iniciales
+    static Config defaults(uint32_t rate, uint32_t ringStart, uint8_t dmaStart);
+
+    void begin(const Config &config);
+    Decision update(const Window &w);
+
+    // Tamaños decididos
+    uint32_t ring() const { return ringFrames; }
+    uint8_t dma() const { return dmaBuffers; }
+    // Tramas que hacen falta en cola y DMA para la latencia de la tarjeta
+    uint32_t needed() const;
+    uint32_t sdPeak() const { return sdPeakUs; }
+
+    // Lo que de verdad se ha podido aplicar (p.ej. sin memoria para crecer)
+    void setRing(uint32_t frames) { ringFrames = frames; }
+    void setDma(uint8_t buffers) { dmaBuffers = buffers; }
+
+    static const char *actionName(Action a);
+
+  private:
+    Config cfg;
+    uint32_t ringFrames = 0;
+    uint8_t dmaBuffers = 0;
+    uint32_t sdPeakUs = 0;
+    uint32_t lowWater = 0;   // Mínimo de la cola desde la última reducción o incidente
+    uint32_t quiet = 0;      // Ventanas seguidas sin vaciados ni cortes
+    uint32_t punctual = 0;   // Ventanas seguidas sin retrasos de la salida
+};
+
+class BufferWatch
+{
+  public:
+    // Una vuelta de la tarea de salida, justo después de pasar la cola al DMA: si ha
+    // quedado cola, el DMA está lleno
+    struct Pass {
+      uint32_t nowUs;
+      uint32_t sent;          // Tramas enviadas al DMA
+      uint32_t level;         // Tramas que quedan en cola
+      uint32_t dmaUs;         // Lo que suena el DMA lleno
+      bool cut;               // El audio se acaba de cortar (cambio de pista o stop)
+      bool playing;           // Sonando (ni parado ni en pausa)
+    };
+
+    // Una ventana cada 'windowUs' sonando
+    void begin(uint32_t windowUs);
+    void pass(const Pass &p);
+    // Desde otra tarea: la última ventana acabada, una vez (sdPeakUs a 0). Si no se toma
+    // antes de que acabe la siguiente, esa se pierde.
+    bool take(BufferController::Window &w);
+
+  private:
+    void clear();
+
+    uint32_t windowUs = 0;
+    BufferController::Window win;
+    BufferController::Window done;
+    std::atomic<bool> doneReady{false};
+    uint32_t windowStart = 0, lastPass = 0, emptyStart = 0;
+    bool primed = false;      // Ha sonado algo desde el último corte o pausa
+    bool inEmpty = false;
+    bool dryCounted = false;
+};
@@ -0,0 +1,161 @@
+/*
+  ButtonInput
+  Botones por interrupción con cola de eventos
+*/
+
+#include "ButtonInput.h"
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+
+int ButtonInput::add(uint8_t pin, uint8_t flags)
+{
+  if (count >= BUTTON_MAX) return -1;
+  Button &b = buttons[count];
+  b.owner = this;
+  b.pin = pin;
+  b.flags = flags;
+  b.bouncing = false;
+  b.edgeTick = 0;
+  b.pressed = false;
+  b.state = IDLE;
+  b.pressTick = 0;
+  b.debounceTimer = nullptr;
+  b.holdTimer = nullptr;
+  return count++;
+}
+
+bool ButtonInput::begin()
+{
+  queue = xQueueCreate(BUTTON_QUEUE_LEN, sizeof(ButtonEvent));
+  if (!queue) return false;
+
+  for (int i = 0; i < count; i++) {
+    Button &b = buttons[i];
+    b.debounceTimer = xTimerCreate("btnDeb", pdMS_TO_TICKS(BUTTON_DEBOUNCE_MS), pdFALSE, &b, onDebounce);
+    b.holdTimer = xTimerCreate("btnHold", pdMS_TO_TICKS(BUTTON_LONG_MS), pdFALSE, &b, onHold);
+    if (!b.debounceTimer || !b.holdTimer) return false;
+    pinMode(b.pin, INPUT_PULLUP);
+    b.pressed = digitalRead(b.pin) == LOW;
+    attachInterruptArg(digitalPinToInterrupt(b.pin), onEdge, &b, CHANGE);
+  }
+  return true;
+}
+
+bool ButtonInput::sleepArm()
+{
+  for (int i = 0; i < count; i++) {
+    Button &b = buttons[i];
+    if (b.bouncing || b.pressed || b.state != IDLE || digitalRead(b.pin) == LOW) return false;
+  }
+  for (int i = 0; i < count; i++) {
+    // Despertar por nivel bajo sin que la interrupción (ahora por nivel) salte sin parar
+    gpio_intr_disable((gpio_num_t)buttons[i].pin);
+    gpio_wakeup_enable((gpio_num_t)buttons[i].pin, GPIO_INTR_LOW_LEVEL);
+  }
+  esp_sleep_enable_gpio_wakeup();
+  return true;
+}
+
+void ButtonInput::sleepDisarm()
+{
+  for (int i = 0; i < count; i++) {
+    Button &b = buttons[i];
+    gpio_wakeup_disable((gpio_num_t)b.pin); // También quita el tipo de interrupción
+    gpio_set_intr_type((gpio_num_t)b.pin, GPIO_INTR_ANYEDGE);
+    gpio_intr_enable((gpio_num_t)b.pin);
+    if ((digitalRead(b.pin) == LOW) != b.pressed && !b.bouncing) {
+      b.bouncing = true;
+      b.edgeTick = xTaskGetTickCount();
+      xTimerReset(b.debounceTimer, 0);
+    }
+  }
+}
+
+// Interrupción de flanco: solo anota el instante y (re)arma el temporizador de rebote
+void IRAM_ATTR ButtonInput::onEdge(void *arg)
+{
+  Button *b = (Button *)arg;
+  if (!b->bouncing) {
+    b->bouncing = true;
+    b->edgeTick = xTaskGetTickCountFromISR();
+  }
+  BaseType_t woken = pdFALSE;
+  xTimerResetFromISR(b->debounceTimer, &woken);
+  if (woken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+// El nivel lleva BUTTON_DEBOUNCE_MS sin cambiar
+void ButtonInput::onDebounce(TimerHandle_t t)
+{
+  Button &b = *(Button *)pvTimerGetTimerID(t);
+  b.bouncing = false;
+  bool pressed = digitalRead(b.pin) == LOW;
+  if (pressed == b.pressed) return; // Rebote que volvió al mismo nivel
+  b.pressed = pressed;
+
+  if (pressed) {
+    if (b.state == WAIT_DOUBLE) {
+      xTimerStop(b.holdTimer, 0);
+      b.state = SECOND_PRESS;
+      b.owner->emit(b, BUTTON_DOUBLE);
+    } else {
+      b.state = PRESSED;
+      b.pressTick = b.edgeTick;
+      b.owner->startHold(b, BUTTON_LONG_MS);
+    }
+    return;
+  }
+
+  // Suelto
+  if (b.state == PRESSED) {
+    xTimerStop(b.holdTimer, 0);
+    if (b.flags & DETECT_DOUBLE) {
+      b.state = WAIT_DOUBLE;
+      b.owner->startHold(b, BUTTON_DOUBLE_MS);
+      return;
+    }
+    b.owner->emit(b, BUTTON_CLICK);
+  } else if (b.state == HELD) {
+    xTimerStop(b.holdTimer, 0);
+  }
+  b.state = IDLE;
+}
+
+void ButtonInput::onHold(TimerHandle_t t)
+{
+  Button &b = *(Button *)pvTimerGetTimerID(t);
+  switch (b.state) {
+    case PRESSED:
+      b.state = HELD;
+      b.owner->emit(b, BUTTON_LONG);
+      if (b.flags & DETECT_REPEAT) b.owner->startHold(b, BUTTON_REPEAT_MS);
+      break;
+    case HELD:
+      b.owner->emit(b, BUTTON_REPEAT);
+      b.owner->startHold(b, BUTTON_REPEAT_MS);
+      break;
+    case WAIT_DOUBLE:
+      b.state = IDLE;
+      b.owner->emit(b, BUTTON_CLICK);
+      break;
+    default:
+      break;
+  }
+}
+
+void ButtonInput::startHold(Button &b, uint32_t ms)
+{
+  // Llamado desde la tarea de temporizadores: no puede esperar a su propia cola
+  xTimerChangePeriod(b.holdTimer, pdMS_TO_TICKS(ms), 0);
+}
+
+void ButtonInput::emit(Button &b, ButtonEventType type)
+{
+  ButtonEvent ev;
+  ev.button = &b - buttons;
+  ev.type = type;
+  ev.timeMs = b.pressTick * portTICK_PERIOD_MS;
+  xQueueSend(queue, &ev, 0); // Si la cola está llena se pierde el evento, loop() va muy atrasado
+}
@@ -0,0 +1,114 @@
+/*
+  ButtonInput
+  Botones por interrupción con cola de eventos.
+  Cada flanco del pin reinicia un temporizador de FreeRTOS; cuando el nivel lleva
+  BUTTON_DEBOUNCE_MS estable, el temporizador (en la tarea de temporizadores, no
+  en loop()) decide si es una pulsación corta, doble o larga y deja el evento en
+  una cola. loop() solo mira la cola: si nadie toca un botón no hace nada más.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/timers.h>
+
+#ifndef BUTTON_DEBOUNCE_MS
+#define BUTTON_DEBOUNCE_MS  30
+#endif
+#ifndef BUTTON_LONG_MS
+#define BUTTON_LONG_MS      600   // Mantener para pulsación larga
+#endif
+#ifndef BUTTON_REPEAT_MS
+#define BUTTON_REPEAT_MS    250   // Repetición mientras se mantiene tras la pulsación larga
+#endif
+#ifndef BUTTON_DOUBLE_MS
+#define BUTTON_DOUBLE_MS    300   // Ventana para la segunda pulsación
+#endif
+#define BUTTON_MAX          4
+#define BUTTON_QUEUE_LEN    16
+
+enum ButtonEventType : uint8_t
+{
+  BUTTON_CLICK,    // Pulsación corta (con doble activada, cuando vence la ventana)
+  BUTTON_DOUBLE,   // Segunda pulsación dentro de BUTTON_DOUBLE_MS
+  BUTTON_LONG,     // Mantenido BUTTON_LONG_MS
+  BUTTON_REPEAT,   // Sigue mantenido, cada BUTTON_REPEAT_MS
+  BUTTON_WAKE      // Sin botón: wake() desde otra tarea (poll() no lo devuelve)
+};
+
+struct ButtonEvent
+{
+  uint8_t button;        // Índice devuelto por add()
+  ButtonEventType type;
+  uint32_t timeMs;       // Momento del primer flanco de la pulsación
+};
+
+class ButtonInput
+{
+  public:
+    enum {
+      DETECT_DOUBLE = 1,   // Retrasa BUTTON_CLICK hasta que vence la ventana de doble pulsación
+      DETECT_REPEAT = 2    // BUTTON_REPEAT tras BUTTON_LONG mientras se mantiene
+    };
+
+    // Botón activo en bajo con pull-up. Devuelve su índice o -1.
+    int add(uint8_t pin, uint8_t flags = 0);
+    bool begin();
+
+    // Siguiente evento, sin esperar
+    bool poll(ButtonEvent &ev)
+    {
+      while (queue && xQueueReceive(queue, &ev, 0) == pdTRUE) {
+        if (ev.type != BUTTON_WAKE) return true;
+      }
+      return false;
+    }
+
+    // Espera hasta 'ms' a que haya un evento, sin sacarlo de la cola
+    bool wait(uint32_t ms)
+    {
+      ButtonEvent ev;
+      return queue && xQueuePeek(queue, &ev, pdMS_TO_TICKS(ms)) == pdTRUE;
+    }
+
+    // Corta la espera de wait() (otra tarea tiene algo para loop())
+    void wake()
+    {
+      ButtonEvent ev = { 0, BUTTON_WAKE, 0 };
+      if (queue) xQueueSend(queue, &ev, 0);
+    }
+
+    // Light sleep: sleepArm() hace que pulsar un botón despierte (false, sin cambiar nada,
+    // si hay uno pulsado o rebotando). sleepDisarm() al despertar vuelve a las
+    // interrupciones por flanco y trata la pulsación que despertó como un flanco más.
+    bool sleepArm();
+    void sleepDisarm();
+
+  private:
+    enum State : uint8_t { IDLE, PRESSED, HELD, WAIT_DOUBLE, SECOND_PRESS };
+
+    struct Button {
+      ButtonInput *owner;
+      uint8_t pin;
+      uint8_t flags;
+      volatile bool bouncing;      // Hay flancos sin confirmar
+      volatile TickType_t edgeTick;
+      bool pressed;                // Último nivel estable
+      State state;
+      TickType_t pressTick;
+      TimerHandle_t debounceTimer;
+      TimerHandle_t holdTimer;     // Pulsación larga, repetición y ventana de doble
+    };
+
+    static void IRAM_ATTR onEdge(void *arg);
+    static void onDebounce(TimerHandle_t t);
+    static void onHold(TimerHandle_t t);
+    void emit(Button &b, ButtonEventType type);
+    void startHold(Button &b, uint32_t ms);
+
+    Button buttons[BUTTON_MAX];
+    int count = 0;
+    QueueHandle_t queue = nullptr;
+};
@@ -0,0 +1,187 @@
+/*
+  CpuGovernor
+  Frecuencia de la CPU según la carga de la decodificación
+*/
+
+#include "CpuGovernor.h"
+
+CpuGovernor::Config CpuGovernor::defaults()
+{
+  Config c;
+  c.count = 0;
+  const uint16_t all[] = { 80, 160, 240 };
+  for (uint16_t f : all) {
+    if (f >= CPU_FREQ_MIN && f <= CPU_FREQ_MAX) c.freqs[c.count++] = f;
+  }
+  c.relockMhz = CPU_FREQ_RELOCK;
+  c.targetPermille = CPU_LOAD_TARGET;
+  c.lowRingPermille = CPU_LOW_RING;
+  c.downWindows = CPU_DOWN_WINDOWS;
+  c.holdWindows = CPU_HOLD_WINDOWS;
+  return c;
+}
+
+void CpuGovernor::begin(const Config &config, uint16_t startMhz)
+{
+  cfg = config;
+  follow(startMhz);
+  hold = 0;
+}
+
+void CpuGovernor::follow(uint16_t mhz)
+{
+  level = cfg.count - 1;
+  while (level > 0 && cfg.freqs[level] > mhz) level--;
+  slack = 0;
+}
+
+// El nivel más bajo en el que la carga (a la frecuencia máxima) no pasa del objetivo
+uint8_t CpuGovernor::levelFor(uint32_t loadPermille) const
+{
+  uint32_t top = cfg.freqs[cfg.count - 1];
+  for (uint8_t i = 0; i < cfg.count; i++) {
+    if ((uint64_t)loadPermille * top <= (uint64_t)cfg.targetPermille * cfg.freqs[i]) return i;
+  }
+  return cfg.count - 1;
+}
+
+bool CpuGovernor::relocks(uint8_t from, uint8_t to) const
+{
+  return cfg.relockMhz && (cfg.freqs[from] == cfg.relockMhz) != (cfg.freqs[to] == cfg.relockMhz);
+}
+
+// El nivel más cercano a 'to' (por encima del actual) al que se llega sin cambiar de PLL
+uint8_t CpuGovernor::reachable(uint8_t to) const
+{
+  while (to > level && relocks(level, to)) to--;
+  return to;
+}
+
+CpuGovernor::Decision CpuGovernor::update(const Window &w)
+{
+  uint8_t old = level;
+  uint8_t top = cfg.count - 1;
+  if (!w.playing) {
+    slack = hold = 0;
+    peakLoad = 0;
+    level = w.background ? top : 0;
+    return { level != old, w.background ? "trabajo en segundo plano" : "parado" };
+  }
+  uint32_t load = w.expectPermille > w.loadPermille ? w.expectPermille : w.loadPermille;
+  if (!load) return { false, "" }; // Sin medida todavía: se queda como está
+  if (load > peakLoad) peakLoad = load;
+
+  uint8_t want = levelFor(load);
+  if (want > level) {
+    slack = 0;
+    uint8_t to = reachable(want); // Lo que falte, en el próximo corte
+    if (to == level) return { false, "" };
+    level = to;
+    return { true, w.expectPermille > w.loadPermille ? "carga prevista" : "carga" };
+  }
+  if (hold) {
+    hold--;
+    return { false, "" };
+  }
+  if (want == level) {
+    slack = 0;
+    return { false, "" };
+  }
+  if (++slack < cfg.downWindows) return { false, "" };
+  if (relocks(level, level - 1)) return { false, "" }; // Espera a un corte
+  slack = 0;
+  level--;
+  return { true, "holgura" };
+}
+
+bool CpuGovernor::guard(uint32_t ringPermille)
+{
+  uint8_t top = cfg.count - 1;
+  if (ringPermille >= cfg.lowRingPermille || level == top) return false;
+  // Un escalón; si aun así sigue bajando, a la máxima (sin cambiar de PLL)
+  uint8_t to = reachable(ringPermille < cfg.lowRingPermille / 2 ? top : level + 1);
+  if (to == level) return false;
+  level = to;
+  slack = 0;
+  hold = cfg.holdWindows;
+  return true;
+}
+
+bool CpuGovernor::cut()
+{
+  hold = 0; // Lo que la hizo subir era de lo que sonaba
+  uint32_t load = peakLoad;
+  peakLoad = 0;
+  if (!load) return false;
+  // Dentro del mismo PLL ya se ocupa update(); aquí solo lo que sonando no se puede.
+  // Con la mayor carga desde el corte anterior: lo que pasa de ella no se cubrirá hasta otro.
+  uint8_t want = levelFor(load);
+  if (want == level || !relocks(level, want)) return false;
+  level = want;
+  slack = 0;
+  return true;
+}
+
+void CpuGovernor::account(uint32_t ms, uint32_t loadPermille)
+{
+  uint32_t busy = (uint64_t)loadPermille * cfg.freqs[cfg.count - 1] / mhz();
+  awakeMs[level] += ms;
+  charge += (uint64_t)modelMicroAmps(mhz(), busy > 1000 ? 1000 : busy) * ms;
+}
+
+void CpuGovernor::accountSleep(uint32_t ms)
+{
+  sleptMs += ms;
+  charge += (uint64_t)sleepMicroAmps * ms;
+}
+
+uint32_t CpuGovernor::averageMicroAmps() const
+{
+  uint64_t ms = sleptMs;
+  for (uint8_t i = 0; i < cfg.count; i++) ms += awakeMs[i];
+  return ms ? charge / ms : 0;
+}
+
+// Hoja de datos del ESP32, modem-sleep (CPU en marcha, radio apagada): de la CPU
+// parada a los dos núcleos ocupados. Entre medias, proporcional a la ocupación.
+uint32_t CpuGovernor::modelMicroAmps(uint16_t mhz, uint32_t busyPermille)
+{
+  uint32_t idle, busy;
+  if (mhz <= 80) {
+    idle = 20000; busy = 31000;
+  } else if (mhz <= 160) {
+    idle = 27000; busy = 44000;
+  } else {
+    idle = 30000; busy = 68000;
+  }
+  if (busyPermille > 2000) busyPermille = 2000;
+  return idle + (uint64_t)(busy - idle) * busyPermille / 2000;
+}
+
+void GovernorWatch::begin(CpuGovernor &governor, uint32_t windowMs)
+{
+  gov = &governor;
+  this->windowMs = windowMs;
+  primed = false;
+}
+
+GovernorWatch::Step GovernorWatch::pass(const Pass &p)
+{
+  Step s = { false, false, false };
+  // guard() solo con la cola llena una vez desde el corte: al arrancar baja sin que falte CPU
+  if (p.cut || !p.playing) primed = false;
+  if (p.cut) s.cut = gov->cut();
+  if (p.playing && p.level >= p.capacity * 3 / 4) primed = true;
+  if (primed && p.capacity) s.raised = gov->guard((uint64_t)p.level * 1000 / p.capacity);
+
+  uint32_t elapsed = p.nowMs - windowStart;
+  if (elapsed < windowMs) return s;
+  windowStart = p.nowMs;
+  uint32_t slept = p.sleptMs - lastSlept;
+  lastSlept = p.sleptMs;
+  gov->accountSleep(slept);
+  gov->account(elapsed > slept ? elapsed - slept : 0, p.playing ? p.loadPermille : 0);
+  s.window = true;
+  return s;
+}
+
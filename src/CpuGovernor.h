@@ -0,0 +1,156 @@
+/*
+  CpuGovernor
+  Elige la frecuencia de la CPU según la carga medida de la decodificación.
+  La carga se da normalizada a la frecuencia máxima (ciclos, no tiempo), así que
+  la prevista a otra frecuencia es carga * máxima / frecuencia. Cada ventana
+  (p.ej. un segundo de reproducción) se llama a update() con lo observado:
+    - parado o en pausa: la mínima, o la máxima si hay trabajo en segundo plano
+      (acaba antes y se puede dormir antes);
+    - si la carga medida (o la esperada, p.ej. antes de un fundido con dos
+      decodificadores) pasa de 'targetPermille' a la frecuencia actual: en el
+      acto la más baja que la deja por debajo;
+    - si una más baja basta durante 'downWindows' ventanas seguidas: un escalón
+      abajo.
+  Entre ventanas, guard() sube un escalón en cuanto la cola baja de
+  'lowRingPermille', sin esperar a la medida, y a la máxima si baja de la mitad
+  de eso; después no baja en 'holdWindows' ventanas.
+
+  Pasar por 'relockMhz' (240 MHz en el ESP32) cambia el PLL (480 <-> 320 MHz) y
+  el reloj del I2S se corta un instante. Sonando no se pasa nunca, ni para subir
+  (update() y guard() se quedan en el lado del PLL actual); solo con el audio
+  parado o en el momento de un corte (cut(), p.ej. al cambiar de pista a mano),
+  hacia donde pida la mayor carga desde el corte anterior.
+
+  GovernorWatch lo lleva desde la tarea de salida: cada vuelta guard() con la
+  cola, cut() en los cortes y, cada ventana, la cuenta del consumo; quien lo usa
+  completa la ventana (trabajo en segundo plano, carga esperada) y llama a update().
+
+  Incluye un modelo de consumo del ESP32 (hoja de datos, sin radio) para estimar
+  la batería a partir del tiempo en cada frecuencia. No usa nada del ESP32, así
+  que se prueba igual en el PC (test/test_cpu_governor).
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef CPU_FREQ_MIN
+#define CPU_FREQ_MIN        80    // MHz; por debajo el APB baja y se para el I2S
+#endif
+#ifndef CPU_FREQ_MAX
+#define CPU_FREQ_MAX        240
+#endif
+#ifndef CPU_LOAD_TARGET
+#define CPU_LOAD_TARGET     600   // Carga máxima de la decodificación a la frecuencia elegida, en milésimas
+#endif
+#ifndef CPU_FREQ_RELOCK
+#define CPU_FREQ_RELOCK     240   // Frecuencia que usa otro PLL (0 = cambiar sin esperar a un corte)
+#endif
+#define CPU_LOW_RING        250   // Cola por debajo de la que se sube sin esperar, en milésimas
+#define CPU_DOWN_WINDOWS    5
+#define CPU_HOLD_WINDOWS    30
+#define CPU_FREQ_LEVELS     4
+
+class CpuGovernor
+{
+  public:
+    struct Config {
+      uint16_t freqs[CPU_FREQ_LEVELS]; // MHz de menor a mayor
+      uint8_t count;
+      uint16_t relockMhz;       // 0 = todas usan el mismo PLL
+      uint16_t targetPermille;
+      uint16_t lowRingPermille;
+      uint16_t downWindows;     // Ventanas con holgura antes de bajar un escalón
+      uint16_t holdWindows;     // Ventanas sin bajar tras guard()
+    };
+
+    // Lo observado durante una ventana
+    struct Window {
+      bool playing;             // Sonando (ni parado ni en pausa)
+      bool background;          // Hay trabajo en segundo plano (índice, sonoridad)
+      uint32_t loadPermille;    // Carga medida a la frecuencia máxima (0 = sin medida)
+      uint32_t expectPermille;  // Carga que se espera en breve (0 = la medida)
+    };
+
+    struct Decision {
+      bool change;
+      const char *reason;       // Para el registro
+    };
+
+    // 80, 160 y 240 MHz con los límites CPU_*
+    static Config defaults();
+
+    void begin(const Config &config, uint16_t startMhz);
+    Decision update(const Window &w);
+    // Cada vuelta con el nivel de la cola (en milésimas): true si ha subido
+    bool guard(uint32_t ringPermille);
+    // El audio se acaba de cortar: true si ha pasado al otro lado de relockMhz porque
+    // la mayor carga desde el corte anterior lo pide (lo que sonando no se puede)
+    bool cut();
+    // La frecuencia puesta no es la que eligió (no se pudo aplicar a tiempo): sigue desde 'mhz'
+    void follow(uint16_t mhz);
+
+    uint16_t mhz() const { return cfg.freqs[level]; }
+    uint8_t levels() const { return cfg.count; }
+    uint16_t freq(uint8_t i) const { return cfg.freqs[i]; }
+
+    // Cuenta 'ms' despierto a la frecuencia actual con la decodificación ocupando
+    // 'loadPermille' (a la frecuencia máxima), o dormido, para estimar el consumo
+    void account(uint32_t ms, uint32_t loadPermille);
+    void accountSleep(uint32_t ms);
+    uint32_t msAt(uint8_t i) const { return awakeMs[i]; }
+    uint32_t sleepMs() const { return sleptMs; }
+    uint32_t averageMicroAmps() const;
+
+    // Consumo del ESP32 en µA a 'mhz' con los dos núcleos ocupados 'busyPermille'
+    // milésimas en total (0..2000), y dormido (light sleep)
+    static uint32_t modelMicroAmps(uint16_t mhz, uint32_t busyPermille);
+    static constexpr uint32_t sleepMicroAmps = 800;
+
+  private:
+    uint8_t levelFor(uint32_t loadPermille) const;
+    bool relocks(uint8_t from, uint8_t to) const;
+    uint8_t reachable(uint8_t to) const;
+
+    Config cfg;
+    uint8_t level = 0;
+    uint16_t slack = 0;   // Ventanas seguidas en las que basta una frecuencia más baja
+    uint16_t hold = 0;
+    uint32_t peakLoad = 0;  // Mayor carga desde el último corte (de medida y esperada)
+
+    uint32_t awakeMs[CPU_FREQ_LEVELS] = {};
+    uint32_t sleptMs = 0;
+    uint64_t charge = 0;  // µA·ms
+};
+
+class GovernorWatch
+{
+  public:
+    // Una vuelta de la tarea de salida
+    struct Pass {
+      uint32_t nowMs;
+      uint32_t sleptMs;         // Total dormido hasta ahora (la tarea no corre dormida)
+      uint32_t level;           // Tramas en cola
+      uint32_t capacity;        // Tramas de la cola
+      uint32_t loadPermille;    // Carga medida a la frecuencia máxima
+      bool cut;                 // El audio se acaba de cortar (cambio de pista o stop)
+      bool playing;             // Sonando (ni parado ni en pausa)
+    };
+
+    struct Step {
+      bool cut;                 // cut() ha cambiado de PLL: se aplica antes de que suene nada
+      bool raised;              // guard() ha subido
+      bool window;              // Ventana acabada y contada: toca update()
+    };
+
+    // Una ventana cada 'windowMs'
+    void begin(CpuGovernor &governor, uint32_t windowMs);
+    Step pass(const Pass &p);
+
+  private:
+    CpuGovernor *gov = nullptr;
+    uint32_t windowMs = 0;
+    uint32_t windowStart = 0;
+    uint32_t lastSlept = 0;
+    bool primed = false;      // La cola ha llegado a 3/4 sonando desde el último corte
+};
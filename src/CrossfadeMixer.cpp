@@ -0,0 +1,141 @@
+/*
+  CrossfadeMixer
+  Fundido de potencia constante entre dos decodificadores
+*/
+
+#include "CrossfadeMixer.h"
+#include <math.h>
+
+int16_t CrossfadeMixer::quarterSine[257];
+
+CrossfadeMixer::CrossfadeMixer(AudioOutput *sink)
+{
+  this->sink = sink;
+  for (int i = 0; i < 2; i++) {
+    inputs[i].mixer = this;
+    inputs[i].id = i;
+  }
+  if (!quarterSine[256]) {
+    for (int k = 0; k <= 256; k++) quarterSine[k] = (int16_t)lroundf(sinf((float)M_PI / 2 * k / 256) * 32767);
+  }
+}
+
+void CrossfadeMixer::setActive(int i)
+{
+  inputs[1 - i].len = 0;
+  inputs[1 - i].ended = false;
+  inputs[i].ended = false;
+  active = i;
+  fadeLen = fadePos = 0;
+}
+
+void CrossfadeMixer::start(int i, uint32_t frames)
+{
+  if (i == active || !frames) return;
+  to = i;
+  inputs[to].len = 0;
+  inputs[to].ended = false;
+  inputs[active].ended = false;
+  fadeLen = frames;
+  fadePos = 0;
+}
+
+void CrossfadeMixer::cancel()
+{
+  if (!fadeLen) return;
+  setActive(active);
+}
+
+void CrossfadeMixer::endInput(int i)
+{
+  inputs[i].ended = true;
+  // Sin nada más que mezclar el fundido se da por terminado
+  if (fadeLen && inputs[active].ended && inputs[to].ended) fadePos = fadeLen;
+  mix();
+}
+
+// Entrega lo que quedó de la última mezcla; true si ya no queda nada
+bool CrossfadeMixer::deliverPending()
+{
+  if (discardPending.exchange(false)) {
+    outLen = outPos = 0;
+    inputs[0].len = inputs[1].len = 0;
+  }
+  if (outPos < outLen) outPos += sink->ConsumeSamples(out + 2 * outPos, outLen - outPos);
+  return outPos >= outLen;
+}
+
+// Quita 'frames' tramas del principio de lo acumulado en la entrada
+void CrossfadeMixer::take(Input &in, uint16_t frames)
+{
+  if (frames > in.len) frames = in.len;
+  in.len -= frames;
+  if (in.len) memmove(in.buf, in.buf + 2 * frames, in.len * 2 * sizeof(int16_t));
+}
+
+uint16_t CrossfadeMixer::consume(int id, int16_t *samples, uint16_t count)
+{
+  if (!deliverPending()) return 0;
+  Input &in = inputs[id];
+
+  if (!fadeLen) {
+    if (id != active) return 0; // La siguiente pista espera a que empiece el fundido
+    if (in.len) {
+      // Lo que esta entrada acumuló durante el fundido va antes que lo nuevo
+      memcpy(out, in.buf, in.len * 2 * sizeof(int16_t));
+      outLen = in.len;
+      outPos = 0;
+      in.len = 0;
+      if (!deliverPending()) return 0;
+    }
+    return sink->ConsumeSamples(samples, count);
+  }
+
+  if (id != active && id != to) return 0;
+  uint16_t n = blockFrames - in.len;
+  if (n > count) n = count;
+  memcpy(in.buf + 2 * in.len, samples, n * 2 * sizeof(int16_t));
+  in.len += n;
+  mix();
+  return n;
+}
+
+static inline int16_t saturate16(int32_t x)
+{
+  return x > 32767 ? 32767 : (x < -32768 ? -32768 : (int16_t)x);
+}
+
+// Mezcla lo que tengan las dos entradas (una entrada terminada cuenta como silencio)
+void CrossfadeMixer::mix()
+{
+  Input &a = inputs[active];
+  Input &b = inputs[to];
+  while (fadePos < fadeLen && deliverPending()) {
+    uint32_t n = blockFrames;
+    if (!a.ended && a.len < n) n = a.len;
+    if (!b.ended && b.len < n) n = b.len;
+    if (fadeLen - fadePos < n) n = fadeLen - fadePos;
+    if (!n) return;
+
+    // Posición en la curva en Q16 de índices de la tabla, calculada una vez por bloque
+    uint32_t phase = (uint32_t)(((uint64_t)fadePos << 24) / fadeLen);
+    uint32_t step = (256u << 16) / fadeLen;
+    for (uint32_t i = 0; i < n; i++, phase += step) {
+      uint32_t k = phase >> 16;
+      int32_t f = (phase >> 8) & 0xff;
+      if (k >= 256) { k = 255; f = 256; }
+      int32_t gIn = quarterSine[k] + (((quarterSine[k + 1] - quarterSine[k]) * f) >> 8);
+      int32_t gOut = quarterSine[256 - k] + (((quarterSine[255 - k] - quarterSine[256 - k]) * f) >> 8);
+      int32_t al = i < a.len ? a.buf[2 * i] : 0, ar = i < a.len ? a.buf[2 * i + 1] : 0;
+      int32_t bl = i < b.len ? b.buf[2 * i] : 0, br = i < b.len ? b.buf[2 * i + 1] : 0;
+      out[2 * i] = saturate16((al * gOut + bl * gIn) >> 15);
+      out[2 * i + 1] = saturate16((ar * gOut + br * gIn) >> 15);
+    }
+    take(a, n);
+    take(b, n);
+    fadePos += n;
+    outLen = n;
+    outPos = 0;
+  }
+  deliverPending();
+}
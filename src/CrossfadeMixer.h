@@ -0,0 +1,87 @@
+/*
+  CrossfadeMixer
+  Mezclador de dos entradas para fundir el final de una pista con el principio
+  de la siguiente. Cada decodificador escribe en su entrada (input(i)); fuera de
+  un fundido solo suena la entrada activa, que pasa directa a la salida sin
+  copias. Durante el fundido cada entrada acumula un bloque y se mezclan las
+  tramas que tengan las dos, con ganancias de potencia constante (coseno para la
+  que sale, seno para la que entra) en Q15 e interpoladas trama a trama.
+
+  No es reentrante: todo se llama desde la tarea de decodificación o con el
+  audio bloqueado, salvo discard().
+*/
+
+#pragma once
+
+#include <atomic>
+#include "AudioOutput.h"
+
+class CrossfadeMixer
+{
+  public:
+    static constexpr int blockFrames = 1152;
+
+    CrossfadeMixer(AudioOutput *sink);
+
+    AudioOutput *input(int i) { return &inputs[i]; }
+
+    // Termina cualquier fundido: solo suena la entrada 'i' (lo que tenga acumulado, primero)
+    void setActive(int i);
+    int activeInput() const { return active; }
+
+    // Empieza a fundir la entrada activa con 'to' durante 'frames' tramas
+    void start(int to, uint32_t frames);
+    // Cancela el fundido y descarta lo acumulado de la entrada que iba a entrar
+    void cancel();
+    // La entrada 'i' no dará más muestras; hasta el final del fundido se mezcla silencio
+    void endInput(int i);
+    bool ended(int i) const { return inputs[i].ended; }
+
+    bool fading() const { return fadeLen != 0; }
+    bool fadeDone() const { return fadeLen && fadePos >= fadeLen; }
+
+    // Descarta lo acumulado y lo mezclado sin entregar; se puede llamar desde otra tarea
+    void discard() { discardPending = true; }
+
+    // Tramas de la entrada activa aceptadas que aún no han llegado a la salida:
+    // acumuladas para el fundido y mezcladas sin entregar
+    uint32_t heldFrames() const { return inputs[active].len + (outLen - outPos); }
+
+  protected:
+    class Input : public AudioOutput
+    {
+      public:
+        virtual bool SetRate(int hz) override { hertz = hz; return mixer->sink->SetRate(hz); }
+        virtual bool SetBitsPerSample(int bits) override { bps = bits; return mixer->sink->SetBitsPerSample(bits); }
+        virtual bool SetChannels(int ch) override { channels = ch; return mixer->sink->SetChannels(ch); }
+        virtual bool begin() override { return mixer->sink->begin(); }
+        virtual bool ConsumeSample(int16_t sample[2]) override { return ConsumeSamples(sample, 1) == 1; }
+        virtual uint16_t ConsumeSamples(int16_t *samples, uint16_t count) override { return mixer->consume(id, samples, count); }
+        virtual bool loop() override { mixer->deliverPending(); return mixer->sink->loop(); }
+        virtual bool stop() override { return mixer->sink->stop(); }
+
+        CrossfadeMixer *mixer;
+        int id;
+        int16_t buf[2 * blockFrames]; // Tramas acumuladas durante el fundido
+        uint16_t len = 0;
+        bool ended = false;
+    };
+
+    uint16_t consume(int id, int16_t *samples, uint16_t count);
+    bool deliverPending();
+    void mix();
+    void take(Input &in, uint16_t frames);
+
+    AudioOutput *sink;
+    Input inputs[2];
+    int active = 0;            // Entrada que suena fuera del fundido (la que sale durante él)
+    int to = 1;
+    uint32_t fadeLen = 0;      // Tramas del fundido en curso (0 = sin fundido)
+    uint32_t fadePos = 0;      // Tramas ya mezcladas
+    std::atomic<bool> discardPending{false};
+    int16_t out[2 * blockFrames]; // Última mezcla (o restos de una entrada) por entregar
+    uint16_t outLen = 0;
+    uint16_t outPos = 0;
+
+    static int16_t quarterSine[257]; // sin(pi/2 * k/256) en Q15
+};
@@ -0,0 +1,28 @@
+/*
+  I2SPack
+  Conversión de un bloque de tramas PCM estéreo a palabras I2S de 32 bits (R en
+  los 16 bits altos): mezcla a mono, ganancia en F2P6 con la misma saturación
+  que AudioOutput::Amplify() y desplazamiento del DAC interno. Es el bucle de
+  AudioOutputI2SBlock; aparte para medirlo en el PC (bench --output).
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+static inline void packI2S(const int16_t *s, uint32_t *words, uint16_t n, int32_t gain, bool monoIn, bool monoOut,
+                           uint32_t dacOffset)
+{
+  for (uint16_t i = 0; i < n; i++) {
+    int32_t l = s[2 * i];
+    int32_t r = monoIn ? l : s[2 * i + 1];
+    if (monoOut) {
+      l = r = (l + r) >> 1;
+    }
+    l = (l * gain) >> 6;
+    r = (r * gain) >> 6;
+    l = l < -32767 ? -32767 : (l > 32767 ? 32767 : l);
+    r = r < -32767 ? -32767 : (r > 32767 ? 32767 : r);
+    words[i] = (((uint32_t)r + dacOffset) << 16) | (((uint32_t)l + dacOffset) & 0xffff);
+  }
+}
@@ -0,0 +1,162 @@
+/*
+  Id3Reader
+  Lector ligero de etiquetas ID3v2 e ID3v1
+*/
+
+#include "Id3Reader.h"
+
+// Añade el código 'cp' en UTF-8 si cabe
+static void putUtf8(char *dst, size_t &n, uint32_t cp)
+{
+  char tmp[4];
+  size_t len;
+  if (cp < 0x80) { tmp[0] = cp; len = 1; }
+  else if (cp < 0x800) { tmp[0] = 0xC0 | (cp >> 6); tmp[1] = 0x80 | (cp & 0x3F); len = 2; }
+  else { tmp[0] = 0xE0 | (cp >> 12); tmp[1] = 0x80 | ((cp >> 6) & 0x3F); tmp[2] = 0x80 | (cp & 0x3F); len = 3; }
+  if (n + len >= ID3_TEXT_MAX) return;
+  memcpy(dst + n, tmp, len);
+  n += len;
+}
+
+// Convierte un campo de texto ID3 (byte de codificación + datos) a UTF-8 sin espacios finales
+static void decodeText(const uint8_t *data, uint32_t len, char *out)
+{
+  size_t n = 0;
+  out[0] = '\0';
+  if (len < 1) return;
+  uint8_t enc = data[0];
+  data++;
+  len--;
+
+  if (enc == 1 || enc == 2) {
+    // UTF-16 con BOM (1) o big endian (2); los pares sustitutos se cambian por '?'
+    bool le = false;
+    if (enc == 1 && len >= 2) {
+      le = (data[0] == 0xFF && data[1] == 0xFE);
+      if ((data[0] == 0xFF && data[1] == 0xFE) || (data[0] == 0xFE && data[1] == 0xFF)) {
+        data += 2;
+        len -= 2;
+      }
+    }
+    for (uint32_t i = 0; i + 1 < len; i += 2) {
+      uint16_t cu = le ? (data[i] | (data[i + 1] << 8)) : ((data[i] << 8) | data[i + 1]);
+      if (cu == 0) break;
+      putUtf8(out, n, (cu >= 0xD800 && cu < 0xE000) ? '?' : cu);
+    }
+  } else if (enc == 3) {
+    // UTF-8: copiar sin partir caracteres multibyte
+    for (uint32_t i = 0; i < len && data[i]; ) {
+      uint32_t clen = (data[i] < 0x80) ? 1 : (data[i] >= 0xF0) ? 4 : (data[i] >= 0xE0) ? 3 : 2;
+      if (i + clen > len || n + clen >= ID3_TEXT_MAX) break;
+      memcpy(out + n, data + i, clen);
+      n += clen;
+      i += clen;
+    }
+  } else {
+    // ISO-8859-1
+    for (uint32_t i = 0; i < len && data[i]; i++) putUtf8(out, n, data[i]);
+  }
+
+  while (n && (out[n - 1] == ' ' || out[n - 1] == '\0')) n--;
+  out[n] = '\0';
+}
+
+static uint32_t syncsafe(const uint8_t *p)
+{
+  return ((uint32_t)(p[0] & 0x7F) << 21) | ((uint32_t)(p[1] & 0x7F) << 14) | ((uint32_t)(p[2] & 0x7F) << 7) | (p[3] & 0x7F);
+}
+
+static bool readId3v2(fs::File &f, Id3Tags &tags)
+{
+  uint8_t hdr[10];
+  if (!f.seek(0) || f.read(hdr, 10) != 10 || memcmp(hdr, "ID3", 3)) return false;
+  uint8_t major = hdr[3];
+  if (major < 2 || major > 4) return false;
+  uint32_t end = 10 + syncsafe(hdr + 6);
+  uint32_t pos = 10;
+
+  // Cabecera extendida
+  if ((hdr[5] & 0x40) && major >= 3) {
+    uint8_t ext[4];
+    if (f.read(ext, 4) != 4) return false;
+    uint64_t extLen = (major == 4) ? syncsafe(ext)
+                                   : 4 + (uint64_t)(((uint32_t)ext[0] << 24) | (ext[1] << 16) | (ext[2] << 8) | ext[3]);
+    if (extLen > end - pos) return false;
+    pos += extLen;
+  }
+
+  const uint32_t frameHdr = (major == 2) ? 6 : 10;
+  const uint32_t idLen = (major == 2) ? 3 : 4;
+  uint8_t found = 0; // Bits: título, artista, álbum, duración
+  uint8_t data[1 + 2 * ID3_TEXT_MAX + 2];
+
+  while (pos + frameHdr <= end && found != 0x0F) {
+    uint8_t fh[10];
+    if (!f.seek(pos) || f.read(fh, frameHdr) != frameHdr) break;
+    if (fh[0] == 0) break; // Relleno: no hay más tramas
+
+    uint32_t size;
+    if (major == 2) size = (fh[3] << 16) | (fh[4] << 8) | fh[5];
+    else if (major == 4) size = syncsafe(fh + 4);
+    else size = ((uint32_t)fh[4] << 24) | (fh[5] << 16) | (fh[6] << 8) | fh[7];
+    pos += frameHdr;
+    if (size == 0 || size > end - pos) break; // Sin dar la vuelta con tamaños de basura
+
+    int field = -1;
+    if (!memcmp(fh, major == 2 ? "TT2" : "TIT2", idLen)) field = 0;
+    else if (!memcmp(fh, major == 2 ? "TP1" : "TPE1", idLen)) field = 1;
+    else if (!memcmp(fh, major == 2 ? "TAL" : "TALB", idLen)) field = 2;
+    else if (!memcmp(fh, major == 2 ? "TLE" : "TLEN", idLen)) field = 3;
+
+    if (field >= 0 && !(found & (1 << field))) {
+      // Solo se lee lo que cabe en el campo; el resto de la trama se salta
+      uint32_t n = size < sizeof(data) ? size : sizeof(data);
+      if (f.read(data, n) != n) break;
+      char *dst = field == 0 ? tags.title : field == 1 ? tags.artist : field == 2 ? tags.album : nullptr;
+      if (dst) {
+        decodeText(data, n, dst);
+      } else {
+        char num[ID3_TEXT_MAX];
+        decodeText(data, n, num);
+        tags.lengthMs = strtoul(num, nullptr, 10);
+      }
+      found |= 1 << field;
+    }
+    pos += size; // Las tramas que no interesan (APIC incluida) nunca se leen
+  }
+  return true;
+}
+
+static void copyV1(const uint8_t *src, char *dst)
+{
+  size_t n = 0;
+  for (int i = 0; i < 30 && src[i]; i++) putUtf8(dst, n, src[i]);
+  while (n && dst[n - 1] == ' ') n--;
+  dst[n] = '\0';
+}
+
+static bool readId3v1(fs::File &f, Id3Tags &tags)
+{
+  uint8_t tag[128];
+  size_t size = f.size();
+  if (size < 128 || !f.seek(size - 128) || f.read(tag, 128) != 128 || memcmp(tag, "TAG", 3)) return false;
+  if (!tags.title[0]) copyV1(tag + 3, tags.title);
+  if (!tags.artist[0]) copyV1(tag + 33, tags.artist);
+  if (!tags.album[0]) copyV1(tag + 63, tags.album);
+  return true;
+}
+
+bool readId3(fs::File &f, Id3Tags &tags)
+{
+  tags.title[0] = '\0';
+  tags.artist[0] = '\0';
+  tags.album[0] = '\0';
+  tags.lengthMs = 0;
+
+  bool v2 = readId3v2(f, tags);
+  bool v1 = false;
+  if (!tags.title[0] || !tags.artist[0] || !tags.album[0]) {
+    v1 = readId3v1(f, tags);
+  }
+  return v2 || v1;
+}
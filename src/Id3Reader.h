@@ -0,0 +1,26 @@
+/*
+  Id3Reader
+  Lector ligero de etiquetas ID3v2 (2.2, 2.3 y 2.4) e ID3v1.
+  Recorre las tramas de la etiqueta leyendo solo sus cabeceras: copia título,
+  artista, álbum y duración y salta el resto (APIC y demás) con seek(), sin
+  cargarlas en memoria. Se detiene en cuanto tiene los cuatro campos.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#define ID3_TEXT_MAX 64
+
+struct Id3Tags
+{
+  char title[ID3_TEXT_MAX];   // Texto en UTF-8
+  char artist[ID3_TEXT_MAX];
+  char album[ID3_TEXT_MAX];
+  uint32_t lengthMs;          // TLEN, 0 si no está
+};
+
+// Lee la etiqueta ID3v2 del principio del fichero y completa con la ID3v1 del final
+// los campos que falten. Devuelve true si ha encontrado alguna de las dos.
+bool readId3(fs::File &f, Id3Tags &tags);
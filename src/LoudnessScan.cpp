@@ -0,0 +1,107 @@
+/*
+  LoudnessScan
+  Análisis de sonoridad en segundo plano para ReplayGain
+*/
+
+#include "LoudnessScan.h"
+#include <math.h>
+#include "XingHeader.h"
+
+bool LoudnessScan::start(fs::FS &fs, const char *dir, const char *indexPath, PlaylistIndex::ThrottleFn throttle,
+                         UBaseType_t prio, BaseType_t core)
+{
+  this->fs = &fs;
+  this->dir = dir;
+  this->indexPath = indexPath;
+  this->throttle = throttle;
+  wasStarted = true;
+  busy = true;
+  if (xTaskCreatePinnedToCore(task, "loudness", LOUDNESS_SCAN_STACK, this, prio, nullptr, core) == pdPASS) return true;
+  busy = false;
+  return false;
+}
+
+void LoudnessScan::task(void *param)
+{
+  static_cast<LoudnessScan *>(param)->run();
+  vTaskDelete(nullptr);
+}
+
+// Mide las pistas sin medida guardada, en el orden del índice
+void LoudnessScan::run()
+{
+  PlaylistEntry *e = (PlaylistEntry *)malloc(sizeof(PlaylistEntry));
+  Job *job = nullptr;
+  if (ESP.getMaxAllocHeap() >= sizeof(Job) + LOUDNESS_HEAP_MARGIN) job = new Job();
+  if (!e || !job || !index.open(*fs, dir, indexPath, false)) {
+    Serial.printf("Análisis de sonoridad: no hay memoria (%u bytes) o índice.\n", (unsigned)sizeof(Job));
+    free(e);
+    delete job;
+    busy = false;
+    return;
+  }
+
+  uint32_t start = millis();
+  uint32_t measured = 0, known = 0, failed = 0;
+  uint64_t audioMs = 0, busyMs = 0;
+  for (uint32_t i = 0; i < index.count(); i++) {
+    if (!index.load(i, *e)) break;
+    TrackLoudness l;
+    if (ReplayGain::load(*fs, e->path, e->size, e->mtime, l)) {
+      known++;
+      continue;
+    }
+    uint32_t busyUs = 0;
+    if (!measure(*job, e->path, l, busyUs) || !ReplayGain::save(*fs, e->path, e->size, e->mtime, l)) {
+      Serial.printf("Sonoridad: error con %s.\n", e->path);
+      failed++;
+      continue;
+    }
+    uint32_t rate = job->meter.sampleRate();
+    uint32_t trackMs = rate ? (uint64_t)job->meter.frames() * 1000 / rate : 0;
+    measured++;
+    audioMs += trackMs;
+    busyMs += busyUs / 1000;
+    Serial.printf("Sonoridad de %s: %.1f LUFS, pico %.2f, ganancia %+.1f dB (%.1fx tiempo real).\n", e->path, l.lufs,
+                  l.peak, 20.0f * log10f(ReplayGain::gain(l)), busyUs ? trackMs * 1000.0f / busyUs : 0.0f);
+  }
+  index.close();
+  free(e);
+  delete job;
+
+  // Ritmo real, con las esperas a la reproducción incluidas
+  uint32_t secs = (millis() - start) / 1000;
+  Serial.printf("Análisis de sonoridad: %u pistas medidas, %u ya medidas, %u con error en %lu s", (unsigned)measured,
+                (unsigned)known, (unsigned)failed, (unsigned long)secs);
+  if (measured && secs) {
+    Serial.printf(" (%.0f pistas/hora, %.1fx tiempo real decodificando)", measured * 3600.0f / secs,
+                  busyMs ? (float)audioMs / busyMs : 0.0f);
+  }
+  Serial.println(".");
+  busy = false;
+}
+
+// Decodifica 'path' entero en el medidor. 'busyUs' es el tiempo pasado decodificando.
+bool LoudnessScan::measure(Job &job, const char *path, TrackLoudness &l, uint32_t &busyUs)
+{
+  if (!job.source.open(path)) return false;
+  XingInfo info;
+  bool hasInfo = readXingInfo(&job.source, info);
+  job.source.seek(hasInfo ? info.firstFramePos : 0, SEEK_SET);
+  job.decoder.SetTrim(hasInfo && info.hasXing ? info.samplesPerFrame : 0, 0); // La trama Xing es silencio
+  job.meter.reset();
+  bool ok = job.decoder.begin(&job.source, &job.meter);
+  while (ok) {
+    uint32_t t0 = micros();
+    bool running = job.decoder.loop();
+    busyUs += micros() - t0;
+    if (!running) break;
+    if (throttle) throttle();
+  }
+  if (job.decoder.isRunning()) job.decoder.stop();
+  if (job.source.isOpen()) job.source.close();
+  if (!ok || !job.meter.frames()) return false;
+  l.lufs = job.meter.loudness();
+  l.peak = job.meter.peak();
+  return true;
+}
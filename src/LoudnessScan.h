@@ -0,0 +1,61 @@
+/*
+  LoudnessScan
+  Análisis de sonoridad en segundo plano para ReplayGain. Una tarea recorre el
+  índice de la playlist (con su propio PlaylistIndex, sin nombres en RAM), y
+  cada pista sin medida guardada la decodifica entera en un AudioOutputLoudness
+  y guarda la medida junto al MP3 (ReplayGain::save()). El decodificador y el
+  medidor están en el heap solo mientras trabaja, y solo si queda
+  LOUDNESS_HEAP_MARGIN libre.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "AudioBackend.h"
+#include "AudioOutputLoudness.h"
+#include "PlaylistIndex.h"
+#include "ReplayGain.h"
+
+#ifndef LOUDNESS_HEAP_MARGIN
+#define LOUDNESS_HEAP_MARGIN 16384 // Heap que se deja libre al reservar el decodificador de la tarea
+#endif
+#define LOUDNESS_SCAN_STACK 6144
+
+class LoudnessScan
+{
+  public:
+    // Arranca la tarea en 'core' con el índice 'indexPath' de 'dir'. 'throttle' se llama
+    // entre bloques decodificados, para ceder la CPU o la tarjeta.
+    bool start(fs::FS &fs, const char *dir, const char *indexPath, PlaylistIndex::ThrottleFn throttle,
+               UBaseType_t prio, BaseType_t core);
+    bool started() const { return wasStarted; }
+    bool running() const { return busy.load(); }
+
+  private:
+    // Decodificador y medidor, en el heap solo mientras trabaja
+    struct Job
+    {
+      alignas(8) uint8_t arena[AudioCodec::preAllocSize()];
+      AudioStorage::Source source; // Sin lectura anticipada: no hay prisa y ahorra sus buffers
+      AudioDecoder decoder;
+      AudioOutputLoudness meter;
+
+      Job() : decoder(arena, sizeof(arena)) {}
+    };
+
+    static void task(void *param);
+    void run();
+    bool measure(Job &job, const char *path, TrackLoudness &l, uint32_t &busyUs);
+
+    PlaylistIndex index;
+    fs::FS *fs = nullptr;
+    const char *dir = nullptr;
+    const char *indexPath = nullptr;
+    PlaylistIndex::ThrottleFn throttle = nullptr;
+    bool wasStarted = false;
+    std::atomic<bool> busy{false}; // La tarea sigue trabajando
+};
@@ -0,0 +1,124 @@
+/*
+  OledRenderer
+  Envío incremental del framebuffer SSD1306
+*/
+
+#include "OledRenderer.h"
+
+bool OledRenderer::begin()
+{
+  width = display.width();
+  pages = display.height() / 8;
+  free(shadow);
+  shadow = (uint8_t *)malloc(width * pages);
+  if (!shadow) return false;
+  wire.setClock(OLED_I2C_CLOCK);
+  invalidate();
+  return true;
+}
+
+void OledRenderer::invalidate()
+{
+  const uint8_t *buf = display.getBuffer();
+  if (!shadow || !buf) return;
+  // Copia opuesta al buffer: todos los bytes cuentan como cambiados
+  for (int i = 0; i < width * pages; i++) shadow[i] = ~buf[i];
+}
+
+void OledRenderer::setMarquee(int16_t y, const char *text)
+{
+  strncpy(marqueeText, text, sizeof(marqueeText) - 1);
+  marqueeText[sizeof(marqueeText) - 1] = '\0';
+  marqueeY = y;
+  marqueeWidth = 6 * strlen(marqueeText); // Fuente por defecto a tamaño 1
+  marqueeOffset = 0;
+  marqueeLast = millis();
+  marqueeOn = true;
+  drawMarquee();
+}
+
+void OledRenderer::drawMarquee()
+{
+  display.fillRect(0, marqueeY, width, 8, SSD1306_BLACK);
+  display.setTextSize(1);
+  display.setTextColor(SSD1306_WHITE);
+  display.setTextWrap(false);
+  display.setCursor(-marqueeOffset, marqueeY);
+  display.print(marqueeText);
+  if (marqueeWidth > width) {
+    // Repetición del principio del texto detrás del hueco, para que la vuelta sea continua
+    display.setCursor(marqueeWidth + MARQUEE_GAP - marqueeOffset, marqueeY);
+    display.print(marqueeText);
+  }
+  display.setTextWrap(true);
+}
+
+bool OledRenderer::service(uint32_t budgetUs)
+{
+  uint32_t start = micros();
+  if (!shadow) return false;
+
+  if (marqueeOn && marqueeWidth > width) {
+    unsigned long now = millis();
+    unsigned long wait = marqueeOffset == 0 ? MARQUEE_HOLD_MS : MARQUEE_STEP_MS;
+    if (now - marqueeLast >= wait) {
+      marqueeLast = now;
+      marqueeOffset = (marqueeOffset + 1) % (marqueeWidth + MARQUEE_GAP);
+      drawMarquee();
+    }
+  }
+
+  int page, c0, c1;
+  while (nextSpan(page, c0, c1)) {
+    sendSpan(page, c0, c1);
+    if (micros() - start >= budgetUs) {
+      return nextSpan(page, c0, c1);
+    }
+  }
+  return false;
+}
+
+// Primer tramo cambiado: página y columnas [c0, c1], como mucho RENDER_CHUNK bytes
+bool OledRenderer::nextSpan(int &page, int &c0, int &c1) const
+{
+  const uint8_t *buf = display.getBuffer();
+  for (page = 0; page < pages; page++) {
+    const uint8_t *row = buf + page * width;
+    const uint8_t *old = shadow + page * width;
+    if (!memcmp(row, old, width)) continue;
+
+    c0 = 0;
+    while (row[c0] == old[c0]) c0++;
+    int limit = c0 + RENDER_CHUNK - 1 < width - 1 ? c0 + RENDER_CHUNK - 1 : width - 1;
+    c1 = limit;
+    while (c1 > c0 && row[c1] == old[c1]) c1--;
+    return true;
+  }
+  return false;
+}
+
+void OledRenderer::sendSpan(int page, int c0, int c1)
+{
+  const uint8_t *buf = display.getBuffer() + page * width;
+  int len = c1 - c0 + 1;
+
+  // Ventana de escritura: una página y las columnas del tramo (modo de direccionamiento horizontal)
+  wire.beginTransmission(address);
+  wire.write((uint8_t)0x00); // Siguen comandos
+  wire.write((uint8_t)SSD1306_PAGEADDR);
+  wire.write((uint8_t)page);
+  wire.write((uint8_t)page);
+  wire.write((uint8_t)SSD1306_COLUMNADDR);
+  wire.write((uint8_t)c0);
+  wire.write((uint8_t)c1);
+  wire.endTransmission();
+
+  wire.beginTransmission(address);
+  wire.write((uint8_t)0x40); // Siguen datos
+  wire.write(buf + c0, len);
+  wire.endTransmission();
+
+  memcpy(shadow + page * width + c0, buf + c0, len);
+  stats.bytes += len;
+  stats.transfers += 2;
+}
@@ -0,0 +1,78 @@
+/*
+  OledRenderer
+  Envío incremental del framebuffer de Adafruit_SSD1306.
+  Se dibuja en el buffer de la librería como siempre (sin llamar a display()) y
+  service() compara con una copia de lo que ya tiene la pantalla: solo manda por
+  I2C los tramos de columnas que han cambiado en cada página (8 filas), en
+  transferencias cortas y sin pasar del tiempo que se le da en cada llamada.
+  Incluye una marquesina para desplazar textos más largos que la pantalla.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_SSD1306.h>
+
+#ifndef RENDER_CHUNK
+#define RENDER_CHUNK       32    // Bytes de datos por transferencia I2C (cabe en el buffer de Wire)
+#endif
+#ifndef OLED_I2C_CLOCK
+#define OLED_I2C_CLOCK     400000
+#endif
+#ifndef MARQUEE_STEP_MS
+#define MARQUEE_STEP_MS    40    // Un píxel cada 40 ms
+#endif
+#ifndef MARQUEE_HOLD_MS
+#define MARQUEE_HOLD_MS    1500  // Parada al principio del texto antes de cada vuelta
+#endif
+#define MARQUEE_GAP        24    // Píxeles entre el final del texto y su repetición
+#define MARQUEE_TEXT_MAX   96
+
+class OledRenderer
+{
+  public:
+    OledRenderer(Adafruit_SSD1306 &display, TwoWire &wire, uint8_t address)
+      : display(display), wire(wire), address(address) {}
+
+    // Tras display.begin(): reserva la copia y marca toda la pantalla para enviar
+    bool begin();
+
+    // Fuerza a reenviar la pantalla completa
+    void invalidate();
+
+    // Avanza la marquesina y envía tramos cambiados hasta gastar 'budgetUs' (al menos uno
+    // si hay algo pendiente). Devuelve true si aún quedan cambios por enviar.
+    bool service(uint32_t budgetUs);
+
+    // Texto en la fila de 8 píxeles que empieza en 'y'. Si no cabe se desplaza solo.
+    void setMarquee(int16_t y, const char *text);
+    void clearMarquee() { marqueeOn = false; }
+    // La marquesina se mueve: service() tiene trabajo cada MARQUEE_STEP_MS
+    bool animating() const { return marqueeOn && marqueeWidth > width; }
+
+    struct Stats {
+      uint32_t bytes;      // Bytes de datos enviados a la pantalla
+      uint32_t transfers;  // Transferencias I2C (comandos + datos)
+    };
+    Stats stats = { 0, 0 };
+
+  private:
+    bool nextSpan(int &page, int &c0, int &c1) const;
+    void sendSpan(int page, int c0, int c1);
+    void drawMarquee();
+
+    Adafruit_SSD1306 &display;
+    TwoWire &wire;
+    uint8_t address;
+    uint8_t *shadow = nullptr;   // Lo que tiene ahora la memoria de la pantalla
+    int pages = 0;
+    int width = 0;
+
+    bool marqueeOn = false;
+    int16_t marqueeY = 0;
+    char marqueeText[MARQUEE_TEXT_MAX];
+    int16_t marqueeWidth = 0;
+    int16_t marqueeOffset = 0;
+    unsigned long marqueeLast = 0;
+};
@@ -0,0 +1,112 @@
+/*
+  PathPool
+  Bloque contiguo de nombres de ficheros con tabla de desplazamientos
+*/
+
+#include <algorithm>
+#include "PathPool.h"
+
+static void *poolAlloc(size_t bytes)
+{
+#ifdef BOARD_HAS_PSRAM
+  void *p = ps_malloc(bytes);
+  if (p) return p;
+#endif
+  return malloc(bytes);
+}
+
+bool PathPool::begin(size_t bytes, uint32_t maxEntries, const char *prefix)
+{
+  end();
+  strncpy(pre, prefix ? prefix : "", sizeof(pre) - 1);
+  pre[sizeof(pre) - 1] = '\0';
+  preLen = strlen(pre);
+  if (!bytes || !maxEntries) return false;
+  text = (char *)poolAlloc(bytes);
+  offsets = (uint32_t *)poolAlloc(maxEntries * sizeof(uint32_t));
+  if (!text || !offsets) {
+    end();
+    return false;
+  }
+  capacity = bytes;
+  this->maxEntries = maxEntries;
+  return true;
+}
+
+void PathPool::end()
+{
+  free(text);
+  free(offsets);
+  text = nullptr;
+  offsets = nullptr;
+  capacity = used = 0;
+  maxEntries = entries = 0;
+}
+
+const char *PathPool::stripPrefix(const char *path) const
+{
+  if (preLen && !strncmp(path, pre, preLen) && path[preLen] == '/') return path + preLen + 1;
+  return path;
+}
+
+int32_t PathPool::add(const char *path)
+{
+  const char *name = stripPrefix(path);
+  return add(name, strlen(name));
+}
+
+int32_t PathPool::add(const char *name, size_t len)
+{
+  if (!text || entries >= maxEntries || used + len + 1 > capacity) return -1;
+  memcpy(text + used, name, len);
+  text[used + len] = '\0';
+  offsets[entries] = used;
+  used += len + 1;
+  return entries++;
+}
+
+void PathPool::shrink()
+{
+  if (!text) return;
+  // Reducir un bloque lo deja donde está: no mueve nada ni fragmenta
+  if (used && used < capacity) {
+    char *t = (char *)realloc(text, used);
+    if (t) {
+      text = t;
+      capacity = used;
+    }
+  }
+  if (entries && entries < maxEntries) {
+    uint32_t *o = (uint32_t *)realloc(offsets, entries * sizeof(uint32_t));
+    if (o) {
+      offsets = o;
+      maxEntries = entries;
+    }
+  }
+}
+
+void PathPool::path(uint32_t i, char *out, size_t len) const
+{
+  if (preLen) snprintf(out, len, "%s/%s", pre, name(i));
+  else snprintf(out, len, "%s", name(i));
+}
+
+void PathPool::sort()
+{
+  const char *t = text;
+  std::sort(offsets, offsets + entries, [t](uint32_t a, uint32_t b) { return strcmp(t + a, t + b) < 0; });
+}
+
+int32_t PathPool::find(const char *path) const
+{
+  const char *key = stripPrefix(path);
+  uint32_t lo = 0, hi = entries;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    int c = strcmp(name(mid), key);
+    if (!c) return mid;
+    if (c < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return -1;
+}
@@ -0,0 +1,62 @@
+/*
+  PathPool
+  Nombres de ficheros en un único bloque de memoria: los textos van seguidos,
+  terminados en '\0', y una tabla de desplazamientos da el de cada entrada.
+  El prefijo común (la carpeta, p.ej. "/playlist") se guarda una sola vez y
+  se quita de cada ruta al añadirla.
+
+  Se reserva de una vez al empezar (en PSRAM si la placa la tiene) y se ajusta
+  al tamaño usado al acabar, así no quedan huecos en el heap. Ordenar solo
+  permuta la tabla de desplazamientos, sin mover los textos, y las consultas
+  devuelven punteros al propio bloque, sin copias.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+#define PATH_POOL_PREFIX_MAX 32
+
+class PathPool
+{
+  public:
+    ~PathPool() { end(); }
+
+    // Sitio para 'bytes' de texto y 'maxEntries' entradas; 'prefix' se quita de las rutas
+    bool begin(size_t bytes, uint32_t maxEntries, const char *prefix);
+    void end();
+    bool ready() const { return text != nullptr; }
+
+    // Añade una ruta (con o sin el prefijo) o un nombre de 'len' bytes. Devuelve su
+    // número o -1 si no cabe.
+    int32_t add(const char *path);
+    int32_t add(const char *name, size_t len);
+    // Devuelve al heap lo reservado de más
+    void shrink();
+
+    uint32_t count() const { return entries; }
+    const char *name(uint32_t i) const { return text + offsets[i]; }
+    const char *prefix() const { return pre; }
+    // Ruta completa de la entrada 'i' (prefijo + '/' + nombre)
+    void path(uint32_t i, char *out, size_t len) const;
+
+    // Orden alfabético por bytes, permutando solo los desplazamientos
+    void sort();
+    // Búsqueda binaria (con la tabla ordenada) por nombre o ruta; -1 si no está
+    int32_t find(const char *path) const;
+
+    // Memoria ocupada: textos más tabla
+    size_t bytes() const { return used + entries * sizeof(uint32_t); }
+
+  private:
+    const char *stripPrefix(const char *path) const;
+
+    char *text = nullptr;
+    uint32_t *offsets = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+    uint32_t maxEntries = 0;
+    uint32_t entries = 0;
+    char pre[PATH_POOL_PREFIX_MAX] = "";
+    size_t preLen = 0;
+};
@@ -0,0 +1,159 @@
+/*
+  PcmRing
+  Cola circular sin bloqueos para un productor y un consumidor (SPSC)
+  de tramas PCM estéreo de 16 bits (int16_t[2] intercalado L/R).
+
+  El productor (tarea de decodificación) solo escribe 'head' y el consumidor
+  (tarea de salida I2S) solo escribe 'tail'. Los índices avanzan libremente
+  y se enmascaran al acceder, por lo que la capacidad debe ser potencia de 2.
+
+  El tamaño se puede cambiar en marcha con resize(), con el productor y el
+  consumidor parados en un punto seguro (TaskPark): 'buf', 'cap' y 'mask' no son
+  atómicos. setLimit() deja al productor llenar menos que la capacidad, para
+  reducirla cuando lo pendiente ya quepa.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+class PcmRing
+{
+  public:
+    // 'storage' debe tener espacio para 'frames' tramas estéreo (2 * frames int16_t)
+    PcmRing(int16_t *storage, uint32_t frames) : buf(storage), cap(frames), mask(frames - 1), limit(frames) {}
+
+    uint32_t capacity() const { return cap; }
+
+    // Tramas que el productor puede tener en cola (como mucho la capacidad)
+    void setLimit(uint32_t frames) { limit.store(frames < cap ? frames : cap, std::memory_order_release); }
+
+    // Pasa la cola a 'storage' ('frames' tramas, potencia de 2) conservando lo pendiente,
+    // que tiene que caber. Con el productor y el consumidor parados (o desde el consumidor
+    // con el productor parado). Devuelve el almacenamiento anterior para liberarlo.
+    int16_t *resize(int16_t *storage, uint32_t frames)
+    {
+      uint32_t t = tail.load(std::memory_order_relaxed);
+      uint32_t h = head.load(std::memory_order_acquire);
+      uint32_t newMask = frames - 1;
+      // Mismas posiciones lógicas: 'head', 'tail', mark() y available() no cambian
+      for (uint32_t i = t; i != h; i++) {
+        memcpy(storage + 2 * (i & newMask), buf + 2 * (i & mask), 2 * sizeof(int16_t));
+      }
+      int16_t *old = buf;
+      buf = storage;
+      cap = frames;
+      mask = newMask;
+      limit.store(frames, std::memory_order_release);
+      return old;
+    }
+
+    // Tramas listas para leer (seguro desde ambos lados)
+    uint32_t available() const
+    {
+      return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    // Tramas libres para escribir (seguro desde ambos lados)
+    uint32_t space() const
+    {
+      uint32_t used = available();
+      uint32_t l = limit.load(std::memory_order_acquire);
+      return used < l ? l - used : 0;
+    }
+
+    // --- Lado productor ---
+
+    // Zona contigua donde escribir; 'frames' devuelve cuántas tramas caben sin dar la vuelta
+    int16_t *writePtr(uint32_t &frames)
+    {
+      uint32_t h = head.load(std::memory_order_relaxed);
+      uint32_t t = tail.load(std::memory_order_acquire);
+      uint32_t l = limit.load(std::memory_order_acquire);
+      uint32_t free = h - t < l ? l - (h - t) : 0;
+      uint32_t toEnd = cap - (h & mask);
+      frames = free < toEnd ? free : toEnd;
+      return buf + 2 * (h & mask);
+    }
+
+    // Publica 'frames' tramas escritas a través de writePtr()
+    void commit(uint32_t frames)
+    {
+      head.store(head.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+    }
+
+    // Copia hasta 'frames' tramas; devuelve las que se han podido escribir
+    uint32_t write(const int16_t *samples, uint32_t frames)
+    {
+      uint32_t done = 0;
+      while (done < frames) {
+        uint32_t n;
+        int16_t *dst = writePtr(n);
+        if (!n) break;
+        if (n > frames - done) n = frames - done;
+        memcpy(dst, samples + 2 * done, n * 2 * sizeof(int16_t));
+        commit(n);
+        done += n;
+      }
+      return done;
+    }
+
+    // Posición de escritura actual, para marcar hasta dónde descartar con dropUntil()
+    uint32_t mark() const { return head.load(std::memory_order_acquire); }
+
+    // --- Lado consumidor ---
+
+    // Posición de lectura actual (la de la próxima trama que sonará)
+    uint32_t readMark() const { return tail.load(std::memory_order_acquire); }
+
+    // Zona contigua a leer; 'frames' devuelve cuántas tramas hay sin dar la vuelta
+    const int16_t *readPtr(uint32_t &frames)
+    {
+      uint32_t t = tail.load(std::memory_order_relaxed);
+      uint32_t h = head.load(std::memory_order_acquire);
+      uint32_t used = h - t;
+      uint32_t toEnd = cap - (t & mask);
+      frames = used < toEnd ? used : toEnd;
+      return buf + 2 * (t & mask);
+    }
+
+    // Libera 'frames' tramas leídas a través de readPtr()
+    void consume(uint32_t frames)
+    {
+      tail.store(tail.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+    }
+
+    // Copia hasta 'frames' tramas; devuelve las que se han podido leer
+    uint32_t read(int16_t *samples, uint32_t frames)
+    {
+      uint32_t done = 0;
+      while (done < frames) {
+        uint32_t n;
+        const int16_t *src = readPtr(n);
+        if (!n) break;
+        if (n > frames - done) n = frames - done;
+        memcpy(samples + 2 * done, src, n * 2 * sizeof(int16_t));
+        consume(n);
+        done += n;
+      }
+      return done;
+    }
+
+    // Descarta todo lo escrito antes de 'markPos' (obtenido con mark()), sin tocar lo posterior
+    void dropUntil(uint32_t markPos)
+    {
+      uint32_t t = tail.load(std::memory_order_relaxed);
+      int32_t pending = (int32_t)(markPos - t);
+      if (pending > 0) consume((uint32_t)pending);
+    }
+
+  private:
+    int16_t *buf;
+    uint32_t cap;
+    uint32_t mask;
+    std::atomic<uint32_t> limit;   // Escrito solo por quien cambia el tamaño
+    std::atomic<uint32_t> head{0}; // Escrito solo por el productor
+    std::atomic<uint32_t> tail{0}; // Escrito solo por el consumidor
+};
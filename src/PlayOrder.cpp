@@ -0,0 +1,185 @@
+/*
+  PlayOrder
+  Orden secuencial o aleatorio (Feistel) de la playlist
+*/
+
+#include "PlayOrder.h"
+
+#define FEISTEL_ROUNDS 8 // Con 4, en listas cortas las parejas consecutivas no salen uniformes
+
+// Mezcla final de MurmurHash3: cada bit de entrada afecta a todos los de salida
+static inline uint32_t mix32(uint32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+void PlayOrder::setCount(uint32_t count)
+{
+  uint32_t track = n ? current() : 0;
+  n = count;
+  // Menor número par de bits (al menos 2) que cubre n: el dominio es como mucho 4n
+  uint8_t bits = 2;
+  while (bits < 32 && (1ull << bits) < n) bits += 2;
+  halfBits = bits / 2;
+  halfMask = (1u << halfBits) - 1;
+
+  cycle = 0;
+  offset = 0;
+  pos = 0;
+  if (!n) return;
+  if (track >= n) track = 0;
+  if (shuffled) offset = unpermute(0, track);
+  jumpTo(track);
+}
+
+void PlayOrder::setShuffle(bool on, uint32_t seed)
+{
+  uint32_t track = n ? current() : 0;
+  shuffled = on;
+  this->seed = seed;
+  cycle = 0;
+  offset = 0;
+  pos = 0;
+  if (!n) return;
+  if (shuffled) offset = unpermute(0, track);
+  jumpTo(track);
+}
+
+PlayOrder::State PlayOrder::state() const
+{
+  State s;
+  s.seed = seed;
+  s.offset = offset;
+  s.cycle = cycle;
+  s.shuffle = shuffled;
+  s.repeat = repeat;
+  return s;
+}
+
+void PlayOrder::restore(const State &s)
+{
+  uint32_t track = n ? current() : 0;
+  seed = s.seed;
+  offset = s.offset < n ? s.offset : 0;
+  cycle = s.cycle;
+  shuffled = s.shuffle;
+  repeat = s.repeat <= REPEAT_ONE ? s.repeat : REPEAT_ALL;
+  if (n) jumpTo(track);
+}
+
+void PlayOrder::jumpTo(uint32_t track)
+{
+  if (track < n) pos = positionOf(cycle, track);
+}
+
+uint32_t PlayOrder::step(int dir)
+{
+  if (!n) return 0;
+  if (dir > 0) {
+    if (++pos >= n) {
+      pos = 0;
+      cycle++;
+    }
+  } else if (pos == 0) {
+    pos = n - 1;
+    cycle--;
+  } else {
+    pos--;
+  }
+  return current();
+}
+
+bool PlayOrder::advance(uint32_t &track)
+{
+  if (!peekNext(track)) return false;
+  if (repeat != REPEAT_ONE) step(1);
+  return true;
+}
+
+bool PlayOrder::peekNext(uint32_t &track) const
+{
+  if (!n) return false;
+  if (repeat == REPEAT_ONE) {
+    track = current();
+    return true;
+  }
+  if (pos + 1 >= n) {
+    if (repeat == REPEAT_OFF) return false;
+    track = trackAt(cycle + 1, 0);
+  } else {
+    track = trackAt(cycle, pos + 1);
+  }
+  return true;
+}
+
+uint32_t PlayOrder::trackAt(int32_t c, uint32_t p) const
+{
+  if (!shuffled || n < 2) return n ? p : 0;
+  // Con dos pistas no hay más orden posible sin repetir al dar la vuelta
+  if (n == 2) return permute(0, (p + offset) % n);
+  if (p <= 1 && swapFirst(c)) p ^= 1;
+  return permute(c, (p + offset) % n);
+}
+
+uint32_t PlayOrder::positionOf(int32_t c, uint32_t track) const
+{
+  if (!shuffled || n < 2) return n ? track : 0;
+  if (n == 2) return (unpermute(0, track) + n - offset) % n;
+  uint32_t p = (unpermute(c, track) + n - offset) % n;
+  if (p <= 1 && swapFirst(c)) p ^= 1;
+  return p;
+}
+
+// La primera del ciclo 'c' repetiría la última del anterior (solo con n >= 3,
+// así la última posición no es ninguna de las dos que se intercambian). El ciclo 0
+// empieza siempre en la pista elegida al barajar.
+bool PlayOrder::swapFirst(int32_t c) const
+{
+  return c != 0 && permute(c, offset) == permute(c - 1, (offset + n - 1) % n);
+}
+
+uint32_t PlayOrder::cycleKey(int32_t c) const
+{
+  return mix32(seed ^ mix32((uint32_t)c * 0x9E3779B9u + 0x7f4a7c15u));
+}
+
+uint32_t PlayOrder::round(uint32_t key, uint32_t x) const
+{
+  return mix32(x ^ key) & halfMask;
+}
+
+uint32_t PlayOrder::permute(int32_t c, uint32_t x) const
+{
+  uint32_t key = cycleKey(c);
+  // Recorrer el ciclo de la permutación de 2^bits hasta volver a [0, n)
+  do {
+    uint32_t l = x >> halfBits, r = x & halfMask;
+    for (int i = 0; i < FEISTEL_ROUNDS; i++) {
+      uint32_t t = l ^ round(key + i * 0x9E3779B9u, r);
+      l = r;
+      r = t;
+    }
+    x = (l << halfBits) | r;
+  } while (x >= n);
+  return x;
+}
+
+uint32_t PlayOrder::unpermute(int32_t c, uint32_t y) const
+{
+  uint32_t key = cycleKey(c);
+  do {
+    uint32_t l = y >> halfBits, r = y & halfMask;
+    for (int i = FEISTEL_ROUNDS - 1; i >= 0; i--) {
+      uint32_t t = r ^ round(key + i * 0x9E3779B9u, l);
+      r = l;
+      l = t;
+    }
+    y = (l << halfBits) | r;
+  } while (y >= n);
+  return y;
+}
@@ -0,0 +1,89 @@
+/*
+  PlayOrder
+  Orden de reproducción de la playlist: secuencial o aleatorio, con repetición
+  desactivada, de toda la lista o de una pista.
+
+  El orden aleatorio no se guarda en memoria: es una permutación de [0, n)
+  calculada al vuelo con una red de Feistel de 8 rondas sobre el menor número
+  par de bits que cubre n, recorriendo el ciclo (cycle walking) hasta caer
+  dentro de [0, n). Como la red se invierte igual de fácil, siguiente, anterior
+  y "en qué posición está la pista i" cuestan O(1) (en media, menos de 4
+  vueltas) y ocupan unos pocos enteros, sea cual sea el tamaño de la lista.
+
+  Cada vuelta a la lista (ciclo) usa una permutación distinta derivada de la
+  semilla y del número de ciclo, así se puede ir hacia atrás más allá del
+  principio del ciclo. Dentro de un ciclo no se repite ninguna pista; entre
+  ciclos, si la primera del nuevo coincide con la última del anterior se
+  intercambian sus dos primeras posiciones (salvo en el ciclo 0, que empieza
+  en la pista donde se barajó).
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+enum RepeatMode : uint8_t
+{
+  REPEAT_OFF,  // Al acabar la lista se para
+  REPEAT_ALL,  // Se vuelve a empezar (en aleatorio, con otro orden)
+  REPEAT_ONE   // Al acabar una pista se repite; los botones cambian de pista igual
+};
+
+class PlayOrder
+{
+  public:
+    // Lo necesario para rehacer el mismo orden (p.ej. tras un reinicio)
+    struct State {
+      uint32_t seed;
+      uint32_t offset;
+      int32_t cycle;
+      bool shuffle;
+      RepeatMode repeat;
+    };
+
+    // Número de pistas; conserva la pista actual (si sigue existiendo) y los modos
+    void setCount(uint32_t count);
+    uint32_t count() const { return n; }
+
+    // Activa o desactiva el aleatorio. Al activarlo empieza un ciclo nuevo con la
+    // semilla 'seed' en la pista actual; también sirve para volver a barajar.
+    void setShuffle(bool on, uint32_t seed);
+    bool shuffle() const { return shuffled; }
+    void setRepeat(RepeatMode mode) { repeat = mode; }
+    RepeatMode repeatMode() const { return repeat; }
+
+    State state() const;
+    void restore(const State &s);
+
+    // Pista actual y salto a una pista concreta (el orden sigue desde ella)
+    uint32_t current() const { return trackAt(cycle, pos); }
+    void jumpTo(uint32_t track);
+
+    // Paso manual (botones): siempre cambia de pista, dando la vuelta en los extremos
+    uint32_t step(int dir);
+    // Fin de pista: la que toca según la repetición; false si se acaba la lista
+    bool advance(uint32_t &track);
+    // Lo mismo sin moverse (para preparar la siguiente pista)
+    bool peekNext(uint32_t &track) const;
+
+    // Pista en la posición 'p' del ciclo 'c' y su inversa
+    uint32_t trackAt(int32_t c, uint32_t p) const;
+    uint32_t positionOf(int32_t c, uint32_t track) const;
+
+  private:
+    uint32_t round(uint32_t key, uint32_t x) const;
+    uint32_t cycleKey(int32_t c) const;
+    uint32_t permute(int32_t c, uint32_t x) const;
+    uint32_t unpermute(int32_t c, uint32_t y) const;
+    bool swapFirst(int32_t c) const;
+
+    uint32_t n = 0;
+    uint32_t pos = 0;        // Posición en el ciclo
+    int32_t cycle = 0;       // Vueltas a la lista (negativo yendo hacia atrás)
+    bool shuffled = false;
+    RepeatMode repeat = REPEAT_ALL;
+    uint32_t seed = 0;
+    uint32_t offset = 0;     // Posición de la permutación que corresponde a la posición 0
+    uint8_t halfBits = 1;
+    uint32_t halfMask = 1;
+};
@@ -0,0 +1,28 @@
+/*
+  PlaybackPosition
+  Cuánto audio ya aceptado por la cadena de salida aún no ha sonado, para pasar de
+  la posición del decodificador (AudioGeneratorMP3Block::Position()) a la muestra
+  que se oye. Una parte espera a la frecuencia del decodificador (el mezclador del
+  fundido y la entrada del conversor) y otra a la de salida (lo ya convertido, el
+  DSP, la cola PCM y el DMA del I2S); esta se pasa a la del decodificador.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+struct HeldAudio
+{
+  uint32_t inputFrames = 0;   // A la frecuencia del decodificador
+  uint32_t outputFrames = 0;  // A la frecuencia de salida
+  uint32_t inputRate = 0;     // Frecuencia del decodificador
+  uint32_t outputRate = 0;    // Frecuencia de salida (0 = la misma)
+
+  // Total en tramas del decodificador
+  uint32_t decoderFrames() const
+  {
+    uint64_t out = outputFrames;
+    if (inputRate && outputRate && inputRate != outputRate) out = (out * inputRate + outputRate / 2) / outputRate;
+    return inputFrames + out;
+  }
+};
@@ -0,0 +1,446 @@
+/*
+  PlaylistIndex
+  Índice binario de la playlist guardado en la tarjeta SD
+*/
+
+#include <algorithm>
+#include "PlaylistIndex.h"
+#include "Id3Reader.h"
+
+static_assert(RUN_KEY_MAX >= PLAYLIST_NAME_MAX, "Los nombres de la playlist deben caber en RUN_KEY_MAX");
+
+// FNV-1a de 32 bits
+static uint32_t fnv1a(uint32_t h, const void *data, size_t len)
+{
+  const uint8_t *p = (const uint8_t *)data;
+  while (len--) {
+    h ^= *p++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static void copyTag(char *dst, const char *src, size_t len)
+{
+  if (len >= PLAYLIST_TAG_MAX) len = PLAYLIST_TAG_MAX - 1;
+  memcpy(dst, src, len);
+  dst[len] = '\0';
+}
+
+void PlaylistIndex::setPaths(fs::FS &fs, const char *dir, const char *indexPath)
+{
+  this->fs = &fs;
+  strncpy(this->dir, dir, sizeof(this->dir) - 1);
+  this->dir[sizeof(this->dir) - 1] = '\0';
+  strncpy(this->indexPath, indexPath, sizeof(this->indexPath) - 1);
+  this->indexPath[sizeof(this->indexPath) - 1] = '\0';
+}
+
+bool PlaylistIndex::begin(fs::FS &fs, const char *dir, const char *indexPath)
+{
+  open(fs, dir, indexPath);
+  wasRebuilt = false;
+
+  char newPath[PLAYLIST_PATH_MAX];
+  snprintf(newPath, sizeof(newPath), "%s.new", indexPath);
+  bool changed = false;
+  if (!rescan(newPath, changed)) {
+    Serial.println("Error al reconstruir el índice de la playlist.");
+    return false;
+  }
+  if (!changed) return opened();
+  wasRebuilt = true;
+  return adopt(newPath);
+}
+
+bool PlaylistIndex::open(fs::FS &fs, const char *dir, const char *indexPath, bool loadNames)
+{
+  close();
+  setPaths(fs, dir, indexPath);
+  index = fs.open(indexPath, FILE_READ);
+  if (!index || !readHeader(index, header)) {
+    close();
+    return false;
+  }
+  entries = header.count;
+  if (loadNames) this->loadNames();
+  return true;
+}
+
+void PlaylistIndex::close()
+{
+  if (index) index.close();
+  names.end();
+  entries = 0;
+}
+
+bool PlaylistIndex::rescan(const char *outPath, bool &changed)
+{
+  changed = false;
+  uint32_t files = 0;
+  uint32_t fingerprint = scanFingerprint(files);
+  if (opened() && header.fingerprint == fingerprint && header.count == files) return true;
+
+  Serial.println("Índice de la playlist desactualizado, reconstruyendo...");
+  if (!rebuild(fingerprint, outPath)) return false;
+  changed = true;
+  return true;
+}
+
+bool PlaylistIndex::adopt(const char *newPath)
+{
+  char dir[PLAYLIST_DIR_MAX], indexPath[PLAYLIST_DIR_MAX];
+  strcpy(dir, this->dir);
+  strcpy(indexPath, this->indexPath);
+  close();
+  fs->remove(indexPath);
+  if (!fs->rename(newPath, indexPath)) return false;
+  return open(*fs, dir, indexPath);
+}
+
+void PlaylistIndex::loadNames()
+{
+  names.end();
+  if (!entries) return;
+  // Los textos van seguidos en el orden de la tabla: "nombre\0título\0artista\0álbum\0"
+  size_t bytes = header.textSize < PLAYLIST_POOL_BYTES ? header.textSize : PLAYLIST_POOL_BYTES;
+  if (!names.begin(bytes, entries, dir) || !index.seek(header.textOffset)) {
+    names.end();
+    return;
+  }
+  uint8_t buf[512];
+  char name[PLAYLIST_NAME_MAX];
+  size_t nameLen = 0;
+  uint32_t field = 0;
+  uint32_t left = header.textSize;
+  while (left && names.count() < entries) {
+    size_t n = index.read(buf, left < sizeof(buf) ? left : sizeof(buf));
+    if (!n) break;
+    left -= n;
+    for (size_t i = 0; i < n; i++) {
+      if (field == 0 && buf[i] && nameLen < sizeof(name) - 1) name[nameLen++] = buf[i];
+      if (buf[i]) continue;
+      if (field == 0 && names.add(name, nameLen) < 0) {
+        Serial.println("Los nombres de la playlist no caben en RAM; se leerán de la tarjeta.");
+        names.end();
+        return;
+      }
+      field = (field + 1) % 4;
+      nameLen = 0;
+    }
+  }
+  if (names.count() != entries) {
+    names.end();
+    return;
+  }
+  names.shrink();
+}
+
+bool PlaylistIndex::readHeader(File &f, Header &h)
+{
+  if (!f.seek(0)) return false;
+  if (f.read((uint8_t *)&h, sizeof(h)) != sizeof(h)) return false;
+  return !memcmp(h.magic, "MP3I", 4) && h.version == version && h.entrySize == sizeof(Record);
+}
+
+bool PlaylistIndex::load(uint32_t i, PlaylistEntry &e)
+{
+  if (i >= entries || !index) return false;
+
+  Record r;
+  if (!index.seek(header.tableOffset + i * sizeof(Record))) return false;
+  if (index.read((uint8_t *)&r, sizeof(r)) != sizeof(r)) return false;
+
+  char text[PLAYLIST_NAME_MAX + 3 * PLAYLIST_TAG_MAX];
+  if (r.textLen > sizeof(text)) return false;
+  if (!index.seek(header.textOffset + r.textOffset)) return false;
+  if (index.read((uint8_t *)text, r.textLen) != r.textLen) return false;
+
+  // "nombre\0título\0artista\0álbum\0"
+  const char *name = text;
+  const char *title = name + strlen(name) + 1;
+  const char *artist = title + strlen(title) + 1;
+  const char *album = artist + strlen(artist) + 1;
+  snprintf(e.path, sizeof(e.path), "%s/%s", dir, name);
+  copyTag(e.title, title, strlen(title));
+  copyTag(e.artist, artist, strlen(artist));
+  copyTag(e.album, album, strlen(album));
+  e.size = r.size;
+  e.mtime = r.mtime;
+  e.durationMs = r.durationMs;
+  return true;
+}
+
+int32_t PlaylistIndex::find(const char *path)
+{
+  if (names.ready()) return names.find(path);
+  // Mismo orden que al construir el índice: memcmp del nombre, el más corto antes
+  PlaylistEntry e;
+  uint32_t lo = 0, hi = entries;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (!load(mid, e)) return -1;
+    int c = strcmp(e.path, path);
+    if (!c) return mid;
+    if (c < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return -1;
+}
+
+// Etiquetas ID3 del fichero; lo que falte se completa con el nombre
+void PlaylistIndex::metadataFromTags(fs::FS &fs, const char *path, const char *name, PlaylistEntry &e)
+{
+  static_assert(ID3_TEXT_MAX == PLAYLIST_TAG_MAX, "ID3_TEXT_MAX y PLAYLIST_TAG_MAX deben coincidir");
+  Id3Tags tags;
+  File f = fs.open(path, FILE_READ);
+  bool found = f && readId3(f, tags);
+  if (f) f.close();
+
+  metadataFromName(fs, path, name, e);
+  if (!found) return;
+  if (tags.title[0]) strcpy(e.title, tags.title);
+  if (tags.artist[0]) strcpy(e.artist, tags.artist);
+  strcpy(e.album, tags.album);
+  e.durationMs = tags.lengthMs;
+}
+
+// Título y artista a partir de "Título_Artista.mp3" (sin las carpetas de 'name')
+void PlaylistIndex::metadataFromName(fs::FS &fs, const char *path, const char *name, PlaylistEntry &e)
+{
+  (void)fs;   // Con la firma de MetadataFn: no abre el fichero
+  (void)path;
+  const char *slash = strrchr(name, '/');
+  if (slash) name = slash + 1;
+  e.album[0] = '\0';
+  e.durationMs = 0;
+  size_t len = strlen(name);
+  if (len > 4 && !strcasecmp(name + len - 4, ".mp3")) len -= 4;
+
+  const char *sep = (const char *)memchr(name, '_', len);
+  if (sep) {
+    copyTag(e.title, name, sep - name);
+    copyTag(e.artist, sep + 1, len - (sep - name) - 1);
+  } else {
+    copyTag(e.title, name, len);
+    strcpy(e.artist, "Desconocido");
+  }
+}
+
+bool PlaylistIndex::isTrack(const char *name)
+{
+  size_t len = strlen(name);
+  return name[0] != '.' && len > 4 && len < PLAYLIST_NAME_MAX && !strcasecmp(name + len - 4, ".mp3");
+}
+
+bool PlaylistIndex::walkBegin(Walk &w)
+{
+  w.depth = 0;
+  w.rel[0] = '\0';
+  w.dirs[0] = fs->open(dir);
+  if (!w.dirs[0] || !w.dirs[0].isDirectory()) return false;
+  w.relLen[0] = 0;
+  w.depth = 1;
+  return true;
+}
+
+// Siguiente pista en profundidad: deja en w.rel su ruta relativa y en w.size/w.mtime
+// los datos del fichero. Las carpetas ocultas (".Trashes", ...) no se recorren.
+bool PlaylistIndex::walkNext(Walk &w)
+{
+  while (w.depth) {
+    File entry = w.dirs[w.depth - 1].openNextFile();
+    if (!entry) {
+      w.dirs[--w.depth].close();
+      continue;
+    }
+    if (throttle) throttle();
+    const char *name = entry.name();
+    const char *slash = strrchr(name, '/');
+    if (slash) name = slash + 1;
+    size_t base = w.relLen[w.depth - 1];
+    size_t len = strlen(name);
+    if (name[0] == '.' || base + len + 1 >= sizeof(w.rel)) continue;
+
+    memcpy(w.rel + base, name, len);
+    if (entry.isDirectory()) {
+      if (w.depth == PLAYLIST_DEPTH_MAX) continue;
+      w.rel[base + len] = '/';
+      w.rel[base + len + 1] = '\0';
+      w.relLen[w.depth] = base + len + 1;
+      w.dirs[w.depth++] = entry;
+      continue;
+    }
+    w.rel[base + len] = '\0';
+    if (!isTrack(name)) continue;
+    w.size = entry.size();
+    w.mtime = (uint32_t)entry.getLastWrite();
+    return true;
+  }
+  return false;
+}
+
+void PlaylistIndex::walkEnd(Walk &w)
+{
+  while (w.depth) w.dirs[--w.depth].close();
+}
+
+// Huella de la carpeta: suma de un hash por fichero (ruta relativa, tamaño y fecha), así
+// no depende del orden en que el sistema de ficheros devuelva las entradas
+uint32_t PlaylistIndex::scanFingerprint(uint32_t &files)
+{
+  uint32_t sum = 0;
+  files = 0;
+  Walk *w = new Walk;
+  if (walkBegin(*w)) {
+    while (walkNext(*w)) {
+      uint32_t h = fnv1a(2166136261u, w->rel, strlen(w->rel));
+      h = fnv1a(h, &w->size, sizeof(w->size));
+      h = fnv1a(h, &w->mtime, sizeof(w->mtime));
+      sum += h;
+      files++;
+      if (discover) discover(w->rel);
+    }
+  }
+  walkEnd(*w);
+  delete w;
+  return sum;
+}
+
+bool PlaylistIndex::rebuild(uint32_t fingerprint, const char *outPath)
+{
+  RunSorter sorter;
+  char sorted[PLAYLIST_PATH_MAX];
+  if (!sorter.begin(*fs, indexPath, throttle) || !sortNames(sorter) || !sorter.finish(sorted, sizeof(sorted))) {
+    return false;
+  }
+  bool ok = writeIndex(sorted, fingerprint, outPath);
+  fs->remove(sorted);
+  return ok;
+}
+
+// Recorre la carpeta y pasa cada pista (ruta relativa, tamaño y fecha) al ordenador externo
+bool PlaylistIndex::sortNames(RunSorter &sorter)
+{
+  bool ok = true;
+  Walk *w = new Walk;
+  if (walkBegin(*w)) {
+    while (ok && walkNext(*w)) {
+      ok = sorter.add(w->size, w->mtime, w->rel, strlen(w->rel));
+    }
+  }
+  walkEnd(*w);
+  delete w;
+  return ok;
+}
+
+// Escribe el índice definitivo a partir del run ordenado. Las pistas que ya estaban en el
+// índice anterior con el mismo tamaño y fecha conservan sus metadatos sin volver a analizarlas.
+bool PlaylistIndex::writeIndex(const char *sortedPath, uint32_t fingerprint, const char *outPath)
+{
+  char textPath[PLAYLIST_PATH_MAX];
+  snprintf(textPath, sizeof(textPath), "%s.txt", indexPath);
+
+  File sorted = fs->open(sortedPath, FILE_READ);
+  fs->remove(outPath);
+  File out = fs->open(outPath, FILE_WRITE);
+  File text = fs->open(textPath, FILE_WRITE);
+  if (!sorted || !out || !text) return false;
+
+  // Índice anterior, recorrido en paralelo (los dos están ordenados por nombre)
+  Header old;
+  bool hasOld = index && readHeader(index, old);
+  uint32_t oldPos = 0;
+  PlaylistEntry *oldEntry = (PlaylistEntry *)malloc(2 * sizeof(PlaylistEntry) + sizeof(RunRecord));
+  if (!oldEntry) return false;
+  PlaylistEntry *e = oldEntry + 1;
+  RunRecord *r = (RunRecord *)(oldEntry + 2);
+  bool oldValid = false;
+  uint32_t savedEntries = entries;
+  Header savedHeader = header;
+  header = old;
+  entries = hasOld ? old.count : 0;
+  const char *oldName = nullptr;
+  auto nextOld = [&]() {
+    oldValid = oldPos < entries && load(oldPos++, *oldEntry);
+    oldName = oldValid ? oldEntry->path + strlen(dir) + 1 : nullptr;
+  };
+  nextOld();
+
+  Header h;
+  memcpy(h.magic, "MP3I", 4);
+  h.version = version;
+  h.entrySize = sizeof(Record);
+  h.count = 0;
+  h.fingerprint = fingerprint;
+  h.tableOffset = sizeof(Header);
+  h.reserved = 0;
+  out.write((const uint8_t *)&h, sizeof(h)); // Se reescribe al final con los totales
+
+  uint32_t textSize = 0;
+  uint32_t reused = 0;
+  uint32_t parseMicros = 0;
+  while (RunSorter::read(sorted, *r)) {
+    if (throttle) throttle();
+    while (oldValid && strcmp(oldName, r->key) < 0) nextOld();
+
+    snprintf(e->path, sizeof(e->path), "%s/%s", dir, r->key);
+    if (oldValid && !strcmp(oldName, r->key) && oldEntry->size == r->a && oldEntry->mtime == r->b) {
+      strcpy(e->title, oldEntry->title);
+      strcpy(e->artist, oldEntry->artist);
+      strcpy(e->album, oldEntry->album);
+      e->durationMs = oldEntry->durationMs;
+      reused++;
+    } else {
+      e->title[0] = '\0';
+      e->artist[0] = '\0';
+      e->album[0] = '\0';
+      e->durationMs = 0;
+      uint32_t t0 = micros();
+      parseMetadata(*fs, e->path, r->key, *e);
+      parseMicros += micros() - t0;
+    }
+
+    Record rec;
+    rec.textOffset = textSize;
+    rec.reserved = 0;
+    rec.size = r->a;   // Tamaño y fecha, tal como los dejó sortNames()
+    rec.mtime = r->b;
+    rec.durationMs = e->durationMs;
+    size_t lt = strlen(e->title) + 1, la = strlen(e->artist) + 1, lb = strlen(e->album) + 1;
+    rec.textLen = r->keyLen + 1 + lt + la + lb;
+    text.write((const uint8_t *)r->key, r->keyLen + 1);
+    text.write((const uint8_t *)e->title, lt);
+    text.write((const uint8_t *)e->artist, la);
+    text.write((const uint8_t *)e->album, lb);
+    out.write((const uint8_t *)&rec, sizeof(rec));
+    textSize += rec.textLen;
+    h.count++;
+  }
+  header = savedHeader;
+  entries = savedEntries;
+  free(oldEntry);
+  sorted.close();
+  text.close();
+
+  // Añadir la zona de textos detrás de la tabla
+  h.textOffset = sizeof(Header) + h.count * sizeof(Record);
+  h.textSize = textSize;
+  text = fs->open(textPath, FILE_READ);
+  uint8_t buf[512];
+  size_t n;
+  while (text && (n = text.read(buf, sizeof(buf))) > 0) {
+    out.write(buf, n);
+  }
+  text.close();
+  fs->remove(textPath);
+  out.seek(0);
+  out.write((const uint8_t *)&h, sizeof(h));
+  out.close();
+
+  Serial.printf("Índice de la playlist: %u pistas, %u sin cambios.\n", (unsigned)h.count, (unsigned)reused);
+  if (h.count > reused) {
+    Serial.printf("Metadatos: %lu us por pista analizada.\n", (unsigned long)(parseMicros / (h.count - reused)));
+  }
+  return true;
+}
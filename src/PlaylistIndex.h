@@ -0,0 +1,168 @@
+/*
+  PlaylistIndex
+  Índice binario de la playlist guardado en la tarjeta SD.
+  Guarda las rutas ordenadas, tamaño, fecha y metadatos de cada pista para no
+  tener que recorrer la carpeta en cada arranque. Se valida con una huella del
+  directorio (nombres, tamaños y fechas) y solo se vuelven a analizar las pistas
+  nuevas o modificadas (sus etiquetas ID3, o el nombre si no tienen). Las entradas se leen de la tarjeta bajo demanda, así la
+  memoria usada no depende del número de canciones.
+
+  La carpeta se recorre con sus subcarpetas (hasta PLAYLIST_DEPTH_MAX niveles,
+  sin recursión) y los nombres guardados son relativos a ella, p.ej.
+  "Album/Cancion_Artista.mp3". Para revisar la carpeta sin parar la música se
+  abre el índice guardado con open() y se revisa desde otra tarea con rescan()
+  sobre un segundo objeto, que escribe el índice nuevo aparte; adopt() lo pone
+  en lugar del anterior cuando convenga.
+
+  Si caben en PLAYLIST_POOL_BYTES, los nombres de todas las pistas se copian
+  además a RAM en un PathPool (una pasada por la zona de textos al abrir): así
+  buscar una pista o recorrer los nombres no toca la tarjeta.
+
+  Formato del fichero (little endian):
+    Cabecera  32 bytes   magic "MP3I", versión, número de entradas, huella,
+                         posición de la tabla y de la zona de textos
+    Tabla     20 bytes   por entrada: desplazamiento y longitud de sus textos,
+                         tamaño y fecha del fichero y duración en ms (0 si no se sabe)
+    Textos               por entrada: "nombre\0título\0artista\0álbum\0"
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include "PathPool.h"
+#include "RunSorter.h"
+
+#ifndef PLAYLIST_NAME_MAX
+#define PLAYLIST_NAME_MAX 256   // Longitud máxima del nombre de fichero (LFN de FAT)
+#endif
+#define PLAYLIST_DIR_MAX  32
+#define PLAYLIST_PATH_MAX (PLAYLIST_DIR_MAX + PLAYLIST_NAME_MAX)
+#define PLAYLIST_TAG_MAX  64
+
+#ifndef PLAYLIST_DEPTH_MAX
+#define PLAYLIST_DEPTH_MAX 8    // Niveles de subcarpetas que se recorren
+#endif
+
+#ifndef PLAYLIST_POOL_BYTES
+#ifdef BOARD_HAS_PSRAM
+#define PLAYLIST_POOL_BYTES (1024 * 1024) // Nombres en RAM (~30 bytes por pista más 4 de tabla)
+#else
+#define PLAYLIST_POOL_BYTES 16384
+#endif
+#endif
+
+struct PlaylistEntry
+{
+  char path[PLAYLIST_PATH_MAX];    // Ruta completa, p.ej. "/playlist/Cancion_Artista.mp3"
+  char title[PLAYLIST_TAG_MAX];
+  char artist[PLAYLIST_TAG_MAX];
+  char album[PLAYLIST_TAG_MAX];
+  uint32_t size;
+  uint32_t mtime;
+  uint32_t durationMs;             // De la etiqueta TLEN; 0 si no se sabe
+};
+
+class PlaylistIndex
+{
+  public:
+    // Abre el índice de 'dir' guardado en 'indexPath' y lo reconstruye si la carpeta ha cambiado
+    bool begin(fs::FS &fs, const char *dir, const char *indexPath);
+
+    // Abre el índice guardado sin mirar la carpeta; false si no hay o no vale.
+    // Con 'loadNames' a false no copia los nombres a RAM.
+    bool open(fs::FS &fs, const char *dir, const char *indexPath, bool loadNames = true);
+    void close();
+    bool opened() const { return (bool)index; }
+    // Recorre la carpeta y, si no coincide con el índice abierto, escribe uno nuevo
+    // en 'outPath' (sin tocar el abierto). 'changed' dice si lo ha escrito.
+    bool rescan(const char *outPath, bool &changed);
+    // Sustituye el índice abierto por el que rescan() escribió en 'newPath'
+    bool adopt(const char *newPath);
+
+    // Se llama en cada fichero del recorrido y en cada paso de la reconstrucción,
+    // para que quien revise la carpeta en segundo plano pueda ceder la CPU o la tarjeta
+    typedef void (*ThrottleFn)();
+    void setThrottle(ThrottleFn fn) { throttle = fn; }
+    // Se llama con el nombre (relativo a 'dir') de cada pista según aparece al recorrer
+    typedef void (*DiscoverFn)(const char *name);
+    void setDiscovery(DiscoverFn fn) { discover = fn; }
+
+    uint32_t count() const { return entries; }
+    // Huella de la carpeta con la que se construyó el índice abierto
+    uint32_t fingerprint() const { return header.fingerprint; }
+    bool rebuilt() const { return wasRebuilt; }
+
+    // Lee de la tarjeta la entrada 'i' (en orden alfabético)
+    bool load(uint32_t i, PlaylistEntry &e);
+    // Posición de la ruta 'path' (búsqueda binaria en RAM o en la tarjeta); -1 si no está
+    int32_t find(const char *path);
+
+    // Nombre de la pista 'i' sin copiarlo, o nullptr si los nombres no están en RAM
+    const char *name(uint32_t i) const { return names.ready() && i < names.count() ? names.name(i) : nullptr; }
+    size_t namesBytes() const { return names.ready() ? names.bytes() : 0; }
+
+    // Rellena los metadatos de una pista nueva o modificada (por defecto, de sus etiquetas ID3)
+    typedef void (*MetadataFn)(fs::FS &fs, const char *path, const char *name, PlaylistEntry &e);
+    void setMetadataParser(MetadataFn fn) { parseMetadata = fn; }
+
+    static void metadataFromTags(fs::FS &fs, const char *path, const char *name, PlaylistEntry &e);
+    static void metadataFromName(fs::FS &fs, const char *path, const char *name, PlaylistEntry &e);
+
+  private:
+    struct Header {
+      char magic[4];
+      uint16_t version;
+      uint16_t entrySize;
+      uint32_t count;
+      uint32_t fingerprint;
+      uint32_t tableOffset;
+      uint32_t textOffset;
+      uint32_t textSize;
+      uint32_t reserved;
+    };
+    struct Record {
+      uint32_t textOffset;
+      uint16_t textLen;
+      uint16_t reserved;
+      uint32_t size;
+      uint32_t mtime;
+      uint32_t durationMs;
+    };
+    static constexpr uint16_t version = 2;
+
+    // Recorrido en profundidad de 'dir': una pila de carpetas abiertas y la ruta
+    // relativa de la entrada actual
+    struct Walk {
+      File dirs[PLAYLIST_DEPTH_MAX];
+      uint16_t relLen[PLAYLIST_DEPTH_MAX]; // Longitud de 'rel' en cada nivel
+      uint8_t depth;
+      char rel[PLAYLIST_NAME_MAX];
+      uint32_t size;
+      uint32_t mtime;
+    };
+
+    bool readHeader(File &f, Header &h);
+    void loadNames();
+    void setPaths(fs::FS &fs, const char *dir, const char *indexPath);
+    bool walkBegin(Walk &w);
+    bool walkNext(Walk &w);
+    void walkEnd(Walk &w);
+    uint32_t scanFingerprint(uint32_t &files);
+    bool rebuild(uint32_t fingerprint, const char *outPath);
+    bool sortNames(RunSorter &sorter);
+    bool writeIndex(const char *sortedPath, uint32_t fingerprint, const char *outPath);
+    static bool isTrack(const char *name);
+
+    fs::FS *fs = nullptr;
+    char dir[PLAYLIST_DIR_MAX];
+    char indexPath[PLAYLIST_DIR_MAX];
+    File index;
+    Header header;
+    PathPool names;
+    uint32_t entries = 0;
+    bool wasRebuilt = false;
+    MetadataFn parseMetadata = metadataFromTags;
+    ThrottleFn throttle = nullptr;
+    DiscoverFn discover = nullptr;
+};
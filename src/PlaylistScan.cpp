@@ -0,0 +1,67 @@
+/*
+  PlaylistScan
+  Revisión de la carpeta de la playlist en segundo plano
+*/
+
+#include "PlaylistScan.h"
+#include "BrowseIndex.h"
+
+PlaylistScan *PlaylistScan::publishing = nullptr;
+
+bool PlaylistScan::discover(size_t poolBytes, const char *dir, const char *resumed)
+{
+  found.begin(poolBytes, poolBytes / 16, dir);
+  resumedFirst = resumed && resumed[0] && found.add(resumed) == 0;
+  foundCount = found.count();
+  return resumedFirst;
+}
+
+bool PlaylistScan::start(fs::FS &fs, const Files &files, PlaylistIndex::ThrottleFn throttle, UBaseType_t prio,
+                         BaseType_t core)
+{
+  this->fs = &fs;
+  this->files = files;
+  this->throttle = throttle;
+  st = RUNNING;
+  if (xTaskCreatePinnedToCore(task, "scan", PLAYLIST_SCAN_STACK, this, prio, nullptr, core) == pdPASS) return true;
+  st = FAILED;
+  return false;
+}
+
+void PlaylistScan::task(void *param)
+{
+  static_cast<PlaylistScan *>(param)->run();
+  vTaskDelete(nullptr);
+}
+
+// Reaprovecha los metadatos del índice guardado y escribe el nuevo aparte
+void PlaylistScan::run()
+{
+  uint32_t start = millis();
+  index.setThrottle(throttle);
+  if (found.ready()) {
+    publishing = this;
+    index.setDiscovery(publish);
+  }
+  index.open(*fs, files.dir, files.index, false);
+  bool changed = false;
+  bool ok = index.rescan(files.indexNew, changed);
+  // Índices por artista y álbum del índice que quedará en uso, si no están ya
+  if (ok && index.open(*fs, files.dir, changed ? files.indexNew : files.index, false) && index.count() &&
+      BrowseIndex::storedFingerprint(*fs, files.browse) != index.fingerprint()) {
+    browseBuilt = BrowseIndex::build(index, *fs, files.browseNew, throttle);
+  }
+  index.close();
+  publishing = nullptr;
+  Serial.printf("Revisión de la playlist en %lu ms: %s.\n", (unsigned long)(millis() - start),
+                !ok ? "error" : changed ? "índice nuevo" : "sin cambios");
+  st = !ok ? FAILED : changed ? CHANGED : UNCHANGED;
+}
+
+// Desde la tarea: deja la pista a la vista, que solo se lee hasta count()
+void PlaylistScan::publish(const char *name)
+{
+  PlaylistScan *s = publishing;
+  if (s->resumedFirst && !strcmp(s->found.name(0), name)) return; // Ya está
+  if (s->found.add(name, strlen(name)) >= 0) s->foundCount.store(s->found.count(), std::memory_order_release);
+}
@@ -0,0 +1,77 @@
+/*
+  PlaylistScan
+  Revisión de la carpeta de la playlist en segundo plano. Una tarea con su propio
+  PlaylistIndex lee el índice guardado, lo compara con la carpeta y, si ha
+  cambiado, escribe el nuevo aparte; también los índices por artista y álbum
+  (BrowseIndex) si no son del índice que quedará en uso. Quien la arranca mira
+  state() y, al acabar, adopta lo escrito y llama a finish().
+
+  Sin índice guardado, discover() hace que las pistas se publiquen según aparecen
+  al recorrer la carpeta: la tarea solo añade y quien lee no pasa de count().
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "PathPool.h"
+#include "PlaylistIndex.h"
+
+#define PLAYLIST_SCAN_STACK 8192
+
+class PlaylistScan
+{
+  public:
+    enum State : int { RUNNING, UNCHANGED, CHANGED, FAILED, DONE };
+
+    // Ficheros de la revisión
+    struct Files {
+      const char *dir;        // Carpeta de la playlist
+      const char *index;      // Índice guardado
+      const char *indexNew;   // Índice nuevo, si la carpeta ha cambiado
+      const char *browse;     // Índices por artista y álbum guardados
+      const char *browseNew;  // Los nuevos, si hay que rehacerlos
+    };
+
+    // Antes de start(), sin índice guardado: publica las pistas de 'dir' en un PathPool
+    // de 'poolBytes'. La ruta 'resumed' (si la hay) queda como la primera; devuelve true
+    // si es así.
+    bool discover(size_t poolBytes, const char *dir, const char *resumed);
+    // Arranca la tarea en 'core'. 'throttle' se llama en cada fichero y cada paso, para
+    // ceder la CPU o la tarjeta.
+    bool start(fs::FS &fs, const Files &files, PlaylistIndex::ThrottleFn throttle, UBaseType_t prio,
+               BaseType_t core);
+
+    State state() const { return st.load(); }
+    // Lo que ha dejado la tarea ya está atendido
+    void finish() { st = DONE; }
+    // true (una vez) si la tarea ha escrito Files::browseNew
+    bool takeBrowse() { return browseBuilt.exchange(false); }
+
+    // Pistas publicadas, hasta que endDiscovery() (con la tarea acabada) las libera
+    bool discovering() const { return found.ready(); }
+    uint32_t count() const { return foundCount.load(std::memory_order_acquire); }
+    const char *name(uint32_t i) const { return found.name(i); }
+    void path(uint32_t i, char *out, size_t len) const { found.path(i, out, len); }
+    void endDiscovery() { found.end(); }
+
+  private:
+    static void task(void *param);
+    static void publish(const char *name);
+    void run();
+
+    static PlaylistScan *publishing; // La que recibe las pistas de setDiscovery()
+
+    PlaylistIndex index;            // El de la tarea: lee el guardado y escribe el nuevo
+    fs::FS *fs = nullptr;
+    Files files = {};
+    PlaylistIndex::ThrottleFn throttle = nullptr;
+    std::atomic<State> st{DONE};
+    std::atomic<bool> browseBuilt{false};
+    PathPool found;                 // Solo añade la tarea
+    std::atomic<uint32_t> foundCount{0};
+    bool resumedFirst = false;      // La primera de 'found' es la pista reanudada
+};
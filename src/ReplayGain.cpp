@@ -0,0 +1,54 @@
+/*
+  ReplayGain
+  Sonoridad de cada pista guardada junto al MP3
+*/
+
+#include "ReplayGain.h"
+#include <math.h>
+
+void ReplayGain::sidecarPath(char *out, size_t len, const char *path)
+{
+  snprintf(out, len, "%s.rg", path);
+}
+
+bool ReplayGain::load(fs::FS &fs, const char *path, uint32_t size, uint32_t mtime, TrackLoudness &out)
+{
+  char name[300];
+  sidecarPath(name, sizeof(name), path);
+  File f = fs.open(name, FILE_READ);
+  if (!f) return false;
+  FileHeader h;
+  bool ok = f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) && !memcmp(h.magic, "MP3G", 4) &&
+            h.version == version && h.fileSize == size && h.mtime == mtime;
+  f.close();
+  if (!ok) return false;
+  out.lufs = h.lufs;
+  out.peak = h.peak;
+  return true;
+}
+
+bool ReplayGain::save(fs::FS &fs, const char *path, uint32_t size, uint32_t mtime, const TrackLoudness &l)
+{
+  char name[300];
+  sidecarPath(name, sizeof(name), path);
+  File f = fs.open(name, FILE_WRITE);
+  if (!f) return false;
+  FileHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, "MP3G", 4);
+  h.version = version;
+  h.fileSize = size;
+  h.mtime = mtime;
+  h.lufs = l.lufs;
+  h.peak = l.peak;
+  bool ok = f.write((const uint8_t *)&h, sizeof(h)) == sizeof(h);
+  f.close();
+  return ok;
+}
+
+float ReplayGain::gain(const TrackLoudness &l)
+{
+  float db = REPLAYGAIN_TARGET - l.lufs;
+  if (db > REPLAYGAIN_MAX_DB) db = REPLAYGAIN_MAX_DB;
+  return powf(10.0f, db / 20.0f);
+}
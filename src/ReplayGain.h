@@ -0,0 +1,55 @@
+/*
+  ReplayGain
+  Sonoridad medida de una pista (AudioOutputLoudness) guardada junto al MP3
+  ("<fichero>.rg") y ganancia que la lleva al nivel de referencia. El fichero
+  lleva el tamaño y la fecha del MP3: si el MP3 cambia, la medida deja de valer
+  y se vuelve a hacer.
+
+  Fichero (little endian, 20 bytes): magic "MP3G", versión, tamaño y fecha del
+  MP3, sonoridad integrada en LUFS y pico de muestra (0..1), ambos en float.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#ifndef REPLAYGAIN_TARGET
+#define REPLAYGAIN_TARGET -18.0f // LUFS de referencia (ReplayGain 2.0)
+#endif
+#ifndef REPLAYGAIN_MAX_DB
+#define REPLAYGAIN_MAX_DB  6.0f  // Subida máxima; BlockDsp no pasa de x2
+#endif
+
+struct TrackLoudness
+{
+  float lufs;
+  float peak;
+};
+
+class ReplayGain
+{
+  public:
+    // Medida guardada del MP3 'path' (de tamaño 'size' y fecha 'mtime'); false si no hay
+    // o es de otra versión del fichero
+    static bool load(fs::FS &fs, const char *path, uint32_t size, uint32_t mtime, TrackLoudness &out);
+    static bool save(fs::FS &fs, const char *path, uint32_t size, uint32_t mtime, const TrackLoudness &l);
+
+    // Ganancia lineal hasta REPLAYGAIN_TARGET, sin subir más de REPLAYGAIN_MAX_DB (el pico
+    // lo limita BlockDsp junto con el volumen)
+    static float gain(const TrackLoudness &l);
+
+  private:
+    struct FileHeader {
+      char magic[4];
+      uint16_t version;
+      uint16_t reserved;
+      uint32_t fileSize;
+      uint32_t mtime;
+      float lufs;
+      float peak;
+    };
+    static constexpr uint16_t version = 1;
+
+    static void sidecarPath(char *out, size_t len, const char *path);
+};
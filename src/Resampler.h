@@ -0,0 +1,198 @@
+/*
+  Resampler
+  Conversor de frecuencia de muestreo polifásico en coma fija para PCM estéreo.
+
+  El filtro (sinc con ventana de Kaiser) se guarda como 'Phases' fases de 'Taps'
+  coeficientes Q14 (en Q15 la suma de 64 productos podría desbordar 32 bits).
+  Cada muestra de salida se calcula con las dos fases más cercanas a su posición
+  e interpolando linealmente entre ellas, así basta una tabla pequeña para cualquier relación entre frecuencias. La posición avanza
+  con un acumulador de 32.32 bits. Al bajar de frecuencia el corte se escala a
+  la de salida para que lo que no cabe se filtre en lugar de plegarse.
+
+  El filtro se diseña para 'AttenDb' de atenuación fuera de banda; la transición
+  queda centrada un cuarto de su anchura por debajo de la mitad de la frecuencia
+  menor, así lo poco que se pliega cae por encima de la banda de paso.
+
+  La tabla se recalcula (en float) solo cuando cambia la relación de frecuencias.
+  La calidad se elige al compilar con RESAMPLE_QUALITY:
+    0  16 coeficientes, 32 fases, 50 dB
+    1  32 coeficientes, 64 fases, 72 dB
+    2  64 coeficientes, 128 fases, 90 dB
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+
+#ifndef RESAMPLE_QUALITY
+#define RESAMPLE_QUALITY 1
+#endif
+
+template <int Taps, int Phases, int AttenDb>
+class PolyphaseResampler
+{
+  public:
+    static constexpr int chunkFrames = 1152; // Entrada que se puede acumular de una vez
+
+    PolyphaseResampler() { reset(); }
+
+    // Devuelve false si alguna frecuencia no es válida. Con las dos iguales no hace falta
+    // llamar a process() (ver passthrough()).
+    bool setRates(uint32_t in, uint32_t out)
+    {
+      if (!in || !out) return false;
+      if (in == inRate && out == outRate) return true;
+      inRate = in;
+      outRate = out;
+      step = ((uint64_t)in << 32) / out;
+      // Al subir de frecuencia el corte depende solo de la entrada: la tabla no cambia
+      float scale = (out < in) ? (float)out / in : 1.0f;
+      if (scale != tableScale) buildTable(scale);
+      return true;
+    }
+
+    bool passthrough() const { return inRate == outRate; }
+
+    // Fin de la banda de paso y principio de la atenuada, en fracción de la mitad de
+    // la frecuencia menor
+    static float passbandEdge() { return 1.0f - 3.0f * transitionWidth() / 4.0f; }
+    static float stopbandEdge() { return 1.0f + transitionWidth() / 4.0f; }
+    uint32_t inputRate() const { return inRate; }
+    uint32_t outputRate() const { return outRate; }
+
+    // Tramas de entrada aceptadas que aún no han salido: las que quedan por delante del
+    // centro del filtro (incluye el retardo de Taps / 2 tramas del propio filtro)
+    uint32_t pending() const
+    {
+      uint32_t used = pos + Taps / 2 - 1;
+      return bufLen > used ? bufLen - used : 0;
+    }
+
+    // Olvida la entrada acumulada (salto o cambio de pista)
+    void reset()
+    {
+      memset(buf, 0, sizeof(int16_t) * 2 * (Taps - 1));
+      bufLen = Taps - 1; // La salida empieza con el filtro lleno de silencio
+      pos = 0;
+      frac = 0;
+    }
+
+    // Toma hasta 'inFrames' tramas de 'in' (devuelve en 'inUsed' cuántas) y escribe
+    // hasta 'outMax' tramas en 'out'. Devuelve las tramas escritas.
+    uint32_t process(const int16_t *in, uint32_t inFrames, uint32_t &inUsed, int16_t *out, uint32_t outMax)
+    {
+      // Descartar lo que ya no alcanza ningún coeficiente y añadir la entrada nueva
+      if (pos) {
+        memmove(buf, buf + 2 * pos, (bufLen - pos) * 2 * sizeof(int16_t));
+        bufLen -= pos;
+        pos = 0;
+      }
+      uint32_t n = bufCap - bufLen;
+      if (n > inFrames) n = inFrames;
+      memcpy(buf + 2 * bufLen, in, n * 2 * sizeof(int16_t));
+      bufLen += n;
+      inUsed = n;
+
+      uint32_t produced = 0;
+      while (produced < outMax && pos + Taps <= bufLen) {
+        // Fase y fracción entre fases a partir de la parte fraccionaria de la posición
+        uint32_t phase = frac >> (32 - phaseBits);
+        int32_t mix = (frac >> (32 - phaseBits - 15)) & 0x7fff; // Q15
+        const int16_t *h0 = table + phase * Taps;
+        const int16_t *h1 = h0 + Taps;
+        const int16_t *x = buf + 2 * pos;
+        int32_t l0 = 0, r0 = 0, l1 = 0, r1 = 0;
+        for (int k = 0; k < Taps; k++) {
+          int32_t xl = x[2 * k], xr = x[2 * k + 1];
+          l0 += h0[k] * xl;
+          r0 += h0[k] * xr;
+          l1 += h1[k] * xl;
+          r1 += h1[k] * xr;
+        }
+        l0 >>= 14; r0 >>= 14; l1 >>= 14; r1 >>= 14;
+        out[2 * produced] = saturate(l0 + (int32_t)(((int64_t)(l1 - l0) * mix) >> 15));
+        out[2 * produced + 1] = saturate(r0 + (int32_t)(((int64_t)(r1 - r0) * mix) >> 15));
+        produced++;
+
+        uint64_t next = (uint64_t)frac + step;
+        pos += next >> 32;
+        frac = (uint32_t)next;
+      }
+      return produced;
+    }
+
+  private:
+    static constexpr int phaseBits = (Phases == 32) ? 5 : (Phases == 64) ? 6 : (Phases == 128) ? 7 : 8;
+    static_assert((1 << phaseBits) == Phases, "Phases debe ser 32, 64, 128 o 256");
+    static constexpr uint32_t bufCap = Taps + chunkFrames;
+
+    static int16_t saturate(int32_t x)
+    {
+      return x > 32767 ? 32767 : (x < -32768 ? -32768 : (int16_t)x);
+    }
+
+    // Anchura de la transición según Kaiser, en fracción de Nyquist
+    static float transitionWidth() { return 2.0f * (AttenDb - 7.95f) / (14.36f * Taps); }
+
+    // Función de Bessel modificada de orden 0 (serie), para la ventana de Kaiser
+    static float besselI0(float x)
+    {
+      float sum = 1.0f, term = 1.0f;
+      for (int k = 1; k < 20; k++) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+      }
+      return sum;
+    }
+
+    // Fase p: coeficiente k para una salida situada p/Phases muestras después de la
+    // muestra Taps/2 - 1. Cada fase se normaliza a ganancia 1 en continua.
+    void buildTable(float scale)
+    {
+      tableScale = scale;
+      // Fórmulas de Kaiser: beta de la ventana y anchura de la transición (en fracción de Nyquist)
+      const float A = AttenDb;
+      const float beta = (A > 50.0f) ? 0.1102f * (A - 8.7f)
+                                     : 0.5842f * powf(A - 21.0f, 0.4f) + 0.07886f * (A - 21.0f);
+      const float cutoff = (1.0f - transitionWidth() / 4.0f) * scale; // Fracción de Nyquist de la entrada
+      const float half = Taps / 2.0f;
+      const float i0beta = besselI0(beta);
+      for (int p = 0; p <= Phases; p++) {
+        float taps[Taps];
+        float sum = 0.0f;
+        for (int k = 0; k < Taps; k++) {
+          float t = k - (half - 1) - (float)p / Phases;
+          float x = (float)M_PI * cutoff * t;
+          float sinc = (fabsf(x) < 1e-6f) ? 1.0f : sinf(x) / x;
+          float w = t / half;
+          float win = (fabsf(w) < 1.0f) ? besselI0(beta * sqrtf(1.0f - w * w)) / i0beta : 0.0f;
+          taps[k] = sinc * win;
+          sum += taps[k];
+        }
+        for (int k = 0; k < Taps; k++) table[p * Taps + k] = (int16_t)lroundf(taps[k] / sum * 16384.0f);
+      }
+    }
+
+    int16_t table[(Phases + 1) * Taps]; // La fase extra es la primera desplazada una muestra
+    float tableScale = 0.0f;
+    int16_t buf[2 * bufCap];           // Entrada pendiente, con Taps - 1 tramas de historia
+    uint32_t bufLen = Taps - 1;
+    uint32_t pos = 0;                  // Primera trama de 'buf' que usa la siguiente salida
+    uint32_t frac = 0;                 // Posición fraccionaria entre 'pos' y 'pos' + 1 (Q32)
+    uint64_t step = 1ULL << 32;        // Tramas de entrada por trama de salida (32.32)
+    uint32_t inRate = 0;
+    uint32_t outRate = 0;
+};
+
+typedef PolyphaseResampler<16, 32, 50> ResamplerQ0;
+typedef PolyphaseResampler<32, 64, 72> ResamplerQ1;
+typedef PolyphaseResampler<64, 128, 90> ResamplerQ2;
+
+#if RESAMPLE_QUALITY == 0
+typedef ResamplerQ0 Resampler;
+#elif RESAMPLE_QUALITY == 1
+typedef ResamplerQ1 Resampler;
+#else
+typedef ResamplerQ2 Resampler;
+#endif
@@ -0,0 +1,62 @@
+/*
+  ResumeStore
+  Punto de reanudación guardado en la NVS
+*/
+
+#include "ResumeStore.h"
+
+bool ResumeStore::begin(const char *name)
+{
+  memset(&last, 0, sizeof(last));
+  opened = prefs.begin(name, false);
+  return opened;
+}
+
+bool ResumeStore::load(ResumePoint &p)
+{
+  if (!opened) return false;
+  Record r;
+  memset(&r, 0, sizeof(r));
+  size_t len = prefs.getBytes("last", &r, sizeof(r) - 1);
+  if (len <= offsetof(Record, path) || r.version != version) return false;
+  r.path[len - offsetof(Record, path)] = '\0';
+  last = r;
+
+  strncpy(p.path, r.path, sizeof(p.path));
+  p.index = r.index;
+  p.size = r.size;
+  p.mtime = r.mtime;
+  p.sample = r.sample;
+  p.playing = r.playing;
+  p.order.seed = r.orderSeed;
+  p.order.offset = r.orderOffset;
+  p.order.cycle = r.orderCycle;
+  p.order.shuffle = r.shuffle;
+  p.order.repeat = (RepeatMode)r.repeat;
+  return true;
+}
+
+bool ResumeStore::save(const ResumePoint &p)
+{
+  if (!opened) return false;
+  Record r;
+  memset(&r, 0, sizeof(r));
+  r.version = version;
+  r.playing = p.playing;
+  r.index = p.index;
+  r.size = p.size;
+  r.mtime = p.mtime;
+  r.sample = p.sample;
+  r.orderSeed = p.order.seed;
+  r.orderOffset = p.order.offset;
+  r.orderCycle = p.order.cycle;
+  r.shuffle = p.order.shuffle;
+  r.repeat = p.order.repeat;
+  strncpy(r.path, p.path, sizeof(r.path) - 1);
+
+  size_t len = recordSize(r);
+  if (len == recordSize(last) && !memcmp(&r, &last, len)) return false;
+  if (prefs.putBytes("last", &r, len) != len) return false;
+  last = r;
+  return true;
+}
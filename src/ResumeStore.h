@@ -0,0 +1,65 @@
+/*
+  ResumeStore
+  Última pista y posición guardadas en la NVS para seguir tras un corte de
+  alimentación. Se guarda la ruta con el tamaño y la fecha del fichero (para no
+  seguir en un MP3 distinto con el mismo nombre) y la muestra en la cuenta del
+  decodificador, que la tabla de búsqueda convierte en byte al reanudar. También
+  el orden (aleatorio, repetición y semilla), para seguir con la misma secuencia.
+
+  save() solo escribe si algo ha cambiado: cada escritura en flash para un
+  momento la caché de los dos núcleos (unos ms, que cubre la cola PCM).
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "PlaylistIndex.h"
+#include "PlayOrder.h"
+
+struct ResumePoint
+{
+  char path[PLAYLIST_PATH_MAX];
+  uint32_t index;    // Posición en la playlist cuando se guardó (se comprueba con la ruta)
+  uint32_t size;
+  uint32_t mtime;
+  uint32_t sample;   // Muestra (sin recortar) donde seguir; 0 = desde el principio
+  bool playing;      // Sonaba (se reanuda al arrancar) o estaba en pausa/parada
+  PlayOrder::State order; // Aleatorio, repetición y orden en curso
+};
+
+class ResumeStore
+{
+  public:
+    bool begin(const char *name = "resume");
+
+    // false si no hay nada guardado o es de otra versión
+    bool load(ResumePoint &p);
+    // true si se ha escrito en la flash
+    bool save(const ResumePoint &p);
+
+  private:
+    struct Record {
+      uint16_t version;
+      uint8_t playing;
+      uint8_t reserved;
+      uint32_t index;
+      uint32_t size;
+      uint32_t mtime;
+      uint32_t sample;
+      uint32_t orderSeed;
+      uint32_t orderOffset;
+      int32_t orderCycle;
+      uint8_t shuffle;
+      uint8_t repeat;
+      uint16_t reserved2;
+      char path[PLAYLIST_PATH_MAX];
+    };
+    static constexpr uint16_t version = 2;
+
+    static size_t recordSize(const Record &r) { return offsetof(Record, path) + strlen(r.path) + 1; }
+
+    Preferences prefs;
+    Record last;          // Lo último leído o escrito, para no repetir escrituras
+    bool opened = false;
+};
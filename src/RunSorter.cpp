@@ -0,0 +1,163 @@
+/*
+  RunSorter
+  Ordenación externa por tramos en la tarjeta SD
+*/
+
+#include <algorithm>
+#include "RunSorter.h"
+
+static constexpr uint32_t maxRecords = INDEX_SORT_BYTES / 16;
+
+bool RunSorter::read(File &f, RunRecord &r)
+{
+  if (f.read((uint8_t *)&r.a, 4) != 4) return false;
+  if (f.read((uint8_t *)&r.b, 4) != 4) return false;
+  if (f.read((uint8_t *)&r.keyLen, 2) != 2) return false;
+  if (r.keyLen >= RUN_KEY_MAX) return false;
+  if (f.read((uint8_t *)r.key, r.keyLen) != r.keyLen) return false;
+  r.key[r.keyLen] = '\0';
+  return true;
+}
+
+void RunSorter::write(File &f, const RunRecord &r)
+{
+  f.write((const uint8_t *)&r.a, 4);
+  f.write((const uint8_t *)&r.b, 4);
+  f.write((const uint8_t *)&r.keyLen, 2);
+  f.write((const uint8_t *)r.key, r.keyLen);
+}
+
+bool RunSorter::begin(fs::FS &fs, const char *base, ThrottleFn throttle)
+{
+  end();
+  this->fs = &fs;
+  strncpy(this->base, base, sizeof(this->base) - 1);
+  this->base[sizeof(this->base) - 1] = '\0';
+  this->throttle = throttle;
+  buf = (uint8_t *)malloc(INDEX_SORT_BYTES);
+  offsets = (uint16_t *)malloc(maxRecords * sizeof(uint16_t));
+  if (!buf || !offsets) {
+    end();
+    return false;
+  }
+  return true;
+}
+
+void RunSorter::end()
+{
+  free(buf);
+  free(offsets);
+  buf = nullptr;
+  offsets = nullptr;
+  used = count = runs = 0;
+}
+
+void RunSorter::runPath(char *out, size_t len, uint32_t n)
+{
+  snprintf(out, len, "%s.run%u", base, (unsigned)n);
+}
+
+bool RunSorter::add(uint32_t a, uint32_t b, const char *key, uint16_t len)
+{
+  if (!buf || len >= RUN_KEY_MAX) return false;
+  if (used + 10 + len > INDEX_SORT_BYTES || count == maxRecords) {
+    if (!flush()) return false;
+  }
+  uint8_t *p = buf + used;
+  memcpy(p, &a, 4);
+  memcpy(p + 4, &b, 4);
+  memcpy(p + 8, &len, 2);
+  memcpy(p + 10, key, len);
+  offsets[count++] = used;
+  used += 10 + len;
+  return true;
+}
+
+// Ordena el buffer y lo escribe como un run nuevo
+bool RunSorter::flush()
+{
+  uint8_t *buf = this->buf;
+  std::sort(offsets, offsets + count, [buf](uint16_t a, uint16_t b) {
+    uint16_t la, lb;
+    memcpy(&la, buf + a + 8, 2);
+    memcpy(&lb, buf + b + 8, 2);
+    int c = memcmp(buf + a + 10, buf + b + 10, la < lb ? la : lb);
+    return c ? c < 0 : la < lb;
+  });
+  char path[64];
+  runPath(path, sizeof(path), runs++);
+  File f = fs->open(path, FILE_WRITE);
+  if (!f) return false;
+  for (uint32_t i = 0; i < count; i++) {
+    uint16_t len;
+    memcpy(&len, buf + offsets[i] + 8, 2);
+    f.write(buf + offsets[i], 10 + len);
+  }
+  f.close();
+  used = 0;
+  count = 0;
+  return true;
+}
+
+bool RunSorter::finish(char *sortedPath, size_t len)
+{
+  if (!buf) return false;
+  // Sin registros: un run vacío basta para dejar un resultado vacío
+  if ((count || !runs) && !flush()) return false;
+  free(buf);
+  free(offsets);
+  buf = nullptr;
+  offsets = nullptr;
+  if (!merge()) return false;
+  runPath(sortedPath, len, 2 * runs - 2); // Con fusiones por parejas el último run es el 2n-2
+  runs = 0;
+  return true;
+}
+
+// Fusiona los runs de dos en dos (0+1 -> n, 2+3 -> n+1, ...) hasta que queda uno, el 2n-2.
+// Solo hay tres ficheros abiertos a la vez y un registro de cada uno en memoria.
+bool RunSorter::merge()
+{
+  char pathA[64], pathB[64], pathOut[64];
+  RunRecord *ra = (RunRecord *)malloc(2 * sizeof(RunRecord));
+  if (!ra) return false;
+  RunRecord *rb = ra + 1;
+
+  for (uint32_t first = 0, next = runs; next - first > 1; first += 2, next++) {
+    runPath(pathA, sizeof(pathA), first);
+    runPath(pathB, sizeof(pathB), first + 1);
+    runPath(pathOut, sizeof(pathOut), next);
+    File a = fs->open(pathA, FILE_READ);
+    File b = fs->open(pathB, FILE_READ);
+    File out = fs->open(pathOut, FILE_WRITE);
+    if (!a || !b || !out) {
+      free(ra);
+      return false;
+    }
+
+    bool hasA = read(a, *ra);
+    bool hasB = read(b, *rb);
+    while (hasA || hasB) {
+      bool takeA = hasA;
+      if (hasA && hasB) {
+        int c = memcmp(ra->key, rb->key, ra->keyLen < rb->keyLen ? ra->keyLen : rb->keyLen);
+        takeA = c ? c < 0 : ra->keyLen <= rb->keyLen;
+      }
+      if (throttle) throttle();
+      if (takeA) {
+        write(out, *ra);
+        hasA = read(a, *ra);
+      } else {
+        write(out, *rb);
+        hasB = read(b, *rb);
+      }
+    }
+    a.close();
+    b.close();
+    out.close();
+    fs->remove(pathA);
+    fs->remove(pathB);
+  }
+  free(ra);
+  return true;
+}
@@ -0,0 +1,63 @@
+/*
+  RunSorter
+  Ordenación externa en la tarjeta SD de registros con una clave de texto y dos
+  enteros. Los registros se acumulan en un buffer de INDEX_SORT_BYTES; cada vez
+  que se llena se ordena y se escribe como un tramo ("run") en un fichero
+  temporal, y al terminar los runs se fusionan de dos en dos hasta dejar uno.
+  Así la memoria usada no depende del número de registros.
+
+  Orden alfabético por bytes de la clave (memcmp, la más corta antes).
+  Formato de cada registro en los runs: a, b (4 bytes), longitud (2) y clave (sin '\0').
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#ifndef INDEX_SORT_BYTES
+#define INDEX_SORT_BYTES  8192  // Memoria para ordenar claves (por tramos)
+#endif
+#define RUN_KEY_MAX 256
+
+struct RunRecord
+{
+  uint32_t a;
+  uint32_t b;
+  uint16_t keyLen;
+  char key[RUN_KEY_MAX];
+};
+
+class RunSorter
+{
+  public:
+    typedef void (*ThrottleFn)();
+
+    ~RunSorter() { end(); }
+
+    // Los temporales se llaman "<base>.run<n>". 'throttle' (opcional) se llama en cada
+    // registro al fusionar.
+    bool begin(fs::FS &fs, const char *base, ThrottleFn throttle = nullptr);
+    bool add(uint32_t a, uint32_t b, const char *key, uint16_t len);
+    // Ordena lo añadido y deja en 'sortedPath' el fichero con el resultado, que hay que
+    // borrar después de leerlo
+    bool finish(char *sortedPath, size_t len);
+    void end();
+
+    static bool read(File &f, RunRecord &r);
+    static void write(File &f, const RunRecord &r);
+
+  private:
+    bool flush();
+    bool merge();
+    void runPath(char *out, size_t len, uint32_t n);
+
+    fs::FS *fs = nullptr;
+    char base[48];
+    ThrottleFn throttle = nullptr;
+    uint8_t *buf = nullptr;
+    uint16_t *offsets = nullptr;
+    uint32_t used = 0;
+    uint32_t count = 0;
+    uint32_t runs = 0;
+};
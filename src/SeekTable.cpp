@@ -0,0 +1,181 @@
+/*
+  SeekTable
+  Tabla de búsqueda trama -> byte de un MP3
+*/
+
+#include "SeekTable.h"
+
+bool SeekTable::begin(fs::FS &fs, const char *path, uint32_t size, uint32_t mtime, const XingInfo &info)
+{
+  end();
+  this->fs = &fs;
+  strncpy(this->path, path, sizeof(this->path) - 1);
+  this->path[sizeof(this->path) - 1] = '\0';
+  fileSize = size;
+  this->mtime = mtime;
+
+  count = 0;
+  stride = SEEK_MIN_STRIDE;
+  scanPos = info.firstFramePos;
+  scanFrame = 0;
+  scanDone = false;
+
+  firstFramePos = info.firstFramePos;
+  spf = info.samplesPerFrame;
+  rate = info.sampleRate;
+  hasToc = info.hasXing && info.hasToc && info.frames;
+  memcpy(toc, info.toc, sizeof(toc));
+  // La trama Xing/Info cuenta como una más: se decodifica (como silencio)
+  xingFrames = (info.hasXing && info.frames) ? info.frames + 1 : 0;
+  xingBytes = (info.hasXing && info.bytes) ? info.bytes : size - info.firstFramePos;
+  frameBytes = xingFrames ? xingBytes / xingFrames : (spf / 8) * info.bitrateKbps * 1000 / rate;
+  if (!frameBytes || !rate) return false;
+
+  ready = true;
+  load();
+  return true;
+}
+
+void SeekTable::end()
+{
+  if (scanFile) scanFile.close();
+  ready = false;
+}
+
+void SeekTable::tablePath(char *out, size_t len) const
+{
+  snprintf(out, len, "%s.sk", path);
+}
+
+bool SeekTable::load()
+{
+  char name[sizeof(path) + 4];
+  tablePath(name, sizeof(name));
+  File f = fs->open(name, FILE_READ);
+  if (!f) return false;
+
+  FileHeader h;
+  bool ok = f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) && !memcmp(h.magic, "MP3T", 4) &&
+            h.version == version && h.fileSize == fileSize && h.mtime == mtime &&
+            h.count && h.count <= SEEK_TABLE_ENTRIES && h.stride;
+  ok = ok && f.read((uint8_t *)offsets, h.count * sizeof(uint32_t)) == h.count * sizeof(uint32_t);
+  f.close();
+  if (!ok) {
+    count = 0;
+    return false;
+  }
+
+  count = h.count;
+  stride = h.stride;
+  scanFrame = h.frames;
+  spf = h.spf;
+  rate = h.rate;
+  scanDone = true;
+  return true;
+}
+
+bool SeekTable::save()
+{
+  char name[sizeof(path) + 4];
+  tablePath(name, sizeof(name));
+  File f = fs->open(name, FILE_WRITE);
+  if (!f) return false;
+
+  FileHeader h;
+  memcpy(h.magic, "MP3T", 4);
+  h.version = version;
+  h.reserved = 0;
+  h.fileSize = fileSize;
+  h.mtime = mtime;
+  h.frames = scanFrame;
+  h.stride = stride;
+  h.count = count;
+  h.spf = spf;
+  h.reserved2 = 0;
+  h.rate = rate;
+  bool ok = f.write((const uint8_t *)&h, sizeof(h)) == sizeof(h) &&
+            f.write((const uint8_t *)offsets, count * sizeof(uint32_t)) == count * sizeof(uint32_t);
+  f.close();
+  return ok;
+}
+
+bool SeekTable::scanStep()
+{
+  if (!ready || scanDone) return false;
+  if (!scanFile) {
+    scanFile = fs->open(path, FILE_READ);
+    if (!scanFile) {
+      scanDone = true; // Sin tabla exacta; se sigue usando la aproximada
+      return false;
+    }
+  }
+
+  for (int n = 0; n < SEEK_SCAN_FRAMES; n++) {
+    // Solo se leen los 4 bytes de cabecera; el resto de la trama se salta
+    uint8_t hdr[4];
+    uint32_t len = 0;
+    if (scanPos + 4 <= fileSize && scanFile.seek(scanPos) && scanFile.read(hdr, 4) == 4) {
+      len = mp3FrameInfo(hdr, nullptr, nullptr, nullptr);
+    }
+    if (!len) {
+      // Fin del audio (o etiqueta ID3v1/APE, o datos dañados: la tabla llega hasta aquí)
+      scanFile.close();
+      scanDone = true;
+      if (count) save();
+      return false;
+    }
+
+    if (scanFrame % stride == 0) {
+      if (count == SEEK_TABLE_ENTRIES) {
+        // Tabla llena: quedarse con una de cada dos entradas y duplicar el paso
+        for (uint32_t i = 0; i < count / 2; i++) offsets[i] = offsets[2 * i];
+        count /= 2;
+        stride *= 2;
+      }
+      if (scanFrame % stride == 0) offsets[count++] = scanPos;
+    }
+    scanPos += len;
+    scanFrame++;
+  }
+  return true;
+}
+
+uint32_t SeekTable::totalFrames() const
+{
+  if (!ready) return 0;
+  if (scanDone) return scanFrame;
+  if (xingFrames) return xingFrames;
+  return (fileSize - firstFramePos) / frameBytes;
+}
+
+bool SeekTable::lookup(uint32_t frame, uint32_t &offset, uint32_t &fromFrame) const
+{
+  if (!ready) return false;
+  uint32_t target = frame > SEEK_PREROLL ? frame - SEEK_PREROLL : 0;
+  if (target < scanFrame && count) {
+    uint32_t i = target / stride;
+    if (i >= count) i = count - 1;
+    offset = offsets[i];
+    fromFrame = i * stride;
+    return true;
+  }
+  // Sin tabla exacta hasta ahí: posición estimada, la trama real puede diferir en una
+  offset = approxOffset(target);
+  fromFrame = target;
+  return true;
+}
+
+uint32_t SeekTable::approxOffset(uint32_t frame) const
+{
+  if (hasToc) {
+    // La TOC da la posición (en 1/256 de los bytes) de cada 1% de la duración; se interpola
+    float pct = 100.0f * frame / xingFrames;
+    if (pct > 99.99f) pct = 99.99f;
+    int i = (int)pct;
+    float a = toc[i];
+    float b = i < 99 ? toc[i + 1] : 256.0f;
+    float pos = a + (b - a) * (pct - i);
+    return firstFramePos + (uint32_t)(pos * xingBytes / 256.0f);
+  }
+  return firstFramePos + frame * frameBytes;
+}
@@ -0,0 +1,99 @@
+/*
+  SeekTable
+  Tabla de búsqueda de un MP3: byte de inicio de cada SEEK_STRIDE tramas.
+  Mientras no se tiene la tabla exacta se usa una aproximada sacada de la TOC
+  Xing (o de la tasa de bits si no hay TOC); la exacta se construye recorriendo
+  solo las cabeceras de las tramas, poco a poco desde loop(), y se guarda junto
+  al MP3 ("<fichero>.sk") para las siguientes veces.
+
+  Fichero de tabla (little endian):
+    Cabecera  32 bytes   magic "MP3T", versión, tamaño y fecha del MP3, tramas,
+                         tramas por entrada, número de entradas, muestras por trama
+                         y frecuencia
+    Entradas  4 bytes    byte de inicio de las tramas 0, stride, 2*stride...
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include "XingHeader.h"
+
+#ifndef SEEK_TABLE_ENTRIES
+#define SEEK_TABLE_ENTRIES 512  // Con el paso mínimo cubre ~1,5 min; después se duplica el paso
+#endif
+#define SEEK_MIN_STRIDE    8    // Tramas por entrada al empezar (~0,2 s a 44,1 kHz)
+#define SEEK_PREROLL       3    // Tramas decodificadas y descartadas antes del punto de búsqueda
+                                // para rellenar la reserva de bits y el solape de la IMDCT
+#ifndef SEEK_SCAN_FRAMES
+#define SEEK_SCAN_FRAMES   64   // Cabeceras analizadas por llamada a scanStep()
+#endif
+
+class SeekTable
+{
+  public:
+    // Prepara la tabla del MP3 'path' (de tamaño 'size' y fecha 'mtime'). Si hay un fichero
+    // de tabla válido se carga; si no, se usa la aproximada y queda pendiente el recorrido.
+    bool begin(fs::FS &fs, const char *path, uint32_t size, uint32_t mtime, const XingInfo &info);
+    void end();
+
+    // Analiza hasta SEEK_SCAN_FRAMES cabeceras. Al llegar al final guarda la tabla.
+    // Devuelve true mientras quede trabajo.
+    bool scanStep();
+
+    bool valid() const { return ready; }
+    bool exact() const { return scanDone; }
+    uint32_t totalFrames() const;
+    uint16_t samplesPerFrame() const { return spf; }
+    uint32_t sampleRate() const { return rate; }
+
+    // Byte desde el que leer para llegar a la trama 'frame' y trama que empieza en él
+    // (anterior a 'frame' en al menos SEEK_PREROLL tramas si es posible)
+    bool lookup(uint32_t frame, uint32_t &offset, uint32_t &fromFrame) const;
+
+  private:
+    struct FileHeader {
+      char magic[4];
+      uint16_t version;
+      uint16_t reserved;
+      uint32_t fileSize;
+      uint32_t mtime;
+      uint32_t frames;
+      uint32_t stride;
+      uint32_t count;
+      uint16_t spf;
+      uint16_t reserved2;
+      uint32_t rate;
+    };
+    static constexpr uint16_t version = 1;
+
+    bool load();
+    bool save();
+    uint32_t approxOffset(uint32_t frame) const;
+    void tablePath(char *out, size_t len) const;
+
+    fs::FS *fs = nullptr;
+    char path[300];
+    File scanFile;
+    uint32_t fileSize = 0;
+    uint32_t mtime = 0;
+    bool ready = false;
+
+    // Tabla exacta, válida para las tramas < scanFrame
+    uint32_t offsets[SEEK_TABLE_ENTRIES];
+    uint32_t count = 0;
+    uint32_t stride = SEEK_MIN_STRIDE;
+    uint32_t scanPos = 0;
+    uint32_t scanFrame = 0;
+    bool scanDone = false;
+
+    // Datos de la cabecera Xing para la tabla aproximada
+    uint32_t firstFramePos = 0;
+    uint32_t xingFrames = 0;    // Tramas contando la de Xing, 0 si no se sabe
+    uint32_t xingBytes = 0;
+    bool hasToc = false;
+    uint8_t toc[100];
+    uint16_t spf = 1152;
+    uint32_t rate = 44100;
+    uint32_t frameBytes = 0;    // Tamaño medio de trama
+};
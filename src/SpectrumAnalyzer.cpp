@@ -0,0 +1,246 @@
+/*
+  SpectrumAnalyzer
+  Espectro por bandas y vúmetro en coma fija para la pantalla
+*/
+
+#include "SpectrumAnalyzer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define FULL_SCALE 32767.0
+
+// log2 en Q8 (8 bits de fracción, interpolación lineal entre potencias de 2)
+static int32_t log2Q8(uint64_t x)
+{
+  if (!x) return INT32_MIN / 2;
+  int n = 63 - __builtin_clzll(x);
+  uint32_t frac = n >= 8 ? (uint32_t)(x >> (n - 8)) : (uint32_t)(x << (8 - n));
+  return n * 256 + (frac & 0xff);
+}
+
+// Diferencia de log2 en Q8 de dos potencias a décimas de dB (10 * log10(2) / 256 por unidad)
+static int16_t toDb(int32_t q)
+{
+  int32_t lowest = (int32_t)SpectrumAnalyzer::bottom() * 256000 / 30103;
+  if (q <= lowest) return SpectrumAnalyzer::bottom();
+  if (q >= 0) return 0;
+  return (int16_t)(q * 30103 / 256000);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+  free(mem);
+}
+
+bool SpectrumAnalyzer::begin(uint16_t fftSize, uint8_t bands)
+{
+  free(mem);
+  mem = nullptr;
+  if (fftSize < 64 || fftSize > SPECTRUM_MAX_FFT || (fftSize & (fftSize - 1))) return false;
+  if (!bands || bands > SPECTRUM_MAX_BANDS || bands >= fftSize / 2) return false;
+
+  // re, im | cola (2 * fftSize tramas estéreo) | ventana | cos, sen (fftSize / 2 cada uno)
+  size_t bytes = 2 * fftSize * sizeof(int32_t) + 4 * fftSize * sizeof(int16_t) + 2 * fftSize * sizeof(int16_t);
+  mem = (uint8_t *)calloc(1, bytes);
+  if (!mem) return false;
+  re = (int32_t *)mem;
+  im = re + fftSize;
+  tap = (int16_t *)(im + fftSize);
+  window = tap + 4 * fftSize;
+  cosT = window + fftSize;
+  sinT = cosT + fftSize / 2;
+  size = fftSize;
+  nBands = bands;
+  written.store(0);
+  lastWritten = 0;
+  edgesRate = 0;
+
+  double sumW2 = 0.0;
+  for (uint32_t i = 0; i < size; i++) {
+    window[i] = (int16_t)lround(FULL_SCALE * (0.5 - 0.5 * cos(2.0 * M_PI * i / size)));
+    sumW2 += (window[i] / 32768.0) * (window[i] / 32768.0);
+  }
+  for (uint32_t k = 0; k < size / 2; k++) {
+    cosT[k] = (int16_t)lround(FULL_SCALE * cos(2.0 * M_PI * k / size));
+    sinT[k] = (int16_t)lround(FULL_SCALE * sin(2.0 * M_PI * k / size));
+  }
+
+  // Un seno de amplitud A con ventana w reparte size * A^2 * sum(w^2) / 4 entre los bins
+  // positivos (Parseval); su valor eficaz al cuadrado por 'size' tramas es size * A^2 / 2
+  double a2 = FULL_SCALE * FULL_SCALE;
+  bandRef = (int32_t)lround(256.0 * log2(size * a2 * sumW2 / 4.0));
+  rmsRef = (int32_t)lround(256.0 * log2(size * a2 / 2.0));
+  peakRef = (int32_t)lround(256.0 * log2(a2));
+
+  for (Meter &m : bars) m = { bottom(), bottom(), 0 };
+  for (Meter &m : meters) m = { bottom(), bottom(), 0 };
+  return true;
+}
+
+void SpectrumAnalyzer::setFullScale(float gain)
+{
+  gainRef = gain > 0.0f ? (int32_t)lroundf(256.0f * log2f(gain * gain)) : 0;
+}
+
+void SpectrumAnalyzer::feed(const int16_t *frames, uint32_t count, bool mono)
+{
+  if (!mem || !count) return;
+  uint32_t cap = 2 * size;
+  uint32_t mask = cap - 1;
+  uint32_t w = written.load(std::memory_order_relaxed);
+  if (count > cap) {
+    frames += 2 * (count - cap);
+    w += count - cap;
+    count = cap;
+  }
+  if (mono) {
+    for (uint32_t i = 0; i < count; i++) {
+      int16_t *d = tap + 2 * ((w + i) & mask);
+      d[0] = d[1] = frames[2 * i];
+    }
+  } else {
+    uint32_t pos = w & mask;
+    uint32_t first = count < cap - pos ? count : cap - pos;
+    memcpy(tap + 2 * pos, frames, first * 2 * sizeof(int16_t));
+    memcpy(tap, frames + 2 * first, (count - first) * 2 * sizeof(int16_t));
+  }
+  // La ventana de analyze() son las 'size' tramas anteriores a 'written': mientras no
+  // lleguen otras tantas durante una lectura no se pisa (y un fotograma a medias no se ve)
+  written.store(w + count, std::memory_order_release);
+}
+
+// Bordes logarítmicos redondeados a bins. Donde los bins no dan para tan estrechas, las
+// bandas de abajo se quedan con un bin y el resto se reparte en escala logarítmica por
+// lo que queda, sin pasar de size / 2.
+void SpectrumAnalyzer::updateEdges(uint32_t hz)
+{
+  edgesRate = hz;
+  uint32_t half = size / 2;
+  uint32_t fmax = SPECTRUM_FREQ_MAX < hz / 2 ? SPECTRUM_FREQ_MAX : hz / 2;
+  long first = lround((double)SPECTRUM_FREQ_MIN * size / hz);
+  long last = lround((double)fmax * size / hz);
+  if (last > (long)half) last = half;
+  if (first > last - nBands) first = last - nBands;
+  edges[0] = first < 1 ? 1 : first;
+  edges[nBands] = last;
+  for (uint8_t i = 1; i < nBands; i++) {
+    double prev = edges[i - 1];
+    long e = lround(prev * pow(last / prev, 1.0 / (nBands - i + 1)));
+    if (e <= edges[i - 1]) e = edges[i - 1] + 1;
+    if (e > last - (nBands - i)) e = last - (nBands - i);
+    edges[i] = e;
+  }
+}
+
+uint32_t SpectrumAnalyzer::edgeHz(uint8_t band) const
+{
+  return edgesRate ? (uint32_t)edges[band] * edgesRate / size : 0;
+}
+
+// Radix-2 por diezmado en el tiempo, en su sitio sobre re/im
+void SpectrumAnalyzer::fft()
+{
+  uint32_t n = size;
+  for (uint32_t i = 1, j = 0; i < n; i++) {
+    uint32_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      int32_t t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+      t = im[i];
+      im[i] = im[j];
+      im[j] = t;
+    }
+  }
+  // Sin escalar: con la entrada en 16 bits la salida cabe en 16 + bits (<= 26) bits
+  for (uint32_t len = 2; len <= n; len <<= 1) {
+    uint32_t half = len >> 1;
+    uint32_t step = n / len;
+    for (uint32_t k = 0; k < half; k++) {
+      int32_t wr = cosT[k * step];
+      int32_t wi = -sinT[k * step];
+      for (uint32_t i = k; i < n; i += len) {
+        uint32_t j = i + half;
+        int32_t tr = (int32_t)(((int64_t)re[j] * wr - (int64_t)im[j] * wi) >> 15);
+        int32_t ti = (int32_t)(((int64_t)re[j] * wi + (int64_t)im[j] * wr) >> 15);
+        re[j] = re[i] - tr;
+        im[j] = im[i] - ti;
+        re[i] += tr;
+        im[i] += ti;
+      }
+    }
+  }
+}
+
+void SpectrumAnalyzer::meter(Meter &m, int16_t level, int16_t peak, uint32_t elapsedMs)
+{
+  int32_t down = m.level - (int32_t)(elapsedMs * SPECTRUM_FALL_DB_S / 100);
+  m.level = level > down ? level : (down > bottom() ? down : bottom());
+  if (peak >= m.peak) {
+    m.peak = peak;
+    m.held = 0;
+  } else if (m.held < SPECTRUM_PEAK_HOLD_MS) {
+    m.held += elapsedMs;
+  } else {
+    int32_t p = m.peak - (int32_t)(elapsedMs * SPECTRUM_PEAK_FALL_DB_S / 100);
+    m.peak = p > bottom() ? p : bottom();
+  }
+  if (m.peak < m.level) m.peak = m.level;
+}
+
+bool SpectrumAnalyzer::analyze(uint32_t elapsedMs)
+{
+  if (!mem) return false;
+  if (elapsedMs > 1000) elapsedMs = 1000;
+  uint32_t hz = rate.load(std::memory_order_relaxed);
+  if (hz && hz != edgesRate) updateEdges(hz);
+
+  uint32_t w = written.load(std::memory_order_acquire);
+  bool fresh = w != lastWritten;
+  lastWritten = w;
+  if (!fresh) {
+    for (uint8_t b = 0; b < nBands; b++) meter(bars[b], bottom(), bottom(), elapsedMs);
+    for (Meter &m : meters) meter(m, bottom(), bottom(), elapsedMs);
+    return false;
+  }
+
+  uint32_t mask = 2 * size - 1;
+  uint64_t sq[2] = { 0, 0 };
+  int32_t pk[2] = { 0, 0 };
+  for (uint32_t i = 0; i < size; i++) {
+    const int16_t *f = tap + 2 * ((w - size + i) & mask);
+    int32_t l = f[0], r = f[1];
+    sq[0] += (uint32_t)(l * l);
+    sq[1] += (uint32_t)(r * r);
+    if (abs(l) > pk[0]) pk[0] = abs(l);
+    if (abs(r) > pk[1]) pk[1] = abs(r);
+    re[i] = ((l + r) * window[i]) >> 16; // Media de los dos canales con ventana
+    im[i] = 0;
+  }
+  fft();
+
+  for (uint8_t b = 0; b < nBands; b++) {
+    uint64_t p = 0;
+    for (uint32_t k = edges[b]; k < edges[b + 1]; k++) {
+      p += (uint64_t)((int64_t)re[k] * re[k]) + (uint64_t)((int64_t)im[k] * im[k]);
+    }
+    int16_t db = toDb(log2Q8(p) - bandRef - gainRef);
+    meter(bars[b], db, db, elapsedMs);
+  }
+  for (int c = 0; c < 2; c++) {
+    meter(meters[c], toDb(log2Q8(sq[c]) - rmsRef - gainRef),
+          toDb(log2Q8((uint64_t)pk[c] * pk[c]) - peakRef - gainRef), elapsedMs);
+  }
+  return true;
+}
+
+bool SpectrumAnalyzer::idle() const
+{
+  for (uint8_t b = 0; b < nBands; b++) {
+    if (bars[b].peak > bottom()) return false;
+  }
+  return meters[0].peak == bottom() && meters[1].peak == bottom();
+}
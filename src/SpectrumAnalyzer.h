@@ -0,0 +1,116 @@
+/*
+  SpectrumAnalyzer
+  Analizador de espectro y vúmetro para la pantalla. La tarea de salida le pasa
+  con feed() las tramas que entrega al I2S (AudioOutputSpectrum) y quien dibuja
+  llama a analyze() en cada fotograma, desde otra tarea.
+
+  feed() solo copia a una cola circular de 2 * fftSize tramas; analyze() toma las
+  últimas fftSize, las mezcla a mono con ventana de Hann y hace una FFT radix-2
+  en coma fija (muestras en 32 bits, senos y cosenos en Q15, productos en 64
+  bits, sin escalar entre etapas). La potencia de cada banda es la suma de la de
+  sus bins; las bandas van en escala logarítmica entre SPECTRUM_FREQ_MIN y
+  SPECTRUM_FREQ_MAX, al menos un bin cada una. El nivel se pasa a dB con un
+  logaritmo entero (error < 0.3 dB), relativo a un seno a plena escala.
+  El vúmetro es el valor eficaz y el pico de cada canal en la misma ventana.
+
+  Las barras suben en el acto y bajan a SPECTRUM_FALL_DB_S; los picos se quedan
+  SPECTRUM_PEAK_HOLD_MS y después bajan a SPECTRUM_PEAK_FALL_DB_S. Si no han
+  llegado tramas desde el último fotograma (pausa, parada) se toma silencio.
+
+  Todos los niveles van en décimas de dB respecto a la plena escala (0 arriba,
+  bottom() abajo). No usa nada del ESP32, así que se prueba igual en el PC
+  (test/test_spectrum; el coste con bench --spectrum).
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#ifndef SPECTRUM_FREQ_MIN
+#define SPECTRUM_FREQ_MIN       50     // Hz, principio de la primera banda
+#endif
+#ifndef SPECTRUM_FREQ_MAX
+#define SPECTRUM_FREQ_MAX       16000  // Hz, final de la última (como mucho la mitad de la frecuencia)
+#endif
+#ifndef SPECTRUM_DB_RANGE
+#define SPECTRUM_DB_RANGE       60     // dB entre lo más alto y lo más bajo que se ve
+#endif
+#ifndef SPECTRUM_FALL_DB_S
+#define SPECTRUM_FALL_DB_S      40
+#endif
+#ifndef SPECTRUM_PEAK_HOLD_MS
+#define SPECTRUM_PEAK_HOLD_MS   600
+#endif
+#define SPECTRUM_PEAK_FALL_DB_S 20
+#define SPECTRUM_MAX_BANDS      32
+#define SPECTRUM_MAX_FFT        1024
+
+class SpectrumAnalyzer
+{
+  public:
+    ~SpectrumAnalyzer();
+
+    // Reserva para FFT de 'fftSize' tramas (potencia de 2, 64..SPECTRUM_MAX_FFT) y
+    // 'bands' bandas (menos que fftSize / 2). Antes de arrancar el audio.
+    bool begin(uint16_t fftSize, uint8_t bands);
+    bool ready() const { return mem != nullptr; }
+
+    // Lado de la salida: frecuencia y tramas estéreo que van a sonar ('mono': solo vale L)
+    void setRate(uint32_t hz) { rate.store(hz, std::memory_order_relaxed); }
+    void feed(const int16_t *frames, uint32_t count, bool mono = false);
+
+    // Nivel que cuenta como plena escala (p.ej. el volumen fijo del DSP, para que las
+    // barras no dependan de él)
+    void setFullScale(float gain);
+
+    // Un fotograma: analiza lo último que ha llegado y aplica caídas y picos por los
+    // 'elapsedMs' desde el anterior. false si no había tramas nuevas.
+    bool analyze(uint32_t elapsedMs);
+
+    uint8_t bands() const { return nBands; }
+    uint16_t fftSize() const { return size; }
+    int16_t level(uint8_t band) const { return bars[band].level; }
+    int16_t peak(uint8_t band) const { return bars[band].peak; }
+    int16_t vu(uint8_t ch) const { return meters[ch].level; }
+    int16_t vuPeak(uint8_t ch) const { return meters[ch].peak; }
+    static constexpr int16_t bottom() { return -10 * SPECTRUM_DB_RANGE; }
+    // Todo abajo: ya no hace falta dibujar
+    bool idle() const;
+    // Frecuencia (Hz) donde empieza la banda 'band' (bands() = donde acaba la última)
+    uint32_t edgeHz(uint8_t band) const;
+
+  private:
+    struct Meter {
+      int16_t level;
+      int16_t peak;
+      uint16_t held;   // ms con el pico quieto
+    };
+
+    void updateEdges(uint32_t hz);
+    void fft();
+    void meter(Meter &m, int16_t level, int16_t peak, uint32_t elapsedMs);
+
+    uint8_t *mem = nullptr;
+    uint16_t size = 0;         // Tramas de la FFT
+    uint8_t nBands = 0;
+    int16_t *tap = nullptr;    // Cola de 2 * size tramas estéreo que escribe feed()
+    std::atomic<uint32_t> written{0};
+    std::atomic<uint32_t> rate{44100};
+    uint32_t lastWritten = 0;
+    int32_t *re = nullptr;
+    int32_t *im = nullptr;
+    int16_t *window = nullptr; // Hann, Q15
+    int16_t *cosT = nullptr;   // cos y sen de 2*pi*k/size, Q15, k < size / 2
+    int16_t *sinT = nullptr;
+
+    uint32_t edgesRate = 0;
+    uint16_t edges[SPECTRUM_MAX_BANDS + 1]; // Primer bin de cada banda
+    int32_t bandRef = 0;       // log2 en Q8 de la potencia de un seno a plena escala en una banda
+    int32_t rmsRef = 0;        // ...de su valor eficaz al cuadrado por fftSize tramas
+    int32_t peakRef = 0;       // ...de su pico al cuadrado
+    int32_t gainRef = 0;       // log2 en Q8 de la plena escala elegida al cuadrado
+
+    Meter bars[SPECTRUM_MAX_BANDS];
+    Meter meters[2];
+};
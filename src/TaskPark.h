@@ -0,0 +1,77 @@
+/*
+  TaskPark
+  Para las tareas de audio en un punto seguro para cambiar desde loop() lo que
+  ellas usan sin bloqueo (el almacenamiento de la cola PCM, el driver I2S, el
+  PLL de la CPU).
+
+  Cada tarea llama a checkpoint() con su bit al principio de su vuelta, sin nada
+  a medias ni el audio bloqueado. Quien cambia llama a park() con los bits de las
+  que tienen que estar paradas, hace el cambio y llama a release(). Una tarea
+  también puede pedirlo con hold() (la de salida justo tras un corte, para que no
+  suene nada nuevo hasta el cambio) y se para en su siguiente checkpoint(); esa
+  parada solo la suelta el release() que sigue a takeHold(), no el de otro cambio.
+
+  Todo lo que las tareas escribieron antes de pararse se ve desde quien cambia,
+  y lo que este cambia se ve desde las tareas al seguir.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+class TaskPark
+{
+  public:
+    // Desde la tarea 'bit': se queda aquí mientras haya un cambio pedido
+    void checkpoint(uint8_t bit)
+    {
+      if (!(state.load(std::memory_order_acquire) & REQUESTED)) return;
+      parked.fetch_or(bit, std::memory_order_acq_rel);
+      while (state.load(std::memory_order_acquire) & REQUESTED) vTaskDelay(1);
+      parked.fetch_and((uint8_t)~bit, std::memory_order_acq_rel);
+    }
+
+    // Desde una tarea: pide la parada y la mantiene hasta que loop() la atienda
+    void hold() { state.fetch_or(REQUESTED | HELD, std::memory_order_acq_rel); }
+    // Desde loop(): true (una vez) si una tarea ha pedido hold(); el release() siguiente la suelta
+    bool takeHold() { return state.fetch_and((uint8_t)~HELD, std::memory_order_acq_rel) & HELD; }
+    bool requested() const { return state.load(std::memory_order_acquire) & REQUESTED; }
+
+    // Pide y espera a que las de 'mask' estén paradas. Si no llegan en 'timeoutMs'
+    // las suelta y devuelve false.
+    bool park(uint8_t mask, uint32_t timeoutMs)
+    {
+      state.fetch_or(REQUESTED, std::memory_order_acq_rel);
+      TickType_t t0 = xTaskGetTickCount();
+      while ((parked.load(std::memory_order_acquire) & mask) != mask) {
+        if (xTaskGetTickCount() - t0 >= pdMS_TO_TICKS(timeoutMs)) {
+          release();
+          return false;
+        }
+        vTaskDelay(1);
+      }
+      return true;
+    }
+
+    // Deja seguir a las tareas, salvo si hay un hold() sin atender, y espera a que hayan
+    // salido (así el siguiente park() no confunde una parada vieja con una nueva)
+    void release()
+    {
+      uint8_t s = state.load(std::memory_order_acquire);
+      do {
+        if (s & HELD) return;
+      } while (!state.compare_exchange_weak(s, s & ~REQUESTED, std::memory_order_acq_rel));
+      while (parked.load(std::memory_order_acquire)) {
+        if (state.load(std::memory_order_acquire) & REQUESTED) return; // Otro hold() entretanto
+        vTaskDelay(1);
+      }
+    }
+
+  private:
+    enum : uint8_t { REQUESTED = 1, HELD = 2 };
+    std::atomic<uint8_t> state{0};
+    std::atomic<uint8_t> parked{0};
+};
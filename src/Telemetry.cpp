@@ -0,0 +1,81 @@
+/*
+  Telemetry
+  Contadores e histogramas de latencia
+*/
+
+#include "Telemetry.h"
+
+#if TELEMETRY
+
+Telemetry telemetry;
+
+uint32_t LatencyHist::percentile(uint32_t p) const
+{
+  uint32_t n = count.load(std::memory_order_relaxed);
+  uint32_t top = maxUs.load(std::memory_order_relaxed);
+  if (!n) return 0;
+  uint64_t target = ((uint64_t)n * p + 99) / 100;
+  uint64_t seen = 0;
+  for (int b = 0; b < TELEMETRY_BUCKETS; b++) {
+    seen += buckets[b].load(std::memory_order_relaxed);
+    if (seen >= target) {
+      uint32_t upper = (b == TELEMETRY_BUCKETS - 1) ? top : (2u << b) - 1;
+      return upper < top ? upper : top;
+    }
+  }
+  return top;
+}
+
+void LatencyHist::print(Print &out, const char *name) const
+{
+  uint32_t n = count.load(std::memory_order_relaxed);
+  if (!n) {
+    out.printf("%-12s sin datos\n", name);
+    return;
+  }
+  out.printf("%-12s n=%lu min=%lu avg=%lu p99<=%lu max=%lu us\n", name, (unsigned long)n,
+             (unsigned long)minUs.load(std::memory_order_relaxed),
+             (unsigned long)(sumUs.load(std::memory_order_relaxed) / n), (unsigned long)percentile(99),
+             (unsigned long)maxUs.load(std::memory_order_relaxed));
+  // Histograma compacto: solo los cubos con muestras, "<límite:cuenta"
+  out.printf("%-12s", "");
+  for (int b = 0; b < TELEMETRY_BUCKETS; b++) {
+    uint32_t k = buckets[b].load(std::memory_order_relaxed);
+    if (k) out.printf(" <%lu:%lu", (unsigned long)(2u << b), (unsigned long)k);
+  }
+  out.printf("\n");
+}
+
+void LatencyHist::reset()
+{
+  count = 0;
+  minUs = UINT32_MAX;
+  maxUs = 0;
+  sumUs = 0;
+  for (int b = 0; b < TELEMETRY_BUCKETS; b++) buckets[b] = 0;
+}
+
+void telemetryPrint(Print &out)
+{
+  out.printf("--- Telemetría (%lu ms) ---\n", (unsigned long)millis());
+  out.printf("underruns    %lu\n", (unsigned long)telemetry.underruns.load());
+  telemetry.decodeFrame.print(out, "decodeFrame");
+  telemetry.sourceRead.print(out, "sourceRead");
+  telemetry.sdRead.print(out, "sdRead");
+  telemetry.loopPeriod.print(out, "loopPeriod");
+  telemetry.display.print(out, "display");
+  telemetry.buttons.print(out, "buttons");
+}
+
+void telemetryReset()
+{
+  telemetry.decodeFrame.reset();
+  telemetry.sourceRead.reset();
+  telemetry.sdRead.reset();
+  telemetry.loopPeriod.reset();
+  telemetry.display.reset();
+  telemetry.buttons.reset();
+  telemetry.underruns = 0;
+}
+
+#endif
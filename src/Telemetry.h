@@ -0,0 +1,92 @@
+/*
+  Telemetry
+  Contadores e histogramas de latencia de las rutas críticas (decodificación, SD,
+  salida, loop()) para diagnosticar cortes. Se consulta por el puerto serie.
+  Con TELEMETRY=0 (por defecto) las macros no generan código y no ocupa memoria.
+
+  Los campos son atómicos: un histograma puede tener escritores en los dos núcleos
+  (sdRead: la tarea de carga y, con su cola llena, la de decodificación) y se lee
+  y se pone a cero desde loop(). Cada campo es exacto; el conjunto que se imprime
+  puede no ser de un mismo instante, suficiente para estadísticas.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+#ifndef TELEMETRY
+#define TELEMETRY 0
+#endif
+
+#if TELEMETRY
+
+#define TELEMETRY_BUCKETS 20  // Potencias de 2 en us: [0,2), [2,4) ... [2^19, inf) ~0,5 s
+
+struct LatencyHist
+{
+  std::atomic<uint32_t> count{0};
+  std::atomic<uint32_t> minUs{UINT32_MAX};
+  std::atomic<uint32_t> maxUs{0};
+  std::atomic<uint64_t> sumUs{0};
+  std::atomic<uint32_t> buckets[TELEMETRY_BUCKETS] = {};
+
+  void add(uint32_t us)
+  {
+    int b = us < 2 ? 0 : 31 - __builtin_clz(us);
+    if (b >= TELEMETRY_BUCKETS) b = TELEMETRY_BUCKETS - 1;
+    buckets[b].fetch_add(1, std::memory_order_relaxed);
+    uint32_t m = minUs.load(std::memory_order_relaxed);
+    while (us < m && !minUs.compare_exchange_weak(m, us, std::memory_order_relaxed)) {}
+    m = maxUs.load(std::memory_order_relaxed);
+    while (us > m && !maxUs.compare_exchange_weak(m, us, std::memory_order_relaxed)) {}
+    sumUs.fetch_add(us, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Cota superior del percentil 'p' (0-100): límite del cubo donde cae
+  uint32_t percentile(uint32_t p) const;
+  void print(Print &out, const char *name) const;
+  void reset();
+};
+
+struct Telemetry
+{
+  LatencyHist decodeFrame;  // AudioGeneratorMP3Block::DecodeFrame(), una trama MP3
+  LatencyHist sourceRead;   // read() de la fuente visto por el decodificador
+  LatencyHist sdRead;       // Lectura de un bloque de la tarjeta
+  LatencyHist loopPeriod;   // Tiempo entre vueltas de loop()
+  LatencyHist display;      // Dibujo y envío a la pantalla en loop()
+  LatencyHist buttons;      // Atención de eventos de botones en loop()
+  std::atomic<uint32_t> underruns{0}; // Cola PCM vacía con la pista sonando
+};
+
+extern Telemetry telemetry;
+
+// Mide el tiempo hasta el final del bloque
+class TelemetryTimer
+{
+  public:
+    TelemetryTimer(LatencyHist &h) : hist(h), start(micros()) {}
+    ~TelemetryTimer() { hist.add(micros() - start); }
+  private:
+    LatencyHist &hist;
+    uint32_t start;
+};
+
+#define TELEMETRY_CAT2(a, b) a##b
+#define TELEMETRY_CAT(a, b) TELEMETRY_CAT2(a, b)
+#define TELEMETRY_SCOPE(hist) TelemetryTimer TELEMETRY_CAT(telemetryTimer, __LINE__)(telemetry.hist)
+#define TELEMETRY_SAMPLE(hist, us) telemetry.hist.add(us)
+#define TELEMETRY_COUNT(counter) (telemetry.counter++)
+
+void telemetryPrint(Print &out);
+void telemetryReset();
+
+#else
+
+#define TELEMETRY_SCOPE(hist)
+#define TELEMETRY_SAMPLE(hist, us)
+#define TELEMETRY_COUNT(counter)
+
+#endif
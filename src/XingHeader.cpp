@@ -0,0 +1,139 @@
+/*
+  XingHeader
+  Lectura de la cabecera Xing/Info y la extensión LAME
+*/
+
+#include <string.h>
+#include "XingHeader.h"
+
+static const uint16_t bitrateTable[2][16] = {
+  { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 }, // MPEG-1 Layer III
+  { 0,  8, 16, 24, 32, 40, 48, 56,  64,  80,  96, 112, 128, 144, 160, 0 }  // MPEG-2/2.5 Layer III
+};
+static const uint16_t rateTable[3] = { 44100, 48000, 32000 };
+
+static uint32_t readBE32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+uint32_t mp3FrameInfo(const uint8_t *hdr, uint32_t *sampleRate, uint16_t *samplesPerFrame, uint16_t *bitrateKbps)
+{
+  if (hdr[0] != 0xFF || (hdr[1] & 0xE0) != 0xE0) return 0;
+  int version = (hdr[1] >> 3) & 3;     // 3 = MPEG-1, 2 = MPEG-2, 0 = MPEG-2.5
+  int layer = (hdr[1] >> 1) & 3;       // 1 = Layer III
+  int brIndex = (hdr[2] >> 4) & 0x0F;
+  int srIndex = (hdr[2] >> 2) & 3;
+  int padding = (hdr[2] >> 1) & 1;
+  if (version == 1 || layer != 1 || brIndex == 0 || brIndex == 15 || srIndex == 3) return 0;
+
+  bool mpeg1 = (version == 3);
+  uint32_t rate = rateTable[srIndex] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+  uint16_t kbps = bitrateTable[mpeg1 ? 0 : 1][brIndex];
+  uint16_t spf = mpeg1 ? 1152 : 576;
+
+  if (sampleRate) *sampleRate = rate;
+  if (samplesPerFrame) *samplesPerFrame = spf;
+  if (bitrateKbps) *bitrateKbps = kbps;
+  return (spf / 8) * kbps * 1000 / rate + padding;
+}
+
+bool parseXingFrame(const uint8_t *buf, uint32_t len, XingInfo &info)
+{
+  if (len < 4) return false;
+  uint32_t frameLen = mp3FrameInfo(buf, &info.sampleRate, &info.samplesPerFrame, &info.bitrateKbps);
+  if (!frameLen) return false;
+
+  info.hasXing = false;
+  info.hasToc = false;
+  info.hasLame = false;
+  info.frames = 0;
+  info.bytes = 0;
+  info.encoderDelay = 0;
+  info.encoderPadding = 0;
+
+  // La etiqueta va justo después de la información lateral
+  bool mpeg1 = ((buf[1] >> 3) & 3) == 3;
+  bool mono = ((buf[3] >> 6) & 3) == 3;
+  uint32_t p = 4 + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17));
+  if (p + 8 > len) return true;
+  if (memcmp(buf + p, "Xing", 4) && memcmp(buf + p, "Info", 4)) return true;
+
+  info.hasXing = true;
+  uint32_t flags = readBE32(buf + p + 4);
+  p += 8;
+  if (flags & 0x1) {
+    if (p + 4 > len) return true;
+    info.frames = readBE32(buf + p);
+    p += 4;
+  }
+  if (flags & 0x2) {
+    if (p + 4 > len) return true;
+    info.bytes = readBE32(buf + p);
+    p += 4;
+  }
+  if (flags & 0x4) {
+    if (p + 100 > len) return true;
+    memcpy(info.toc, buf + p, 100);
+    info.hasToc = true;
+    p += 100;
+  }
+  if (flags & 0x8) p += 4; // Calidad
+
+  // Extensión LAME: versión (9), revisión/método (1), paso bajo (1), ReplayGain (8),
+  // flags (1), bitrate (1) y después 12 bits de retardo + 12 bits de relleno
+  if (p + 24 <= len && (!memcmp(buf + p, "LAME", 4) || !memcmp(buf + p, "Lavf", 4) || !memcmp(buf + p, "Lavc", 4))) {
+    const uint8_t *d = buf + p + 21;
+    info.encoderDelay = (d[0] << 4) | (d[1] >> 4);
+    info.encoderPadding = ((d[1] & 0x0F) << 8) | d[2];
+    info.hasLame = true;
+  }
+  return true;
+}
+
+bool readXingInfo(AudioFileSource *src, XingInfo &info)
+{
+  uint8_t buf[512];
+  uint32_t start = 0;
+
+  if (!src->seek(0, SEEK_SET)) return false;
+  if (src->read(buf, 10) == 10 && !memcmp(buf, "ID3", 3)) {
+    // Tamaño "syncsafe" de 4x7 bits, más la cabecera y el pie opcional
+    start = 10 + (((uint32_t)(buf[6] & 0x7F) << 21) | ((uint32_t)(buf[7] & 0x7F) << 14) |
+                  ((uint32_t)(buf[8] & 0x7F) << 7) | (buf[9] & 0x7F));
+    if (buf[5] & 0x10) start += 10;
+  }
+
+  bool found = false;
+  if (src->seek(start, SEEK_SET)) {
+    uint32_t len = src->read(buf, sizeof(buf));
+    // Puede haber basura entre la etiqueta y la primera trama
+    for (uint32_t i = 0; i + 4 <= len; i++) {
+      if (buf[i] == 0xFF && mp3FrameInfo(buf + i, nullptr, nullptr, nullptr)) {
+        found = parseXingFrame(buf + i, len - i, info);
+        info.firstFramePos = start + i;
+        info.audioStartPos = info.firstFramePos;
+        if (found && info.hasXing) {
+          info.audioStartPos += mp3FrameInfo(buf + i, nullptr, nullptr, nullptr);
+        }
+        break;
+      }
+    }
+  }
+  src->seek(0, SEEK_SET);
+  return found;
+}
+
+void gaplessTrim(const XingInfo &info, uint32_t &skip, uint32_t &length)
+{
+  skip = 0;
+  length = 0;
+  if (!info.hasXing) return;
+  skip = info.samplesPerFrame;
+  if (!info.hasLame) return;
+  skip += info.encoderDelay + MP3_DECODER_DELAY;
+  uint32_t total = info.frames * info.samplesPerFrame;
+  if (info.frames && total > (uint32_t)info.encoderDelay + info.encoderPadding) {
+    length = total - info.encoderDelay - info.encoderPadding;
+  }
+}
@@ -0,0 +1,48 @@
+/*
+  XingHeader
+  Lectura de la cabecera Xing/Info (y la extensión LAME) de la primera trama de un MP3.
+  Da el número de tramas, la tabla TOC de búsqueda y el retardo/relleno del
+  codificador necesarios para reproducir sin huecos.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "AudioFileSource.h"
+
+struct XingInfo
+{
+  uint32_t firstFramePos;   // Byte de la primera trama MPEG (la de Xing si existe)
+  uint32_t audioStartPos;   // Byte de la primera trama con audio
+  uint32_t sampleRate;
+  uint16_t samplesPerFrame;
+  uint16_t bitrateKbps;     // De la primera trama (en VBR no representa al fichero)
+
+  bool hasXing;             // Trama "Xing" (VBR) o "Info" (CBR)
+  uint32_t frames;          // Tramas de audio, 0 si no se conoce
+  uint32_t bytes;           // Bytes de audio, 0 si no se conoce
+  bool hasToc;
+  uint8_t toc[100];         // Posición (/256 del tamaño) de cada 1% de la duración
+
+  bool hasLame;
+  uint16_t encoderDelay;    // Muestras de silencio añadidas al principio por el codificador
+  uint16_t encoderPadding;  // Muestras de relleno al final
+};
+
+// Retardo propio de la síntesis de libmad, se suma al del codificador
+static constexpr uint16_t MP3_DECODER_DELAY = 529;
+
+// Analiza la cabecera de trama en 'hdr'. Devuelve la longitud de la trama en bytes o 0 si no es válida.
+uint32_t mp3FrameInfo(const uint8_t *hdr, uint32_t *sampleRate, uint16_t *samplesPerFrame, uint16_t *bitrateKbps);
+
+// Analiza una trama que empieza en 'buf'. Rellena 'info' (salvo las posiciones) aunque no haya Xing.
+bool parseXingFrame(const uint8_t *buf, uint32_t len, XingInfo &info);
+
+// Salta la etiqueta ID3v2, busca la primera trama y lee su cabecera Xing/LAME.
+// Deja la fuente posicionada al principio del fichero.
+bool readXingInfo(AudioFileSource *src, XingInfo &info);
+
+// Recorte para AudioGeneratorMP3Block::SetTrim(): la trama Xing/Info (que se decodifica
+// como silencio), el retardo del codificador y el de libmad al principio, y el relleno
+// al final. Sin cabecera LAME solo se quita la trama Xing; sin Xing, nada.
+void gaplessTrim(const XingInfo &info, uint32_t &skip, uint32_t &length);
@@ -1,21 +1,39 @@
 #include <Arduino.h>
-#include <SD.h>
 #include <FS.h>
-#include <Audio.h>
-#include <AudioGeneratorMP3.h>
-#include <AudioOutputI2S.h>
-#include <AudioFileSourceSD.h>
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include <driver/i2s.h>
+#include <esp_sleep.h>
 #include <vector>
+#include <atomic>
+#include "PcmRing.h"
+#include "AudioOutputRing.h"
+#include "AudioOutputDsp.h"
+#include "AudioOutputResample.h"
+#include "CrossfadeMixer.h"
+#include "AudioOutputI2SBlock.h"
+#include "AudioOutputSpectrum.h"
+#include "AudioBackend.h"
+#include "AudioSlotPool.h"
+#include "XingHeader.h"
+#include "PlaylistIndex.h"
+#include "BrowseIndex.h"
+#include "PlaylistScan.h"
+#include "SeekTable.h"
+#include "OledRenderer.h"
+#include "ButtonInput.h"
+#include "PlayOrder.h"
+#include "ResumeStore.h"
+#include "ReplayGain.h"
+#include "LoudnessScan.h"
+#include "Telemetry.h"
+#include "BufferController.h"
+#include "TaskPark.h"
+#include "CpuGovernor.h"
+#include "PlaybackPosition.h"
 
-// Definir pines digitales utilizados
-#define SD_CS         15
-#define SPI_MOSI      12
-#define SPI_MISO      13
-#define SPI_SCK       14
+// Definir pines digitales utilizados (los de la tarjeta SD están en AudioBackend.h)
 #define I2S_DOUT      25
 #define I2S_BCLK      27
 #define I2S_LRC       26
@@ -23,7 +41,178 @@
 #define I2C_SCL       22
 #define BUTTON_PLAY   4
 #define BUTTON_PREV   16
+#ifndef BUTTON_NEXT
 #define BUTTON_NEXT   2
+#endif
+#if AUDIO_STORAGE == AUDIO_STORAGE_SDMMC && BUTTON_NEXT == 2
+#error "Con AUDIO_STORAGE_SDMMC el GPIO 2 es D0 de la tarjeta: mover BUTTON_NEXT"
+#endif
+
+// Modo pipeline: el MP3 se decodifica en su propia tarea fijada al núcleo 0 y
+// alimenta una cola PCM sin bloqueos que otra tarea vuelca al I2S. loop() (núcleo 1)
+// queda solo para botones y pantalla, así un refresco lento no corta el audio.
+#ifndef AUDIO_PIPELINE
+#define AUDIO_PIPELINE 1
+#endif
+#define AUDIO_CORE        0    // Núcleo de las tareas de audio (loop() corre en el 1)
+#define DECODE_TASK_PRIO  3
+#define OUTPUT_TASK_PRIO  4    // La salida tiene prioridad sobre la decodificación
+#define PCM_RING_FRAMES   2048 // Tramas estéreo en la cola (~46 ms a 44.1 kHz), potencia de 2
+#define I2S_DMA_BUFFERS   8    // Buffers DMA del I2S al arrancar (de 128 tramas)
+#define AUDIO_SLOTS       2    // Parejas fuente + decodificador preasignadas (actual + siguiente)
+#define AUDIO_PARK_MS     100  // Espera máxima a que las tareas de audio se paren (TaskPark)
+
+// Buffers adaptativos: BufferController ajusta en marcha la cola PCM (entre
+// BUFFER_RING_MIN y BUFFER_RING_MAX, empezando en PCM_RING_FRAMES) y los buffers DMA
+// según los vaciados de la cola, los retrasos de la salida y la lectura más lenta de
+// la tarjeta. La tarea de salida mide (BufferWatch) y loop() decide y aplica, con las
+// tareas de audio paradas (TaskPark) mientras cambia la cola o el driver. La cola cambia
+// en el acto; el DMA solo en un corte (cambio de pista o stop), porque cambiarlo
+// reinstala el driver y vacía lo que suena. Con 0, tamaños fijos.
+#ifndef BUFFER_ADAPTIVE
+#define BUFFER_ADAPTIVE AUDIO_PIPELINE
+#endif
+#if BUFFER_ADAPTIVE && !AUDIO_PIPELINE
+#error "BUFFER_ADAPTIVE necesita AUDIO_PIPELINE"
+#endif
+#define BUFFER_WINDOW_MS    1000  // Cada cuánto se decide
+#define BUFFER_HEAP_RESERVE 16384 // Heap que la cola deja libre al crecer
+
+// Ahorro de energía. Con las tareas de audio, loop() no da vueltas en vacío: espera a un
+// botón como mucho LOOP_IDLE_MS (lo que necesitan pantalla y marquesina) y el núcleo 1
+// queda parado en la tarea inactiva. CpuGovernor (-DCPU_GOVERNOR=0 para no tocar la
+// frecuencia) baja la CPU a 80 o 160 MHz según la carga medida de la decodificación
+// y sube en cuanto la cola baja; decide en la tarea de salida y loop() pone la
+// frecuencia, sonando sin cambiar de PLL (ver CpuGovernor.h) salvo en un corte, con la
+// salida parada. Sonando no se puede dormir (el I2S se para con los relojes), así que
+// light sleep (-DLIGHT_SLEEP=0 para no usarlo) solo se usa parado o en pausa tras
+// IDLE_SLEEP_DELAY_MS sin nada que hacer; despierta con un botón o cada IDLE_SLEEP_MS.
+// El puerto serie no despierta: lo que llegue dormido se pierde.
+// 'p' por el puerto serie imprime el tiempo en cada frecuencia y la batería estimada.
+#ifndef CPU_GOVERNOR
+#define CPU_GOVERNOR AUDIO_PIPELINE
+#endif
+#ifndef LIGHT_SLEEP
+#define LIGHT_SLEEP AUDIO_PIPELINE
+#endif
+#if (CPU_GOVERNOR || LIGHT_SLEEP) && !AUDIO_PIPELINE
+#error "CPU_GOVERNOR y LIGHT_SLEEP necesitan AUDIO_PIPELINE"
+#endif
+#define LOOP_IDLE_MS        20
+#define CPU_WINDOW_MS       1000
+#define IDLE_SLEEP_MS       1000
+#define IDLE_SLEEP_DELAY_MS 3000
+#ifndef BATTERY_MAH
+#define BATTERY_MAH 2000 // Para la estimación de 'p'
+#endif
+#ifndef BOARD_MA
+#define BOARD_MA    15   // Consumo del resto de la placa (pantalla, DAC, tarjeta) para la estimación
+#endif
+
+// Reproducción sin huecos: cerca del final de la pista se abre y pre-decodifica la
+// siguiente, y la tarea de decodificación pasa a ella sin vaciar la cola PCM.
+// Necesita el modo pipeline para preparar la pista mientras suena la actual.
+#ifndef GAPLESS
+#define GAPLESS AUDIO_PIPELINE
+#endif
+#define GAPLESS_PREFETCH_BYTES 65536 // Bytes restantes de la pista actual para preparar la siguiente
+
+// Fundido entre pistas (-DCROSSFADE_MS=1000..10000, 0 = desactivado). Los dos huecos
+// del pool decodifican a la vez y CrossfadeMixer los mezcla. Antes de cada fundido se
+// comprueba con la carga medida de la decodificación que dos decodificadores caben en
+// el núcleo; si no, el fundido se acorta a lo que la cola PCM puede cubrir o se
+// encadena sin fundido. Necesita GAPLESS.
+#ifndef CROSSFADE_MS
+#define CROSSFADE_MS 0
+#endif
+#if CROSSFADE_MS && !GAPLESS
+#error "CROSSFADE_MS necesita GAPLESS"
+#endif
+#define CROSSFADE_MIN_MS        1000 // Más corto no merece la pena: se encadena sin más
+#define CROSSFADE_LEAD_MS       3000 // Margen para abrir la siguiente antes del fundido
+#define CROSSFADE_MAX_PERMILLE  850  // Carga máxima prevista del núcleo de audio durante el fundido
+#define CROSSFADE_MIX_PERMILLE  20   // Coste estimado de la mezcla, en milésimas de tiempo real
+
+// Telemetría (-DTELEMETRY=1): enviar 't' por el puerto serie imprime los contadores
+// e histogramas y 'r' los pone a cero. Con 0 no se compila nada.
+
+// Volumen de salida (0..1) y balance (-100..100). Se aplican en coma fija junto al
+// ecualizador (BlockDsp) antes de la cola PCM; el I2S queda a ganancia 1.
+#ifndef DSP_VOLUME
+#define DSP_VOLUME  0.125
+#endif
+#ifndef DSP_BALANCE
+#define DSP_BALANCE 0
+#endif
+// Con -DDSP_BENCHMARK=1 se miden al arrancar los ciclos por muestra con 0, 3 y 10 bandas
+#ifndef DSP_BENCHMARK
+#define DSP_BENCHMARK 0
+#endif
+
+// Frecuencia fija del I2S (p.ej. -DRESAMPLE_RATE=44100): las pistas a otra frecuencia
+// se convierten (calidad con RESAMPLE_QUALITY, ver Resampler.h) en lugar de
+// reconfigurar el I2S en cada cambio. Con 0 el I2S sigue la frecuencia de cada pista.
+#ifndef RESAMPLE_RATE
+#define RESAMPLE_RATE 0
+#endif
+
+// Cada cuántos ms imprimir bytes y transacciones por segundo de la SD (0 = nunca)
+#ifndef SD_STATS_INTERVAL
+#define SD_STATS_INTERVAL 0
+#endif
+
+// Reanudación: la pista y la muestra que sonaban se guardan en la NVS al pausar, parar o
+// cambiar de pista, y en el acto si RESUME_POWER_PIN (a nivel bajo, p.ej. un supervisor
+// de tensión que avisa antes del brownout o al apagar; -1 = sin él) avisa de que cae la
+// alimentación. Al arrancar se sigue desde ahí. Sin ese aviso, un corte vuelve al último
+// de esos momentos; RESUME_SAVE_MS (0 = nunca) guarda además cada tanto mientras suena, a
+// costa de una escritura en flash cada vez (p.ej. 600000, cada 10 min).
+#ifndef RESUME_SAVE_MS
+#define RESUME_SAVE_MS   0
+#endif
+#ifndef RESUME_POWER_PIN
+#define RESUME_POWER_PIN -1
+#endif
+// Objetivo desde el reset hasta el primer audio enviado al I2S (solo se informa)
+#ifndef BOOT_TARGET_MS
+#define BOOT_TARGET_MS   1000
+#endif
+#define UI_INIT_CORE     0 // La pantalla se inicia en el otro núcleo mientras setup() sigue
+
+// Orden al arrancar por primera vez (después se recuerda en la NVS). Por el puerto
+// serie: 's' activa o desactiva el aleatorio (barajando de nuevo), 'm' cambia la repetición.
+#ifndef PLAY_SHUFFLE
+#define PLAY_SHUFFLE 0
+#endif
+#ifndef PLAY_REPEAT
+#define PLAY_REPEAT  REPEAT_ALL // REPEAT_OFF, REPEAT_ALL o REPEAT_ONE
+#endif
+
+// Revisión de la carpeta de la playlist (con subcarpetas) en segundo plano: se arranca con
+// el índice guardado y una tarea en el núcleo 1 lo compara con la carpeta y, si ha cambiado,
+// escribe uno nuevo que loop() adopta al terminar. Sin índice, las pistas se pueden elegir
+// según van apareciendo. La tarea trabaja a tramos de SCAN_SLICE_US, descansa SCAN_PAUSE_MS
+// entre tramos y espera mientras la cola PCM esté por debajo de la mitad.
+// Con SCAN_BACKGROUND 0 se revisa en setup(), como antes.
+#ifndef SCAN_BACKGROUND
+#define SCAN_BACKGROUND 1
+#endif
+#define SCAN_CORE       1
+#define SCAN_TASK_PRIO  1    // Como loop(): se reparten el núcleo 1
+#define SCAN_SLICE_US   4000
+#define SCAN_PAUSE_MS   10
+
+// Normalización de volumen (ReplayGain 2.0): cuando el índice está al día, una tarea de
+// baja prioridad en el núcleo de audio decodifica las pistas que aún no tienen medida,
+// calcula su sonoridad (EBU R128, AudioOutputLoudness) y la guarda junto al MP3
+// ("<fichero>.rg"). Al sonar, la ganancia de cada pista se aplica en BlockDsp. La tarea
+// espera mientras la cola PCM esté por debajo de la mitad y cede un tick cada
+// LOUDNESS_SLICE_US para no quitar el núcleo a la tarea IDLE (perro guardián).
+#ifndef REPLAYGAIN
+#define REPLAYGAIN 1
+#endif
+#define LOUDNESS_TASK_PRIO   1     // Por debajo de la decodificación y de la salida
+#define LOUDNESS_SLICE_US    8000
 
 // Declarar objeto de pantalla
 #define SCREEN_WIDTH 128 // OLED display width, in pixels
@@ -31,213 +220,1842 @@
 #define OLED_RESET    -1 // Reset pin # (or -1 if sharing Arduino reset pin)
 #define SCREEN_ADDRESS 0x3C
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+// Se dibuja en el buffer de 'display' y el renderer envía solo lo que cambia, a trozos desde loop()
+OledRenderer renderer(display, Wire, SCREEN_ADDRESS);
+#ifndef RENDER_BUDGET_US
+#define RENDER_BUDGET_US 2000 // Tiempo máximo de pantalla por vuelta de loop()
+#endif
+
+// Analizador de espectro y vúmetro en la mitad de abajo de la pantalla (el artista pasa a
+// la marquesina, detrás del título). Lo alimenta lo que entra en el I2S
+// (AudioOutputSpectrum) y loop() lo analiza y lo dibuja SPECTRUM_FPS veces por segundo.
+// Si análisis y dibujo pasan de SPECTRUM_MAX_PERMILLE del núcleo en una ventana, los
+// fotogramas por segundo bajan a la mitad (hasta SPECTRUM_MIN_FPS) y vuelven a subir
+// cuando sobra. El envío por I2C no cuenta: es del renderer, con su presupuesto, y el
+// núcleo queda libre mientras espera al bus. 'v' por el puerto serie da el coste medido.
+#ifndef SPECTRUM
+#define SPECTRUM 1
+#endif
+#ifndef SPECTRUM_BANDS
+#define SPECTRUM_BANDS        24   // 16..32
+#endif
+#ifndef SPECTRUM_FFT_SIZE
+#define SPECTRUM_FFT_SIZE     512  // Tramas por análisis (~12 ms y bins de 86 Hz a 44.1 kHz)
+#endif
+#ifndef SPECTRUM_FPS
+#define SPECTRUM_FPS          25
+#endif
+#ifndef SPECTRUM_MAX_PERMILLE
+#define SPECTRUM_MAX_PERMILLE 50   // Coste máximo en milésimas de un núcleo (a la frecuencia que haya)
+#endif
+#if SPECTRUM && (SPECTRUM_BANDS < 16 || SPECTRUM_BANDS > 32)
+#error "SPECTRUM_BANDS tiene que estar entre 16 y 32"
+#endif
+#define SPECTRUM_MIN_FPS      5
+#define SPECTRUM_WINDOW_MS    1000
+#define SPECTRUM_Y            16   // Filas 16..31
+#define SPECTRUM_VU_WIDTH     16   // A la derecha: una barra por canal
+#if SPECTRUM
+SpectrumAnalyzer spectrum;
+AudioOutputSpectrum *spectrumOutput = nullptr; // Justo delante del I2S
+uint32_t spectrumFps = SPECTRUM_FPS;
+uint32_t spectrumCost = 0; // Milésimas de núcleo en la última ventana
+#endif
+SemaphoreHandle_t uiReady;   // uiInitTask() ha terminado de iniciar la pantalla
+bool displayOk = false;      // Resultado de uiInitTask(); solo se lee tras 'uiReady'
+bool displayReady = false;   // Se puede dibujar en 'display'
+bool bootOk = false;         // setup() llegó al final; si no (SD, memoria), loop() no hace nada
 
 // Declaración de objetos de audio y variables globales
-AudioFileSourceSD *audioFile;
-AudioGeneratorMP3 *mp3;
-AudioOutputI2S *audioOutput;
-const int Nfiles=15;  //Variable para número de archivos permitidos
-String playlist[Nfiles]; // Array para almacenar nombres de archivos MP3
+AudioSlotPool<AUDIO_SLOTS> audioPool; // Fuentes y decodificadores reutilizables, sin new/delete por pista
+AudioSlot *currentSlot = nullptr;     // Hueco del pool en uso (audioFile y mp3 apuntan dentro)
+AudioFileSource *audioFile;
+AudioDecoder *mp3;
+AudioOutputI2SBlock *audioOutput;
+AudioOutput *decoderOutput; // Salida a la que escribe el decodificador (conversor o DSP)
+BlockDsp dsp;                // Ecualizador, volumen y balance
+AudioOutputDsp *dspOutput;   // Pasa los bloques por 'dsp' antes del I2S o de la cola PCM
+#if RESAMPLE_RATE
+AudioOutputResample *resampleOutput; // Convierte a RESAMPLE_RATE antes de 'dspOutput'
+#endif
+#define PLAYLIST_DIR   "/playlist"
+#define PLAYLIST_INDEX "/.playlist.idx" // Fuera de la carpeta para que no se liste a sí mismo
+#define PLAYLIST_INDEX_NEW PLAYLIST_INDEX ".new" // Índice que escribe la revisión en segundo plano
+PlaylistIndex playlistIndex; // Índice en la SD; las entradas se leen bajo demanda
+#define BROWSE_INDEX   "/.playlist.brw" // Índices por artista y álbum (BrowseIndex)
+#define BROWSE_INDEX_NEW BROWSE_INDEX ".new"
+BrowseIndex browseIndex;
+#if SCAN_BACKGROUND
+// Revisión de la carpeta. Mientras no hay índice (discovering()), las pistas son las que
+// publica, en el orden en que aparecen.
+PlaylistScan playlistScan;
+#endif
+#if REPLAYGAIN
+LoudnessScan loudnessScan;
+#endif
+#ifndef TRACK_CACHE_SIZE
+#define TRACK_CACHE_SIZE 8 // Entradas del índice (ruta y etiquetas) guardadas en RAM
+#endif
+PlaylistEntry entryCache[TRACK_CACHE_SIZE]; // Últimas pistas leídas del índice
+int entryCacheIndex[TRACK_CACHE_SIZE];
+int entryCacheNext = 0;
 int fileCount = 0; // Contador de archivos en la playlist
 int currentIndex = 0; // Índice del archivo actualmente seleccionado
+PlayOrder playOrder;  // Siguiente/anterior: secuencial o aleatorio, y repetición
 bool isPlaying = false; // Variable para verificar si se está reproduciendo una canción o no
-#define DEBOUNCE_DELAY 200 //Debounce botones
-std::vector<String> filenames;
+volatile bool isPaused = false; // Pista abierta pero sin decodificar; PLAY la reanuda
+uint32_t pausedSample = 0;      // Muestra (sin recortar) donde se pausó
+SeekTable seekTable;            // Tabla de búsqueda de la pista actual
+ResumeStore resumeStore;
+ResumePoint resumePoint;        // Lo guardado en la NVS, leído al arrancar
+bool resumeLoaded = false;
+uint32_t resumeSample = 0;      // Muestra donde empezar resumePoint.path cuando se abra (0 = principio)
+unsigned long lastResumeSave = 0;
+volatile bool powerFailing = false; // RESUME_POWER_PIN ha avisado: guardar ya
+volatile uint32_t firstAudioMs = 0; // ms desde el arranque hasta que el I2S recibe el primer audio
+
+#if AUDIO_PIPELINE
+#if BUFFER_ADAPTIVE
+PcmRing pcmRing(nullptr, 0); // En el heap para poder cambiarla de tamaño; se reserva en setup()
+BufferController bufferCtl;
+BufferWatch bufferWatch;                 // Ventanas que mide la tarea de salida para loop()
+std::atomic<int> dmaTarget{I2S_DMA_BUFFERS}; // Buffers DMA que quiere BufferController
+#else
+int16_t pcmRingStorage[2 * PCM_RING_FRAMES];
+PcmRing pcmRing(pcmRingStorage, PCM_RING_FRAMES);
+#endif
+AudioOutputRing *ringOutput;
+SemaphoreHandle_t audioMutex; // Protege mp3/audioFile entre loop() y la tarea de decodificación
+volatile bool trackFinished = false; // La tarea de decodificación avisa a loop() del fin de pista
+TaskPark audioPark;                  // Para cambiar desde loop() lo que las tareas de audio usan sin bloqueo
+#define PARK_DECODE 0x01
+#define PARK_OUTPUT 0x02
+#endif
 
-// Estados de los botones
-bool prevButtonStateRaw = false;
-bool playButtonStateRaw = false;
-bool nextButtonStateRaw = false;
+#if GAPLESS
+AudioSlot *nextSlot = nullptr;        // Pista siguiente ya abierta y pre-decodificada
+int nextIndex = 0;                    // Índice en la playlist de nextSlot
+bool prefetchTried = false;           // Evita reintentar en cada vuelta si la siguiente falla
+volatile bool gaplessAdvanced = false; // La tarea de decodificación ha pasado a nextSlot
+#endif
 
-bool prevButtonState = false;
-bool playButtonState = false;
-bool nextButtonState = false;
+#if CROSSFADE_MS
+CrossfadeMixer *mixer;                 // Cada hueco del pool escribe en su entrada
+uint32_t fadeStartSample = 0;          // Posición de la pista actual donde empieza el fundido
+uint32_t fadeFrames = 0;               // Duración admitida del fundido (0 = encadenar sin fundido)
+volatile uint32_t fadeLoad = 0;        // Carga medida durante el último fundido (dos pistas)
+uint32_t fadeBusyUs = 0, fadeBusyFrames = 0;
+#endif
+#if CROSSFADE_MS || CPU_GOVERNOR
+// Tiempo de decodificación por tiempo de audio, en milésimas y a CPU_FREQ_MAX (el tiempo
+// medido se escala con la frecuencia del momento, así no depende de la que haya puesto el
+// regulador)
+volatile uint32_t decodeLoad = 0;
+#endif
+#if CPU_GOVERNOR
+CpuGovernor governor;                    // Decide la tarea de salida; loop() pone la frecuencia
+GovernorWatch governorWatch;             // Lo que mide la tarea de salida para el regulador
+std::atomic<uint16_t> cpuMhz{0};         // Frecuencia puesta (solo la cambia loop())
+std::atomic<uint16_t> cpuWantMhz{0};     // Pedida por el regulador (0 = nada)
+std::atomic<const char *> cpuWantReason{""};
+std::atomic<uint16_t> cpuCutMhz{0};      // Pedida en un corte, con la salida parada (0 = nada)
+#endif
+#if CPU_GOVERNOR || LIGHT_SLEEP
+volatile uint32_t sleptMs = 0;      // Total dormido en light sleep
+#endif
 
-bool prevButtonLastState = false;
-bool playButtonLastState = false;
-bool nextButtonLastState = false;
+// Botones: interrupciones y temporizadores dejan los eventos en una cola que lee loop()
+ButtonInput buttons;
+int buttonPrev, buttonPlay, buttonNext;
+#define SKIP_STEP_MS 5000 // Salto por cada repetición de NEXT/PREV mantenido
 
-unsigned long lastDebounceTimePrev = 0;
-unsigned long lastDebounceTimePlay = 0;
-unsigned long lastDebounceTimeNext = 0;
+// Navegación por artista y álbum: se entra con PLAY largo con la música parada (o 'b' por
+// el puerto serie). PREV/NEXT cambian de artista o de álbum (mantenidos, de inicial en
+// inicial entre artistas), PLAY baja de nivel y en un álbum lo reproduce, doble PLAY sube
+// y PLAY largo sale.
+enum BrowseMode { BROWSE_OFF, BROWSE_ARTISTS, BROWSE_ALBUMS };
+BrowseMode browseMode = BROWSE_OFF;
+uint32_t browseArtist = 0;
+uint32_t browseAlbum = 0;
 
 // Declaración de funciones
 void playMP3(const char *filename);
 void listFiles();
 void playNext();
-void displaySongInfo(const char *filename);
+void displaySongInfo(int index);
 void readButtons();
+void stopTrack();
+void seekRelative(int32_t deltaMs);
+AudioSlot *dropPrefetch();
+void releaseSlot(AudioSlot *slot);
 void displayCurrentSelection();
+const PlaylistEntry *trackEntry(int index);
+const char *trackPath(int index);
+void lockAudio();
+void unlockAudio();
+void flushAudio();
+bool startSlot(AudioSlot *slot, const char *filename);
+bool switchToNextSlot();
+void prefetchNext();
+AudioSlot *cancelPrefetch();
+void printSdStats();
+void serialQuery();
+AudioOutput *slotOutput(AudioSlot *slot);
+void admitCrossfade();
+void attachSeekTable(AudioSlot *slot, int index);
+void pauseTrack();
+void resumeTrack();
+uint32_t elapsedMs();
+uint32_t playedSample();
+uint32_t totalMs();
+void displayTime();
+void displayTrack(const PlaylistEntry *e);
+bool seekSlot(AudioSlot *slot, uint32_t sample);
+void saveResume(bool playing);
+void resumeAtBoot();
+void locateResumedTrack();
+void bootPhase(const char *name);
+void setupPlayOrder();
+void toggleShuffle();
+void nextRepeatMode();
+void orderChanged();
+void uiInitTask(void *param);
+void openBrowseIndex();
+void browseEnter();
+void browseExit();
+void browseButton(const ButtonEvent &ev);
+uint32_t browseInitial(uint32_t artist, int dir);
+void displayBrowse();
+#if SCAN_BACKGROUND
+void scanThrottle();
+void serviceScan();
+bool adoptIndex();
+#endif
+void loadTrackGain(AudioSlot *slot, int index, const char *filename);
+void startLoudnessAnalysis();
+#if REPLAYGAIN
+void loudnessThrottle();
+#endif
+#if RESUME_POWER_PIN >= 0
+void IRAM_ATTR onPowerFail();
+#endif
+#if DSP_BENCHMARK
+void dspBenchmark();
+#endif
+#if AUDIO_PIPELINE
+bool decodeStep();
+bool crossfadeStep();
+void decodeTask(void *param);
+void outputTask(void *param);
+void holdAtCut();
+void cutService();
+#endif
+#if BUFFER_ADAPTIVE
+void watchBuffers(uint32_t sent, bool cut);
+void bufferService();
+void applyDma();
+bool resizeRing(uint32_t frames);
+#endif
+#if CPU_GOVERNOR
+void watchGovernor(bool cut);
+void governorRequest(const char *reason);
+void governorService();
+void applyCpu(uint16_t mhz, const char *reason);
+void printEnergy();
+#endif
+void powerIdle(bool pending, uint32_t waitMs);
+#if AUDIO_PIPELINE
+bool backgroundBusy();
+#endif
+#if LIGHT_SLEEP
+bool lightSleep();
+#endif
+#if CROSSFADE_MS || CPU_GOVERNOR
+uint32_t busySince(uint32_t t0);
+#endif
+#if SPECTRUM
+uint32_t spectrumStep();
+void drawSpectrum();
+int spectrumHeight(int16_t level, int h);
+#endif
 
 void setup() {
   Serial.begin(115200);
-  SPI.begin(SPI_SCK, SPI_MISO, SPI_MOSI, SD_CS);
+
+  // La pantalla (I2C y OLED) se inicia en paralelo; no se dibuja hasta que termine
+  uiReady = xSemaphoreCreateBinary();
+  xTaskCreatePinnedToCore(uiInitTask, "uiInit", 4096, nullptr, 1, nullptr, UI_INIT_CORE);
 
   // Inicializar la tarjeta SD
-  if (!SD.begin(SD_CS)) {
+  if (!AudioStorage::begin()) {
     Serial.println("Error al inicializar la tarjeta SD.");
     return;
   }
   Serial.println("Tarjeta SD inicializada correctamente.");
-
-  // Inicializar la comunicación I2C
-  Wire.begin(I2C_SDA, I2C_SCL);
-  Serial.println("Comunicación I2C inicializada correctamente.");
-
-  // Inicializar la pantalla OLED
-  if (!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) {
-    Serial.println(F("Error en la inicialización de la pantalla OLED."));
-    for (;;);
-  }
-  Serial.println("Pantalla OLED inicializada correctamente.");
+  bootPhase("SD");
+#if SD_READAHEAD
+  AudioFileSourceSDReadAhead::begin(); // La tarea de carga, antes de abrir ninguna pista
+#endif
 
   // Configurar pines para audio
-  audioOutput = new AudioOutputI2S();
+  audioOutput = new AudioOutputI2SBlock(0, AudioOutputI2S::EXTERNAL_I2S, I2S_DMA_BUFFERS);
   audioOutput->SetPinout(I2S_BCLK, I2S_LRC, I2S_DOUT);
-  audioOutput->SetGain(0.125);
+  audioOutput->SetGain(1.0);
+  dsp.setVolume(DSP_VOLUME);
+  dsp.setBalance(DSP_BALANCE);
   Serial.println("Pines de audio configurados correctamente.");
+#if DSP_BENCHMARK
+  dspBenchmark();
+#endif
 
-  // Configurar pines de botones
-  pinMode(BUTTON_PLAY, INPUT_PULLUP);
-  pinMode(BUTTON_PREV, INPUT_PULLUP);
-  pinMode(BUTTON_NEXT, INPUT_PULLUP);
+  AudioOutput *finalOutput = audioOutput; // La que llega al I2S
+#if SPECTRUM
+  if (spectrum.begin(SPECTRUM_FFT_SIZE, SPECTRUM_BANDS)) {
+    spectrum.setFullScale(DSP_VOLUME); // Las barras no dependen del volumen
+    spectrumOutput = new AudioOutputSpectrum(&spectrum, audioOutput);
+    finalOutput = spectrumOutput;
+  } else {
+    Serial.println("Sin memoria para el analizador de espectro.");
+  }
+#endif
+
+#if AUDIO_PIPELINE
+  // Arrancar las tareas de audio en el núcleo 0
+  audioMutex = xSemaphoreCreateMutex();
+#if CPU_GOVERNOR
+  cpuMhz = getCpuFrequencyMhz();
+  governor.begin(CpuGovernor::defaults(), cpuMhz);
+  governorWatch.begin(governor, CPU_WINDOW_MS);
+#endif
+#if BUFFER_ADAPTIVE
+  // La frecuencia solo convierte latencias en tramas: la habitual basta
+  bufferCtl.begin(BufferController::defaults(RESAMPLE_RATE ? RESAMPLE_RATE : 44100, PCM_RING_FRAMES, I2S_DMA_BUFFERS));
+  bufferWatch.begin(BUFFER_WINDOW_MS * 1000u);
+  int16_t *ringStorage = (int16_t *)malloc(2 * PCM_RING_FRAMES * sizeof(int16_t));
+  if (!ringStorage) {
+    Serial.println("Sin memoria para la cola PCM.");
+    return;
+  }
+  pcmRing.resize(ringStorage, PCM_RING_FRAMES); // Aún no hay tareas de audio
+#endif
+  ringOutput = new AudioOutputRing(&pcmRing, finalOutput);
+  dspOutput = new AudioOutputDsp(&dsp, ringOutput);
+  xTaskCreatePinnedToCore(outputTask, "i2sOut", 3072, nullptr, OUTPUT_TASK_PRIO, nullptr, AUDIO_CORE);
+  xTaskCreatePinnedToCore(decodeTask, "mp3Dec", 8192, nullptr, DECODE_TASK_PRIO, nullptr, AUDIO_CORE);
+  Serial.println("Tareas de audio iniciadas correctamente.");
+#else
+  dspOutput = new AudioOutputDsp(&dsp, finalOutput);
+#endif
+#if RESAMPLE_RATE
+  resampleOutput = new AudioOutputResample(RESAMPLE_RATE, dspOutput);
+  decoderOutput = resampleOutput;
+#else
+  decoderOutput = dspOutput;
+#endif
+#if CROSSFADE_MS
+  // Memoria del fundido: toda fija, reservada aquí o en el pool desde el arranque
+  mixer = new CrossfadeMixer(decoderOutput);
+  Serial.printf("Fundido de %u ms: %u bytes (%d huecos de %u, mezclador de %u).\n", CROSSFADE_MS,
+                (unsigned)(sizeof(audioPool) + sizeof(CrossfadeMixer)), AUDIO_SLOTS,
+                (unsigned)sizeof(AudioSlot), (unsigned)sizeof(CrossfadeMixer));
+#endif
+  bootPhase("audio");
+
+  // Configurar pines de botones (PLAY: doble = reiniciar pista, largo = stop o, parado,
+  // navegación por artista y álbum;
+  // PREV/NEXT mantenidos: retroceso/avance rápido dentro de la pista)
+  buttonPlay = buttons.add(BUTTON_PLAY, ButtonInput::DETECT_DOUBLE);
+  buttonPrev = buttons.add(BUTTON_PREV, ButtonInput::DETECT_REPEAT);
+  buttonNext = buttons.add(BUTTON_NEXT, ButtonInput::DETECT_REPEAT);
+  if (!buttons.begin()) {
+    Serial.println("Error al configurar los botones.");
+  }
   Serial.println("Pines de botones configurados correctamente.");
+#if RESUME_POWER_PIN >= 0
+  pinMode(RESUME_POWER_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(RESUME_POWER_PIN), onPowerFail, FALLING);
+#endif
+
+  // Seguir donde se quedó: si sonaba, el audio arranca ya, sin esperar al índice
+  resumeAtBoot();
+  bootPhase("reanudación");
 
-  // Listar los archivos disponibles en la carpeta "playlist"
+  // Listar los archivos disponibles en la carpeta "playlist" (con la pista ya sonando)
   listFiles();
+  locateResumedTrack();
+  setupPlayOrder();
   Serial.println("Archivos en la playlist listados correctamente.");
+  bootPhase("índice");
+#if !SCAN_BACKGROUND
+  startLoudnessAnalysis();
+#endif
 
-  // Mostrar la primera canción en la lista
-  displayCurrentSelection();
+  xSemaphoreTake(uiReady, portMAX_DELAY);
+  if (!displayOk) {
+    Serial.println(F("Error en la inicialización de la pantalla OLED."));
+    for (;;);
+  }
+  displayReady = true;
+  Serial.println("Pantalla OLED inicializada correctamente.");
+  bootPhase("espera de la pantalla");
+
+  // Mostrar la canción actual (la reanudada o la primera de la lista)
+  if (isPlaying) {
+    displaySongInfo(currentIndex);
+  } else {
+    displayCurrentSelection();
+  }
   Serial.println("Canción inicial mostrada correctamente.");
+
+  bootOk = true;
+
+  // Para comparar configuraciones: tamaño del firmware, memoria libre y tiempo de arranque
+  Serial.printf("%s + %s: firmware %u bytes, heap libre %u bytes (bloque máximo %u), setup() en %lu ms.\n",
+                AudioStorage::name, AudioCodec::name, ESP.getSketchSize(), ESP.getFreeHeap(),
+                ESP.getMaxAllocHeap(), millis());
+}
+
+// I2C y pantalla OLED, en paralelo con la SD, el audio y el índice
+void uiInitTask(void *param) {
+  (void)param;
+  uint32_t start = millis();
+  Wire.begin(I2C_SDA, I2C_SCL);
+  displayOk = display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS);
+  if (displayOk) renderer.begin();
+  Serial.printf("Arranque: pantalla en %lu ms, en paralelo (total %lu ms).\n",
+                (unsigned long)(millis() - start), (unsigned long)millis());
+  xSemaphoreGive(uiReady);
+  vTaskDelete(nullptr);
+}
+
+#if RESUME_POWER_PIN >= 0
+void IRAM_ATTR onPowerFail() {
+  powerFailing = true;
+}
+#endif
+
+// Duración de cada fase del arranque y tiempo total desde el arranque del programa
+void bootPhase(const char *name) {
+  static uint32_t last = 0;
+  uint32_t now = millis();
+  Serial.printf("Arranque: %s en %lu ms (total %lu ms).\n", name, (unsigned long)(now - last), (unsigned long)now);
+  last = now;
 }
 
 void loop() {
-  // Leer el estado de los botones
-  readButtons();
+  // Sin SD o sin memoria para la cola no hay mutex, cola ni tareas de audio
+  if (!bootOk) {
+    delay(1000);
+    return;
+  }
+
+#if TELEMETRY
+  static uint32_t lastLoop = 0;
+  uint32_t loopStart = micros();
+  if (lastLoop) TELEMETRY_SAMPLE(loopPeriod, loopStart - lastLoop);
+  lastLoop = loopStart;
+#endif
+
+  // Atender los eventos de los botones (si no hay, no se hace nada)
+  {
+    TELEMETRY_SCOPE(buttons);
+    readButtons();
+  }
 
+#if AUDIO_PIPELINE
+  // La decodificación corre en decodeTask(); aquí solo se atiende el fin de pista
+  if (trackFinished) {
+    playNext();
+    Serial.println("Canción siguiente reproducida automáticamente.");
+  }
+#if GAPLESS
+  if (gaplessAdvanced) {
+    // La pista siguiente ya está sonando, solo queda actualizar índice y pantalla
+    gaplessAdvanced = false;
+    prefetchTried = false;
+    uint32_t next;
+    playOrder.advance(next);
+    if ((int)next != nextIndex) playOrder.jumpTo(nextIndex); // El orden cambió tras prepararla
+    currentIndex = nextIndex;
+    attachSeekTable(currentSlot, currentIndex);
+    displaySongInfo(currentIndex);
+    saveResume(true);
+#if CROSSFADE_MS
+    if (fadeLoad) {
+      Serial.printf("Canción siguiente encadenada con fundido (carga medida %lu‰).\n", (unsigned long)fadeLoad);
+      fadeLoad = 0;
+    } else
+#endif
+    Serial.println("Canción siguiente encadenada sin pausa.");
+  }
+  prefetchNext();
+#endif
+  cutService();
+#if BUFFER_ADAPTIVE
+  bufferService();
+#endif
+#if CPU_GOVERNOR
+  governorService();
+#endif
+#else
   // Verificar si la reproducción está en curso
-  if (mp3 && mp3->isRunning()) {
+  if (mp3 && mp3->isRunning() && !isPaused) {
     if (!mp3->loop()) {
       // La canción actual ha terminado, reproducir la siguiente automáticamente
       playNext();
       Serial.println("Canción siguiente reproducida automáticamente.");
+    } else if (!firstAudioMs) {
+      firstAudioMs = millis();
+    }
+  }
+#endif
+
+  // Completar la tabla de búsqueda poco a poco mientras suena la pista
+  bool pending = false; // Queda trabajo para la siguiente vuelta: no esperar
+  uint32_t waitMs = LOOP_IDLE_MS; // Si no, lo más que se puede esperar
+  if (isPlaying && !isPaused) {
+    pending = seekTable.scanStep();
+  }
+
+  {
+    TELEMETRY_SCOPE(display);
+    // Tiempo transcurrido en pantalla, una vez por segundo
+    static unsigned long lastTimeDraw = 0;
+    if (isPlaying && millis() - lastTimeDraw >= 1000) {
+      lastTimeDraw = millis();
+      displayTime();
+    }
+#if SPECTRUM
+    uint32_t frameMs = spectrumStep();
+    if (frameMs < waitMs) waitMs = frameMs;
+#endif
+
+    // Enviar a la pantalla lo que haya cambiado, sin pasar del presupuesto de tiempo
+    if (renderer.service(RENDER_BUDGET_US)) pending = true;
+  }
+
+  // Guardar la posición en el acto si cae la alimentación (y, si se pide, cada RESUME_SAVE_MS)
+  if (powerFailing) {
+    powerFailing = false;
+    saveResume(isPlaying && !isPaused);
+    Serial.println("Aviso de alimentación: posición guardada.");
+  }
+#if RESUME_SAVE_MS
+  else if (isPlaying && !isPaused && millis() - lastResumeSave >= RESUME_SAVE_MS) {
+    saveResume(true);
+  }
+#endif
+
+  static bool firstAudioReported = false;
+  if (!firstAudioReported && firstAudioMs) {
+    firstAudioReported = true;
+    Serial.printf("Primer audio a %lu ms del arranque (objetivo %u ms)%s\n", (unsigned long)firstAudioMs,
+                  BOOT_TARGET_MS, firstAudioMs > BOOT_TARGET_MS ? ": OBJETIVO SUPERADO." : ".");
+  }
+
+#if SCAN_BACKGROUND
+  serviceScan();
+#endif
+  printSdStats();
+  serialQuery();
+  powerIdle(pending, waitMs);
+}
+
+// Consultas por el puerto serie: solo se mira si ha llegado algo
+void serialQuery() {
+  if (!Serial.available()) return;
+  int c = Serial.read();
+  if (c == 's') {
+    toggleShuffle();
+  } else if (c == 'm') {
+    nextRepeatMode();
+  } else if (c == 'b') {
+    if (browseMode == BROWSE_OFF) browseEnter();
+    else browseExit();
+  }
+#if CPU_GOVERNOR
+  else if (c == 'p') {
+    printEnergy();
+  }
+#endif
+#if SPECTRUM
+  else if (c == 'v') {
+    Serial.printf("Espectro: %u bandas, FFT de %u tramas, %lu fps, %lu‰ de un núcleo (máximo %u‰).\n",
+                  spectrum.bands(), spectrum.fftSize(), (unsigned long)spectrumFps, (unsigned long)spectrumCost,
+                  SPECTRUM_MAX_PERMILLE);
+  }
+#endif
+#if TELEMETRY
+  else if (c == 't') {
+    telemetryPrint(Serial);
+  } else if (c == 'r') {
+    telemetryReset();
+    Serial.println("Telemetría a cero.");
+  }
+#endif
+}
+
+// Ritmo de lectura de la tarjeta desde la última llamada
+void printSdStats() {
+#if SD_STATS_INTERVAL && SD_READAHEAD
+  static unsigned long lastTime = 0;
+  static uint32_t lastBytes = 0, lastTransactions = 0, lastWaits = 0;
+  unsigned long now = millis();
+  if (now - lastTime < SD_STATS_INTERVAL) return;
+
+  uint32_t bytes = AudioFileSourceSDReadAhead::stats.bytes;
+  uint32_t transactions = AudioFileSourceSDReadAhead::stats.transactions;
+  uint32_t waits = AudioFileSourceSDReadAhead::stats.waits;
+  float secs = (now - lastTime) / 1000.0;
+  Serial.printf("SD: %.0f B/s, %.1f lecturas/s, %u esperas\n",
+                (bytes - lastBytes) / secs, (transactions - lastTransactions) / secs,
+                (unsigned)(waits - lastWaits));
+  lastBytes = bytes;
+  lastTransactions = transactions;
+  lastWaits = waits;
+  lastTime = now;
+#endif
+}
+
+#if DSP_BENCHMARK
+// Ciclos de CPU por trama estéreo de BlockDsp::process() con 0, 3 y 10 bandas
+// (ecualizador gráfico por octavas), sobre ruido y a volumen distinto de 1
+void dspBenchmark() {
+  static BlockDsp bench;
+  static int16_t pcm[2 * AudioOutputDsp::blockFrames];
+  const int rounds = 20;
+  const int bandSets[] = { 0, 3, 10 };
+  for (int n : bandSets) {
+    bench.clearBands();
+    for (int b = 0; b < n && b < DSP_MAX_BANDS; b++) {
+      float freq = (n == 3) ? 100.0f * powf(10.0f, b) : 31.25f * (1 << b);
+      bench.setBand(b, BlockDsp::PEAK, freq, (b & 1) ? -3.0f : 3.0f, 1.0f);
+    }
+    bench.setVolume(0.5f);
+    uint32_t cycles = 0;
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < 2 * AudioOutputDsp::blockFrames; i++) pcm[i] = (int16_t)esp_random();
+      uint32_t c0 = ESP.getCycleCount();
+      bench.process(pcm, AudioOutputDsp::blockFrames);
+      cycles += ESP.getCycleCount() - c0;
+    }
+    Serial.printf("DSP %2d bandas: %.1f ciclos/trama estéreo\n", bench.activeBands(),
+                  (float)cycles / (rounds * AudioOutputDsp::blockFrames));
+  }
+}
+#endif
+
+#if AUDIO_PIPELINE
+// Productor: decodifica mientras haya sitio en la cola PCM
+void decodeTask(void *param) {
+  (void)param;
+  for (;;) {
+    audioPark.checkpoint(PARK_DECODE); // Sin el audio bloqueado ni nada a medio escribir
+    bool decoding = false;
+    lockAudio();
+    if (mp3 && !trackFinished && !isPaused) {
+      if (crossfadeStep()) {
+        decoding = true;
+      } else if (!mp3->isRunning()) {
+        // Pista terminada o parada: loop() decide qué sigue
+      } else if (decodeStep()) {
+        decoding = true;
+      } else if (switchToNextSlot()) {
+        decoding = true;
+      } else {
+        trackFinished = true; // playNext() se llama desde loop()
+      }
+    }
+    unlockAudio();
+
+    // mp3->loop() vuelve cuando la cola está llena; ceder la CPU hasta que se vacíe algo
+    if (!decoding || pcmRing.space() == 0) {
+      vTaskDelay(1);
+    }
+  }
+}
+
+// Una vuelta del decodificador actual. Con fundido o regulador además se mide su carga:
+// tiempo de decodificación por tiempo de audio producido, promediado por segundos de audio.
+bool decodeStep() {
+#if CROSSFADE_MS || CPU_GOVERNOR
+  static uint32_t busyUs = 0, busyFrames = 0;
+  AudioDecoder &dec = currentSlot->decoder;
+  uint32_t t0 = micros();
+  uint32_t p0 = dec.Position();
+  bool running = mp3->loop();
+  uint32_t p1 = dec.Position();
+  uint32_t rate = dec.SampleRate();
+  if (running && p1 > p0 && rate) {
+    busyUs += busySince(t0);
+    busyFrames += p1 - p0;
+    if (busyFrames >= rate) {
+      uint32_t load = (uint64_t)busyUs * rate / busyFrames / 1000;
+      decodeLoad = decodeLoad ? (3 * decodeLoad + load) / 4 : load;
+      busyUs = busyFrames = 0;
+    }
+  }
+  return running;
+#else
+  return mp3->loop();
+#endif
+}
+
+// Una vuelta de las dos pistas durante el fundido: lo empieza al llegar la actual a
+// fadeStartSample y pasa a la nueva al terminarlo. Devuelve false si no hay fundido.
+bool crossfadeStep() {
+#if CROSSFADE_MS
+  if (!mixer->fading()) {
+    if (!fadeFrames || !nextSlot || currentSlot->decoder.Position() < fadeStartSample) return false;
+    mixer->start(audioPool.indexOf(nextSlot), fadeFrames);
+    fadeBusyUs = fadeBusyFrames = 0;
+  }
+  int from = audioPool.indexOf(currentSlot);
+  int to = audioPool.indexOf(nextSlot);
+  AudioDecoder &next = nextSlot->decoder;
+  uint32_t t0 = micros();
+  uint32_t p0 = next.Position();
+  // La que sale puede acabar antes que el fundido: a partir de ahí se mezcla silencio
+  if (!mixer->ended(from) && !mp3->loop()) mixer->endInput(from);
+  if (!mixer->ended(to) && !next.loop()) mixer->endInput(to);
+  fadeBusyUs += busySince(t0);
+  fadeBusyFrames += next.Position() - p0;
+
+  if (mixer->fadeDone()) {
+    uint32_t rate = next.SampleRate();
+    fadeLoad = (fadeBusyFrames && rate) ? (uint64_t)fadeBusyUs * rate / fadeBusyFrames / 1000 : 0;
+    switchToNextSlot();
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+#if CROSSFADE_MS || CPU_GOVERNOR
+// Microsegundos desde 't0' pasados a lo que habrían sido a CPU_FREQ_MAX
+uint32_t busySince(uint32_t t0) {
+  return (micros() - t0) * getCpuFrequencyMhz() / CPU_FREQ_MAX;
+}
+#endif
+
+// Consumidor: vuelca la cola PCM en los buffers DMA del I2S
+void outputTask(void *param) {
+  (void)param;
+#if TELEMETRY
+  bool starved = false;
+#endif
+  for (;;) {
+    audioPark.checkpoint(PARK_OUTPUT);
+    uint32_t sent = ringOutput->drain();
+    if (sent && !firstAudioMs) firstAudioMs = millis();
+#if TELEMETRY
+    // Cola vacía mientras la pista debería sonar: el I2S se queda sin datos (una vez por racha)
+    bool empty = !sent && pcmRing.available() == 0 && isPlaying && !isPaused && !trackFinished;
+    if (empty && !starved) TELEMETRY_COUNT(underruns);
+    starved = empty;
+#endif
+#if BUFFER_ADAPTIVE || CPU_GOVERNOR
+    bool cut = ringOutput->takeCut();
+#endif
+#if BUFFER_ADAPTIVE
+    watchBuffers(sent, cut);
+#endif
+#if CPU_GOVERNOR
+    watchGovernor(cut);
+#endif
+    if (sent == 0) {
+      vTaskDelay(1); // Cola vacía o DMA lleno
+    }
+  }
+}
+
+// Desde la tarea de salida tras un corte: se para en su siguiente vuelta, antes de que
+// suene nada nuevo, hasta que cutService() cambie lo que haga falta
+void holdAtCut() {
+  audioPark.hold();
+  buttons.wake();
+}
+
+// Desde loop(): con la salida parada en un corte y la decodificación también, cambia lo
+// que con el audio en marcha se oiría (los buffers DMA y el PLL de la CPU)
+void cutService() {
+  if (!audioPark.takeHold()) return;
+  if (audioPark.park(PARK_DECODE | PARK_OUTPUT, AUDIO_PARK_MS)) {
+#if BUFFER_ADAPTIVE
+    applyDma();
+#endif
+#if CPU_GOVERNOR
+    uint16_t mhz = cpuCutMhz.load();
+    if (mhz && mhz != cpuMhz) applyCpu(mhz, "corte");
+#endif
+    audioPark.release();
+  }
+#if CPU_GOVERNOR
+  cpuCutMhz = 0; // Si no se ha podido, el regulador sigue desde la frecuencia puesta
+#endif
+}
+#endif
+
+#if BUFFER_ADAPTIVE
+// Desde la tarea de salida, justo después de drain(): la vuelta para BufferWatch y,
+// tras un corte, parar para cambiar el DMA si hace falta
+void watchBuffers(uint32_t sent, bool cut) {
+  uint32_t hz = audioOutput->Rate() > 0 ? audioOutput->Rate() : 44100;
+  BufferWatch::Pass p;
+  p.nowUs = micros();
+  p.sent = sent;
+  p.level = pcmRing.available();
+  p.dmaUs = (uint64_t)audioOutput->DmaBuffers() * BUFFER_DMA_FRAMES * 1000000 / hz;
+  p.cut = cut;
+  p.playing = isPlaying && !isPaused && !trackFinished;
+  bufferWatch.pass(p);
+
+  // Tras un corte el DMA está vacío: si hay que cambiarlo, se hace ahora
+  if (cut && dmaTarget.load() != audioOutput->DmaBuffers()) holdAtCut();
+}
+
+// Desde loop(): pasa cada ventana medida a BufferController y aplica lo que decide
+void bufferService() {
+  BufferController::Window win;
+  if (bufferWatch.take(win)) {
+#if SD_READAHEAD
+    win.sdPeakUs = AudioFileSourceSDReadAhead::stats.slowestUs.exchange(0);
+#endif
+    BufferController::Decision d = bufferCtl.update(win);
+    if (d.action != BufferController::KEEP || d.reason[0]) {
+      Serial.printf("Buffers: %s (%s): cola %u, DMA %u, lectura más lenta %u us\n",
+                    BufferController::actionName(d.action), d.reason, (unsigned)bufferCtl.ring(),
+                    (unsigned)bufferCtl.dma(), (unsigned)bufferCtl.sdPeak());
+    }
+    dmaTarget = bufferCtl.dma();
+  }
+
+  // DMA: reinstalar el driver vacía lo que suena, así que solo sin sonar o tras un
+  // corte (en cutService())
+  if (bufferCtl.dma() != audioOutput->DmaBuffers() && (!isPlaying || isPaused)) {
+    if (audioPark.park(PARK_DECODE | PARK_OUTPUT, AUDIO_PARK_MS)) {
+      applyDma();
+      audioPark.release();
+    }
+  }
+
+  // Cola: crece en el acto; para reducirla primero se limita el productor y se cambia
+  // cuando lo pendiente ya cabe
+  uint32_t ring = bufferCtl.ring();
+  if (ring > pcmRing.capacity()) {
+    if (!resizeRing(ring)) {
+      Serial.printf("Buffers: sin memoria para una cola de %u tramas.\n", (unsigned)ring);
+      bufferCtl.setRing(pcmRing.capacity());
+    }
+  } else if (ring < pcmRing.capacity()) {
+    pcmRing.setLimit(ring);
+    if (pcmRing.available() <= ring) resizeRing(ring);
+  }
+}
+
+// Con las tareas de audio paradas (la decodificación también cambia la frecuencia del
+// I2S): pone los buffers DMA que quiere BufferController
+void applyDma() {
+  int dma = bufferCtl.dma();
+  if (dma == audioOutput->DmaBuffers() || audioOutput->SetDmaBuffers(dma)) return;
+  Serial.printf("Buffers: no se pudo poner el DMA a %d buffers.\n", dma);
+  bufferCtl.setDma(audioOutput->DmaBuffers());
+  dmaTarget = audioOutput->DmaBuffers();
+}
+
+// Pasa la cola PCM a un almacenamiento nuevo de 'frames' tramas. Desde loop(): la
+// reserva y la liberación se hacen aquí y la copia con las tareas de audio paradas.
+bool resizeRing(uint32_t frames) {
+  size_t bytes = 2 * frames * sizeof(int16_t);
+  if (frames > pcmRing.capacity() && ESP.getMaxAllocHeap() < bytes + BUFFER_HEAP_RESERVE) return false;
+  int16_t *storage = (int16_t *)malloc(bytes);
+  if (!storage) return false;
+  if (!audioPark.park(PARK_DECODE | PARK_OUTPUT, AUDIO_PARK_MS)) {
+    free(storage);
+    return false;
+  }
+  int16_t *old = pcmRing.resize(storage, frames);
+  audioPark.release();
+  free(old);
+  return true;
+}
+#endif
+
+#if CPU_GOVERNOR
+// Regulador desde la tarea de salida (ver GovernorWatch): lleva a loop() lo que elige
+void watchGovernor(bool cut) {
+  // Lo que loop() no ha podido poner (ver governorService()): sigue desde lo puesto
+  uint16_t applied = cpuMhz.load();
+  if (!cpuWantMhz.load() && !cpuCutMhz.load() && governor.mhz() != applied) governor.follow(applied);
+
+  bool playing = isPlaying && !isPaused && !trackFinished;
+  GovernorWatch::Pass p = { (uint32_t)millis(), sleptMs, pcmRing.available(), pcmRing.capacity(), decodeLoad, cut,
+                            playing };
+  GovernorWatch::Step s = governorWatch.pass(p);
+  if (s.cut) {
+    cpuWantMhz = 0;
+    cpuCutMhz = governor.mhz();
+    holdAtCut();
+  }
+  if (s.raised) governorRequest("cola baja");
+  if (!s.window) return;
+
+  CpuGovernor::Window w;
+  w.playing = playing;
+  w.background = backgroundBusy();
+  w.loadPermille = decodeLoad;
+  w.expectPermille = 0;
+#if CROSSFADE_MS
+  if (fadeFrames && nextSlot) w.expectPermille = 2 * decodeLoad + CROSSFADE_MIX_PERMILLE; // Dos decodificadores
+#endif
+  CpuGovernor::Decision d = governor.update(w);
+  if (d.change) governorRequest(d.reason);
+}
+
+// Deja la frecuencia elegida a loop() y la despierta: esta tarea no cambia relojes ni escribe
+void governorRequest(const char *reason) {
+  cpuWantReason = reason;
+  cpuWantMhz = governor.mhz();
+  buttons.wake();
+}
+
+// Desde loop(): pone la frecuencia que ha pedido el regulador. Si la pidió parado y ya
+// suena, no cambia de PLL: la descarta y el regulador sigue desde la puesta.
+void governorService() {
+  uint16_t mhz = cpuWantMhz.load();
+  if (!mhz) return;
+  uint16_t now = cpuMhz.load();
+  bool playing = isPlaying && !isPaused && !trackFinished;
+  bool relock = CPU_FREQ_RELOCK && (mhz == CPU_FREQ_RELOCK) != (now == CPU_FREQ_RELOCK);
+  if (mhz != now && !(playing && relock)) applyCpu(mhz, cpuWantReason.load());
+  cpuWantMhz.compare_exchange_strong(mhz, 0); // Si ha pedido otra entretanto, a la próxima vuelta
+}
+
+// Desde loop(): pone 'mhz' y lo registra
+void applyCpu(uint16_t mhz, const char *reason) {
+  setCpuFrequencyMhz(mhz);
+  cpuMhz = mhz;
+  Serial.printf("CPU: %u MHz (%s, carga %lu‰ a %u MHz).\n", mhz, reason, (unsigned long)decodeLoad, CPU_FREQ_MAX);
+}
+
+// Tiempo en cada frecuencia y consumo estimado con el modelo de CpuGovernor
+void printEnergy() {
+  Serial.print("Energía:");
+  for (uint8_t i = 0; i < governor.levels(); i++) {
+    Serial.printf(" %u MHz %lu s,", governor.freq(i), (unsigned long)(governor.msAt(i) / 1000));
+  }
+  float ma = governor.averageMicroAmps() / 1000.0f;
+  Serial.printf(" dormido %lu s. Media estimada %.1f mA (+%u de la placa): %.0f h con %u mAh.\n",
+                (unsigned long)(governor.sleepMs() / 1000), ma, BOARD_MA, BATTERY_MAH / (ma + BOARD_MA),
+                BATTERY_MAH);
+}
+#endif
+
+#if AUDIO_PIPELINE
+// Tareas que trabajan por su cuenta y no pueden quedarse paradas en light sleep
+bool backgroundBusy() {
+#if SCAN_BACKGROUND
+  if (playlistScan.state() == PlaylistScan::RUNNING) return true;
+#endif
+#if REPLAYGAIN
+  if (loudnessScan.running()) return true;
+#endif
+  return false;
+}
+#endif
+
+// Fin de cada vuelta de loop(): sin nada pendiente se espera a un botón (como mucho
+// 'waitMs') y el núcleo queda en la tarea inactiva; parado o en pausa un rato, se duerme
+// en light sleep. Sin las tareas de audio loop() decodifica y no puede esperar.
+void powerIdle(bool pending, uint32_t waitMs) {
+#if AUDIO_PIPELINE
+  if (pending || trackFinished) return;
+#if GAPLESS
+  if (gaplessAdvanced) return;
+#endif
+#if LIGHT_SLEEP
+  static uint32_t idleSince = 0;
+  bool stopped = !isPlaying || isPaused;
+  bool animating = renderer.animating();
+#if SPECTRUM
+  if (!spectrum.idle()) animating = true; // Las barras aún están bajando
+#endif
+  if (!stopped || animating || backgroundBusy() || Serial.available()) {
+    idleSince = millis();
+  } else if (millis() - idleSince >= IDLE_SLEEP_DELAY_MS && lightSleep()) {
+    return;
+  }
+  if (buttons.wait(waitMs)) idleSince = millis();
+#else
+  buttons.wait(waitMs);
+#endif
+#else
+  (void)pending;
+  (void)waitMs;
+#endif
+}
+
+#if LIGHT_SLEEP
+// Duerme hasta un botón o IDLE_SLEEP_MS. false si un botón pulsado no deja dormir.
+// Los relojes del I2S se paran: solo con el audio en pausa o parado.
+bool lightSleep() {
+  if (!buttons.sleepArm()) return false;
+  Serial.flush();
+  esp_sleep_enable_timer_wakeup(IDLE_SLEEP_MS * 1000ULL);
+  uint32_t start = millis();
+  esp_light_sleep_start();
+  sleptMs += millis() - start;
+  buttons.sleepDisarm();
+  return true;
+}
+#endif
+
+void lockAudio() {
+#if AUDIO_PIPELINE
+  xSemaphoreTake(audioMutex, portMAX_DELAY);
+#endif
+}
+
+void unlockAudio() {
+#if AUDIO_PIPELINE
+  xSemaphoreGive(audioMutex);
+#endif
+}
+
+// Cortar en el acto el audio ya decodificado (cambio de pista manual o stop)
+void flushAudio() {
+#if RESAMPLE_RATE
+  resampleOutput->discard();
+#endif
+#if CROSSFADE_MS
+  mixer->discard();
+#endif
+  dspOutput->discard(); // Lo que siga entra con una subida corta de volumen, sin chasquido
+#if AUDIO_PIPELINE
+  ringOutput->discard();
+#endif
+}
+
+// Abre el fichero en el hueco y arranca su decodificador. Con la cabecera LAME se
+// recortan el retardo y el relleno del codificador para que las uniones sean exactas.
+// Lee de la SD: con el hueco aún fuera del alcance de la tarea de decodificación y sin
+// bloquear el audio.
+bool startSlot(AudioSlot *slot, const char *filename) {
+  if (!slot->source.open(filename)) return false;
+
+  XingInfo &info = slot->info;
+  if (!readXingInfo(&slot->source, info)) {
+    memset(&info, 0, sizeof(info));
+  } else {
+    // Empezar en la primera trama: la etiqueta ID3v2 (con su carátula) no se lee, y la
+    // cuenta de tramas del decodificador coincide con la de la tabla de búsqueda
+    slot->source.seek(info.firstFramePos, SEEK_SET);
+  }
+  uint32_t skip, length;
+  gaplessTrim(info, skip, length);
+  slot->decoder.SetTrim(skip, length);
+  return slot->decoder.begin(&slot->source, slotOutput(slot));
+}
+
+// Salida de cada hueco: con fundido, su entrada del mezclador
+AudioOutput *slotOutput(AudioSlot *slot) {
+#if CROSSFADE_MS
+  return mixer->input(audioPool.indexOf(slot));
+#else
+  (void)slot;
+  return decoderOutput;
+#endif
+}
+
+// Llamada desde la tarea de decodificación, con el audio bloqueado, al acabar la pista
+bool switchToNextSlot() {
+#if GAPLESS
+  if (!nextSlot) return false;
+  audioPool.release(currentSlot);
+  currentSlot = nextSlot;
+  nextSlot = nullptr;
+  audioFile = &currentSlot->source;
+  mp3 = &currentSlot->decoder;
+  dsp.setTrackGain(currentSlot->gain, currentSlot->peak); // Con fundido, al terminarlo
+#if CROSSFADE_MS
+  mixer->setActive(audioPool.indexOf(currentSlot));
+  fadeFrames = 0;
+#endif
+  gaplessAdvanced = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Cerca del final de la pista abre la siguiente y decodifica su primer bloque
+void prefetchNext() {
+#if GAPLESS
+  if (!isPlaying || isPaused || nextSlot || prefetchTried || gaplessAdvanced || fileCount == 0) return;
+
+#if CROSSFADE_MS
+  // El fundido empieza antes del final: la siguiente tiene que estar lista a tiempo
+  uint32_t total = totalMs();
+  bool fadeNear = total && total <= elapsedMs() + CROSSFADE_MS + CROSSFADE_LEAD_MS;
+#else
+  bool fadeNear = false;
+#endif
+  lockAudio();
+  bool nearEnd = audioFile && (fadeNear || audioFile->getSize() - audioFile->getPos() <= GAPLESS_PREFETCH_BYTES);
+  AudioSlot *slot = nearEnd ? audioPool.acquire() : nullptr;
+  unlockAudio();
+  if (!slot) return;
+
+  // El hueco aún no es visible para la tarea de decodificación: se prepara sin bloquearla
+  prefetchTried = true;
+  uint32_t index;
+  if (!playOrder.peekNext(index)) {
+    // Última de la lista sin repetición: al acabar se para
+    releaseSlot(slot);
+    return;
+  }
+  const char *path = trackPath(index);
+  bool ok = startSlot(slot, path) && slot->decoder.Prime();
+  if (ok) loadTrackGain(slot, index, path);
+
+  lockAudio();
+  bool used = ok && isPlaying;
+  if (used) {
+    nextSlot = slot;
+    nextIndex = index;
+    admitCrossfade();
+  }
+  unlockAudio();
+  if (!used) releaseSlot(slot);
+  Serial.println(ok ? "Siguiente canción preparada." : "Error al preparar la siguiente canción.");
+#endif
+}
+
+// Descarta la pista preparada (cambio manual de pista o stop). Con el audio bloqueado;
+// devuelve su hueco para releaseSlot(), una vez desbloqueado.
+AudioSlot *cancelPrefetch() {
+#if GAPLESS
+  gaplessAdvanced = false;
+#endif
+  return dropPrefetch();
+}
+
+// Saca la pista preparada sin olvidar un encadenado pendiente (pausa o salto dentro de
+// la pista: se volverá a preparar al acercarse otra vez al final). Con el audio bloqueado;
+// devuelve su hueco (o nullptr) para releaseSlot(), una vez desbloqueado.
+AudioSlot *dropPrefetch() {
+#if CROSSFADE_MS
+  mixer->cancel();
+  fadeFrames = 0;
+#endif
+#if GAPLESS
+  AudioSlot *slot = nextSlot;
+  nextSlot = nullptr;
+  prefetchTried = false;
+  return slot;
+#else
+  return nullptr;
+#endif
+}
+
+// Devuelve al pool un hueco que la tarea de decodificación ya no ve. Sin el audio
+// bloqueado: cerrar el fichero espera a la lectura de la SD en curso.
+void releaseSlot(AudioSlot *slot) {
+  if (!slot) return;
+  slot->source.close();
+  lockAudio();
+  audioPool.release(slot);
+  unlockAudio();
+}
+
+// Decide si la pista preparada entra con fundido y cuánto dura. Con el audio bloqueado.
+void admitCrossfade() {
+#if CROSSFADE_MS
+  fadeFrames = 0;
+  AudioDecoder &cur = currentSlot->decoder;
+  uint32_t rate = cur.SampleRate();
+  if (!rate || nextSlot->decoder.SampleRate() != rate) {
+    Serial.println("Sin fundido: las pistas tienen distinta frecuencia.");
+    return;
+  }
+  // El final de la pista actual tiene que ser exacto: cabecera LAME o tabla ya completa
+  uint32_t end = 0;
+  if (cur.TrimLength()) {
+    end = cur.TrimSkip() + cur.TrimLength();
+  } else if (seekTable.valid() && seekTable.exact()) {
+    end = seekTable.totalFrames() * seekTable.samplesPerFrame();
+  }
+  uint32_t load = decodeLoad;
+  if (!end || !load) {
+    Serial.println("Sin fundido: falta el final de la pista o la medida de carga.");
+    return;
+  }
+
+  // Con dos decodificadores la carga se duplica. Lo que pase del máximo lo tiene que
+  // cubrir la cola PCM, que se vacía a ese ritmo: el fundido se acorta para gastar
+  // como mucho la mitad de la cola.
+  uint32_t frames = (uint64_t)CROSSFADE_MS * rate / 1000;
+  uint32_t dual = 2 * load + CROSSFADE_MIX_PERMILLE;
+  if (dual > CROSSFADE_MAX_PERMILLE) {
+    uint32_t limit = (uint64_t)pcmRing.capacity() * 1000 / 2 / (dual - CROSSFADE_MAX_PERMILLE);
+    if (limit < frames) frames = limit;
+  }
+  uint32_t pos = cur.Position();
+  if (end < pos + frames) frames = end > pos ? end - pos : 0; // Preparada tarde
+  if (frames < (uint64_t)CROSSFADE_MIN_MS * rate / 1000) {
+    Serial.printf("Sin fundido: carga %lu‰ con una pista, %lu‰ prevista con dos.\n",
+                  (unsigned long)load, (unsigned long)dual);
+    return;
+  }
+  fadeStartSample = end - frames;
+  fadeFrames = frames;
+  Serial.printf("Fundido de %lu ms (carga %lu‰ con una pista, %lu‰ prevista con dos).\n",
+                (unsigned long)((uint64_t)frames * 1000 / rate), (unsigned long)load, (unsigned long)dual);
+#endif
+}
+
+// Prepara la tabla de búsqueda de la pista 'index', abierta en 'slot' (se carga de la SD
+// si ya se había creado). Solo desde loop(): no hace falta el audio bloqueado.
+void attachSeekTable(AudioSlot *slot, int index) {
+  const PlaylistEntry *e = trackEntry(index);
+  if (!slot || !slot->info.sampleRate ||
+      !seekTable.begin(AudioStorage::fs(), e->path, e->size, e->mtime, slot->info)) {
+    seekTable.end();
+  }
+}
+
+// Ganancia de la pista 'index' (abierta en el hueco como 'filename') si ya se ha medido;
+// si no, suena tal cual. Se aplica en BlockDsp al empezar a sonar el hueco. Busca la
+// entrada y lee la SD: antes de que el hueco sea visible, sin bloquear el audio.
+void loadTrackGain(AudioSlot *slot, int index, const char *filename) {
+  slot->gain = 1.0f;
+  slot->peak = 0.0f;
+#if REPLAYGAIN
+  const PlaylistEntry *e = trackEntry(index);
+  TrackLoudness l;
+  if (!strcmp(e->path, filename) && ReplayGain::load(AudioStorage::fs(), e->path, e->size, e->mtime, l)) {
+    slot->gain = ReplayGain::gain(l);
+    slot->peak = l.peak;
+    Serial.printf("ReplayGain: %.1f LUFS, %+.1f dB.\n", l.lufs, 20.0f * log10f(slot->gain));
+  }
+#else
+  (void)index;
+  (void)filename;
+#endif
+}
+
+// Para la decodificación y corta el audio en cola, recordando la muestra que sonaba
+void pauseTrack() {
+  lockAudio();
+  AudioSlot *dropped = dropPrefetch();
+  pausedSample = playedSample();
+  if (pausedSample < currentSlot->decoder.TrimSkip()) pausedSample = currentSlot->decoder.TrimSkip();
+  isPaused = true;
+  unlockAudio();
+  releaseSlot(dropped);
+  flushAudio();
+  saveResume(false);
+  Serial.printf("Reproducción en pausa (%lu ms).\n", (unsigned long)elapsedMs());
+}
+
+// Salta a la muestra 'sample' de la pista abierta en 'slot' con la tabla (con el audio
+// bloqueado si es la actual)
+bool seekSlot(AudioSlot *slot, uint32_t sample) {
+  AudioDecoder &dec = slot->decoder;
+  uint32_t spf = seekTable.samplesPerFrame();
+  uint32_t offset, fromFrame;
+  return dec.isRunning() && seekTable.valid() && seekTable.lookup(sample / spf, offset, fromFrame) &&
+         dec.Seek(offset, fromFrame * spf, sample);
+}
+
+// Vuelve a la muestra exacta de la pausa saltando con la tabla, sin decodificar desde el principio
+void resumeTrack() {
+  lockAudio();
+  bool running = currentSlot->decoder.isRunning();
+  bool ok = running && seekSlot(currentSlot, pausedSample);
+  isPaused = false;
+  unlockAudio();
+
+  if (!running) {
+    playNext(); // Se pausó justo al acabar la pista
+  } else if (!ok) {
+    // Sin tabla: se sigue desde donde se quedó el decodificador (se pierde lo que había en cola)
+    Serial.println("Reanudando sin tabla de búsqueda.");
+  }
+  Serial.println("Reproducción reanudada.");
+}
+
+// Avance o retroceso dentro de la pista desde lo que está sonando
+void seekRelative(int32_t deltaMs) {
+  if (!isPlaying || isPaused || !currentSlot || !seekTable.valid()) return;
+  lockAudio();
+  AudioDecoder &dec = currentSlot->decoder;
+  uint32_t pos = playedSample();
+  uint32_t spf = seekTable.samplesPerFrame();
+  uint32_t start = dec.TrimSkip();
+  uint32_t end = dec.TrimLength() ? start + dec.TrimLength() : seekTable.totalFrames() * spf;
+  int64_t target = (int64_t)pos + (int64_t)deltaMs * seekTable.sampleRate() / 1000;
+  if (target < start) target = start;
+
+  uint32_t offset, fromFrame;
+  AudioSlot *dropped = nullptr;
+  if (dec.isRunning() && target < end && seekTable.lookup(target / spf, offset, fromFrame)) {
+    dropped = dropPrefetch();
+    if (dec.Seek(offset, fromFrame * spf, target)) {
+      flushAudio(); // Con el audio bloqueado: solo se descarta lo decodificado antes del salto
     }
   }
+  unlockAudio();
+  releaseSlot(dropped);
+}
+
+// Para la pista y la cierra; PLAY vuelve a empezarla
+void stopTrack() {
+  lockAudio();
+  isPaused = false;
+  if (mp3) mp3->stop();
+  AudioSlot *dropped = cancelPrefetch();
+  unlockAudio();
+  releaseSlot(dropped);
+  flushAudio();
+  seekTable.end();
+  isPlaying = false;
+  saveResume(false); // PLAY (también tras reiniciar) vuelve a empezar la pista
+  displayCurrentSelection(); // Actualizar la pantalla
+  Serial.println("Reproducción detenida.");
+}
+
+// Tiempo sonado de la pista actual, sin contar el retardo recortado del codificador
+uint32_t elapsedMs() {
+  if (!currentSlot) return 0;
+  uint32_t rate = seekTable.valid() ? seekTable.sampleRate() : 44100;
+  lockAudio();
+  uint32_t pos = isPaused ? pausedSample : playedSample();
+  uint32_t skip = currentSlot->decoder.TrimSkip();
+  unlockAudio();
+  return pos > skip ? (uint64_t)(pos - skip) * 1000 / rate : 0;
 }
 
+// Muestra de la pista actual (en la cuenta de Position()) que se está oyendo: la del
+// decodificador menos lo que aún espera en el mezclador, el conversor, el DSP, la cola
+// PCM y el DMA, pasado a la frecuencia del decodificador. Con el audio bloqueado.
+uint32_t playedSample() {
+  AudioDecoder &dec = currentSlot->decoder;
+  HeldAudio held;
+  held.inputRate = dec.SampleRate() ? dec.SampleRate() : currentSlot->info.sampleRate;
+#if CROSSFADE_MS
+  held.inputFrames += mixer->heldFrames();
+#endif
+#if RESAMPLE_RATE
+  held.outputRate = RESAMPLE_RATE;
+  held.inputFrames += resampleOutput->heldInputFrames();
+  held.outputFrames += resampleOutput->heldOutputFrames();
+#endif
+  held.outputFrames += dspOutput->heldFrames();
+#if AUDIO_PIPELINE
+  held.outputFrames += pcmRing.available();
+#endif
+  // La tarea de salida (o el decodificador sin ella) rellena el DMA en cuanto hay hueco
+  held.outputFrames += audioOutput->DmaBuffers() * BUFFER_DMA_FRAMES;
+  uint32_t pos = dec.Position();
+  uint32_t behind = held.decoderFrames();
+  return pos > behind ? pos - behind : 0;
+}
+
+// Duración de la pista actual: cabecera LAME, tabla de búsqueda o etiqueta TLEN
+uint32_t totalMs() {
+  if (!currentSlot) return 0;
+  AudioDecoder &dec = currentSlot->decoder;
+  if (seekTable.valid()) {
+    uint32_t rate = seekTable.sampleRate();
+    if (dec.TrimLength()) return (uint64_t)dec.TrimLength() * 1000 / rate;
+    uint32_t samples = seekTable.totalFrames() * seekTable.samplesPerFrame();
+    return samples > dec.TrimSkip() ? (uint64_t)(samples - dec.TrimSkip()) * 1000 / rate : 0;
+  }
+  return trackEntry(currentIndex)->durationMs;
+}
 
+// Abre la pista en un hueco libre sin bloquear el audio (la apertura, la cabecera LAME,
+// la ganancia y, al reanudar, la tabla y el salto leen de la SD) y la cambia por la actual con el
+// audio bloqueado
 void playMP3(const char *filename) {
+  // La pista guardada en la NVS se abre en la muestra donde se quedó
+  uint32_t startAt = (resumeSample && !strcmp(filename, resumePoint.path)) ? resumeSample : 0;
+  resumeSample = 0;
+  lockAudio();
+#if AUDIO_PIPELINE
+  // Al acabar la pista suena lo que quede en cola; un cambio manual lo corta en el acto
+  bool cut = isPlaying && !trackFinished;
+  trackFinished = false;
+#else
+  bool cut = isPlaying;
+#endif
+  isPaused = false;
+  AudioSlot *dropped = cancelPrefetch();
   if (isPlaying && mp3) {
     mp3->stop();
     isPlaying = false;
     Serial.println("Reproducción detenida.");
   }
+  // Con el decodificador ya parado y el audio bloqueado no entra nada más de la pista vieja
+  if (cut) flushAudio();
+  // El hueco de la siguiente ya está libre; la tarea de decodificación no lo ve hasta el cambio
+  AudioSlot *slot = audioPool.acquire();
+  if (!slot) {
+    audioPool.release(currentSlot);
+    currentSlot = nullptr;
+    mp3 = nullptr;
+    audioFile = nullptr;
+    slot = audioPool.acquire();
+  }
+  unlockAudio();
+  releaseSlot(dropped);
 
   Serial.print("Reproduciendo archivo MP3: ");
   Serial.println(filename);
 
-  audioFile = new AudioFileSourceSD(filename);
-  mp3 = new AudioGeneratorMP3();
-  if (mp3->begin(audioFile, audioOutput)) {
+  bool ok = startSlot(slot, filename);
+  if (ok) loadTrackGain(slot, currentIndex, filename);
+  if (ok && startAt) {
+    // Saltar antes del cambio para que no suene el principio de la pista
+    attachSeekTable(slot, currentIndex);
+    if (!seekSlot(slot, startAt)) Serial.println("No se pudo saltar a la posición guardada.");
+  }
+
+  lockAudio();
+  AudioSlot *old = currentSlot;
+  if (ok) {
+    currentSlot = slot;
+    audioFile = &slot->source;
+    mp3 = &slot->decoder;
+#if CROSSFADE_MS
+    mixer->setActive(audioPool.indexOf(slot));
+#endif
+    dsp.setTrackGain(slot->gain, slot->peak);
     isPlaying = true;
-    displaySongInfo(filename);
-    Serial.println("Reproducción iniciada correctamente.");
   } else {
-    Serial.println("Error al iniciar la reproducción del archivo MP3.");
-    delete mp3;
-    delete audioFile;
+    currentSlot = nullptr;
     mp3 = nullptr;
     audioFile = nullptr;
   }
+  unlockAudio();
+
+  // Devolver al pool la pareja fuente/decodificador de la pista anterior (o la nueva si no
+  // ha arrancado): ya no la ve la tarea de decodificación, así que se cierra sin bloquear el audio
+  releaseSlot(old);
+  if (!ok) releaseSlot(slot);
+
+  if (ok) {
+    if (!startAt) attachSeekTable(currentSlot, currentIndex);
+    displaySongInfo(currentIndex);
+    saveResume(true);
+    Serial.println("Reproducción iniciada correctamente.");
+  } else {
+    Serial.println("Error al iniciar la reproducción del archivo MP3.");
+  }
 }
 
-void displaySongInfo(const char *filename) {
-  Serial.print("Mostrando información para: ");
-  Serial.println(filename);
+// Guarda en la NVS la pista actual y la muestra que suena (solo si ha cambiado)
+void saveResume(bool playing) {
+  lastResumeSave = millis();
+  const PlaylistEntry *e = trackEntry(currentIndex);
+  if (!e->path[0]) return;
+  uint32_t sample = 0;
+  if (isPlaying && currentSlot) {
+    lockAudio();
+    sample = isPaused ? pausedSample : playedSample();
+    unlockAudio();
+  }
+  ResumePoint p;
+  strncpy(p.path, e->path, sizeof(p.path));
+  p.index = currentIndex;
+  p.size = e->size;
+  p.mtime = e->mtime;
+  p.sample = sample;
+  p.playing = playing;
+  p.order = playOrder.state();
+  resumeStore.save(p);
+}
+
+// Vuelve a la pista guardada. Si sonaba, empieza ya, antes de cargar el índice: su
+// entrada se toma de lo guardado. Si no, queda seleccionada y PLAY sigue desde ahí.
+void resumeAtBoot() {
+  if (!resumeStore.begin() || !resumeStore.load(resumePoint)) return;
+  resumeLoaded = true;
+  File f = AudioStorage::fs().open(resumePoint.path, FILE_READ);
+  bool same = f && f.size() == resumePoint.size && (uint32_t)f.getLastWrite() == resumePoint.mtime;
+  if (f) f.close();
+  if (!same) {
+    Serial.println("La pista guardada ya no está o ha cambiado; se empieza por la primera.");
+    resumePoint.path[0] = '\0';
+    return;
+  }
 
-  String fileStr = String(filename);
-  fileStr.replace("/playlist/", ""); // Eliminar la ruta
-  fileStr.replace(".mp3", ""); // Eliminar la extensión .mp3
+  // Entrada provisional de la pista hasta tener el índice (listFiles() vacía la caché)
+  for (int i = 0; i < TRACK_CACHE_SIZE; i++) entryCacheIndex[i] = -1;
+  PlaylistEntry &e = entryCache[0];
+  memset(&e, 0, sizeof(e));
+  strncpy(e.path, resumePoint.path, sizeof(e.path) - 1);
+  e.size = resumePoint.size;
+  e.mtime = resumePoint.mtime;
+  entryCacheIndex[0] = resumePoint.index;
+  entryCacheNext = 1;
 
-  int separatorIndex = fileStr.indexOf('_');
-  String songName, artistName;
+  currentIndex = resumePoint.index;
+  resumeSample = resumePoint.sample;
+  Serial.printf("Reanudando %s en la muestra %lu.\n", resumePoint.path, (unsigned long)resumePoint.sample);
+  if (resumePoint.playing) playMP3(resumePoint.path);
+}
 
-  if (separatorIndex != -1) {
-    songName = fileStr.substring(0, separatorIndex);
-    artistName = fileStr.substring(separatorIndex + 1);
+// Con el índice cargado: posición real en la playlist de la pista reanudada
+void locateResumedTrack() {
+  if (!resumePoint.path[0] || fileCount == 0) return;
+#if SCAN_BACKGROUND
+  if (playlistScan.discovering()) return; // Es la primera publicada; se busca al adoptar el índice
+#endif
+  int32_t i = -1;
+  if (resumePoint.index < (uint32_t)fileCount && !strcmp(trackPath(resumePoint.index), resumePoint.path)) {
+    i = resumePoint.index;
   } else {
-    songName = fileStr; // Si no hay un guion bajo, usar todo el nombre del archivo como nombre de la canción
-    artistName = "Desconocido"; // Artista desconocido
+    i = playlistIndex.find(resumePoint.path);
+  }
+  if (i < 0) {
+    // Ya no está en la playlist: sigue sonando si sonaba, pero se navega desde la primera
+    i = 0;
+    resumeSample = 0;
   }
+  currentIndex = i;
+}
+
+void displaySongInfo(int index) {
+  if (!displayReady) return; // Reanudación en el arranque: se dibuja al acabar setup()
+  if (browseMode != BROWSE_OFF) return; // Se dibuja al salir de la navegación
+  const PlaylistEntry *e = trackEntry(index);
+  Serial.print("Mostrando información para: ");
+  Serial.println(e->path);
 
+  displayTrack(e);
+  displayTime();
+  Serial.println("Display updated.");
+}
+
+// Título y artista, que vienen ya extraídos (etiquetas ID3 o nombre) en la entrada del índice
+void displayTrack(const PlaylistEntry *e) {
   display.clearDisplay();
   display.setTextSize(1);
   display.setTextColor(SSD1306_WHITE);
 
-  display.setTextSize(1);
-  display.setCursor(0, 10);
-  display.println(songName);
+#if SPECTRUM
+  // Abajo va el espectro: el artista sigue al título
+  char text[MARQUEE_TEXT_MAX];
+  snprintf(text, sizeof(text), e->artist[0] ? "%s - %s" : "%s", e->title, e->artist);
+  renderer.setMarquee(8, text); // Se desplaza si no cabe
+#else
+  renderer.setMarquee(8, e->title); // Se desplaza si no cabe
   display.setTextSize(1);
   display.setCursor(0, 20);
-  display.println(artistName);
+  display.println(e->artist);
+#endif
+}
 
-  display.display();
-  Serial.println("Display updated.");
+// Línea superior: "m:ss / m:ss", con "||" en pausa
+void displayTime() {
+  if (!displayReady || browseMode != BROWSE_OFF) return;
+  uint32_t cur = elapsedMs() / 1000;
+  uint32_t total = totalMs() / 1000;
+  char text[24];
+  snprintf(text, sizeof(text), "%lu:%02lu / %lu:%02lu%s", (unsigned long)(cur / 60), (unsigned long)(cur % 60),
+           (unsigned long)(total / 60), (unsigned long)(total % 60), isPaused ? "  ||" : "");
+
+  display.fillRect(0, 0, SCREEN_WIDTH, 8, SSD1306_BLACK);
+  display.setTextSize(1);
+  display.setTextColor(SSD1306_WHITE);
+  display.setCursor(0, 0);
+  display.print(text);
 }
 
+#if SPECTRUM
+// Un fotograma del espectro cuando toca; devuelve los ms que faltan para el siguiente.
+// Parado o en pausa deja caer las barras y, con todo abajo, no hace nada.
+uint32_t spectrumStep() {
+  static uint32_t last = 0, windowStart = 0, busyUs = 0;
+  if (!spectrum.ready() || !displayReady || browseMode != BROWSE_OFF) return LOOP_IDLE_MS;
+  uint32_t now = millis();
+  if ((!isPlaying || isPaused) && spectrum.idle()) {
+    last = windowStart = now;
+    busyUs = 0;
+    return LOOP_IDLE_MS;
+  }
+  uint32_t frameMs = 1000 / spectrumFps;
+  uint32_t elapsed = now - last;
+  if (elapsed < frameMs) return frameMs - elapsed;
+  last = now;
+
+  uint32_t t0 = micros();
+  spectrum.analyze(elapsed);
+  drawSpectrum();
+  busyUs += micros() - t0;
+
+  if (now - windowStart >= SPECTRUM_WINDOW_MS) {
+    spectrumCost = busyUs / (now - windowStart); // us por ms: milésimas
+    busyUs = 0;
+    windowStart = now;
+    uint32_t fps = spectrumFps;
+    if (spectrumCost > SPECTRUM_MAX_PERMILLE && fps > SPECTRUM_MIN_FPS) {
+      fps = fps / 2 > SPECTRUM_MIN_FPS ? fps / 2 : SPECTRUM_MIN_FPS;
+    } else if (8 * spectrumCost <= 3 * SPECTRUM_MAX_PERMILLE && fps < SPECTRUM_FPS) {
+      fps = 2 * fps < SPECTRUM_FPS ? 2 * fps : SPECTRUM_FPS; // El doble cabe con margen
+    }
+    if (fps != spectrumFps) {
+      Serial.printf("Espectro: %lu fps (%lu‰ de un núcleo).\n", (unsigned long)fps, (unsigned long)spectrumCost);
+      spectrumFps = fps;
+    }
+  }
+  return frameMs;
+}
+
+// Altura en píxeles de un nivel del analizador (décimas de dB) en 'h' filas
+int spectrumHeight(int16_t level, int h) {
+  return (level - SpectrumAnalyzer::bottom()) * h / -SpectrumAnalyzer::bottom();
+}
+
+// Barras con el pico como una línea encima y, a la derecha, el valor eficaz y el pico
+// de cada canal
+void drawSpectrum() {
+  const int h = SCREEN_HEIGHT - SPECTRUM_Y;
+  const int width = SCREEN_WIDTH - SPECTRUM_VU_WIDTH;
+  const int slot = width / spectrum.bands();
+  const int x0 = (width - slot * spectrum.bands()) / 2;
+  display.fillRect(0, SPECTRUM_Y, SCREEN_WIDTH, h, SSD1306_BLACK);
+  for (uint8_t b = 0; b < spectrum.bands(); b++) {
+    int x = x0 + b * slot;
+    int bar = spectrumHeight(spectrum.level(b), h);
+    int peak = spectrumHeight(spectrum.peak(b), h);
+    if (bar) display.fillRect(x, SCREEN_HEIGHT - bar, slot - 1, bar, SSD1306_WHITE);
+    if (peak > bar) display.drawFastHLine(x, SCREEN_HEIGHT - peak, slot - 1, SSD1306_WHITE);
+  }
+  const int vuWidth = (SPECTRUM_VU_WIDTH - 4) / 2;
+  for (uint8_t c = 0; c < 2; c++) {
+    int x = width + 2 + c * (vuWidth + 2);
+    int bar = spectrumHeight(spectrum.vu(c), h);
+    int peak = spectrumHeight(spectrum.vuPeak(c), h);
+    if (bar) display.fillRect(x, SCREEN_HEIGHT - bar, vuWidth, bar, SSD1306_WHITE);
+    if (peak > bar) display.drawFastHLine(x, SCREEN_HEIGHT - peak, vuWidth, SSD1306_WHITE);
+  }
+}
+#endif
+
 void listFiles() {
-  filenames.clear(); // Limpiar vector de nombres de archivo
-  
-  File dir = SD.open("/playlist");
-  if (!dir) {
+  // El índice guardado en la SD ya está ordenado alfabéticamente; solo se
+  // reconstruye (y solo para las pistas nuevas o cambiadas) si la carpeta ha cambiado
+  fileCount = 0;
+  for (int i = 0; i < TRACK_CACHE_SIZE; i++) entryCacheIndex[i] = -1;
+#if SCAN_BACKGROUND
+  // Se usa el guardado tal cual y la carpeta se revisa en segundo plano
+  if (!playlistIndex.open(AudioStorage::fs(), PLAYLIST_DIR, PLAYLIST_INDEX)) {
+    // La pista reanudada (si la hay) queda como la primera; su entrada sigue en la caché
+    if (playlistScan.discover(PLAYLIST_POOL_BYTES, PLAYLIST_DIR, resumePoint.path)) {
+      PlaylistIndex::metadataFromName(AudioStorage::fs(), entryCache[0].path, playlistScan.name(0), entryCache[0]);
+      entryCacheIndex[0] = 0;
+      currentIndex = 0;
+    }
+    fileCount = playlistScan.count();
+    Serial.println("Sin índice de la playlist: las pistas aparecen según se encuentran.");
+  } else {
+    fileCount = playlistIndex.count();
+    Serial.println("Índice de la playlist cargado; la carpeta se revisa en segundo plano.");
+  }
+  openBrowseIndex();
+  PlaylistScan::Files files = { PLAYLIST_DIR, PLAYLIST_INDEX, PLAYLIST_INDEX_NEW, BROWSE_INDEX, BROWSE_INDEX_NEW };
+  playlistScan.start(AudioStorage::fs(), files, scanThrottle, SCAN_TASK_PRIO, SCAN_CORE);
+#else
+  if (!playlistIndex.begin(AudioStorage::fs(), PLAYLIST_DIR, PLAYLIST_INDEX)) {
     Serial.println("Error al abrir la carpeta de la playlist.");
     return;
   }
+  fileCount = playlistIndex.count();
+  Serial.println(playlistIndex.rebuilt() ? "Índice de la playlist reconstruido." : "Índice de la playlist cargado.");
+  openBrowseIndex();
+  if (!browseIndex.ready() && fileCount > 0) {
+    BrowseIndex::build(playlistIndex, AudioStorage::fs(), BROWSE_INDEX);
+    openBrowseIndex();
+  }
+#endif
 
-  Serial.println("Archivos disponibles en la playlist:");
-  fileCount = 0;
-  while (true) {
-    File entry = dir.openNextFile();
-    if (!entry) break;
-    filenames.push_back(String("/playlist/") + entry.name());
+  Serial.print("Archivos en la playlist: ");
+  Serial.println(fileCount);
+  if (playlistIndex.namesBytes()) {
+    Serial.printf("Nombres de la playlist en RAM: %u bytes.\n", (unsigned)playlistIndex.namesBytes());
   }
-  dir.close();
+}
 
-  // Ordenar los nombres de archivo según sea necesario
-  // Aquí puedes implementar tu lógica de ordenamiento personalizada
-  // Por ejemplo, ordenar alfabéticamente o por fecha de modificación
-  // En este ejemplo, se ordena alfabéticamente:
-  std::sort(filenames.begin(), filenames.end());
+#if SCAN_BACKGROUND
+// Se llama en cada fichero y en cada paso de la reconstrucción. La tarjeta es antes de
+// la decodificación: mientras la cola PCM esté por debajo de la mitad no se sigue.
+void scanThrottle() {
+  static uint32_t sliceStart = micros();
+#if AUDIO_PIPELINE
+  while (isPlaying && !isPaused && !trackFinished && pcmRing.available() < pcmRing.capacity() / 2) {
+    vTaskDelay(pdMS_TO_TICKS(SCAN_PAUSE_MS));
+    sliceStart = micros();
+  }
+#endif
+  if (micros() - sliceStart >= SCAN_SLICE_US) {
+    vTaskDelay(pdMS_TO_TICKS(SCAN_PAUSE_MS));
+    sliceStart = micros();
+  }
+}
 
-  // Copiar los nombres ordenados al array playlist
-  fileCount = filenames.size();
-  for (int i = 0; i < fileCount; ++i) {
-    playlist[i] = filenames[i];
-    Serial.println(playlist[i]);
+// Desde loop(): pistas nuevas mientras no hay índice y, al acabar la revisión, el índice nuevo
+void serviceScan() {
+  if (playlistScan.discovering()) {
+    int n = playlistScan.count();
+    if (n != fileCount) {
+      bool first = fileCount == 0;
+      fileCount = n;
+      playOrder.setCount(fileCount);
+      if (first && !isPlaying) displayCurrentSelection();
+    }
   }
-  
-  Serial.println("Archivos ordenados y listados correctamente.");
+  PlaylistScan::State state = playlistScan.state();
+  if (state == PlaylistScan::RUNNING || state == PlaylistScan::DONE) return;
+  if (state == PlaylistScan::CHANGED && !adoptIndex()) return; // Se reintenta en la siguiente vuelta
+  if (playlistScan.takeBrowse()) {
+    if (!browseIndex.adopt(BROWSE_INDEX_NEW, playlistIndex.fingerprint(), playlistIndex.count())) {
+      Serial.println("Error al abrir el índice por artista y álbum.");
+    }
+    if (browseMode != BROWSE_OFF) browseExit();
+  }
+  if (state == PlaylistScan::FAILED) Serial.println("Error al revisar la carpeta de la playlist.");
+  // Sin índice ni cambios: la carpeta está vacía o la revisión falló
+  if (state != PlaylistScan::CHANGED) playlistScan.endDiscovery();
+  playlistScan.finish();
+  startLoudnessAnalysis(); // Con el índice definitivo
 }
 
+// Cambia al índice nuevo sin parar la pista: se vuelve a buscar por su ruta
+bool adoptIndex() {
+  lockAudio();
+#if GAPLESS
+  if (gaplessAdvanced) {
+    // loop() aún no ha pasado a la pista encadenada (nextIndex es del índice anterior)
+    unlockAudio();
+    return false;
+  }
+#endif
+  AudioSlot *dropped = dropPrefetch(); // La siguiente puede tener otro número en el índice nuevo
+  unlockAudio();
+  releaseSlot(dropped);
+
+  char path[PLAYLIST_PATH_MAX] = "";
+  if (fileCount > 0) strncpy(path, trackPath(currentIndex), sizeof(path) - 1);
+  browseMode = BROWSE_OFF; // Los números de pista cambian
+  bool ok = playlistIndex.adopt(PLAYLIST_INDEX_NEW);
+  for (int i = 0; i < TRACK_CACHE_SIZE; i++) entryCacheIndex[i] = -1;
+  playlistScan.endDiscovery();
+  fileCount = ok ? playlistIndex.count() : 0;
+  if (!ok) Serial.println("Error al abrir el índice nuevo de la playlist.");
+
+  int32_t i = path[0] && fileCount > 0 ? playlistIndex.find(path) : -1;
+  currentIndex = i >= 0 ? i : 0;
+  playOrder.setCount(fileCount);
+  playOrder.jumpTo(currentIndex);
+  if (isPlaying) {
+    displaySongInfo(currentIndex);
+  } else {
+    displayCurrentSelection();
+  }
+  Serial.printf("Playlist actualizada: %d pistas.\n", fileCount);
+  return true;
+}
+#endif
+
+// Arranca el análisis de sonoridad una vez, con el índice de la playlist ya al día
+void startLoudnessAnalysis() {
+#if REPLAYGAIN
+  if (loudnessScan.started() || fileCount == 0) return;
+  loudnessScan.start(AudioStorage::fs(), PLAYLIST_DIR, PLAYLIST_INDEX, loudnessThrottle, LOUDNESS_TASK_PRIO, AUDIO_CORE);
+#endif
+}
+
+#if REPLAYGAIN
+// Entre bloques decodificados: la tarjeta y el núcleo son antes para la reproducción
+void loudnessThrottle() {
+  static uint32_t sliceStart = micros();
+#if AUDIO_PIPELINE
+  while (isPlaying && !isPaused && !trackFinished && pcmRing.available() < pcmRing.capacity() / 2) {
+    vTaskDelay(1);
+    sliceStart = micros();
+  }
+#endif
+  if (micros() - sliceStart >= LOUDNESS_SLICE_US) {
+    vTaskDelay(1);
+    sliceStart = micros();
+  }
+}
+#endif
+
+// Entrada de la pista 'index' (ruta, título, artista...). Se lee del índice de la SD y se
+// guarda en una caché de TRACK_CACHE_SIZE entradas, así redibujar la pantalla o volver a
+// una pista reciente no toca la tarjeta. El puntero vale hasta que se pidan otras
+// TRACK_CACHE_SIZE pistas distintas.
+const PlaylistEntry *trackEntry(int index) {
+  for (int i = 0; i < TRACK_CACHE_SIZE; i++) {
+    if (entryCacheIndex[i] == index) return &entryCache[i];
+  }
+  int slot = entryCacheNext;
+  entryCacheNext = (entryCacheNext + 1) % TRACK_CACHE_SIZE;
+#if SCAN_BACKGROUND
+  if (playlistScan.discovering()) {
+    // Aún sin índice: ruta publicada, tamaño y fecha del fichero y metadatos del nombre
+    PlaylistEntry &e = entryCache[slot];
+    memset(&e, 0, sizeof(e));
+    entryCacheIndex[slot] = -1;
+    if (index < 0 || index >= fileCount) return &e;
+    playlistScan.path(index, e.path, sizeof(e.path));
+    File f = AudioStorage::fs().open(e.path, FILE_READ);
+    if (f) {
+      e.size = f.size();
+      e.mtime = (uint32_t)f.getLastWrite();
+      f.close();
+    }
+    PlaylistIndex::metadataFromName(AudioStorage::fs(), e.path, playlistScan.name(index), e);
+    entryCacheIndex[slot] = index;
+    return &e;
+  }
+#endif
+  if (!playlistIndex.load(index, entryCache[slot])) {
+    memset(&entryCache[slot], 0, sizeof(PlaylistEntry));
+    entryCacheIndex[slot] = -1;
+    return &entryCache[slot];
+  }
+  entryCacheIndex[slot] = index;
+  return &entryCache[slot];
+}
+
+const char *trackPath(int index) {
+  return trackEntry(index)->path;
+}
+
+// Fin de pista: la siguiente según el orden y la repetición
 void playNext() {
   if (fileCount > 0) {
-    currentIndex = (currentIndex + 1) % fileCount;
-
-    // Verificar si currentIndex sigue siendo válido
-    if (currentIndex < fileCount) {
-      playMP3(playlist[currentIndex].c_str());
-      Serial.print("Reproducción siguiente canción: ");
-      Serial.println(playlist[currentIndex]);
-    } 
-    else {
-      // currentIndex está fuera de los límites de la lista, volver al primer archivo
-      currentIndex = 0;
-      Serial.println("Volviendo al inicio de la lista.");
-      playMP3(playlist[currentIndex].c_str());
-      Serial.print("Reproduciendo siguiente canción: ");
-      Serial.println(playlist[currentIndex]);
-    } 
+    uint32_t next;
+    if (!playOrder.advance(next)) {
+      // Sin repetición, al acabar la lista se para con la primera seleccionada
+#if AUDIO_PIPELINE
+      trackFinished = false;
+#endif
+      currentIndex = playOrder.step(1);
+      stopTrack();
+      Serial.println("Fin de la lista.");
+      return;
+    }
+    currentIndex = next;
+    playMP3(trackPath(currentIndex));
+    Serial.print("Reproduciendo siguiente canción: ");
+    Serial.println(trackPath(currentIndex));
   }
   else {
     Serial.println("No hay archivos en la lista.");
@@ -246,118 +2064,218 @@ void playNext() {
   
 }
 
-void readButtons() {
-  // Leer estado actual de los botones
-  prevButtonStateRaw = digitalRead(BUTTON_PREV);
-  playButtonStateRaw = digitalRead(BUTTON_PLAY);
-  nextButtonStateRaw = digitalRead(BUTTON_NEXT);
-
-  // Obtener el tiempo actual
-  unsigned long currentTime = millis();
-
-  // Botón PREV
-  if (prevButtonStateRaw != prevButtonLastState) {
-    lastDebounceTimePrev = currentTime;
-  }
-  if ((currentTime - lastDebounceTimePrev) > DEBOUNCE_DELAY) {
-    if (prevButtonStateRaw != prevButtonState) {
-      prevButtonState = prevButtonStateRaw;
-      if (prevButtonState == LOW) {
-        // Acción al detectar flanco descendente
-        currentIndex = (currentIndex - 1 + fileCount) % fileCount;
-        Serial.println("Valor current index");
-        Serial.println(currentIndex);
-        if (isPlaying) {
-          playMP3(playlist[currentIndex].c_str());
-        } else {
-          displayCurrentSelection();
-        }
-        Serial.println("Canción anterior seleccionada correctamente.");
-      }
-    }
+// Con el índice cargado: orden guardado (o el de PLAY_SHUFFLE/PLAY_REPEAT) en la pista actual
+void setupPlayOrder() {
+  playOrder.setCount(fileCount);
+  playOrder.setRepeat(PLAY_REPEAT);
+  if (PLAY_SHUFFLE) playOrder.setShuffle(true, esp_random());
+  if (resumeLoaded) playOrder.restore(resumePoint.order);
+  playOrder.jumpTo(currentIndex);
+}
+
+// Aleatorio sí/no; al activarlo se baraja de nuevo empezando por la pista actual
+void toggleShuffle() {
+  playOrder.jumpTo(currentIndex);
+  playOrder.setShuffle(!playOrder.shuffle(), esp_random());
+  orderChanged();
+}
+
+void nextRepeatMode() {
+  playOrder.setRepeat((RepeatMode)((playOrder.repeatMode() + 1) % 3));
+  orderChanged();
+}
+
+void orderChanged() {
+  // La pista preparada para encadenar puede no ser ya la que toca
+  lockAudio();
+  AudioSlot *dropped = dropPrefetch();
+  unlockAudio();
+  releaseSlot(dropped);
+  saveResume(isPlaying && !isPaused);
+  static const char *const repeatNames[] = { "sin repetición", "repetir todo", "repetir una" };
+  Serial.printf("Orden %s, %s.\n", playOrder.shuffle() ? "aleatorio" : "secuencial",
+                repeatNames[playOrder.repeatMode()]);
+}
+
+// Índices por artista y álbum, si corresponden al índice de la playlist abierto
+void openBrowseIndex() {
+  browseIndex.open(AudioStorage::fs(), BROWSE_INDEX, playlistIndex.opened() ? playlistIndex.fingerprint() : 0,
+                   playlistIndex.count());
+}
+
+// Entra en la navegación en el artista y el álbum de la pista actual
+void browseEnter() {
+  if (!browseIndex.ready() || browseIndex.count(BrowseIndex::ARTISTS) == 0) {
+    Serial.println("Índice por artista y álbum no disponible todavía.");
+    return;
   }
-  prevButtonLastState = prevButtonStateRaw;
+  const PlaylistEntry *e = trackEntry(currentIndex);
+  int32_t artist = browseIndex.findArtist(e->artist);
+  browseArtist = artist >= 0 ? artist : 0;
+  int32_t album = browseIndex.findAlbum(browseArtist, e->album);
+  browseAlbum = album >= 0 ? album : browseIndex.firstAlbum(browseArtist);
+  browseMode = BROWSE_ARTISTS;
+  displayBrowse();
+  Serial.println("Navegación por artista.");
+}
 
-  // Botón PLAY
-  if (playButtonStateRaw != playButtonLastState) {
-    lastDebounceTimePlay = currentTime;
+void browseExit() {
+  browseMode = BROWSE_OFF;
+  if (isPlaying) {
+    displaySongInfo(currentIndex);
+  } else {
+    displayCurrentSelection();
   }
-  if ((currentTime - lastDebounceTimePlay) > DEBOUNCE_DELAY) {
-    if (playButtonStateRaw != playButtonState) {
-      playButtonState = playButtonStateRaw;
-      if (playButtonState == LOW) {
-        // Acción al detectar flanco descendente
-        if (!isPlaying) {
-          playMP3(playlist[currentIndex].c_str());
-          Serial.println("Canción reproducida correctamente.");
-        } else {
-          // Pausar o detener la reproducción si está en curso
-          // Aquí puedes implementar una lógica adicional si se desea.
-          mp3->stop();
-          displayCurrentSelection(); // Actualizar la pantalla
-          Serial.println("Reproducción detenida.");
-          isPlaying = false;
-        }
-        }
-      }
+}
+
+void browseButton(const ButtonEvent &ev) {
+  if (ev.button == buttonPrev || ev.button == buttonNext) {
+    int dir = (ev.button == buttonNext) ? 1 : -1;
+    bool held = ev.type == BUTTON_LONG || ev.type == BUTTON_REPEAT;
+    if (browseMode == BROWSE_ARTISTS) {
+      uint32_t n = browseIndex.count(BrowseIndex::ARTISTS);
+      browseArtist = held ? browseInitial(browseArtist, dir) : (browseArtist + n + dir) % n;
+    } else {
+      uint32_t first = browseIndex.firstAlbum(browseArtist);
+      uint32_t n = browseIndex.firstAlbum(browseArtist + 1) - first;
+      browseAlbum = first + (browseAlbum - first + n + dir) % n;
     }
-  playButtonLastState = playButtonStateRaw;
-
-
-  // Botón NEXT
-  if (nextButtonStateRaw != nextButtonLastState) {
-    lastDebounceTimeNext = currentTime;
-  }
-  if ((currentTime - lastDebounceTimeNext) > DEBOUNCE_DELAY) {
-    if (nextButtonStateRaw != nextButtonState) {
-      nextButtonState = nextButtonStateRaw;
-      if (nextButtonState == LOW) {
-        // Acción al detectar flanco descendente
-        currentIndex = (currentIndex + 1) % fileCount;
-        Serial.println("Valor current index");
-        Serial.println(currentIndex);
-        if (isPlaying) {
-          playMP3(playlist[currentIndex].c_str());
-        } else {
-          displayCurrentSelection();
-        }
-        Serial.println("Canción siguiente seleccionada correctamente.");
+    displayBrowse();
+  } else if (ev.button == buttonPlay) {
+    if (ev.type == BUTTON_LONG) {
+      browseExit();
+    } else if (ev.type == BUTTON_DOUBLE) {
+      // Sube un nivel; desde los artistas, sale
+      if (browseMode == BROWSE_ALBUMS) {
+        browseMode = BROWSE_ARTISTS;
+        displayBrowse();
+      } else {
+        browseExit();
+      }
+    } else if (ev.type == BUTTON_CLICK) {
+      if (browseMode == BROWSE_ARTISTS) {
+        browseMode = BROWSE_ALBUMS;
+        browseAlbum = browseIndex.firstAlbum(browseArtist);
+        displayBrowse();
+      } else {
+        // Primera pista del álbum; después sigue el orden de siempre
+        currentIndex = browseIndex.track(browseIndex.firstPosition(browseAlbum));
+        playOrder.jumpTo(currentIndex);
+        browseMode = BROWSE_OFF;
+        playMP3(trackPath(currentIndex));
+        Serial.println("Álbum reproducido correctamente.");
       }
     }
   }
-  nextButtonLastState = nextButtonStateRaw;
 }
 
-
-
-void displayCurrentSelection(){
-  if (fileCount > 0) {
-    String fileStr = playlist[currentIndex];
-    fileStr.replace("/playlist/", ""); // Eliminar la ruta
-    fileStr.replace(".mp3", ""); // Eliminar la extensión .mp3
-
-  int separatorIndex = fileStr.indexOf('_');
-  String songName, artistName;
-
-  if (separatorIndex != -1) {
-    songName = fileStr.substring(0, separatorIndex);
-    artistName = fileStr.substring(separatorIndex + 1);
-  } else {
-    songName = fileStr; // Si no hay un guion bajo, usar todo el nombre del archivo como nombre de la canción
-    artistName = "Desconocido"; // Artista desconocido
+// Primer artista de la inicial siguiente (o de la anterior), dando la vuelta en los extremos
+uint32_t browseInitial(uint32_t artist, int dir) {
+  uint32_t n = browseIndex.count(BrowseIndex::ARTISTS);
+  char name[PLAYLIST_TAG_MAX];
+  char key[2] = { 0, 0 };
+  browseIndex.name(BrowseIndex::ARTISTS, artist, name, sizeof(name));
+  if (dir > 0) {
+    if ((uint8_t)name[0] == 0xFF) return 0;
+    key[0] = name[0] ? name[0] + 1 : 1;
+    uint32_t next = browseIndex.lowerBound(BrowseIndex::ARTISTS, artist + 1, n, key);
+    return next < n ? next : 0;
   }
+  key[0] = name[0];
+  uint32_t start = browseIndex.lowerBound(BrowseIndex::ARTISTS, 0, artist + 1, key); // Primero de esta inicial
+  uint32_t prev = start > 0 ? start - 1 : n - 1;
+  browseIndex.name(BrowseIndex::ARTISTS, prev, name, sizeof(name));
+  key[0] = name[0];
+  return browseIndex.lowerBound(BrowseIndex::ARTISTS, 0, prev + 1, key);
+}
 
+// "Artista 3/120" o "Album 1/4" arriba, el nombre (desplazándose si no cabe) y, en los
+// álbumes, el artista debajo. Solo se lee de la tarjeta lo que se dibuja.
+void displayBrowse() {
+  if (!displayReady) return;
+  char name[PLAYLIST_TAG_MAX] = "";
+  char top[24];
   display.clearDisplay();
   display.setTextSize(1);
   display.setTextColor(SSD1306_WHITE);
+  if (browseMode == BROWSE_ARTISTS) {
+    browseIndex.name(BrowseIndex::ARTISTS, browseArtist, name, sizeof(name));
+    snprintf(top, sizeof(top), "Artista %lu/%lu", (unsigned long)browseArtist + 1,
+             (unsigned long)browseIndex.count(BrowseIndex::ARTISTS));
+  } else {
+    uint32_t first = browseIndex.firstAlbum(browseArtist);
+    browseIndex.name(BrowseIndex::ALBUMS, browseAlbum, name, sizeof(name));
+    snprintf(top, sizeof(top), "Album %lu/%lu", (unsigned long)(browseAlbum - first + 1),
+             (unsigned long)(browseIndex.firstAlbum(browseArtist + 1) - first));
+  }
+  display.setCursor(0, 0);
+  display.print(top);
+  renderer.setMarquee(8, name[0] ? name : "(sin album)");
+  if (browseMode == BROWSE_ALBUMS) {
+    browseIndex.name(BrowseIndex::ARTISTS, browseArtist, name, sizeof(name));
+    display.setCursor(0, 20);
+    display.println(name);
+  }
+}
+
+void readButtons() {
+  ButtonEvent ev;
+  while (buttons.poll(ev)) {
+    if (browseMode != BROWSE_OFF) {
+      browseButton(ev);
+      continue;
+    }
+    if (ev.button == buttonPrev || ev.button == buttonNext) {
+      int dir = (ev.button == buttonNext) ? 1 : -1;
+      if (ev.type == BUTTON_LONG || ev.type == BUTTON_REPEAT) {
+        // Mantenido: avance/retroceso rápido dentro de la pista
+        seekRelative(dir * SKIP_STEP_MS);
+        displayTime();
+        continue;
+      }
+      if (fileCount == 0) continue;
+      currentIndex = playOrder.step(dir);
+      Serial.println("Valor current index");
+      Serial.println(currentIndex);
+      if (isPlaying) {
+        playMP3(trackPath(currentIndex));
+      } else {
+        displayCurrentSelection();
+      }
+      Serial.println(dir > 0 ? "Canción siguiente seleccionada correctamente." : "Canción anterior seleccionada correctamente.");
+    } else if (ev.button == buttonPlay) {
+      if (ev.type == BUTTON_LONG) {
+        if (isPlaying) stopTrack();
+        else browseEnter();
+      } else if (ev.type == BUTTON_DOUBLE) {
+        // Reiniciar la pista actual
+        if (fileCount > 0) {
+          playMP3(trackPath(currentIndex));
+        }
+      } else if (ev.type == BUTTON_CLICK) {
+        if (!isPlaying) {
+          if (fileCount > 0) {
+            playMP3(trackPath(currentIndex));
+            Serial.println("Canción reproducida correctamente.");
+          }
+        } else if (isPaused) {
+          // Reanudar en la muestra exacta donde se pausó
+          resumeTrack();
+          displayTime();
+        } else {
+          // Pausar sin cerrar la pista
+          pauseTrack();
+          displayTime(); // Actualizar la pantalla
+        }
+      }
+    }
+  }
+}
 
-  display.setTextSize(1);
-  display.setCursor(0, 10);
-  display.println(songName);
-  display.setTextSize(1);
-  display.setCursor(0, 20);
-  display.println(artistName);
 
-  display.display();
+
+void displayCurrentSelection(){
+  if (displayReady && fileCount > 0 && browseMode == BROWSE_OFF) {
+    displayTrack(trackEntry(currentIndex));
   }
 }
@@ -0,0 +1,108 @@
+/*
+  Pruebas de BlockDsp (pio test -e native)
+  Sin bandas y a volumen 1 la señal pasa intacta; volumen, balance y ganancia de
+  pista (limitada por el pico) escalan lo que toca tras la rampa; una banda PEAK
+  de +6 dB sube un tono en su centro y deja casi igual uno lejos.
+*/
+
+#include <unity.h>
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+#include "BlockDsp.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint32_t frames = 4096;
+
+// Ruido blanco de amplitud 'amp' (o un seno de 'freq' Hz si no es 0)
+static std::vector<int16_t> signal(int amp, double freq = 0.0)
+{
+  std::vector<int16_t> pcm(2 * frames);
+  srand(1);
+  for (uint32_t i = 0; i < frames; i++) {
+    int16_t v = freq ? (int16_t)lrint(amp * sin(2 * M_PI * freq * i / 44100)) : (int16_t)(rand() % (2 * amp + 1) - amp);
+    pcm[2 * i] = pcm[2 * i + 1] = v;
+  }
+  return pcm;
+}
+
+// Mayor diferencia en el canal 'ch' entre 'out' y 'in' * 'gain', sin la rampa del principio
+static int worstError(const std::vector<int16_t> &in, const std::vector<int16_t> &out, int ch, double gain)
+{
+  int worst = 0;
+  for (uint32_t i = DSP_RAMP_FRAMES; i < frames; i++) {
+    int e = abs(out[2 * i + ch] - (int)lrint(in[2 * i + ch] * gain));
+    if (e > worst) worst = e;
+  }
+  return worst;
+}
+
+static void test_unity_passes_through()
+{
+  BlockDsp dsp;
+  std::vector<int16_t> in = signal(20000), out = in;
+  dsp.process(out.data(), frames);
+  TEST_ASSERT_EQUAL_INT(0, dsp.activeBands());
+  TEST_ASSERT_LESS_OR_EQUAL(1, worstError(in, out, 0, 1.0));
+  TEST_ASSERT_LESS_OR_EQUAL(1, worstError(in, out, 1, 1.0));
+}
+
+static void test_volume_and_balance()
+{
+  BlockDsp dsp;
+  dsp.setVolume(0.5f);
+  dsp.setBalance(50); // Hacia la derecha: la izquierda a la mitad
+  std::vector<int16_t> in = signal(20000), out = in;
+  dsp.process(out.data(), frames);
+  TEST_ASSERT_LESS_OR_EQUAL(1, worstError(in, out, 0, 0.25));
+  TEST_ASSERT_LESS_OR_EQUAL(1, worstError(in, out, 1, 0.5));
+}
+
+static void test_track_gain_is_limited_by_peak()
+{
+  BlockDsp dsp;
+  dsp.setVolume(0.5f);
+  dsp.setTrackGain(4.0f, 0.8f); // 0.5 * 4 = 2 haría saturar el pico: 1 / 0.8
+  std::vector<int16_t> in = signal(20000), out = in;
+  dsp.process(out.data(), frames);
+  TEST_ASSERT_LESS_OR_EQUAL(1, worstError(in, out, 0, 1.25));
+}
+
+// Nivel en dB de un seno tras el ecualizador (sin el arranque de los filtros)
+static double toneGainDb(BlockDsp &dsp, double freq)
+{
+  std::vector<int16_t> in = signal(8000, freq), out = in;
+  dsp.restart();
+  dsp.process(out.data(), frames);
+  double ein = 0, eout = 0;
+  for (uint32_t i = frames / 2; i < frames; i++) {
+    ein += (double)in[2 * i] * in[2 * i];
+    eout += (double)out[2 * i] * out[2 * i];
+  }
+  return 10 * log10(eout / ein);
+}
+
+static void test_peak_band_boosts_its_centre()
+{
+  BlockDsp dsp;
+  dsp.setSampleRate(44100);
+  TEST_ASSERT_TRUE(dsp.setBand(0, BlockDsp::PEAK, 1000.0f, 6.0f, 1.0f));
+  TEST_ASSERT_EQUAL_INT(1, dsp.activeBands());
+  TEST_ASSERT_FLOAT_WITHIN(0.3, 6.0, toneGainDb(dsp, 1000.0));
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 0.0, toneGainDb(dsp, 100.0));
+  dsp.clearBands();
+  TEST_ASSERT_EQUAL_INT(0, dsp.activeBands());
+  TEST_ASSERT_FALSE(dsp.setBand(DSP_MAX_BANDS, BlockDsp::PEAK, 1000.0f, 6.0f, 1.0f));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_unity_passes_through);
+  RUN_TEST(test_volume_and_balance);
+  RUN_TEST(test_track_gain_is_limited_by_peak);
+  RUN_TEST(test_peak_band_boosts_its_centre);
+  return UNITY_END();
+}
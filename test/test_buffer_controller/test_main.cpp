@@ -0,0 +1,137 @@
+/*
+  Pruebas de BufferController (pio test -e native)
+  Cada regla de update() por separado y, con la simulación de bench/BufferSim.h
+  y la traza sintética de la tarjeta (atascos de 100-450 ms y alguno de casi un
+  segundo), 30 min a 128 y 320 kbps: los buffers adaptativos no cortan más que
+  los fijos de siempre y gastan de media menos RAM que los fijos al máximo.
+  Y las ventanas de BufferWatch: vaciados, cortes y retrasos de la salida, sin
+  contar el arranque tras un corte.
+*/
+
+#include <unity.h>
+#include "BufferController.h"
+#include "BufferSim.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const BufferController::Window quiet = { 0, 0, 0, 2048, 0 };
+
+static void test_empty_ring_doubles_ring()
+{
+  BufferController ctl;
+  ctl.begin(BufferController::defaults(44100, 2048, 8));
+  BufferController::Window w = quiet;
+  w.ringEmpty = 1;
+  w.ringLow = 0;
+  TEST_ASSERT_EQUAL(BufferController::GROW_RING, ctl.update(w).action);
+  TEST_ASSERT_EQUAL_UINT32(4096, ctl.ring());
+  TEST_ASSERT_EQUAL(8, ctl.dma());
+}
+
+static void test_late_output_grows_dma()
+{
+  BufferController ctl;
+  ctl.begin(BufferController::defaults(44100, 2048, 8));
+  BufferController::Window w = quiet;
+  w.late = 1;
+  TEST_ASSERT_EQUAL(BufferController::GROW_DMA, ctl.update(w).action);
+  TEST_ASSERT_EQUAL(8 + BUFFER_DMA_STEP, ctl.dma());
+}
+
+static void test_slow_card_sizes_ring_to_cover_it()
+{
+  BufferController ctl;
+  ctl.begin(BufferController::defaults(44100, 2048, 8));
+  BufferController::Window w = quiet;
+  w.sdPeakUs = 200000; // 200 ms: más que cola y DMA juntos (~70 ms)
+  TEST_ASSERT_EQUAL(BufferController::GROW_RING, ctl.update(w).action);
+  TEST_ASSERT_TRUE(ctl.ring() + ctl.dma() * BUFFER_DMA_FRAMES >= ctl.needed());
+  TEST_ASSERT_TRUE(ctl.ring() <= BUFFER_RING_MAX);
+}
+
+static void test_quiet_windows_shrink_within_limits()
+{
+  BufferController ctl;
+  ctl.begin(BufferController::defaults(44100, 8192, 16));
+  BufferController::Window w = quiet;
+  w.ringLow = 8000;
+  bool shrunk = false;
+  for (int i = 0; i < 20 * BUFFER_SHRINK_WINDOWS; i++) {
+    if (ctl.update(w).action == BufferController::SHRINK_RING) shrunk = true;
+    w.ringLow = ctl.ring();
+  }
+  TEST_ASSERT_TRUE(shrunk);
+  TEST_ASSERT_EQUAL_UINT32(BUFFER_RING_MIN, ctl.ring());
+  TEST_ASSERT_EQUAL(BUFFER_DMA_MIN, ctl.dma());
+}
+
+static void checkBitrate(uint32_t kbps)
+{
+  std::vector<uint32_t> trace;
+  syntheticTrace(trace);
+  BufferSimResult fixed = bufferSim(trace, kbps, 2048, 8, false, false);
+  BufferSimResult most = bufferSim(trace, kbps, BUFFER_RING_MAX, BUFFER_DMA_MAX, false, false);
+  BufferSimResult adaptive = bufferSim(trace, kbps, 2048, 8, true, false);
+  char msg[160];
+  snprintf(msg, sizeof(msg), "%u kbps: cortes %u fijos, %u al máximo, %u adaptativos; RAM %.1f / %.1f / %.1f KB",
+           (unsigned)kbps, (unsigned)fixed.glitches, (unsigned)most.glitches, (unsigned)adaptive.glitches,
+           fixed.ramKb, most.ramKb, adaptive.ramKb);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE_MESSAGE(adaptive.glitches <= fixed.glitches, msg);
+  TEST_ASSERT_TRUE_MESSAGE(adaptive.ramKb < most.ramKb, msg);
+}
+
+static void test_adaptive_no_worse_than_fixed_128()
+{
+  checkBitrate(128);
+}
+
+static void test_adaptive_no_worse_than_fixed_320()
+{
+  checkBitrate(320);
+}
+
+// Salida cada 'stepUs' con 'level' tramas en cola (enviando algo si hay)
+static void passes(BufferWatch &watch, uint32_t &now, int n, uint32_t stepUs, uint32_t level, bool cut = false)
+{
+  for (int i = 0; i < n; i++) {
+    now += stepUs;
+    BufferWatch::Pass p = { now, level ? 128u : 0u, level, 20000, cut && i == 0, true };
+    watch.pass(p);
+  }
+}
+
+static void test_watch_counts_empty_dry_and_late()
+{
+  BufferWatch watch;
+  watch.begin(1000000);
+  BufferController::Window w;
+  uint32_t now = 0;
+  passes(watch, now, 10, 1000, 0, true);  // Arranque tras un corte: no cuenta
+  passes(watch, now, 10, 1000, 1500);
+  passes(watch, now, 30, 1000, 0);        // Vacía 30 ms, más que el DMA: un vaciado y un corte
+  passes(watch, now, 1, 1000, 800);
+  passes(watch, now, 1, 25000, 800);      // La salida vuelve tarde con datos en cola
+  TEST_ASSERT_FALSE(watch.take(w));
+  passes(watch, now, 1000, 1000, 1500);
+  TEST_ASSERT_TRUE(watch.take(w));
+  TEST_ASSERT_EQUAL_UINT32(1, w.ringEmpty);
+  TEST_ASSERT_EQUAL_UINT32(1, w.dry);
+  TEST_ASSERT_EQUAL_UINT32(1, w.late);
+  TEST_ASSERT_EQUAL_UINT32(800, w.ringLow);
+  TEST_ASSERT_FALSE(watch.take(w));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_ring_doubles_ring);
+  RUN_TEST(test_late_output_grows_dma);
+  RUN_TEST(test_slow_card_sizes_ring_to_cover_it);
+  RUN_TEST(test_quiet_windows_shrink_within_limits);
+  RUN_TEST(test_watch_counts_empty_dry_and_late);
+  RUN_TEST(test_adaptive_no_worse_than_fixed_128);
+  RUN_TEST(test_adaptive_no_worse_than_fixed_320);
+  return UNITY_END();
+}
@@ -0,0 +1,210 @@
+/*
+  Pruebas de ButtonInput (pio test -e native)
+  Los pines son los GPIO simulados de bench/host: cada cambio de nivel llama a la
+  interrupción y el reloj manual dispara los temporizadores de FreeRTOS, así que
+  los rebotes se reproducen al milisegundo. Rebotes al pulsar y al soltar dan una
+  sola pulsación con la hora del primer flanco; doble, larga con repetición, un
+  pico más corto que BUTTON_DEBOUNCE_MS no cuenta, sleepArm() no duerme con un
+  botón pulsado, y wake() corta wait() sin dejar evento.
+*/
+
+#include <unity.h>
+#include <vector>
+#include "ButtonInput.h"
+
+static const uint8_t pinA = 4, pinB = 5;
+static ButtonInput *input;
+static int a, b;
+
+void setUp()
+{
+  hostManualClock(true);
+  hostAdvanceMs(1000);
+  hostSetPin(pinA, HIGH);
+  hostSetPin(pinB, HIGH);
+  input = new ButtonInput();
+  a = input->add(pinA);
+  b = input->add(pinB, ButtonInput::DETECT_DOUBLE | ButtonInput::DETECT_REPEAT);
+  TEST_ASSERT_TRUE(input->begin());
+}
+
+void tearDown()
+{
+  // Los temporizadores siguen apuntando a los botones: se deja que venzan antes de borrarlos
+  hostAdvanceMs(2000);
+  delete input;
+}
+
+static std::vector<ButtonEvent> events()
+{
+  std::vector<ButtonEvent> out;
+  ButtonEvent ev;
+  while (input->poll(ev)) out.push_back(ev);
+  return out;
+}
+
+// 'edges' cambios de nivel, uno cada 'everyMs', acabando en 'level'
+static void bounce(uint8_t pin, int level, int edges, uint32_t everyMs)
+{
+  for (int i = edges - 1; i >= 0; i--) {
+    hostSetPin(pin, (i & 1) ? !level : level);
+    hostAdvanceMs(everyMs);
+  }
+}
+
+static void test_bouncy_press_is_one_click()
+{
+  uint32_t t0 = millis();
+  bounce(pinA, LOW, 7, 2);
+  hostAdvanceMs(120);
+  TEST_ASSERT_EQUAL_UINT32(0, events().size());
+  bounce(pinA, HIGH, 5, 3);
+  hostAdvanceMs(BUTTON_DEBOUNCE_MS - 3 - 1);
+  TEST_ASSERT_EQUAL_UINT32(0, events().size()); // A 1 ms de dar el nivel por estable
+  hostAdvanceMs(1);
+  std::vector<ButtonEvent> ev = events();
+  TEST_ASSERT_EQUAL_UINT32(1, ev.size());
+  TEST_ASSERT_EQUAL(a, ev[0].button);
+  TEST_ASSERT_EQUAL(BUTTON_CLICK, ev[0].type);
+  TEST_ASSERT_EQUAL_UINT32(t0, ev[0].timeMs);
+}
+
+// Un pico más corto que el tiempo de rebote vuelve al mismo nivel: nada
+static void test_glitch_is_ignored()
+{
+  hostSetPin(pinA, LOW);
+  hostAdvanceMs(BUTTON_DEBOUNCE_MS - 5);
+  hostSetPin(pinA, HIGH);
+  hostAdvanceMs(500);
+  TEST_ASSERT_EQUAL_UINT32(0, events().size());
+}
+
+static void test_click_waits_for_double_window()
+{
+  uint32_t t0 = millis();
+  bounce(pinB, LOW, 3, 1);
+  hostAdvanceMs(80);
+  bounce(pinB, HIGH, 3, 1);
+  hostAdvanceMs(BUTTON_DEBOUNCE_MS + BUTTON_DOUBLE_MS - 10);
+  TEST_ASSERT_EQUAL_UINT32(0, events().size());
+  hostAdvanceMs(20);
+  std::vector<ButtonEvent> ev = events();
+  TEST_ASSERT_EQUAL_UINT32(1, ev.size());
+  TEST_ASSERT_EQUAL(b, ev[0].button);
+  TEST_ASSERT_EQUAL(BUTTON_CLICK, ev[0].type);
+  TEST_ASSERT_EQUAL_UINT32(t0, ev[0].timeMs);
+}
+
+static void test_double_press()
+{
+  bounce(pinB, LOW, 5, 1);
+  hostAdvanceMs(80);
+  bounce(pinB, HIGH, 5, 1);
+  hostAdvanceMs(100);
+  bounce(pinB, LOW, 5, 1);
+  hostAdvanceMs(80);
+  bounce(pinB, HIGH, 5, 1);
+  hostAdvanceMs(BUTTON_DOUBLE_MS + 100);
+  std::vector<ButtonEvent> ev = events();
+  TEST_ASSERT_EQUAL_UINT32(1, ev.size());
+  TEST_ASSERT_EQUAL(BUTTON_DOUBLE, ev[0].type);
+}
+
+// Mantenido: larga a BUTTON_LONG_MS del flanco estable y repetición cada BUTTON_REPEAT_MS
+static void test_long_press_repeats_until_release()
+{
+  uint32_t t0 = millis();
+  bounce(pinB, LOW, 5, 2); // Último flanco en t0 + 8, y 2 ms más
+  hostAdvanceMs(BUTTON_DEBOUNCE_MS + BUTTON_LONG_MS - 2 - 1);
+  TEST_ASSERT_EQUAL_UINT32(0, events().size());
+  hostAdvanceMs(1);
+  std::vector<ButtonEvent> ev = events();
+  TEST_ASSERT_EQUAL_UINT32(1, ev.size());
+  TEST_ASSERT_EQUAL(BUTTON_LONG, ev[0].type);
+  TEST_ASSERT_EQUAL_UINT32(t0, ev[0].timeMs);
+  hostAdvanceMs(3 * BUTTON_REPEAT_MS);
+  ev = events();
+  TEST_ASSERT_EQUAL_UINT32(3, ev.size());
+  for (const ButtonEvent &e : ev) TEST_ASSERT_EQUAL(BUTTON_REPEAT, e.type);
+  bounce(pinB, HIGH, 5, 2);
+  hostAdvanceMs(2000);
+  TEST_ASSERT_EQUAL_UINT32(0, events().size());
+}
+
+// Sin DETECT_REPEAT solo hay una larga, y al soltar no hay pulsación corta
+static void test_long_press_without_repeat()
+{
+  hostSetPin(pinA, LOW);
+  hostAdvanceMs(2000);
+  hostSetPin(pinA, HIGH);
+  hostAdvanceMs(100);
+  std::vector<ButtonEvent> ev = events();
+  TEST_ASSERT_EQUAL_UINT32(1, ev.size());
+  TEST_ASSERT_EQUAL(BUTTON_LONG, ev[0].type);
+}
+
+static void test_both_buttons_at_once()
+{
+  hostSetPin(pinA, LOW);
+  hostAdvanceMs(5);
+  hostSetPin(pinB, LOW);
+  hostAdvanceMs(100);
+  hostSetPin(pinA, HIGH);
+  hostSetPin(pinB, HIGH);
+  hostAdvanceMs(BUTTON_DEBOUNCE_MS + BUTTON_DOUBLE_MS + 10);
+  std::vector<ButtonEvent> ev = events();
+  TEST_ASSERT_EQUAL_UINT32(2, ev.size());
+  TEST_ASSERT_EQUAL(a, ev[0].button);
+  TEST_ASSERT_EQUAL(b, ev[1].button);
+  TEST_ASSERT_EQUAL(ev[0].timeMs + 5, ev[1].timeMs);
+}
+
+static void test_sleep_refused_while_pressed()
+{
+  hostSetPin(pinA, LOW);
+  TEST_ASSERT_FALSE(input->sleepArm()); // Rebotando
+  hostAdvanceMs(100);
+  TEST_ASSERT_FALSE(input->sleepArm()); // Pulsado
+  hostSetPin(pinA, HIGH);
+  hostAdvanceMs(BUTTON_DEBOUNCE_MS + 10);
+  events();
+  TEST_ASSERT_TRUE(input->sleepArm());
+  // Despierta con el botón pulsado: la pulsación cuenta al volver a los flancos
+  hostSetPin(pinA, LOW);
+  input->sleepDisarm();
+  hostAdvanceMs(100);
+  hostSetPin(pinA, HIGH);
+  hostAdvanceMs(BUTTON_DEBOUNCE_MS + 10);
+  std::vector<ButtonEvent> ev = events();
+  TEST_ASSERT_EQUAL_UINT32(1, ev.size());
+  TEST_ASSERT_EQUAL(BUTTON_CLICK, ev[0].type);
+}
+
+static void test_wake_ends_wait_without_event()
+{
+  input->wake();
+  TEST_ASSERT_TRUE(input->wait(0));
+  TEST_ASSERT_EQUAL_UINT32(0, events().size());
+  TEST_ASSERT_FALSE(input->wait(0));
+  input->wake();
+  bounce(pinA, LOW, 1, 100);
+  bounce(pinA, HIGH, 1, BUTTON_DOUBLE_MS + 10);
+  std::vector<ButtonEvent> ev = events();
+  TEST_ASSERT_EQUAL_UINT32(1, ev.size());
+  TEST_ASSERT_EQUAL(BUTTON_CLICK, ev[0].type);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_bouncy_press_is_one_click);
+  RUN_TEST(test_glitch_is_ignored);
+  RUN_TEST(test_click_waits_for_double_window);
+  RUN_TEST(test_double_press);
+  RUN_TEST(test_long_press_repeats_until_release);
+  RUN_TEST(test_long_press_without_repeat);
+  RUN_TEST(test_both_buttons_at_once);
+  RUN_TEST(test_sleep_refused_while_pressed);
+  RUN_TEST(test_wake_ends_wait_without_event);
+  return UNITY_END();
+}
@@ -0,0 +1,173 @@
+/*
+  Pruebas de CpuGovernor (pio test -e native)
+  Las reglas de update(), guard() y cut() por separado y, con la simulación de
+  bench/GovernorSim.h, 20 min de reproducción con cada perfil de carga: sonando
+  nunca se cambia de PLL, y el regulador no añade vaciados de la cola a los de
+  la CPU fija a 240 MHz mientras 160 MHz baste (sin esperar al PLL, nunca).
+*/
+
+#include <unity.h>
+#include "CpuGovernor.h"
+#include "GovernorSim.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_stopped_goes_to_lowest_or_top_with_background()
+{
+  CpuGovernor g;
+  g.begin(CpuGovernor::defaults(), 240);
+  TEST_ASSERT_EQUAL(240, g.mhz());
+  CpuGovernor::Window w = { false, false, 0, 0 };
+  TEST_ASSERT_TRUE(g.update(w).change);
+  TEST_ASSERT_EQUAL(80, g.mhz());
+  w.background = true;
+  TEST_ASSERT_TRUE(g.update(w).change);
+  TEST_ASSERT_EQUAL(240, g.mhz());
+}
+
+static void test_load_above_target_raises_at_once()
+{
+  CpuGovernor g;
+  g.begin(CpuGovernor::defaults(), 80);
+  CpuGovernor::Window w = { true, false, 250, 0 }; // 750‰ a 80 MHz, 375‰ a 160
+  TEST_ASSERT_TRUE(g.update(w).change);
+  TEST_ASSERT_EQUAL(160, g.mhz());
+}
+
+static void test_slack_lowers_one_step_after_down_windows()
+{
+  CpuGovernor::Config cfg = CpuGovernor::defaults();
+  cfg.relockMhz = 0;
+  CpuGovernor g;
+  g.begin(cfg, 160);
+  CpuGovernor::Window w = { true, false, 100, 0 };
+  for (int i = 0; i < CPU_DOWN_WINDOWS - 1; i++) TEST_ASSERT_FALSE(g.update(w).change);
+  TEST_ASSERT_TRUE(g.update(w).change);
+  TEST_ASSERT_EQUAL(80, g.mhz());
+}
+
+static void test_guard_raises_on_low_ring_and_holds()
+{
+  CpuGovernor::Config cfg = CpuGovernor::defaults();
+  cfg.relockMhz = 0;
+  CpuGovernor g;
+  g.begin(cfg, 80);
+  TEST_ASSERT_FALSE(g.guard(500));
+  TEST_ASSERT_TRUE(g.guard(CPU_LOW_RING - 1));
+  TEST_ASSERT_EQUAL(160, g.mhz());
+  CpuGovernor::Window w = { true, false, 50, 0 };
+  for (int i = 0; i < CPU_HOLD_WINDOWS; i++) TEST_ASSERT_FALSE(g.update(w).change);
+  TEST_ASSERT_TRUE(g.guard(CPU_LOW_RING / 2 - 1));
+  TEST_ASSERT_EQUAL(240, g.mhz());
+}
+
+// Sonando ni guard() ni update() pasan a 240 MHz (otro PLL); el corte siguiente sí
+static void test_no_relock_while_playing()
+{
+  CpuGovernor g;
+  g.begin(CpuGovernor::defaults(), 80);
+  TEST_ASSERT_TRUE(g.guard(0));
+  TEST_ASSERT_EQUAL(160, g.mhz());
+  TEST_ASSERT_FALSE(g.guard(0));
+  CpuGovernor::Window w = { true, false, 700, 0 }; // 1050‰ a 160 MHz
+  TEST_ASSERT_FALSE(g.update(w).change);
+  TEST_ASSERT_EQUAL(160, g.mhz());
+  TEST_ASSERT_TRUE(g.cut());
+  TEST_ASSERT_EQUAL(240, g.mhz());
+
+  // Y para bajar de 240 con poca carga, también al corte
+  w.loadPermille = 100;
+  for (int i = 0; i < 3 * CPU_DOWN_WINDOWS; i++) TEST_ASSERT_FALSE(g.update(w).change);
+  TEST_ASSERT_EQUAL(240, g.mhz());
+  TEST_ASSERT_TRUE(g.cut());
+  TEST_ASSERT_EQUAL(80, g.mhz());
+  TEST_ASSERT_FALSE(g.cut());
+}
+
+// Parado decidió 240 pero no llegó a ponerse antes de sonar: sigue desde lo puesto
+static void test_follow_the_applied_frequency()
+{
+  CpuGovernor g;
+  g.begin(CpuGovernor::defaults(), 80);
+  CpuGovernor::Window w = { false, true, 0, 0 };
+  TEST_ASSERT_TRUE(g.update(w).change);
+  TEST_ASSERT_EQUAL(240, g.mhz());
+  g.follow(80);
+  TEST_ASSERT_EQUAL(80, g.mhz());
+  w = { true, false, 700, 0 };
+  TEST_ASSERT_TRUE(g.update(w).change);
+  TEST_ASSERT_EQUAL(160, g.mhz());
+}
+
+// guard() no actúa hasta que la cola llega a 3/4 desde el corte; cada ventana cuenta lo dormido aparte
+static void test_watch_primes_after_cut_and_accounts_windows()
+{
+  CpuGovernor::Config cfg = CpuGovernor::defaults();
+  cfg.relockMhz = 0;
+  CpuGovernor g;
+  g.begin(cfg, 80);
+  GovernorWatch watch;
+  watch.begin(g, 1000);
+  GovernorWatch::Pass p = { 100, 0, 0, 1000, 200, true, true };
+  GovernorWatch::Step s = watch.pass(p); // Arranque con la cola vacía
+  TEST_ASSERT_FALSE(s.raised);
+  TEST_ASSERT_FALSE(s.window);
+  p.cut = false;
+  p.nowMs = 200;
+  p.level = 750;
+  TEST_ASSERT_FALSE(watch.pass(p).raised);
+  p.nowMs = 300;
+  p.level = CPU_LOW_RING - 1;
+  TEST_ASSERT_TRUE(watch.pass(p).raised);
+  TEST_ASSERT_EQUAL(160, g.mhz());
+
+  p.nowMs = 1300;
+  p.sleptMs = 400;
+  p.level = 750;
+  s = watch.pass(p);
+  TEST_ASSERT_TRUE(s.window);
+  TEST_ASSERT_EQUAL(400, g.sleepMs());
+  TEST_ASSERT_EQUAL(0, g.msAt(0)); // La ventana se cuenta a la frecuencia del final
+  TEST_ASSERT_EQUAL(900, g.msAt(1));
+}
+
+static void test_no_added_underruns()
+{
+  const uint32_t seconds = 20 * 60;
+  CpuGovernor::Config fixed = CpuGovernor::defaults();
+  fixed.freqs[0] = fixed.freqs[fixed.count - 1];
+  fixed.count = 1;
+  CpuGovernor::Config free = CpuGovernor::defaults();
+  free.relockMhz = 0;
+  for (int n = 0; n < 6; n++) {
+    LoadProfile p = loadProfile(n, seconds);
+    GovernorSimResult a = governorSim(p, fixed);
+    GovernorSimResult b = governorSim(p, CpuGovernor::defaults());
+    GovernorSimResult c = governorSim(p, free);
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%s: vaciados %u a 240 fija, %u regulada, %u sin esperar al PLL; %u cambios de PLL sonando",
+             p.name, (unsigned)a.underruns, (unsigned)b.underruns, (unsigned)c.underruns, (unsigned)b.relocksPlaying);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, b.relocksPlaying, msg);
+    // Con la carga más alta del perfil por debajo de lo que da 160 MHz, esperar al corte no cuesta nada
+    uint16_t peak = 0;
+    for (uint16_t l : p.load) peak = l > peak ? l : peak;
+    if ((uint32_t)peak * 240 / 160 < 1000) TEST_ASSERT_TRUE_MESSAGE(b.underruns <= a.underruns, msg);
+    TEST_ASSERT_TRUE_MESSAGE(c.underruns <= a.underruns, msg);
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_stopped_goes_to_lowest_or_top_with_background);
+  RUN_TEST(test_load_above_target_raises_at_once);
+  RUN_TEST(test_slack_lowers_one_step_after_down_windows);
+  RUN_TEST(test_guard_raises_on_low_ring_and_holds);
+  RUN_TEST(test_no_relock_while_playing);
+  RUN_TEST(test_follow_the_applied_frequency);
+  RUN_TEST(test_watch_primes_after_cut_and_accounts_windows);
+  RUN_TEST(test_no_added_underruns);
+  return UNITY_END();
+}
@@ -0,0 +1,161 @@
+/*
+  Pruebas de CrossfadeMixer (pio test -e native)
+  Fuera del fundido solo pasa la entrada activa, sin tocarla; durante el fundido
+  la suma de potencias se mantiene (coseno / seno), la que sale acaba en
+  silencio, una entrada terminada cuenta como silencio y nada se pierde cuando
+  la salida no acepta todo de una vez.
+*/
+
+#include <unity.h>
+#include <math.h>
+#include <vector>
+#include "CrossfadeMixer.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Salida que guarda lo que recibe, como mucho 'room' tramas por llamada
+class CaptureOutput : public AudioOutput
+{
+  public:
+    virtual bool begin() override { return true; }
+    virtual bool ConsumeSample(int16_t sample[2]) override { return ConsumeSamples(sample, 1) == 1; }
+    virtual uint16_t ConsumeSamples(int16_t *samples, uint16_t count) override
+    {
+      if (count > room) count = room;
+      pcm.insert(pcm.end(), samples, samples + 2 * count);
+      return count;
+    }
+    uint32_t frames() const { return pcm.size() / 2; }
+
+    std::vector<int16_t> pcm;
+    uint16_t room = 0xffff;
+};
+
+// Bloque constante: 'l' a la izquierda y 'r' a la derecha
+static std::vector<int16_t> block(int16_t l, int16_t r, uint16_t frames)
+{
+  std::vector<int16_t> pcm(2 * frames);
+  for (uint16_t i = 0; i < frames; i++) {
+    pcm[2 * i] = l;
+    pcm[2 * i + 1] = r;
+  }
+  return pcm;
+}
+
+// Entrega el bloque entero a la entrada; false si se atasca
+static bool feed(CrossfadeMixer &mixer, int i, std::vector<int16_t> &pcm)
+{
+  uint16_t frames = pcm.size() / 2, done = 0;
+  for (int tries = 0; done < frames && tries < 100; tries++) {
+    done += mixer.input(i)->ConsumeSamples(pcm.data() + 2 * done, frames - done);
+    mixer.input(i)->loop();
+  }
+  return done == frames;
+}
+
+static void test_active_input_passes_through()
+{
+  CaptureOutput out;
+  CrossfadeMixer mixer(&out);
+  std::vector<int16_t> a = block(1234, -4321, 500);
+  TEST_ASSERT_EQUAL_UINT16(500, mixer.input(0)->ConsumeSamples(a.data(), 500));
+  TEST_ASSERT_EQUAL_UINT16(0, mixer.input(1)->ConsumeSamples(a.data(), 500));
+  TEST_ASSERT_EQUAL_UINT32(500, out.frames());
+  TEST_ASSERT_TRUE(out.pcm == a);
+  TEST_ASSERT_FALSE(mixer.fading());
+}
+
+// La que sale solo a la izquierda y la que entra solo a la derecha: L^2 + R^2 constante
+static void test_fade_keeps_power_and_ends_on_incoming()
+{
+  const uint32_t len = 4 * CrossfadeMixer::blockFrames;
+  const int16_t amp = 16000;
+  CaptureOutput out;
+  CrossfadeMixer mixer(&out);
+  mixer.start(1, len);
+  TEST_ASSERT_TRUE(mixer.fading());
+  std::vector<int16_t> a = block(amp, 0, 576), b = block(0, amp, 576);
+  while (!mixer.fadeDone()) {
+    TEST_ASSERT_TRUE(feed(mixer, 0, a));
+    TEST_ASSERT_TRUE(feed(mixer, 1, b));
+  }
+  TEST_ASSERT_EQUAL_UINT32(len, out.frames());
+  double worst = 0;
+  for (uint32_t i = 0; i < len; i++) {
+    double l = out.pcm[2 * i] / (double)amp, r = out.pcm[2 * i + 1] / (double)amp;
+    worst = fmax(worst, fabs(l * l + r * r - 1.0));
+    if (i) TEST_ASSERT_TRUE(out.pcm[2 * i] <= out.pcm[2 * i - 2] && out.pcm[2 * i + 1] >= out.pcm[2 * i - 1]);
+  }
+  TEST_ASSERT_TRUE(worst < 0.01);
+  TEST_ASSERT_INT_WITHIN(10, amp, out.pcm[0]);
+  TEST_ASSERT_INT_WITHIN(200, 0, out.pcm[2 * len - 2]);
+  TEST_ASSERT_INT_WITHIN(200, amp, out.pcm[2 * len - 1]);
+
+  mixer.setActive(1);
+  out.pcm.clear();
+  TEST_ASSERT_EQUAL_UINT16(576, mixer.input(1)->ConsumeSamples(b.data(), 576));
+  TEST_ASSERT_TRUE(out.pcm == b);
+}
+
+// La que sale termina pronto: el resto del fundido es la que entra sola, subiendo
+static void test_ended_input_mixes_silence()
+{
+  const uint32_t len = 4 * CrossfadeMixer::blockFrames;
+  CaptureOutput out;
+  CrossfadeMixer mixer(&out);
+  mixer.start(1, len);
+  std::vector<int16_t> a = block(16000, 16000, 576), b = block(16000, 16000, 576);
+  TEST_ASSERT_TRUE(feed(mixer, 0, a));
+  TEST_ASSERT_TRUE(feed(mixer, 1, b));
+  mixer.endInput(0);
+  TEST_ASSERT_TRUE(mixer.ended(0));
+  while (!mixer.fadeDone()) TEST_ASSERT_TRUE(feed(mixer, 1, b));
+  TEST_ASSERT_EQUAL_UINT32(len, out.frames());
+  // Tras la parte de la que sale, solo queda la ganancia de la que entra, siempre creciente
+  for (uint32_t i = 577; i < len; i++) TEST_ASSERT_TRUE(out.pcm[2 * i] >= out.pcm[2 * i - 2]);
+  TEST_ASSERT_TRUE(out.pcm[2 * 577] < 16000 / 2);
+}
+
+// Con una salida que acepta poco cada vez, lo mezclado se entrega entero y en orden
+static void test_backpressure_loses_nothing()
+{
+  const uint32_t len = 2 * CrossfadeMixer::blockFrames;
+  CaptureOutput out;
+  out.room = 100;
+  CrossfadeMixer mixer(&out);
+  mixer.start(1, len);
+  std::vector<int16_t> a = block(8000, 8000, 288), b = block(8000, 8000, 288);
+  for (int rounds = 0; rounds < 1000 && !mixer.fadeDone(); rounds++) {
+    feed(mixer, 0, a);
+    feed(mixer, 1, b);
+  }
+  for (int rounds = 0; rounds < 100; rounds++) mixer.input(1)->loop();
+  TEST_ASSERT_TRUE(mixer.fadeDone());
+  TEST_ASSERT_EQUAL_UINT32(len, out.frames());
+}
+
+static void test_cancel_keeps_outgoing()
+{
+  CaptureOutput out;
+  CrossfadeMixer mixer(&out);
+  mixer.start(1, 10000);
+  std::vector<int16_t> b = block(1, 1, 100);
+  TEST_ASSERT_TRUE(feed(mixer, 1, b));
+  mixer.cancel();
+  TEST_ASSERT_FALSE(mixer.fading());
+  TEST_ASSERT_EQUAL(0, mixer.activeInput());
+  TEST_ASSERT_EQUAL_UINT16(0, mixer.input(1)->ConsumeSamples(b.data(), 100));
+  TEST_ASSERT_EQUAL_UINT32(0, out.frames());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_active_input_passes_through);
+  RUN_TEST(test_fade_keeps_power_and_ends_on_incoming);
+  RUN_TEST(test_ended_input_mixes_silence);
+  RUN_TEST(test_backpressure_loses_nothing);
+  RUN_TEST(test_cancel_keeps_outgoing);
+  return UNITY_END();
+}
@@ -0,0 +1,165 @@
+/*
+  Pruebas del recorte sin huecos (pio test -e native)
+  Sin codificador MP3 en el árbol, cada pista se simula tal como la entrega libmad:
+  la trama Info en silencio, los 529 de la síntesis, el retardo del codificador,
+  el audio y el relleno, en tramas de 1152. Las tramas pasan por
+  AudioGeneratorMP3Block::TrimFrame() con la ventana de gaplessTrim(), igual que en
+  DecodeBlock(), y dos pistas seguidas van a una salida que lo guarda: en la unión
+  no debe quedar ni una muestra de silencio ni perderse una de audio.
+*/
+
+#include <unity.h>
+#include <vector>
+#include "AudioGeneratorMP3Block.h"
+#include "XingHeader.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint32_t spf = 1152;
+
+struct Track {
+  uint16_t delay;   // Retardo del codificador
+  uint32_t samples; // Audio real
+  int16_t base;     // Para distinguir una pista de otra
+  uint32_t frames;  // Tramas de audio (sin la Info)
+  uint16_t padding; // Relleno hasta completar la última trama
+};
+
+// Como LAME: el relleno completa la última trama y deja sitio al retardo de libmad
+static Track track(uint16_t delay, uint32_t samples, int16_t base)
+{
+  Track t = { delay, samples, base, 0, 0 };
+  t.frames = (delay + samples + MP3_DECODER_DELAY + spf - 1) / spf;
+  t.padding = t.frames * spf - delay - samples;
+  return t;
+}
+
+static XingInfo info(const Track &t, bool lame)
+{
+  XingInfo x = {};
+  x.sampleRate = 44100;
+  x.samplesPerFrame = spf;
+  x.hasXing = true;
+  x.frames = t.frames;
+  x.hasLame = lame;
+  x.encoderDelay = t.delay;
+  x.encoderPadding = t.padding;
+  return x;
+}
+
+// Muestra 'i' del audio de la pista (nunca 0)
+static int16_t sample(const Track &t, uint32_t i)
+{
+  return t.base + (int16_t)(i % 1000) + 1;
+}
+
+// Lo que decodifica libmad: Info + retardo de síntesis + retardo del codificador + audio + relleno
+static std::vector<int16_t> decoded(const Track &t)
+{
+  std::vector<int16_t> pcm((t.frames + 1) * spf, 0);
+  uint32_t at = spf + MP3_DECODER_DELAY + t.delay;
+  for (uint32_t i = 0; i < t.samples; i++) pcm[at + i] = sample(t, i);
+  return pcm;
+}
+
+// Salida que guarda el canal izquierdo de lo que recibe
+class CaptureOutput : public AudioOutput
+{
+  public:
+    virtual bool begin() override { return true; }
+    virtual bool ConsumeSample(int16_t s[2]) override { return ConsumeSamples(s, 1) == 1; }
+    virtual uint16_t ConsumeSamples(int16_t *samples, uint16_t count) override
+    {
+      for (uint16_t i = 0; i < count; i++) pcm.push_back(samples[2 * i]);
+      return count;
+    }
+    std::vector<int16_t> pcm;
+};
+
+// El bucle de DecodeBlock(): trama a trama, solo lo que cae en la ventana de recorte
+static void play(const Track &t, const XingInfo &x, bool trim, CaptureOutput &out)
+{
+  uint32_t skip = 0, length = 0;
+  if (trim) gaplessTrim(x, skip, length);
+  const uint32_t end = length ? skip + length : UINT32_MAX;
+  std::vector<int16_t> pcm = decoded(t);
+  int16_t block[2 * spf];
+  for (uint32_t pos = 0; pos < pcm.size() && pos < end; pos += spf) {
+    uint32_t from, to;
+    if (!AudioGeneratorMP3Block::TrimFrame(pos, spf, skip, end, from, to)) continue;
+    for (uint32_t i = from; i < to; i++) block[2 * (i - from)] = block[2 * (i - from) + 1] = pcm[pos + i];
+    out.ConsumeSamples(block, to - from);
+  }
+}
+
+// Silencio más largo en la salida
+static uint32_t longestSilence(const std::vector<int16_t> &pcm)
+{
+  uint32_t run = 0, worst = 0;
+  for (int16_t s : pcm) {
+    run = s ? 0 : run + 1;
+    if (run > worst) worst = run;
+  }
+  return worst;
+}
+
+static void join(const Track &a, const Track &b)
+{
+  CaptureOutput out;
+  play(a, info(a, true), true, out);
+  play(b, info(b, true), true, out);
+  char msg[96];
+  snprintf(msg, sizeof(msg), "retardos %u/%u, audio %u/%u", a.delay, b.delay, (unsigned)a.samples, (unsigned)b.samples);
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(a.samples + b.samples, out.pcm.size(), msg);
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, longestSilence(out.pcm), msg);
+  for (uint32_t i = 0; i < a.samples; i++) TEST_ASSERT_EQUAL_INT16_MESSAGE(sample(a, i), out.pcm[i], msg);
+  for (uint32_t i = 0; i < b.samples; i++) TEST_ASSERT_EQUAL_INT16_MESSAGE(sample(b, i), out.pcm[a.samples + i], msg);
+}
+
+static void test_lame_join_has_no_silence()
+{
+  join(track(576, 44100 * 3, 1000), track(576, 44100 * 2 + 17, -9000));
+}
+
+// Retardo mayor que una trama (ffmpeg) y audio que acaba justo en el borde de una trama
+static void test_long_delay_and_frame_aligned_end()
+{
+  join(track(1105, 10 * spf - 1105 - MP3_DECODER_DELAY, 2000), track(2 * spf + 3, 5000, 3000));
+}
+
+static void test_many_lengths()
+{
+  for (uint32_t n = 1; n < 3 * spf; n += 97) join(track(576, n, 100), track(576, 3 * spf - n + 1, 5000));
+}
+
+// Sin recorte se oyen la trama Info, los dos retardos y el relleno
+static void test_untrimmed_join_is_silent()
+{
+  Track a = track(576, 44100, 1000), b = track(576, 44100, 2000);
+  CaptureOutput out;
+  play(a, info(a, true), false, out);
+  play(b, info(b, true), false, out);
+  TEST_ASSERT_EQUAL_UINT32(a.padding - MP3_DECODER_DELAY + spf + MP3_DECODER_DELAY + b.delay, longestSilence(out.pcm));
+}
+
+// Con Xing pero sin LAME solo se quita la trama Info: no se pierde audio
+static void test_xing_without_lame_keeps_all_audio()
+{
+  Track a = track(576, 44100, 1000);
+  CaptureOutput out;
+  play(a, info(a, false), true, out);
+  TEST_ASSERT_EQUAL_UINT32(a.frames * spf, out.pcm.size());
+  TEST_ASSERT_EQUAL_INT16(sample(a, 0), out.pcm[MP3_DECODER_DELAY + a.delay]);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_lame_join_has_no_silence);
+  RUN_TEST(test_long_delay_and_frame_aligned_end);
+  RUN_TEST(test_many_lengths);
+  RUN_TEST(test_untrimmed_join_is_silent);
+  RUN_TEST(test_xing_without_lame_keeps_all_audio);
+  return UNITY_END();
+}
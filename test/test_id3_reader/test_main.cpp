@@ -0,0 +1,300 @@
+/*
+  Pruebas de Id3Reader (pio test -e native)
+  Etiquetas construidas byte a byte en ficheros de la tarjeta simulada: tramas de
+  ID3v2.2, 2.3 y 2.4, cabecera extendida, UTF-16 con BOM, una carátula (APIC)
+  grande que se salta sin leerla, la ID3v1 del final cuando falta la v2, y
+  etiquetas cortadas o con tamaños de basura, que no deben leer fuera de sus
+  límites ni quedarse dando vueltas.
+*/
+
+#include <unity.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "Id3Reader.h"
+#include "SD.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static std::string root;
+
+void setUp() {}
+void tearDown() {}
+
+static void append(Bytes &b, const void *data, size_t len)
+{
+  b.insert(b.end(), (const uint8_t *)data, (const uint8_t *)data + len);
+}
+
+static void putSyncsafe(Bytes &b, uint32_t v)
+{
+  for (int s = 21; s >= 0; s -= 7) b.push_back((v >> s) & 0x7F);
+}
+
+static void putBigEndian(Bytes &b, uint32_t v)
+{
+  for (int s = 24; s >= 0; s -= 8) b.push_back(v >> s);
+}
+
+// Trama de texto: byte de codificación y el texto tal cual
+static Bytes text(uint8_t enc, const void *data, size_t len)
+{
+  Bytes t(1, enc);
+  append(t, data, len);
+  return t;
+}
+
+static Bytes latin1(const char *s)
+{
+  return text(0, s, strlen(s));
+}
+
+static void frame(Bytes &b, uint8_t major, const char *id, const Bytes &payload)
+{
+  if (major == 2) {
+    append(b, id, 3);
+    for (int s = 16; s >= 0; s -= 8) b.push_back(payload.size() >> s);
+  } else {
+    append(b, id, 4);
+    if (major == 4) putSyncsafe(b, payload.size());
+    else putBigEndian(b, payload.size());
+    b.push_back(0);
+    b.push_back(0);
+  }
+  append(b, payload.data(), payload.size());
+}
+
+// Cabecera ID3v2 delante de 'body' (tramas, y la cabecera extendida si la lleva)
+static Bytes tag(uint8_t major, uint8_t flags, const Bytes &body)
+{
+  Bytes b = { 'I', 'D', '3', major, 0, flags };
+  putSyncsafe(b, body.size());
+  append(b, body.data(), body.size());
+  return b;
+}
+
+// Una trama MPEG muda detrás de la etiqueta, como en un fichero de verdad
+static void writeFile(const char *name, const Bytes &data)
+{
+  File f = SD.open(name, FILE_WRITE);
+  TEST_ASSERT_TRUE(f);
+  if (!data.empty()) f.write(data.data(), data.size());
+  uint8_t mpeg[417] = { 0xFF, 0xFB, 0x90, 0x64 };
+  f.write(mpeg, sizeof(mpeg));
+  f.close();
+}
+
+static bool read(const char *name, Id3Tags &tags)
+{
+  File f = SD.open(name);
+  TEST_ASSERT_TRUE(f);
+  bool found = readId3(f, tags);
+  f.close();
+  TEST_ASSERT_TRUE(strlen(tags.title) < ID3_TEXT_MAX);
+  TEST_ASSERT_TRUE(strlen(tags.artist) < ID3_TEXT_MAX);
+  TEST_ASSERT_TRUE(strlen(tags.album) < ID3_TEXT_MAX);
+  return found;
+}
+
+static void test_v22_frames()
+{
+  Bytes body;
+  frame(body, 2, "TT2", latin1("Canci\xF3n"));
+  frame(body, 2, "TP1", latin1("Sidonie  "));
+  frame(body, 2, "TAL", latin1("El Peor Grupo del Mundo"));
+  frame(body, 2, "TLE", latin1("215000"));
+  writeFile("/v22.mp3", tag(2, 0, body));
+  Id3Tags t;
+  TEST_ASSERT_TRUE(read("/v22.mp3", t));
+  TEST_ASSERT_EQUAL_STRING("Canción", t.title);
+  TEST_ASSERT_EQUAL_STRING("Sidonie", t.artist);
+  TEST_ASSERT_EQUAL_STRING("El Peor Grupo del Mundo", t.album);
+  TEST_ASSERT_EQUAL_UINT32(215000, t.lengthMs);
+}
+
+// v2.3: la cabecera extendida no cuenta sus 4 bytes de tamaño
+static void test_v23_frames_after_extended_header()
+{
+  Bytes body;
+  putBigEndian(body, 6);
+  Bytes ext = { 0, 0, 0, 0, 0, 0 };
+  append(body, ext.data(), ext.size());
+  frame(body, 3, "TPE1", latin1("Izal"));
+  frame(body, 3, "TIT2", text(3, "Copacabana", 10));
+  frame(body, 3, "TALB", latin1("Autoterapia"));
+  writeFile("/v23.mp3", tag(3, 0x40, body));
+  Id3Tags t;
+  TEST_ASSERT_TRUE(read("/v23.mp3", t));
+  TEST_ASSERT_EQUAL_STRING("Copacabana", t.title);
+  TEST_ASSERT_EQUAL_STRING("Izal", t.artist);
+  TEST_ASSERT_EQUAL_STRING("Autoterapia", t.album);
+}
+
+// v2.4: tamaños syncsafe (una trama de más de 127 bytes delante) y la cabecera
+// extendida los cuenta
+static void test_v24_syncsafe_sizes_and_extended_header()
+{
+  Bytes body;
+  putSyncsafe(body, 6);
+  body.push_back(1);
+  body.push_back(0);
+  frame(body, 4, "PRIV", Bytes(300, 0x7F));
+  frame(body, 4, "TIT2", text(3, "Mar\xC3\xAD" "a", 6));
+  frame(body, 4, "TPE1", latin1("Rosal\xED" "a"));
+  writeFile("/v24.mp3", tag(4, 0x40, body));
+  Id3Tags t;
+  TEST_ASSERT_TRUE(read("/v24.mp3", t));
+  TEST_ASSERT_EQUAL_STRING("María", t.title);
+  TEST_ASSERT_EQUAL_STRING("Rosalía", t.artist);
+  TEST_ASSERT_EQUAL_STRING("", t.album);
+}
+
+static void test_utf16_with_bom()
+{
+  const uint8_t le[] = { 0xFF, 0xFE, 0xD1, 0, 'a', 0, 'n', 0, 'd', 0, 0xFA, 0, 0, 0 };
+  const uint8_t be[] = { 0xFE, 0xFF, 0, 'L', 0, 'u', 0x20, 0xAC, 0xD8, 0x3D, 0xDE, 0x00 };
+  Bytes body;
+  frame(body, 3, "TIT2", text(1, le, sizeof(le)));
+  frame(body, 3, "TPE1", text(1, be, sizeof(be)));
+  writeFile("/utf16.mp3", tag(3, 0, body));
+  Id3Tags t;
+  TEST_ASSERT_TRUE(read("/utf16.mp3", t));
+  TEST_ASSERT_EQUAL_STRING("Ñandú", t.title);
+  TEST_ASSERT_EQUAL_STRING("Lu€??", t.artist); // Cada mitad de un par sustituto queda como '?'
+}
+
+// La carátula de 200 KB no se lee: solo las cabeceras de trama y los campos de texto
+static void test_large_apic_is_skipped()
+{
+  Bytes body;
+  frame(body, 3, "TPE1", latin1("Vetusta Morla"));
+  Bytes apic = text(0, "image/jpeg\0\3\0", 13);
+  apic.resize(200 * 1024, 0xAB);
+  frame(body, 3, "APIC", apic);
+  frame(body, 3, "TIT2", latin1("Copenhague"));
+  frame(body, 3, "TALB", latin1("Un D\xED" "a en el Mundo"));
+  frame(body, 3, "TLEN", latin1("262000"));
+  writeFile("/apic.mp3", tag(3, 0, body));
+  SD.stats.bytes = 0;
+  Id3Tags t;
+  TEST_ASSERT_TRUE(read("/apic.mp3", t));
+  TEST_ASSERT_EQUAL_STRING("Copenhague", t.title);
+  TEST_ASSERT_EQUAL_STRING("Un Día en el Mundo", t.album);
+  TEST_ASSERT_EQUAL_UINT32(262000, t.lengthMs);
+  TEST_ASSERT_TRUE(SD.stats.bytes < 1024);
+}
+
+// Sin ID3v2, o con campos que faltan, se completa con la ID3v1 del final
+static void test_v1_fallback()
+{
+  Bytes v1(128, 0);
+  memcpy(v1.data(), "TAG", 3);
+  memcpy(v1.data() + 3, "Entre Dos Tierras             ", 30);
+  memcpy(v1.data() + 33, "H\xE9roes del Silencio", 19);
+  memcpy(v1.data() + 63, "Senderos de Traici\xF3n", 20);
+
+  File f = SD.open("/v1.mp3", FILE_WRITE);
+  uint8_t mpeg[417] = { 0xFF, 0xFB, 0x90, 0x64 };
+  f.write(mpeg, sizeof(mpeg));
+  f.write(v1.data(), v1.size());
+  f.close();
+  Id3Tags t;
+  TEST_ASSERT_TRUE(read("/v1.mp3", t));
+  TEST_ASSERT_EQUAL_STRING("Entre Dos Tierras", t.title);
+  TEST_ASSERT_EQUAL_STRING("Héroes del Silencio", t.artist);
+  TEST_ASSERT_EQUAL_STRING("Senderos de Traición", t.album);
+
+  // La v2 manda en lo que tiene
+  Bytes body;
+  frame(body, 3, "TIT2", latin1("Maldito Duende"));
+  Bytes both = tag(3, 0, body);
+  both.insert(both.end(), mpeg, mpeg + sizeof(mpeg));
+  append(both, v1.data(), v1.size());
+  f = SD.open("/v1v2.mp3", FILE_WRITE);
+  f.write(both.data(), both.size());
+  f.close();
+  TEST_ASSERT_TRUE(read("/v1v2.mp3", t));
+  TEST_ASSERT_EQUAL_STRING("Maldito Duende", t.title);
+  TEST_ASSERT_EQUAL_STRING("Héroes del Silencio", t.artist);
+
+  writeFile("/none.mp3", Bytes());
+  TEST_ASSERT_FALSE(read("/none.mp3", t));
+  TEST_ASSERT_EQUAL_STRING("", t.title);
+}
+
+static void test_truncated_and_garbage_tags_stay_in_bounds()
+{
+  Id3Tags t;
+
+  // La cabecera promete 100 KB y el fichero acaba a mitad de la primera trama
+  Bytes body;
+  frame(body, 3, "TIT2", latin1("Cortada"));
+  Bytes cut = tag(3, 0, body);
+  cut[6] = 0;
+  cut[7] = 6;
+  cut[8] = 32;
+  cut[9] = 0;
+  cut.resize(14);
+  File f = SD.open("/cut.mp3", FILE_WRITE);
+  f.write(cut.data(), cut.size());
+  f.close();
+  read("/cut.mp3", t);
+  TEST_ASSERT_EQUAL_STRING("", t.title);
+
+  // Tamaños que darían la vuelta a la posición (v2.3) o a la cabecera extendida
+  body.clear();
+  append(body, "XXXX\xFF\xFF\xFF\xF0\0\0", 10);
+  frame(body, 3, "TIT2", latin1("Vuelta"));
+  writeFile("/wrap.mp3", tag(3, 0, body));
+  read("/wrap.mp3", t);
+  TEST_ASSERT_EQUAL_STRING("", t.title);
+  body.clear();
+  putBigEndian(body, 0xFFFFFFFF);
+  frame(body, 3, "TIT2", latin1("Extendida"));
+  writeFile("/ext.mp3", tag(3, 0x40, body));
+  read("/ext.mp3", t);
+  TEST_ASSERT_EQUAL_STRING("", t.title);
+
+  // Un título mucho más largo que el campo se corta sin partir caracteres UTF-8
+  std::string longTitle;
+  for (int i = 0; i < 1000; i++) longTitle += "\xC3\xB1";
+  body.clear();
+  frame(body, 4, "TIT2", text(3, longTitle.data(), longTitle.size()));
+  writeFile("/long.mp3", tag(4, 0, body));
+  read("/long.mp3", t);
+  TEST_ASSERT_EQUAL_UINT32(ID3_TEXT_MAX - 2, strlen(t.title));
+  TEST_ASSERT_EQUAL_STRING("\xC3\xB1", t.title + ID3_TEXT_MAX - 4);
+
+  // Basura al azar detrás de una cabecera válida: termina y los campos quedan acotados
+  srand(1234);
+  for (int n = 0; n < 500; n++) {
+    Bytes junk(16 + rand() % 600);
+    for (uint8_t &b : junk) b = rand() % 4 ? rand() : 0xFF;
+    if (n % 2) memcpy(junk.data() + rand() % 10, "TIT2", 4);
+    writeFile("/junk.mp3", tag(2 + n % 3, n % 5 ? 0 : 0x40, junk));
+    read("/junk.mp3", t);
+  }
+}
+
+int main()
+{
+  char dir[] = "/tmp/id3XXXXXX";
+  if (!mkdtemp(dir)) return 1;
+  root = dir;
+  SD.setRoot(dir);
+  UNITY_BEGIN();
+  RUN_TEST(test_v22_frames);
+  RUN_TEST(test_v23_frames_after_extended_header);
+  RUN_TEST(test_v24_syncsafe_sizes_and_extended_header);
+  RUN_TEST(test_utf16_with_bom);
+  RUN_TEST(test_large_apic_is_skipped);
+  RUN_TEST(test_v1_fallback);
+  RUN_TEST(test_truncated_and_garbage_tags_stay_in_bounds);
+  int failures = UNITY_END();
+  const char *names[] = { "/v22.mp3", "/v23.mp3", "/v24.mp3", "/utf16.mp3", "/apic.mp3", "/v1.mp3", "/v1v2.mp3",
+                          "/none.mp3", "/cut.mp3", "/wrap.mp3", "/ext.mp3", "/long.mp3", "/junk.mp3" };
+  for (const char *n : names) SD.remove(n);
+  rmdir(root.c_str());
+  return failures;
+}
@@ -0,0 +1,79 @@
+/*
+  Pruebas de AudioOutputLoudness (pio test -e native)
+  Señales de EBU Tech 3341 a 44.1 y 48 kHz: seno de 1 kHz a -23 dBFS, y con
+  tramos a -36 y -72 dBFS que tienen que quedar fuera por las puertas. Todas
+  tienen que dar -23 +/- 0.1 LUFS.
+*/
+
+#include <unity.h>
+#include <math.h>
+#include <utility>
+#include <vector>
+#include "AudioOutputLoudness.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Seno estéreo de 1 kHz por tramos de (segundos, dBFS) en el medidor
+static float loudnessOf(AudioOutputLoudness &meter, uint32_t rate, const std::vector<std::pair<double, double>> &parts)
+{
+  meter.SetRate(rate);
+  meter.SetChannels(2);
+  meter.reset();
+  std::vector<int16_t> pcm(2 * 1152);
+  uint64_t n = 0;
+  for (const auto &p : parts) {
+    double amp = 32767.0 * pow(10.0, p.second / 20.0);
+    uint64_t frames = (uint64_t)(p.first * rate);
+    while (frames) {
+      uint16_t k = frames < 1152 ? frames : 1152;
+      for (uint16_t i = 0; i < k; i++, n++) {
+        int16_t v = (int16_t)lrint(amp * sin(2.0 * M_PI * 1000.0 * n / rate));
+        pcm[2 * i] = pcm[2 * i + 1] = v;
+      }
+      meter.ConsumeSamples(pcm.data(), k);
+      frames -= k;
+    }
+  }
+  return meter.loudness();
+}
+
+static void checkRate(uint32_t rate)
+{
+  static AudioOutputLoudness meter;
+  struct Case {
+    const char *name;
+    std::vector<std::pair<double, double>> parts;
+  };
+  const Case cases[] = {
+    { "-23 dBFS 20 s", { { 20, -23 } } },
+    { "-36/-23/-36 dBFS", { { 10, -36 }, { 60, -23 }, { 10, -36 } } },
+    { "-72/-36/-23/-36/-72 dBFS", { { 10, -72 }, { 10, -36 }, { 60, -23 }, { 10, -36 }, { 10, -72 } } },
+  };
+  for (const Case &c : cases) {
+    float lufs = loudnessOf(meter, rate, c.parts);
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%u Hz %s: %.2f LUFS", (unsigned)rate, c.name, lufs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_FLOAT_WITHIN_MESSAGE(0.1f, -23.0f, lufs, msg);
+  }
+  TEST_ASSERT_EQUAL_UINT32(rate, meter.sampleRate());
+}
+
+static void test_ebu_3341_at_44100()
+{
+  checkRate(44100);
+}
+
+static void test_ebu_3341_at_48000()
+{
+  checkRate(48000);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_ebu_3341_at_44100);
+  RUN_TEST(test_ebu_3341_at_48000);
+  return UNITY_END();
+}
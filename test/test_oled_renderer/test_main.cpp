@@ -0,0 +1,162 @@
+/*
+  Pruebas de OledRenderer (pio test -e native)
+  Con la pantalla de 128x32 y el Wire de bench/host, que guarda cada transmisión:
+  la primera vez van los 512 bytes, sin cambios no se envía nada, un cambio
+  pequeño manda solo sus columnas, los tramos no pasan de RENDER_CHUNK, con
+  presupuesto 0 sale un tramo por llamada y cada paso de la marquesina solo toca
+  su página.
+*/
+
+#include <unity.h>
+#include "OledRenderer.h"
+
+static Adafruit_SSD1306 display(128, 32, &Wire);
+static OledRenderer *renderer;
+
+// Lo enviado desde la última llamada: bytes de datos y páginas tocadas (bit por página)
+struct Sent {
+  uint32_t data;
+  uint32_t spans;
+  uint8_t pages;
+};
+
+static Sent sent()
+{
+  Sent s = { 0, 0, 0 };
+  for (const TwoWire::Transmission &t : Wire.log) {
+    TEST_ASSERT_EQUAL_UINT8(0x3C, t.address);
+    if (t.bytes[0] == 0x00) {
+      // Ventana: página y columnas
+      TEST_ASSERT_EQUAL_UINT8(SSD1306_PAGEADDR, t.bytes[1]);
+      s.pages |= 1 << t.bytes[2];
+      s.spans++;
+    } else {
+      TEST_ASSERT_EQUAL_UINT8(0x40, t.bytes[0]);
+      s.data += t.bytes.size() - 1;
+    }
+  }
+  Wire.log.clear();
+  return s;
+}
+
+// Envía todo lo pendiente
+static Sent flush()
+{
+  while (renderer->service(1000000)) {}
+  return sent();
+}
+
+void setUp()
+{
+  hostManualClock(true);
+  TEST_ASSERT_TRUE(display.begin(SSD1306_SWITCHCAPVCC, 0x3C));
+  renderer = new OledRenderer(display, Wire, 0x3C);
+  TEST_ASSERT_TRUE(renderer->begin());
+}
+
+void tearDown()
+{
+  delete renderer;
+  Wire.log.clear();
+}
+
+static void test_first_update_sends_whole_screen()
+{
+  Sent s = flush();
+  TEST_ASSERT_EQUAL_UINT32(512, s.data);
+  TEST_ASSERT_EQUAL_UINT32(512, renderer->stats.bytes);
+  TEST_ASSERT_EQUAL_UINT32(4 * 128 / RENDER_CHUNK, s.spans);
+  TEST_ASSERT_EQUAL_UINT8(0x0F, s.pages);
+}
+
+static void test_no_change_sends_nothing()
+{
+  flush();
+  TEST_ASSERT_FALSE(renderer->service(1000000));
+  TEST_ASSERT_TRUE(Wire.log.empty());
+}
+
+// Un píxel: una ventana de una columna y un byte de datos
+static void test_small_change_sends_only_its_columns()
+{
+  flush();
+  display.drawPixel(70, 20, SSD1306_WHITE);
+  Sent s = flush();
+  TEST_ASSERT_EQUAL_UINT32(1, s.data);
+  TEST_ASSERT_EQUAL_UINT32(1, s.spans);
+  TEST_ASSERT_EQUAL_UINT8(1 << 2, s.pages);
+
+  // Dos píxeles separados en la misma página van en un tramo si caben en RENDER_CHUNK
+  display.drawPixel(10, 0, SSD1306_WHITE);
+  display.drawPixel(10 + RENDER_CHUNK - 1, 0, SSD1306_WHITE);
+  s = flush();
+  TEST_ASSERT_EQUAL_UINT32(RENDER_CHUNK, s.data);
+  TEST_ASSERT_EQUAL_UINT32(1, s.spans);
+}
+
+static void test_spans_are_split_at_chunk()
+{
+  flush();
+  display.fillRect(0, 8, 2 * RENDER_CHUNK + 5, 8, SSD1306_WHITE);
+  Sent s = flush();
+  TEST_ASSERT_EQUAL_UINT32(2 * RENDER_CHUNK + 5, s.data);
+  TEST_ASSERT_EQUAL_UINT32(3, s.spans);
+  TEST_ASSERT_EQUAL_UINT8(1 << 1, s.pages);
+}
+
+// Sin presupuesto sale un tramo por llamada y el resto queda para las siguientes
+static void test_zero_budget_sends_one_span()
+{
+  TEST_ASSERT_TRUE(renderer->service(0));
+  Sent s = sent();
+  TEST_ASSERT_EQUAL_UINT32(1, s.spans);
+  TEST_ASSERT_EQUAL_UINT32(RENDER_CHUNK, s.data);
+  uint32_t calls = 1;
+  while (renderer->service(0)) calls++;
+  calls++;
+  TEST_ASSERT_EQUAL_UINT32(4 * 128 / RENDER_CHUNK, calls);
+  TEST_ASSERT_EQUAL_UINT32(512, renderer->stats.bytes);
+}
+
+// Cada paso de la marquesina cambia solo la fila de texto (página 1)
+static void test_marquee_step_touches_only_its_page()
+{
+  renderer->setMarquee(8, "Un titulo demasiado largo para caber en la pantalla");
+  TEST_ASSERT_TRUE(renderer->animating());
+  flush();
+  hostAdvanceMs(MARQUEE_HOLD_MS - 1);
+  TEST_ASSERT_FALSE(renderer->service(1000000));
+  TEST_ASSERT_TRUE(Wire.log.empty());
+  for (int step = 0; step < 20; step++) {
+    hostAdvanceMs(step ? MARQUEE_STEP_MS : 1);
+    Sent s = flush();
+    TEST_ASSERT_TRUE(s.data > 0);
+    TEST_ASSERT_TRUE(s.data <= 128);
+    TEST_ASSERT_EQUAL_UINT8(1 << 1, s.pages);
+  }
+  // Entre pasos no se envía nada
+  hostAdvanceMs(MARQUEE_STEP_MS - 1);
+  TEST_ASSERT_TRUE(flush().data == 0);
+}
+
+static void test_short_marquee_does_not_move()
+{
+  renderer->setMarquee(8, "Corto");
+  TEST_ASSERT_FALSE(renderer->animating());
+  flush();
+  hostAdvanceMs(10000);
+  TEST_ASSERT_EQUAL_UINT32(0, flush().data);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_update_sends_whole_screen);
+  RUN_TEST(test_no_change_sends_nothing);
+  RUN_TEST(test_small_change_sends_only_its_columns);
+  RUN_TEST(test_spans_are_split_at_chunk);
+  RUN_TEST(test_zero_budget_sends_one_span);
+  RUN_TEST(test_marquee_step_touches_only_its_page);
+  RUN_TEST(test_short_marquee_does_not_move);
+  return UNITY_END();
+}
@@ -0,0 +1,62 @@
+/*
+  Pruebas de PathPool (pio test -e native)
+  Con 1000 y 10000 rutas añadidas en el orden del directorio, el pool ordenado
+  queda en orden alfabético por bytes y find() encuentra cada ruta.
+*/
+
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "PathPool.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void checkPool(uint32_t count)
+{
+  const char *artists[] = { "Los Planetas", "Vetusta Morla", "Rosalía", "Extremoduro", "Love of Lesbian",
+                            "Héroes del Silencio", "Sidonie", "Izal" };
+  std::vector<std::string> paths;
+  size_t textBytes = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    char name[128];
+    snprintf(name, sizeof(name), "/playlist/Canción %05u_%s.mp3", (unsigned)((i * 7919u) % count), artists[i % 8]);
+    paths.push_back(name);
+    textBytes += paths.back().size() + 1;
+  }
+
+  PathPool pool;
+  TEST_ASSERT_TRUE(pool.begin(textBytes, count, "/playlist"));
+  for (const std::string &p : paths) TEST_ASSERT_TRUE(pool.add(p.c_str()) >= 0);
+  pool.shrink();
+  pool.sort();
+  TEST_ASSERT_EQUAL_UINT32(count, pool.count());
+  for (const std::string &p : paths) {
+    int32_t i = pool.find(p.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(i >= 0, p.c_str());
+    TEST_ASSERT_EQUAL_STRING(p.c_str() + strlen("/playlist/"), pool.name(i));
+    char full[160];
+    pool.path(i, full, sizeof(full));
+    TEST_ASSERT_EQUAL_STRING(p.c_str(), full);
+  }
+  for (uint32_t i = 1; i < pool.count(); i++) TEST_ASSERT_TRUE(strcmp(pool.name(i - 1), pool.name(i)) < 0);
+  TEST_ASSERT_EQUAL_INT(-1, pool.find("/playlist/no está.mp3"));
+}
+
+static void test_sorted_pool_finds_every_path_1000()
+{
+  checkPool(1000);
+}
+
+static void test_sorted_pool_finds_every_path_10000()
+{
+  checkPool(10000);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_sorted_pool_finds_every_path_1000);
+  RUN_TEST(test_sorted_pool_finds_every_path_10000);
+  return UNITY_END();
+}
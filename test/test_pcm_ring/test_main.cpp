@@ -0,0 +1,196 @@
+/*
+  Pruebas de PcmRing (pio test -e native)
+  Un hilo productor y uno consumidor, como la tarea de decodificación y la de
+  salida: cada trama lleva su número de orden y el consumidor comprueba que
+  llegan todas, en orden y sin tramas rotas, con bloques de tamaños al azar,
+  con write()/read() y con writePtr()/readPtr(), y con el consumidor cambiando
+  el límite de llenado a la vez. Y que AudioOutputRing cambia el formato de la
+  salida real justo en la trama en que cambia, no antes.
+*/
+
+#include <unity.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "AudioOutputRing.h"
+#include "PcmRing.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint32_t total = 4000000; // Tramas por prueba
+
+// Trama 'n': la izquierda es el número de orden y la derecha su complemento
+static inline void frame(int16_t *p, uint32_t n)
+{
+  p[0] = (int16_t)n;
+  p[1] = (int16_t)~n;
+}
+
+static void producer(PcmRing &ring, bool zeroCopy, uint32_t seed)
+{
+  int16_t block[2 * 1152];
+  uint32_t n = 0;
+  while (n < total) {
+    seed = seed * 1103515245u + 12345u;
+    uint32_t want = 1 + (seed >> 16) % 1152;
+    if (want > total - n) want = total - n;
+    if (zeroCopy) {
+      uint32_t room;
+      int16_t *dst = ring.writePtr(room);
+      if (room > want) room = want;
+      for (uint32_t i = 0; i < room; i++) frame(dst + 2 * i, n + i);
+      ring.commit(room);
+      n += room;
+      if (!room) std::this_thread::yield();
+    } else {
+      for (uint32_t i = 0; i < want; i++) frame(block + 2 * i, n + i);
+      uint32_t done = 0;
+      while (done < want) {
+        uint32_t k = ring.write(block + 2 * done, want - done);
+        if (!k) std::this_thread::yield();
+        done += k;
+      }
+      n += want;
+    }
+  }
+}
+
+// Lee todo lo que escribe el productor; devuelve las tramas fuera de orden o rotas
+static uint32_t consumer(PcmRing &ring, bool zeroCopy, bool changeLimit, uint32_t seed)
+{
+  int16_t block[2 * 256];
+  uint32_t n = 0, errors = 0;
+  while (n < total) {
+    seed = seed * 1103515245u + 12345u;
+    if (changeLimit && (seed >> 28) == 0) ring.setLimit(64 << ((seed >> 16) % 6));
+    uint32_t got;
+    const int16_t *src;
+    if (zeroCopy) {
+      src = ring.readPtr(got);
+      if (got > 256) got = 256;
+    } else {
+      got = ring.read(block, 1 + (seed >> 16) % 256);
+      src = block;
+    }
+    for (uint32_t i = 0; i < got; i++, n++) {
+      if (src[2 * i] != (int16_t)n || src[2 * i + 1] != (int16_t)~n) errors++;
+    }
+    if (zeroCopy) ring.consume(got);
+    if (ring.available() > ring.capacity()) errors++;
+    if (!got) std::this_thread::yield();
+  }
+  return errors;
+}
+
+static void stress(bool zeroCopy, bool changeLimit)
+{
+  static int16_t storage[2 * 2048];
+  PcmRing ring(storage, 2048);
+  std::thread p(producer, std::ref(ring), zeroCopy, 1u);
+  uint32_t errors = consumer(ring, zeroCopy, changeLimit, 7u);
+  p.join();
+  TEST_ASSERT_EQUAL_UINT32(0, errors);
+  TEST_ASSERT_EQUAL_UINT32(0, ring.available());
+}
+
+static void test_copy_threads()
+{
+  stress(false, false);
+}
+
+static void test_zero_copy_threads()
+{
+  stress(true, false);
+}
+
+static void test_limit_changes_while_running()
+{
+  stress(true, true);
+}
+
+// Cambio de tamaño con el productor parado: lo pendiente se conserva en orden
+static void test_resize_keeps_pending()
+{
+  static int16_t small[2 * 1024], big[2 * 4096];
+  PcmRing ring(small, 1024);
+  int16_t f[2];
+  // Da la vuelta a la cola pequeña antes de pasarla a la grande
+  for (uint32_t n = 0; n < 1500; n++) {
+    if (ring.available() == 900) ring.read(f, 1);
+    frame(f, n);
+    ring.write(f, 1);
+  }
+  TEST_ASSERT_TRUE(ring.resize(big, 4096) == small);
+  TEST_ASSERT_EQUAL_UINT32(4096, ring.capacity());
+  TEST_ASSERT_EQUAL_UINT32(900, ring.available());
+  for (uint32_t n = 600; n < 1500; n++) {
+    TEST_ASSERT_EQUAL_UINT32(1, ring.read(f, 1));
+    TEST_ASSERT_EQUAL_INT16((int16_t)n, f[0]);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, ring.available());
+}
+
+// Salida que apunta la frecuencia de cada trama que recibe
+class RateLog : public AudioOutput
+{
+  public:
+    std::vector<int> rates;
+    uint32_t room = UINT32_MAX; // Tramas que caben (el DMA)
+
+    virtual bool SetRate(int hz) override { hertz = hz; return true; }
+    virtual bool begin() override { return true; }
+    virtual bool ConsumeSample(int16_t sample[2]) override
+    {
+      (void)sample;
+      if (!room) return false;
+      room--;
+      rates.push_back(hertz);
+      return true;
+    }
+};
+
+// El final de una pista a 44.1 kHz que sigue en cola suena a 44.1 aunque la siguiente ya sea de 48
+static void test_format_change_waits_for_its_frame()
+{
+  static int16_t storage[2 * 1024];
+  PcmRing ring(storage, 1024);
+  RateLog sink;
+  AudioOutputRing out(&ring, &sink);
+  int16_t block[2 * 300] = {};
+  out.begin();
+  out.SetRate(44100);
+  TEST_ASSERT_EQUAL_UINT16(300, out.ConsumeSamples(block, 300));
+  sink.room = 100;
+  TEST_ASSERT_EQUAL_UINT32(100, out.drain());
+  out.SetRate(48000);
+  out.SetChannels(2);
+  TEST_ASSERT_EQUAL_UINT16(300, out.ConsumeSamples(block, 300));
+  TEST_ASSERT_EQUAL_UINT16(300, out.ConsumeSamples(block, 300)); // Sin cambios: sin marca
+  sink.room = UINT32_MAX;
+  TEST_ASSERT_EQUAL_UINT32(800, out.drain());
+  TEST_ASSERT_EQUAL_UINT32(900, sink.rates.size());
+  for (uint32_t i = 0; i < 900; i++) TEST_ASSERT_EQUAL_INT(i < 300 ? 44100 : 48000, sink.rates[i]);
+
+  // Lo descartado no retrasa el cambio: vale desde la primera trama que queda
+  out.SetRate(44100);
+  TEST_ASSERT_EQUAL_UINT16(300, out.ConsumeSamples(block, 300));
+  out.discard();
+  out.SetRate(32000);
+  TEST_ASSERT_EQUAL_UINT16(10, out.ConsumeSamples(block, 10));
+  TEST_ASSERT_EQUAL_UINT32(10, out.drain());
+  TEST_ASSERT_EQUAL_INT(32000, sink.rates.back());
+  TEST_ASSERT_TRUE(out.takeCut());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_copy_threads);
+  RUN_TEST(test_zero_copy_threads);
+  RUN_TEST(test_limit_changes_while_running);
+  RUN_TEST(test_resize_keeps_pending);
+  RUN_TEST(test_format_change_waits_for_its_frame);
+  return UNITY_END();
+}
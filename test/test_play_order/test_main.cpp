@@ -0,0 +1,132 @@
+/*
+  Pruebas de PlayOrder (pio test -e native)
+  Cada ciclo del aleatorio recorre todas las pistas una vez, sin repetir en el
+  cambio de ciclo, adelante y atrás dan la misma secuencia y positionOf()
+  deshace trackAt(). La uniformidad se mide con chi cuadrado de pista por
+  posición y de parejas consecutivas sobre muchas semillas.
+*/
+
+#include <unity.h>
+#include <math.h>
+#include <vector>
+#include "PlayOrder.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Recorre 3 ciclos hacia delante y los deshace hacia atrás
+static void checkCycles(uint32_t n, uint32_t seed)
+{
+  char msg[64];
+  snprintf(msg, sizeof(msg), "%u pistas, semilla %08x", (unsigned)n, (unsigned)seed);
+  PlayOrder order;
+  order.setCount(n);
+  order.jumpTo(n / 3);
+  order.setShuffle(true, seed);
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(n / 3, order.current(), msg); // El ciclo nuevo empieza en la pista actual
+
+  std::vector<uint32_t> seq;
+  seq.push_back(order.current());
+  for (uint32_t i = 0; i < 3 * n; i++) seq.push_back(order.step(1));
+  for (uint32_t c = 0; c < 3; c++) {
+    std::vector<bool> seen(n);
+    for (uint32_t i = c * n; i < (c + 1) * n; i++) {
+      TEST_ASSERT_TRUE_MESSAGE(seq[i] < n && !seen[seq[i]], msg);
+      seen[seq[i]] = true;
+    }
+  }
+  for (size_t i = 1; i < seq.size() && n > 1; i++) TEST_ASSERT_TRUE_MESSAGE(seq[i] != seq[i - 1], msg);
+  for (size_t i = seq.size() - 1; i > 0; i--) TEST_ASSERT_EQUAL_UINT32_MESSAGE(seq[i - 1], order.step(-1), msg);
+
+  // Hacia atrás desde el principio y vuelta
+  std::vector<uint32_t> back;
+  for (uint32_t i = 0; i < n + 2; i++) back.push_back(order.step(-1));
+  for (size_t i = back.size() - 1; i > 0; i--) TEST_ASSERT_EQUAL_UINT32_MESSAGE(back[i - 1], order.step(1), msg);
+
+  for (int32_t c = -2; c <= 2; c++) {
+    for (uint32_t p = 0; p < n; p += 1 + n / 64) {
+      TEST_ASSERT_EQUAL_UINT32_MESSAGE(p, order.positionOf(c, order.trackAt(c, p)), msg);
+    }
+  }
+}
+
+static void test_cycles_complete_without_repeats()
+{
+  const uint32_t sizes[] = { 1, 2, 3, 5, 17, 64, 1000, 20000 };
+  for (uint32_t n : sizes) {
+    checkCycles(n, 1);
+    checkCycles(n, 0xdeadbeef);
+  }
+}
+
+// Chi cuadrado de una tabla de cuentas con la misma esperanza en cada celda
+static double chiSquare(const std::vector<uint32_t> &counts, double expected)
+{
+  double chi = 0;
+  for (uint32_t c : counts) chi += (c - expected) * (c - expected) / expected;
+  return chi;
+}
+
+// Con el aleatorio activado en la pista 0, el ciclo 1 es una permutación completa. Sus
+// dos primeras posiciones se corrigen para no repetir la última del ciclo 0, así que
+// se mide desde la tercera.
+static void test_shuffle_is_uniform()
+{
+  const uint32_t n = 16, seeds = 160000, first = 2;
+  std::vector<uint32_t> byPos((n - first) * n), pairs;
+  std::vector<uint32_t> pairCount(n * n);
+  PlayOrder order;
+  order.setCount(n);
+  for (uint32_t s = 0; s < seeds; s++) {
+    order.setShuffle(true, s * 2654435761u + 1);
+    uint32_t prev = 0;
+    for (uint32_t p = first; p < n; p++) {
+      uint32_t t = order.trackAt(1, p);
+      byPos[(p - first) * n + t]++;
+      if (p > first) pairCount[prev * n + t]++;
+      prev = t;
+    }
+  }
+  for (uint32_t a = 0; a < n; a++) {
+    for (uint32_t b = 0; b < n; b++) {
+      if (a != b) pairs.push_back(pairCount[a * n + b]); // Una pista no sigue a sí misma
+    }
+  }
+  double dofPos = (n - first) * (n - 1);
+  double dofPairs = n * (n - 1) - 1;
+  double chiPos = chiSquare(byPos, (double)seeds / n);
+  double chiPairs = chiSquare(pairs, (double)seeds * (n - first - 1) / (n * (n - 1)));
+  // Límite holgado: media + 6 desviaciones (la desviación es sqrt(2 * grados))
+  char msg[128];
+  snprintf(msg, sizeof(msg), "pista por posición %.0f (%.0f grados), parejas %.0f (%.0f grados)", chiPos, dofPos,
+           chiPairs, dofPairs);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE_MESSAGE(chiPos < dofPos + 6 * sqrt(2 * dofPos), msg);
+  TEST_ASSERT_TRUE_MESSAGE(chiPairs < dofPairs + 6 * sqrt(2 * dofPairs), msg);
+}
+
+// Sin repetición la lista se acaba; con repetir una, avanzar no cambia de pista
+static void test_repeat_modes()
+{
+  PlayOrder order;
+  order.setCount(3);
+  order.setRepeat(REPEAT_OFF);
+  order.jumpTo(2);
+  uint32_t next;
+  TEST_ASSERT_FALSE(order.advance(next));
+  order.setRepeat(REPEAT_ALL);
+  TEST_ASSERT_TRUE(order.advance(next));
+  TEST_ASSERT_EQUAL_UINT32(0, next);
+  order.setRepeat(REPEAT_ONE);
+  TEST_ASSERT_TRUE(order.advance(next));
+  TEST_ASSERT_EQUAL_UINT32(0, next);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_cycles_complete_without_repeats);
+  RUN_TEST(test_shuffle_is_uniform);
+  RUN_TEST(test_repeat_modes);
+  return UNITY_END();
+}
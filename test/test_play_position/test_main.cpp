@@ -0,0 +1,156 @@
+/*
+  Pruebas de la posición reproducida (pio test -e native)
+  La cadena de main.cpp (fundido, conversor a la frecuencia fija, DSP y cola PCM)
+  con un DMA simulado: una subida a la muestra N del decodificador, y en el
+  momento en que suena, la posición del decodificador menos lo retenido (con
+  HeldAudio, como playedSample()) vuelve a dar N. A 44.1 y 48 kHz de entrada,
+  con la salida fija a 44.1 y a 48 kHz.
+*/
+
+#include <unity.h>
+#include <stdlib.h>
+#include <deque>
+#include <vector>
+#include "AudioOutputDsp.h"
+#include "AudioOutputResample.h"
+#include "AudioOutputRing.h"
+#include "CrossfadeMixer.h"
+#include "PlaybackPosition.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint32_t marker = 30000;        // Primera muestra alta del decodificador
+static const uint32_t dmaFrames = 8 * 128;   // Lo que cabe en el DMA simulado
+static const uint32_t ringFrames = 8192;
+
+// Salida final que no hace nada: la cola se vacía a mano
+class NullOutput : public AudioOutput
+{
+  public:
+    virtual bool begin() override { return true; }
+    virtual bool ConsumeSample(int16_t sample[2]) override { (void)sample; return true; }
+};
+
+struct Result {
+  int32_t played; // Posición calculada al sonar la subida
+  int32_t naive;  // La misma sin convertir lo retenido a la frecuencia del decodificador
+};
+
+static Result run(uint32_t inRate, uint32_t outRate, bool crossfade)
+{
+  static int16_t storage[2 * ringFrames];
+  PcmRing ring(storage, ringFrames);
+  NullOutput sink;
+  AudioOutputRing ringOutput(&ring, &sink);
+  BlockDsp dsp;
+  AudioOutputDsp dspOutput(&dsp, &ringOutput);
+  AudioOutputResample resampleOutput(outRate, &dspOutput);
+  CrossfadeMixer mixer(&resampleOutput);
+  AudioOutput *head = crossfade ? mixer.input(0) : (AudioOutput *)&resampleOutput;
+  head->SetRate(inRate);
+
+  // Decodificador: bloques de 1152 tramas; 'decoded' es lo aceptado, como Position()
+  int16_t block[2 * 1152];
+  uint32_t blockLen = 0, blockPos = 0, produced = 0, decoded = 0;
+  auto decode = [&]() {
+    for (int tries = 0; tries < 4; tries++) {
+      if (blockPos == blockLen) {
+        for (uint32_t i = 0; i < 1152; i++, produced++) {
+          int16_t v = produced >= marker ? 16000 : 0;
+          block[2 * i] = block[2 * i + 1] = v;
+        }
+        blockLen = 1152;
+        blockPos = 0;
+      }
+      uint16_t k = head->ConsumeSamples(block + 2 * blockPos, blockLen - blockPos);
+      head->loop();
+      blockPos += k;
+      decoded += k;
+      if (!k) break;
+    }
+  };
+
+  std::deque<int16_t> dma;
+  auto refill = [&]() {
+    int16_t f[2];
+    while (dma.size() < dmaFrames && ring.read(f, 1)) dma.push_back(f[0]);
+  };
+
+  for (int i = 0; i < 100; i++) {
+    decode();
+    refill();
+  }
+  TEST_ASSERT_EQUAL_UINT32(dmaFrames, dma.size());
+
+  for (uint32_t n = 0; n < 4 * marker; n++) {
+    int16_t v = dma.front();
+    dma.pop_front();
+    refill();
+    decode();
+    if (v < 8000) continue;
+
+    HeldAudio held;
+    held.inputRate = inRate;
+    held.outputRate = outRate;
+    if (crossfade) held.inputFrames += mixer.heldFrames();
+    held.inputFrames += resampleOutput.heldInputFrames();
+    held.outputFrames += resampleOutput.heldOutputFrames();
+    held.outputFrames += dspOutput.heldFrames() + ring.available() + dma.size();
+    Result r;
+    r.played = (int32_t)decoded - (int32_t)held.decoderFrames();
+    r.naive = (int32_t)decoded - (int32_t)(held.inputFrames + held.outputFrames);
+    return r;
+  }
+  TEST_FAIL_MESSAGE("La subida no ha llegado a sonar");
+  return Result();
+}
+
+static void check(uint32_t inRate, uint32_t outRate, bool crossfade)
+{
+  Result r = run(inRate, outRate, crossfade);
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%u -> %u Hz%s: %d (sin convertir %d)", (unsigned)inRate, (unsigned)outRate,
+           crossfade ? " con fundido" : "", (int)r.played, (int)r.naive);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_INT_WITHIN_MESSAGE(2, (int32_t)marker, r.played, msg);
+  // Con frecuencias distintas, sumar tramas de salida como si fueran de entrada se nota
+  if (inRate != outRate) TEST_ASSERT_TRUE_MESSAGE(abs(r.naive - (int32_t)marker) > 100, msg);
+}
+
+static void test_44100_to_44100()
+{
+  check(44100, 44100, false);
+}
+
+static void test_48000_to_44100()
+{
+  check(48000, 44100, false);
+}
+
+static void test_44100_to_48000()
+{
+  check(44100, 48000, false);
+}
+
+static void test_48000_to_48000()
+{
+  check(48000, 48000, false);
+}
+
+static void test_with_crossfade_mixer()
+{
+  check(48000, 44100, true);
+  check(44100, 48000, true);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_44100_to_44100);
+  RUN_TEST(test_48000_to_44100);
+  RUN_TEST(test_44100_to_48000);
+  RUN_TEST(test_48000_to_48000);
+  RUN_TEST(test_with_crossfade_mixer);
+  return UNITY_END();
+}
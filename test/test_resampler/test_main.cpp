@@ -0,0 +1,133 @@
+/*
+  Pruebas del conversor de frecuencia (pio test -e native)
+  Las tres calidades de 48, 32 y 22.05 kHz a 44.1 kHz (y de 44.1 a 48 kHz): rizado
+  en la banda de paso, nivel de imágenes y distorsión con tonos dentro de banda y,
+  al bajar de frecuencia, lo que se pliega con tonos que no caben en la salida.
+  Los límites dejan unos dB de margen sobre lo medido; en las calidades 1 y 2 lo
+  que queda fuera del tono está en el ruido de redondeo a 16 bits (~-75 dB).
+*/
+
+#include <unity.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "Resampler.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Convierte un tono de 'freq' Hz (amplitud 16000, 0.5 s) y deja la salida en 'out'
+template <class R>
+static void resampleTone(R &r, uint32_t inRate, double freq, std::vector<int16_t> &out)
+{
+  std::vector<int16_t> in(inRate & ~1u);
+  for (size_t i = 0; i < in.size() / 2; i++) in[2 * i] = in[2 * i + 1] = (int16_t)lround(16000 * sin(2 * M_PI * freq * i / inRate));
+  r.reset();
+  out.clear();
+  int16_t block[2 * 1152];
+  size_t pos = 0;
+  while (pos < in.size() / 2) {
+    uint32_t used;
+    uint32_t n = r.process(&in[2 * pos], in.size() / 2 - pos, used, block, 1152);
+    pos += used;
+    out.insert(out.end(), block, block + 2 * n);
+  }
+}
+
+// Ajusta un seno de 'freq' Hz al canal izquierdo (sin el arranque del filtro) y
+// devuelve su nivel y el del resto de la señal, en dB respecto a la entrada
+static void measureTone(const std::vector<int16_t> &out, uint32_t rate, double freq, double &toneDb, double &restDb)
+{
+  // Mínimos cuadrados con seno y coseno: el tramo no tiene por qué ser de periodos enteros
+  size_t n = out.size() / 2, from = n / 4;
+  double ss = 0, cc = 0, sc = 0, xs = 0, xc = 0, e = 0;
+  for (size_t i = from; i < n; i++) {
+    double ph = 2 * M_PI * freq * i / rate;
+    double si = sin(ph), co = cos(ph), x = out[2 * i];
+    ss += si * si; cc += co * co; sc += si * co;
+    xs += x * si; xc += x * co;
+    e += x * x;
+  }
+  double det = ss * cc - sc * sc;
+  double a = (xs * cc - xc * sc) / det;
+  double b = (xc * ss - xs * sc) / det;
+  double rest = (e - a * xs - b * xc) / (n - from); // Energía que el seno no explica
+  toneDb = 10 * log10((a * a + b * b) / (16000.0 * 16000));
+  restDb = 10 * log10((rest > 1e-3 ? rest : 1e-3) / (16000.0 * 16000 / 2));
+}
+
+// 'maxRipple' en dB de pico a pico; 'maxRest' y 'maxAlias' en dB respecto al tono
+template <class R>
+static void checkQuality(const char *name, double maxRipple, double maxRest, double maxAlias)
+{
+  static R r;
+  const uint32_t rates[][2] = { { 48000, 44100 }, { 32000, 44100 }, { 22050, 44100 }, { 44100, 48000 } };
+  std::vector<int16_t> out;
+  for (const auto &rate : rates) {
+    uint32_t inRate = rate[0], outRate = rate[1];
+    TEST_ASSERT_TRUE(r.setRates(inRate, outRate));
+    double nyquist = std::min(inRate, outRate) / 2.0;
+
+    // Banda de paso: rizado del tono y peor nivel de lo que no es el tono
+    double lo = 1e9, hi = -1e9, worstRest = -200;
+    for (double f = 50; f < R::passbandEdge() * nyquist; f *= 1.15) {
+      double tone, rest;
+      resampleTone(r, inRate, f, out);
+      measureTone(out, outRate, f, tone, rest);
+      lo = std::min(lo, tone);
+      hi = std::max(hi, tone);
+      worstRest = std::max(worstRest, rest);
+    }
+
+    // Al bajar de frecuencia, tonos de la banda atenuada: todo lo que sale es plegado
+    double worstAlias = -200;
+    for (double f = R::stopbandEdge() * outRate / 2; inRate > outRate && f < 0.98 * inRate / 2; f += 250) {
+      double tone, rest;
+      resampleTone(r, inRate, f, out);
+      measureTone(out, outRate, f, tone, rest);
+      worstAlias = std::max(worstAlias, rest);
+    }
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%s %u->%u: rizado %.3f dB, imágenes %.1f dB, plegado %.1f dB", name,
+             (unsigned)inRate, (unsigned)outRate, hi - lo, worstRest, worstAlias);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE_MESSAGE(hi - lo <= maxRipple, msg);
+    TEST_ASSERT_TRUE_MESSAGE(worstRest <= maxRest, msg);
+    TEST_ASSERT_TRUE_MESSAGE(worstAlias <= maxAlias, msg);
+  }
+}
+
+static void test_quality_0()
+{
+  checkQuality<ResamplerQ0>("calidad 0", 0.2, -50, -45);
+}
+
+static void test_quality_1()
+{
+  checkQuality<ResamplerQ1>("calidad 1", 0.01, -68, -65);
+}
+
+static void test_quality_2()
+{
+  checkQuality<ResamplerQ2>("calidad 2", 0.01, -68, -70);
+}
+
+// Con la misma frecuencia no hace falta convertir
+static void test_same_rate_is_passthrough()
+{
+  ResamplerQ1 r;
+  TEST_ASSERT_TRUE(r.setRates(44100, 44100));
+  TEST_ASSERT_TRUE(r.passthrough());
+  TEST_ASSERT_FALSE(r.setRates(0, 44100));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_quality_0);
+  RUN_TEST(test_quality_1);
+  RUN_TEST(test_quality_2);
+  RUN_TEST(test_same_rate_is_passthrough);
+  return UNITY_END();
+}
@@ -0,0 +1,221 @@
+/*
+  Pruebas de AudioSlotPool (pio test -e native)
+  10000 cambios de pista como los hace prefetchNext(): coger un hueco libre, abrir
+  el fichero con lectura anticipada, leer la cabecera Xing, arrancar el
+  decodificador, decodificar la pista entera (tramas Layer III de verdad, mudas) y
+  soltar el hueco de la pista anterior.
+
+  Se cuenta todo lo que pasa por malloc/calloc/realloc/free (glibc), que es lo
+  que usan ESP8266Audio y libmad (main_data y overlap en III_decode) y también
+  new. Lo que piden begin(), loop() y stop() del decodificador se cuenta aparte:
+  con la memoria preasignada es nada, y sin ella (la prueba de control) no.
+  Además, tras los primeros cambios ni el máximo ni lo vivo vuelven a moverse.
+*/
+
+#include <unity.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include "AudioSlotPool.h"
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static std::atomic<size_t> liveBytes(0), peakBytes(0);
+static std::atomic<uint32_t> decoderAllocs(0);
+static thread_local bool inDecoder = false; // Solo lo que pide el decodificador desde este hilo
+
+static void *counted(void *p)
+{
+  if (!p) return p;
+  size_t now = liveBytes += malloc_usable_size(p);
+  size_t peak = peakBytes.load();
+  while (now > peak && !peakBytes.compare_exchange_weak(peak, now)) {}
+  if (inDecoder) decoderAllocs++;
+  return p;
+}
+
+extern "C" void *malloc(size_t size)
+{
+  return counted(__libc_malloc(size));
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+  return counted(__libc_calloc(n, size));
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+  if (ptr) liveBytes -= malloc_usable_size(ptr);
+  return counted(__libc_realloc(ptr, size));
+}
+
+extern "C" void free(void *ptr)
+{
+  if (!ptr) return;
+  liveBytes -= malloc_usable_size(ptr);
+  __libc_free(ptr);
+}
+
+// Salida que lo descarta todo y cuenta las tramas
+class NullOutput : public AudioOutput
+{
+  public:
+    uint32_t frames = 0;
+
+    virtual bool begin() override { return true; }
+    virtual bool ConsumeSample(int16_t sample[2]) override
+    {
+      (void)sample;
+      frames++;
+      return true;
+    }
+};
+
+static std::string root;
+static const int tracks = 8;
+
+void setUp() {}
+void tearDown() {}
+
+// Pistas de prueba: ID3v2 de tamaño distinto en cada una, una trama Info con LAME y tramas mudas
+static void makeTracks()
+{
+  char dir[] = "/tmp/slotpoolXXXXXX";
+  TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+  root = dir;
+  SD.setRoot(dir);
+  static const uint8_t hdr[4] = { 0xFF, 0xFB, 0x90, 0x64 }; // MPEG-1 L3, 128 kbps, 44.1 kHz, estéreo
+  for (int t = 0; t < tracks; t++) {
+    char name[16];
+    snprintf(name, sizeof(name), "/%d.mp3", t);
+    File f = SD.open(name, FILE_WRITE);
+    TEST_ASSERT_TRUE(f);
+    uint32_t tag = 1000 * t;
+    uint8_t id3[10] = { 'I', 'D', '3', 3, 0, 0, 0, 0, (uint8_t)(tag >> 7), (uint8_t)(tag & 0x7F) };
+    f.write(id3, 10);
+    for (uint32_t i = 0; i < tag; i++) f.write((uint8_t)0);
+    for (int n = 0; n < 60; n++) {
+      uint8_t frame[417] = { 0 };
+      memcpy(frame, hdr, 4);
+      if (n == 0) {
+        memcpy(frame + 36, "Info", 4);
+        frame[39 + 4] = 0x0F; // Tramas, bytes, TOC y calidad
+        frame[40 + 4 + 3] = 59;
+        memcpy(frame + 36 + 120, "LAME3.100", 9);
+        frame[36 + 120 + 21] = 0x24; // Retardo 576, relleno 1000
+        frame[36 + 120 + 22] = 0x03;
+        frame[36 + 120 + 23] = 0xE8;
+      }
+      f.write(frame, sizeof(frame));
+    }
+    f.close();
+  }
+}
+
+static void removeTracks()
+{
+  for (int t = 0; t < tracks; t++) {
+    char name[16];
+    snprintf(name, sizeof(name), "/%d.mp3", t);
+    SD.remove(name);
+  }
+  rmdir(root.c_str());
+}
+
+static AudioSlotPool<2> pool;
+static NullOutput out;
+
+// Lo mismo que prefetchNext() + switchToNextSlot(): prepara la siguiente y suelta la actual
+static AudioSlot *switchTrack(AudioSlot *current, int n)
+{
+  AudioSlot *slot = pool.acquire();
+  TEST_ASSERT_NOT_NULL(slot);
+  char name[16];
+  snprintf(name, sizeof(name), "/%d.mp3", n % tracks);
+  TEST_ASSERT_TRUE(slot->source.open(name));
+  TEST_ASSERT_TRUE(readXingInfo(&slot->source, slot->info));
+  TEST_ASSERT_TRUE(slot->info.hasLame);
+  slot->source.seek(slot->info.firstFramePos, SEEK_SET);
+  uint32_t skip, length;
+  gaplessTrim(slot->info, skip, length);
+  slot->decoder.SetTrim(skip, length);
+  out.frames = 0;
+  inDecoder = true;
+  TEST_ASSERT_TRUE(slot->decoder.begin(&slot->source, &out));
+  while (slot->decoder.loop()) {}
+  pool.release(current);
+  inDecoder = false;
+  // La pista entera, recortada (libmad puede dejar la última trama sin el guarda del final)
+  TEST_ASSERT_UINT32_WITHIN(AudioDecoder::blockFrames, length, out.frames);
+  return slot;
+}
+
+static void test_heap_is_flat_over_10000_switches()
+{
+  makeTracks();
+  AudioSlot *current = nullptr;
+  for (int n = 0; n < 100; n++) current = switchTrack(current, n);
+  size_t warmPeak = peakBytes, warmLive = liveBytes;
+  for (int n = 100; n < 10000; n++) current = switchTrack(current, n);
+  size_t endLive = liveBytes;
+  pool.release(current);
+  char msg[128];
+  snprintf(msg, sizeof(msg), "máximo %u -> %u bytes, vivos %u -> %u, %u reservas del decodificador",
+           (unsigned)warmPeak, (unsigned)peakBytes.load(), (unsigned)warmLive, (unsigned)endLive,
+           (unsigned)decoderAllocs.load());
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL_UINT32(0, decoderAllocs.load());
+  TEST_ASSERT_EQUAL_UINT32(warmPeak, peakBytes.load());
+  TEST_ASSERT_EQUAL_UINT32(warmLive, endLive);
+  removeTracks();
+}
+
+// Control: el mismo decodificador sin memoria preasignada reserva en cada pista, y se ve
+static void test_unpreallocated_decoder_allocates()
+{
+  makeTracks();
+  AudioSlotSource source;
+  AudioDecoder decoder;
+  for (int n = 0; n < 3; n++) {
+    TEST_ASSERT_TRUE(source.open("/1.mp3"));
+    uint32_t before = decoderAllocs;
+    out.frames = 0;
+    inDecoder = true;
+    TEST_ASSERT_TRUE(decoder.begin(&source, &out));
+    while (decoder.loop()) {}
+    decoder.stop();
+    inDecoder = false;
+    TEST_ASSERT_TRUE(out.frames > 0);
+    TEST_ASSERT_TRUE(decoderAllocs > before);
+    source.close();
+  }
+  removeTracks();
+}
+
+static void test_pool_exhaustion()
+{
+  AudioSlotPool<2> p;
+  AudioSlot *a = p.acquire(), *b = p.acquire();
+  TEST_ASSERT_NOT_NULL(a);
+  TEST_ASSERT_NOT_NULL(b);
+  TEST_ASSERT_NULL(p.acquire());
+  p.release(a);
+  TEST_ASSERT_TRUE(p.acquire() == a);
+  TEST_ASSERT_EQUAL(1, p.indexOf(b));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  AudioFileSourceSDReadAhead::begin();
+  RUN_TEST(test_heap_is_flat_over_10000_switches);
+  RUN_TEST(test_unpreallocated_decoder_allocates);
+  RUN_TEST(test_pool_exhaustion);
+  return UNITY_END();
+}
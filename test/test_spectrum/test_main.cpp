@@ -0,0 +1,140 @@
+/*
+  Pruebas de SpectrumAnalyzer (pio test -e native)
+  A 44.1 y 48 kHz: senos a 0 y -30 dBFS en el centro de cada banda de al menos
+  5 bins (+/- 1 dB en su banda, 35 dB menos en las no vecinas), el vúmetro con
+  un solo canal, y la caída de barras y picos al parar.
+*/
+
+#include <unity.h>
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+#include "SpectrumAnalyzer.h"
+
+void setUp() {}
+void tearDown() {}
+
+static SpectrumAnalyzer sa;
+static const uint16_t fft = 512;
+static const uint8_t bands = 24;
+
+// Seno a 'db' dBFS en los canales elegidos durante 'ms', con un fotograma cada 'frameMs'
+static void tone(uint32_t rate, double freq, double db, uint32_t ms, uint32_t frameMs, bool left = true,
+                 bool right = true)
+{
+  static uint64_t n = 0;
+  double amp = 32767.0 * pow(10.0, db / 20.0);
+  uint32_t per = rate * frameMs / 1000;
+  std::vector<int16_t> pcm(2 * per);
+  for (uint32_t t = 0; t < ms; t += frameMs) {
+    for (uint32_t i = 0; i < per; i++, n++) {
+      int16_t v = (int16_t)lrint(amp * sin(2.0 * M_PI * freq * n / rate));
+      pcm[2 * i] = left ? v : 0;
+      pcm[2 * i + 1] = right ? v : 0;
+    }
+    sa.feed(pcm.data(), per);
+    sa.analyze(frameMs);
+  }
+}
+
+static void reset(uint32_t rate)
+{
+  TEST_ASSERT_TRUE(sa.begin(fft, bands));
+  sa.setRate(rate);
+  sa.analyze(0); // Calcula los bordes de las bandas
+}
+
+static void checkBands(uint32_t rate)
+{
+  reset(rate);
+  int checked = 0;
+  for (uint8_t b = 0; b < bands; b++) {
+    uint32_t lo = sa.edgeHz(b) * fft / rate, hi = sa.edgeHz(b + 1) * fft / rate;
+    if (hi - lo < 5) continue;
+    double freq = (double)(lo + hi) / 2 * rate / fft;
+    for (double db : { 0.0, -30.0 }) {
+      reset(rate);
+      tone(rate, freq, db, 200, 40);
+      char msg[96];
+      snprintf(msg, sizeof(msg), "%u Hz, banda %u, %.0f Hz a %.0f dBFS: %.1f dB", (unsigned)rate, b, freq, db,
+               sa.level(b) / 10.0);
+      TEST_ASSERT_INT_WITHIN_MESSAGE(10, (int)(db * 10), sa.level(b), msg);
+      for (uint8_t o = 0; o < bands; o++) {
+        if (o + 1 >= b && o <= b + 1) continue;
+        if (sa.level(o) == SpectrumAnalyzer::bottom()) continue; // Por debajo de lo que se ve
+        TEST_ASSERT_TRUE_MESSAGE(sa.level(o) - (int)(db * 10) <= -350, msg);
+      }
+      checked++;
+    }
+  }
+  TEST_ASSERT_TRUE(checked > 10);
+}
+
+static void test_bands_at_44100()
+{
+  checkBands(44100);
+}
+
+static void test_bands_at_48000()
+{
+  checkBands(48000);
+}
+
+// Seno a plena escala solo en el canal izquierdo
+static void test_vu_meter_per_channel()
+{
+  for (uint32_t rate : { 44100u, 48000u }) {
+    reset(rate);
+    tone(rate, 1000.0, 0.0, 200, 40, true, false);
+    TEST_ASSERT_INT_WITHIN(10, 0, sa.vu(0));
+    TEST_ASSERT_INT_WITHIN(10, 0, sa.vuPeak(0));
+    TEST_ASSERT_EQUAL_INT(SpectrumAnalyzer::bottom(), sa.vu(1));
+  }
+}
+
+// 500 ms de seno y después nada (pausa): la barra cae a SPECTRUM_FALL_DB_S, el pico se
+// queda SPECTRUM_PEAK_HOLD_MS y todo llega abajo cuando toca
+static void test_bars_and_peaks_fall_when_stopped()
+{
+  reset(44100);
+  tone(44100, 1000.0, 0.0, 520, 40);
+  int band = 0;
+  for (uint8_t b = 0; b < bands; b++) {
+    if (sa.level(b) > sa.level(band)) band = b;
+  }
+  int16_t top = sa.level(band);
+  uint32_t idleMs = 0;
+  bool fresh = false;
+  for (uint32_t t = 40; t <= 6000 && !idleMs; t += 40) {
+    fresh |= sa.analyze(40);
+    if (t == 400) {
+      TEST_ASSERT_INT_WITHIN(20, SPECTRUM_FALL_DB_S * 4, top - sa.level(band));
+      TEST_ASSERT_EQUAL_INT(top, sa.peak(band));
+    }
+    if (sa.idle()) idleMs = t;
+  }
+  uint32_t expect = SPECTRUM_PEAK_HOLD_MS + (uint32_t)(top - SpectrumAnalyzer::bottom()) * 100 / SPECTRUM_PEAK_FALL_DB_S;
+  TEST_ASSERT_FALSE(fresh);
+  TEST_ASSERT_TRUE(idleMs > 0);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(expect + 200, idleMs);
+}
+
+static void test_rejects_bad_sizes()
+{
+  SpectrumAnalyzer bad;
+  TEST_ASSERT_FALSE(bad.begin(500, 24));
+  TEST_ASSERT_FALSE(bad.begin(64, 32));
+  TEST_ASSERT_FALSE(bad.begin(2048, 24));
+  TEST_ASSERT_FALSE(bad.ready());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_bands_at_44100);
+  RUN_TEST(test_bands_at_48000);
+  RUN_TEST(test_vu_meter_per_channel);
+  RUN_TEST(test_bars_and_peaks_fall_when_stopped);
+  RUN_TEST(test_rejects_bad_sizes);
+  return UNITY_END();
+}
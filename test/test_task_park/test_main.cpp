@@ -0,0 +1,156 @@
+/*
+  Pruebas de TaskPark (pio test -e native)
+  Un productor y un consumidor de PcmRing con su checkpoint() en cada vuelta,
+  como las tareas de audio, y el hilo principal cambiando el tamaño de la cola
+  con las dos paradas, como loop(): todas las tramas llegan en orden. Si una
+  tarea no llega a pararse, park() se rinde y la suelta; y una tarea puede
+  pedir la parada ella misma, sin que otro cambio entretanto la suelte.
+*/
+
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "PcmRing.h"
+#include "TaskPark.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint8_t producerBit = 0x01, consumerBit = 0x02;
+static const uint32_t total = 10000000;
+
+static void producer(PcmRing &ring, TaskPark &park)
+{
+  int16_t block[2 * 512];
+  uint32_t n = 0;
+  while (n < total) {
+    park.checkpoint(producerBit);
+    uint32_t want = 1 + n % 511;
+    if (want > total - n) want = total - n;
+    for (uint32_t i = 0; i < want; i++) {
+      block[2 * i] = (int16_t)(n + i);
+      block[2 * i + 1] = (int16_t)~(n + i);
+    }
+    uint32_t k = ring.write(block, want);
+    n += k;
+    if (!k) std::this_thread::yield();
+  }
+}
+
+static void consumer(PcmRing &ring, TaskPark &park, std::atomic<uint32_t> &errors, std::atomic<bool> &done)
+{
+  int16_t block[2 * 300];
+  uint32_t n = 0;
+  while (n < total) {
+    park.checkpoint(consumerBit);
+    uint32_t got = ring.read(block, 1 + n % 300);
+    for (uint32_t i = 0; i < got; i++, n++) {
+      if (block[2 * i] != (int16_t)n || block[2 * i + 1] != (int16_t)~n) errors++;
+    }
+    if (!got) std::this_thread::yield();
+  }
+  done = true;
+}
+
+// Crece y encoge la cola en marcha; al encoger, primero se limita y se espera a que quepa
+static void test_resize_while_running()
+{
+  PcmRing ring(nullptr, 0);
+  TaskPark park;
+  ring.resize(new int16_t[2 * 1024], 1024);
+  std::atomic<uint32_t> errors{0};
+  std::atomic<bool> done{false};
+  std::thread p(producer, std::ref(ring), std::ref(park));
+  std::thread c(consumer, std::ref(ring), std::ref(park), std::ref(errors), std::ref(done));
+
+  uint32_t sizes[] = { 4096, 2048, 16384, 1024, 8192, 2048 };
+  uint32_t resizes = 0;
+  for (uint32_t i = 0; !done; i++) {
+    uint32_t frames = sizes[i % 6];
+    if (frames < ring.capacity()) {
+      ring.setLimit(frames);
+      while (ring.available() > frames && !done) std::this_thread::yield();
+    }
+    int16_t *storage = new int16_t[2 * frames];
+    if (!park.park(producerBit | consumerBit, 1000)) {
+      delete[] storage;
+      continue;
+    }
+    delete[] ring.resize(storage, frames);
+    park.release();
+    resizes++;
+  }
+  p.join();
+  c.join();
+  char msg[64];
+  snprintf(msg, sizeof(msg), "%u cambios de tamaño", (unsigned)resizes);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(resizes > 10);
+  TEST_ASSERT_EQUAL_UINT32(0, errors.load());
+  TEST_ASSERT_EQUAL_UINT32(0, ring.available());
+  delete[] ring.resize(nullptr, 0);
+}
+
+// Solo una de las dos pasa por checkpoint(): park() se rinde y la deja seguir
+static void test_park_times_out()
+{
+  TaskPark park;
+  std::atomic<bool> stop{false};
+  std::atomic<uint32_t> turns{0};
+  std::thread t([&]() {
+    while (!stop) {
+      park.checkpoint(producerBit);
+      turns++;
+      vTaskDelay(1);
+    }
+  });
+  TEST_ASSERT_FALSE(park.park(producerBit | consumerBit, 50));
+  TEST_ASSERT_FALSE(park.requested());
+  uint32_t before = turns;
+  vTaskDelay(20);
+  TEST_ASSERT_TRUE(turns > before);
+  stop = true;
+  t.join();
+}
+
+// La tarea pide la parada con hold() y se queda en su checkpoint() hasta que el otro lado la
+// atiende; otro park()/release() entretanto no la suelta
+static void test_task_holds_itself()
+{
+  TaskPark park;
+  std::atomic<bool> stop{false}, asked{false};
+  std::atomic<uint32_t> turns{0};
+  std::thread t([&]() {
+    while (!stop) {
+      park.checkpoint(consumerBit);
+      turns++;
+      if (!asked.exchange(true)) park.hold();
+      vTaskDelay(1);
+    }
+  });
+  while (!park.requested()) vTaskDelay(1);
+  TEST_ASSERT_TRUE(park.park(consumerBit, 1000));
+  uint32_t held = turns;
+  park.release();
+  vTaskDelay(20);
+  TEST_ASSERT_EQUAL_UINT32(held, turns.load());
+
+  TEST_ASSERT_TRUE(park.takeHold());
+  TEST_ASSERT_FALSE(park.takeHold());
+  TEST_ASSERT_TRUE(park.park(consumerBit, 1000));
+  park.release();
+  vTaskDelay(20);
+  TEST_ASSERT_TRUE(turns > held);
+  TEST_ASSERT_FALSE(park.requested());
+  stop = true;
+  t.join();
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_resize_while_running);
+  RUN_TEST(test_park_times_out);
+  RUN_TEST(test_task_holds_itself);
+  return UNITY_END();
+}